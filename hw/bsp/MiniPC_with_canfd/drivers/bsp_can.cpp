@@ -6,10 +6,17 @@
 #include <array>
 
 #include "bsp_def.h"
+#include "bsp_time.h"
 #include "bsp_uart.h"
 
 #define CRC8_INIT 0Xff
 
+/* 单次从串口读取的最大长度 */
+#define UART_RX_CHUNK_SIZE (4096)
+
+/* 回放测试默认循环次数 */
+#define UART_REPLAY_DEFAULT_LOOP (100)
+
 typedef struct __attribute__((packed)) {
   uint8_t prefix;
   uint8_t id;
@@ -20,6 +27,15 @@ typedef struct __attribute__((packed)) {
   uint8_t crc8;
 } UartDataHeader;
 
+/* 帧头 + 最大数据长度 + 帧尾crc8 */
+#define UART_FRAME_MAX_SIZE (sizeof(UartDataHeader) + 63 + 1)
+
+/* 接收缓冲区，保留上一次读取中不完整的帧 */
+#define UART_RX_BUFF_SIZE (UART_RX_CHUNK_SIZE + UART_FRAME_MAX_SIZE)
+
+/* 一次解析最多得到的帧数 */
+#define UART_RX_BATCH_NUM (UART_RX_BUFF_SIZE / (sizeof(UartDataHeader) + 1))
+
 enum { BSP_CAN_UART1, BSP_CAN_UART2, BSP_CAN_UART_NUM };
 
 typedef struct {
@@ -27,6 +43,16 @@ typedef struct {
   void *arg;
 } can_callback_t;
 
+typedef struct {
+  uint8_t buff[UART_RX_BUFF_SIZE];
+  size_t size;
+  const uint8_t *batch[UART_RX_BATCH_NUM];
+  FILE *capture;
+  uint64_t byte_count;
+  uint32_t frame_count;
+  uint32_t crc_error;
+} uart_rx_stream_t;
+
 static const std::array<uint8_t, 256> CRC8_TAB = {
     0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83, 0xc2, 0x9c, 0x7e, 0x20,
     0xa3, 0xfd, 0x1f, 0x41, 0x9d, 0xc3, 0x21, 0x7f, 0xfc, 0xa2, 0x40, 0x1e,
@@ -70,9 +96,12 @@ bool verify(const uint8_t *buf, size_t len) {
 
 static can_callback_t callback_list[BSP_CAN_NUM][BSP_CAN_CB_NUM];
 
-static uint8_t uart_rx_buff[64][BSP_CAN_UART_NUM];
+/* 正在分发的帧的ID格式 */
+static bsp_can_format_t rx_format[BSP_CAN_NUM];
 
-static uint8_t uart_tx_buff[128][BSP_CAN_UART_NUM];
+static uart_rx_stream_t uart_rx_stream[BSP_CAN_UART_NUM];
+
+static uint8_t uart_tx_buff[BSP_CAN_UART_NUM][128];
 
 static pthread_mutex_t tx_mutex[BSP_CAN_UART_NUM] = {PTHREAD_MUTEX_INITIALIZER,
                                                      PTHREAD_MUTEX_INITIALIZER};
@@ -91,64 +120,202 @@ inline bsp_uart_t bsp_can_get_uart(bsp_can_t can) {
 
 inline uint8_t bsp_can_get_id(bsp_can_t can) { return can % 2; }
 
-void bsp_can_init(void) {
-  auto uart_rx_thread_fn = [](void *arg) {
-    bsp_uart_t uart = *static_cast<bsp_uart_t *>(arg);
+/* 从缓冲区中解析出所有完整的帧，返回帧数，pos指向第一个未解析的字节 */
+static size_t uart_stream_decode(uart_rx_stream_t *stream,
+                                 const uint8_t **pos) {
+  const uint8_t *index = stream->buff;
+  const uint8_t *end = stream->buff + stream->size;
+  size_t batch_num = 0;
+
+  while (static_cast<size_t>(end - index) >= sizeof(UartDataHeader)) {
+    if (*index != 0xa5) {
+      index = static_cast<const uint8_t *>(memchr(index, 0xa5, end - index));
+      if (index == NULL) {
+        index = end;
+      }
+      continue;
+    }
 
-    while (true) {
-      auto index = uart_rx_buff[uart];
-      do {
-        bsp_uart_receive(uart, uart_rx_buff[uart], sizeof(uint8_t), true);
-      } while (*uart_rx_buff[uart] != 0xa5);
+    if (!verify(index, sizeof(UartDataHeader))) {
+      stream->crc_error++;
+      index++;
+      continue;
+    }
+
+    auto header = reinterpret_cast<const UartDataHeader *>(index);
+    size_t frame_size = sizeof(UartDataHeader) + header->data_len + 1;
+
+    if (static_cast<size_t>(end - index) < frame_size) {
+      break;
+    }
 
+    if (!verify(index, frame_size)) {
+      stream->crc_error++;
       index++;
+      continue;
+    }
 
-      bsp_uart_receive(uart, index, sizeof(UartDataHeader) - 1, true);
-      index += sizeof(UartDataHeader) - 1;
+    stream->batch[batch_num++] = index;
+    index += frame_size;
+  }
 
-      if (!verify(uart_rx_buff[uart], sizeof(UartDataHeader))) {
-        continue;
+  *pos = index;
+
+  return batch_num;
+}
+
+static void uart_stream_dispatch(bsp_uart_t uart, uart_rx_stream_t *stream,
+                                 size_t batch_num) {
+  for (size_t i = 0; i < batch_num; i++) {
+    auto header = reinterpret_cast<const UartDataHeader *>(stream->batch[i]);
+    auto data =
+        const_cast<uint8_t *>(stream->batch[i]) + sizeof(UartDataHeader);
+    auto can = bsp_can_get(uart, header->id);
+
+    if (can >= BSP_CAN_NUM) {
+      continue;
+    }
+
+    rx_format[can] = header->ext ? CAN_FORMAT_EXT : CAN_FORMAT_STD;
+
+    if (header->fd) {
+      auto &cb = callback_list[can][CANFD_RX_MSG_CALLBACK];
+      if (cb.fn) {
+        bsp_canfd_data_t fd_data = {.size = header->data_len, .data = data};
+        cb.fn(can, header->index, reinterpret_cast<uint8_t *>(&fd_data),
+              cb.arg);
+      }
+    } else {
+      auto &cb = callback_list[can][CAN_RX_MSG_CALLBACK];
+      if (cb.fn) {
+        cb.fn(can, header->index, data, cb.arg);
       }
+    }
+  }
 
-      auto header = reinterpret_cast<UartDataHeader *>(uart_rx_buff[uart]);
+  stream->frame_count += batch_num;
+}
+
+/* 解析并分发缓冲区中的帧，将不完整的帧移动到缓冲区头部 */
+static void uart_stream_process(bsp_uart_t uart, uart_rx_stream_t *stream) {
+  const uint8_t *pos = NULL;
 
-      bsp_uart_receive(uart, index, header->data_len + 1, true);
+  size_t batch_num = uart_stream_decode(stream, &pos);
 
-      if (!verify(uart_rx_buff[uart],
-                  sizeof(UartDataHeader) + header->data_len + 1)) {
+  uart_stream_dispatch(uart, stream, batch_num);
+
+  stream->size = stream->buff + stream->size - pos;
+  memmove(stream->buff, pos, stream->size);
+}
+
+/* 读取XROBOT_CAN_REPLAY指定的数据，代替串口输入测试解析吞吐量 */
+static void *uart_replay_thread_fn(void *arg) {
+  const char *path = static_cast<const char *>(arg);
+
+  FILE *fd = fopen(path, "rb");
+  if (fd == NULL) {
+    printf("can replay: open %s failed.\r\n", path);
+    return static_cast<void *>(0);
+  }
+
+  static_cast<void>(fseek(fd, 0, SEEK_END));
+  size_t size = ftell(fd);
+  static_cast<void>(fseek(fd, 0, SEEK_SET));
+
+  auto data = static_cast<uint8_t *>(malloc(size));
+  size = fread(data, 1, size, fd);
+  static_cast<void>(fclose(fd));
+
+  const char *loop_str = getenv("XROBOT_CAN_REPLAY_LOOP");
+  uint32_t loop =
+      loop_str ? strtoul(loop_str, NULL, 10) : UART_REPLAY_DEFAULT_LOOP;
+
+  auto uart = static_cast<bsp_uart_t>(BSP_CAN_UART1);
+  auto stream = &uart_rx_stream[uart];
+
+  uint64_t time = bsp_time_get_us();
+
+  for (uint32_t i = 0; i < loop; i++) {
+    for (size_t offset = 0; offset < size; offset += UART_RX_CHUNK_SIZE) {
+      size_t len = size - offset;
+      if (len > UART_RX_CHUNK_SIZE) {
+        len = UART_RX_CHUNK_SIZE;
+      }
+      memcpy(stream->buff + stream->size, data + offset, len);
+      stream->size += len;
+      stream->byte_count += len;
+      uart_stream_process(uart, stream);
+    }
+  }
+
+  time = bsp_time_get_us() - time;
+
+  free(data);
+
+  if (time == 0) {
+    time = 1;
+  }
+
+  printf(
+      "can replay: %zu bytes x %u, %u frames, %u crc errors, %.3f ms\r\n"
+      "\t%.0f frames/s, %.2f MB/s\r\n",
+      size, loop, stream->frame_count, stream->crc_error,
+      static_cast<double>(time) / 1000.0,
+      static_cast<double>(stream->frame_count) * 1000000.0 /
+          static_cast<double>(time),
+      static_cast<double>(stream->byte_count) / static_cast<double>(time));
+
+  return static_cast<void *>(0);
+}
+
+void bsp_can_init(void) {
+  auto uart_rx_thread_fn = [](void *arg) {
+    bsp_uart_t uart = *static_cast<bsp_uart_t *>(arg);
+    auto stream = &uart_rx_stream[uart];
+
+    while (true) {
+      size_t len = bsp_uart_receive_burst(uart, stream->buff + stream->size,
+                                          UART_RX_CHUNK_SIZE);
+      if (len == 0) {
         continue;
       }
 
-      if (header->fd) {
-        if (callback_list[bsp_can_get(uart, header->id)][CANFD_RX_MSG_CALLBACK]
-                .fn) {
-          bsp_canfd_data_t data = {.size = header->data_len, .data = index};
-          callback_list[bsp_can_get(uart, header->id)][CANFD_RX_MSG_CALLBACK]
-              .fn(bsp_can_get(uart, header->id), header->index,
-                  reinterpret_cast<uint8_t *>(&data),
-                  callback_list[bsp_can_get(uart, header->id)]
-                               [CANFD_RX_MSG_CALLBACK]
-                                   .arg);
-        } else {
-          if (callback_list[bsp_can_get(uart, header->id)][CAN_RX_MSG_CALLBACK]
-                  .fn) {
-            callback_list[bsp_can_get(uart, header->id)][CAN_RX_MSG_CALLBACK]
-                .fn(bsp_can_get(uart, header->id), header->index, index,
-                    callback_list[bsp_can_get(uart, header->id)]
-                                 [CAN_RX_MSG_CALLBACK]
-                                     .arg);
-          }
-        }
+      if (stream->capture) {
+        static_cast<void>(
+            fwrite(stream->buff + stream->size, 1, len, stream->capture));
       }
+
+      stream->size += len;
+      stream->byte_count += len;
+
+      uart_stream_process(uart, stream);
     }
 
     return static_cast<void *>(0);
   };
 
+  static pthread_t replay_thread;
+
+  const char *replay_path = getenv("XROBOT_CAN_REPLAY");
+  if (replay_path) {
+    pthread_create(&replay_thread, NULL, uart_replay_thread_fn,
+                   const_cast<char *>(replay_path));
+    return;
+  }
+
+  /* 将串口原始数据保存到XROBOT_CAN_CAPTURE.[串口号]，用于回放测试 */
+  const char *capture_path = getenv("XROBOT_CAN_CAPTURE");
+
   static bsp_uart_t uart[BSP_CAN_UART_NUM];
   static pthread_t thread[BSP_CAN_UART_NUM];
 
   for (int i = 0; i < BSP_CAN_UART_NUM; i++) {
+    if (capture_path) {
+      char path[256];
+      static_cast<void>(snprintf(path, sizeof(path), "%s.%d", capture_path, i));
+      uart_rx_stream[i].capture = fopen(path, "wb");
+    }
+
     uart[i] = static_cast<bsp_uart_t>(i);
     pthread_create(&thread[i], NULL, uart_rx_thread_fn, &uart[i]);
   }
@@ -166,6 +333,8 @@ bsp_status_t bsp_can_register_callback(
   return BSP_OK;
 };
 
+bsp_can_format_t bsp_can_get_rx_format(bsp_can_t can) { return rx_format[can]; }
+
 bsp_status_t bsp_can_trans_packet(bsp_can_t can, bsp_can_format_t format,
                                   uint32_t id, uint8_t *data) {
   auto uart = bsp_can_get_uart(can);
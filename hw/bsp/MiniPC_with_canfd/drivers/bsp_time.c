@@ -1,25 +1,36 @@
 #include "bsp_time.h"
 
-#include <sys/time.h>
+#include <errno.h>
+#include <time.h>
 
-static struct timeval start_time;
+/* 基于CLOCK_MONOTONIC，不受NTP校时影响，经vDSO读取无需系统调用 */
+static uint64_t start_time;
 
-void bsp_time_init() { gettimeofday(&start_time, NULL); }
+static uint64_t bsp_time_get_raw_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+void bsp_time_init() { start_time = bsp_time_get_raw_ns(); }
 
 uint32_t bsp_time_get_ms() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return ((tv.tv_sec - start_time.tv_sec) * 1000 +
-          (tv.tv_usec - start_time.tv_usec) / 1000) %
-         UINT32_MAX;
+  return (uint32_t)(bsp_time_get_ns() / 1000000);
 }
 
-uint64_t bsp_time_get_us() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return ((tv.tv_sec - start_time.tv_sec) * 1000000 +
-          (tv.tv_usec - start_time.tv_usec)) %
-         UINT32_MAX;
-}
+uint64_t bsp_time_get_us() { return bsp_time_get_ns() / 1000; }
+
+uint64_t bsp_time_get_ns() { return bsp_time_get_raw_ns() - start_time; }
 
 uint64_t bsp_time_get() __attribute__((alias("bsp_time_get_us")));
+
+void bsp_time_sleep_until_ns(uint64_t time) {
+  time += start_time;
+
+  struct timespec ts;
+  ts.tv_sec = (time_t)(time / 1000000000);
+  ts.tv_nsec = (long)(time % 1000000000);
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+}
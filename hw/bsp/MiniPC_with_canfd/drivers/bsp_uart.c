@@ -227,6 +227,21 @@ rework:
   return true;
 }
 
+size_t bsp_uart_receive_burst(bsp_uart_t uart, uint8_t *buff, size_t size) {
+  if (!uart_block[uart]) {
+    fcntl(uart_fd[uart], F_SETFL, 0);
+    uart_block[uart] = true;
+  }
+
+  rx_count[uart] = read(uart_fd[uart], buff, size);
+
+  if (rx_count[uart] < 0) {
+    rx_count[uart] = 0;
+  }
+
+  return rx_count[uart];
+}
+
 uint32_t bsp_uart_get_count(bsp_uart_t uart) { return rx_count[uart]; }
 
 bsp_status_t bsp_uart_abort_receive(bsp_uart_t uart) {
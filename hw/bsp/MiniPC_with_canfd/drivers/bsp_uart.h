@@ -34,6 +34,8 @@ bsp_status_t bsp_uart_transmit(bsp_uart_t uart, uint8_t *data, size_t size,
 bsp_status_t bsp_uart_receive(bsp_uart_t uart, uint8_t *buff, size_t size,
                               bool block);
 bsp_status_t bsp_uart_abort_receive(bsp_uart_t uart);
+/* 阻塞读取至多size字节，返回实际读到的长度 */
+size_t bsp_uart_receive_burst(bsp_uart_t uart, uint8_t *buff, size_t size);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,24 @@
+cmake_minimum_required(VERSION 3.11)
+
+set(USE_SIMULATOR true)
+
+add_compile_definitions(USE_SIMULATOR)
+
+add_subdirectory(${BOARD_DIR}/drivers)
+
+add_executable(${PROJECT_NAME}.elf ${BOARD_DIR}/main.cpp)
+
+target_link_libraries(
+  ${PROJECT_NAME}.elf
+  PUBLIC bsp
+  PUBLIC system
+  PUBLIC robot)
+
+
+target_include_directories(
+  ${PROJECT_NAME}.elf
+  PUBLIC ${CMAKE_CURRENT_SOURCE_DIR}
+  PRIVATE $<TARGET_PROPERTY:bsp,INTERFACE_INCLUDE_DIRECTORIES>
+  PRIVATE $<TARGET_PROPERTY:system,INTERFACE_INCLUDE_DIRECTORIES>
+  PRIVATE $<TARGET_PROPERTY:robot,INTERFACE_INCLUDE_DIRECTORIES>
+)
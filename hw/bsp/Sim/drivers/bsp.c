@@ -0,0 +1,5 @@
+#include "bsp.h"
+
+#include "bsp_sim.h"
+
+void bsp_init() { bsp_sim_init(); }
@@ -0,0 +1,18 @@
+#include "bsp_gpio.h"
+
+#include "webots/led.h"
+#include "webots/robot.h"
+
+static WbDeviceTag led = 0;
+
+inline bsp_status_t bsp_gpio_write_pin(bsp_gpio_t gpio, bool value) {
+  (void)gpio;
+
+  if (!led) {
+    led = wb_robot_get_device("led");
+  }
+
+  wb_led_set(led, value ? 1 : 0);
+
+  return BSP_OK;
+}
@@ -0,0 +1,359 @@
+#include "bsp_sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsp_time.h"
+#include "webots/accelerometer.h"
+#include "webots/camera.h"
+#include "webots/gyro.h"
+#include "webots/inertial_unit.h"
+#include "webots/keyboard.h"
+#include "webots/led.h"
+#include "webots/motor.h"
+#include "webots/position_sensor.h"
+#include "webots/robot.h"
+
+#define SENSOR_SUFFIX "_Sensor"
+
+typedef enum {
+  SIM_DEVICE_NONE,
+  SIM_DEVICE_MOTOR,
+  SIM_DEVICE_IMU,
+  SIM_DEVICE_GYRO,
+  SIM_DEVICE_ACCL,
+  SIM_DEVICE_OTHER,
+} sim_device_type_t;
+
+typedef struct {
+  char name[BSP_SIM_NAME_LEN];
+  sim_device_type_t type;
+  /* 电机：直流电机+编码器 */
+  double inertia;
+  double damping;
+  double friction;
+  double torque;
+  double pos;
+  double vel;
+  uint64_t time;
+  /* 惯性传感器：每个ms采样一次噪声 */
+  double value[3];
+  uint32_t sample_time;
+  bool sampled;
+} sim_device_t;
+
+static sim_device_t device[BSP_SIM_DEVICE_NUM + 1];
+static uint16_t device_num = 0;
+
+static uint64_t rand_state = 1;
+
+/* xorshift64*，保证同一种子下噪声序列完全一致 */
+static double rand_uniform() {
+  rand_state ^= rand_state >> 12;
+  rand_state ^= rand_state << 25;
+  rand_state ^= rand_state >> 27;
+  return (double)((rand_state * 2685821657736338717ull) >> 11) /
+         (double)(1ull << 53);
+}
+
+static double rand_gauss(double sigma) {
+  double u1 = rand_uniform(), u2 = rand_uniform();
+  if (u1 < 1e-300) {
+    u1 = 1e-300;
+  }
+  return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static sim_device_t *get_device(WbDeviceTag tag) {
+  if (tag == 0 || tag > device_num) {
+    return NULL;
+  }
+  return &device[tag];
+}
+
+static WbDeviceTag find_device(const char *name, size_t len) {
+  for (uint16_t i = 1; i <= device_num; i++) {
+    if (strlen(device[i].name) == len && !strncmp(device[i].name, name, len)) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static WbDeviceTag add_device(const char *name, size_t len,
+                              sim_device_type_t type) {
+  if (device_num >= BSP_SIM_DEVICE_NUM || len >= BSP_SIM_NAME_LEN) {
+    return 0;
+  }
+
+  sim_device_t *dev = &device[++device_num];
+  memset(dev, 0, sizeof(*dev));
+  memcpy(dev->name, name, len);
+  dev->type = type;
+  dev->inertia = BSP_SIM_MOTOR_INERTIA;
+  dev->damping = BSP_SIM_MOTOR_DAMPING;
+  dev->friction = BSP_SIM_MOTOR_FRICTION;
+  dev->time = bsp_time_get_us();
+
+  return device_num;
+}
+
+/* 半隐式欧拉法积分到当前虚拟时间，力矩为零阶保持 */
+static void motor_update(sim_device_t *dev) {
+  const double dt = BSP_SIM_STEP_US / 1000000.0;
+  uint64_t now = bsp_time_get_us();
+
+  while (dev->time + BSP_SIM_STEP_US <= now) {
+    double torque = dev->torque - dev->damping * dev->vel;
+
+    /* 静摩擦：速度为零且驱动力矩不足时保持静止 */
+    if (dev->vel == 0.0 && fabs(torque) <= dev->friction) {
+      torque = 0.0;
+    } else if (dev->vel != 0.0) {
+      torque -= dev->vel > 0.0 ? dev->friction : -dev->friction;
+    } else {
+      torque -= torque > 0.0 ? dev->friction : -dev->friction;
+    }
+
+    double vel = dev->vel + torque / dev->inertia * dt;
+
+    /* 摩擦力不能让速度反向 */
+    if (dev->vel != 0.0 && vel * dev->vel < 0.0 &&
+        fabs(dev->torque) <= dev->friction) {
+      vel = 0.0;
+    }
+
+    dev->vel = vel;
+    dev->pos += dev->vel * dt;
+    dev->time += BSP_SIM_STEP_US;
+  }
+}
+
+/* 静止的机体，零偏会让偏航角缓慢漂移 */
+static const double *imu_sample(sim_device_t *dev) {
+  static const double zero[3] = {0.0, 0.0, 0.0};
+
+  if (dev == NULL) {
+    return zero;
+  }
+
+  uint32_t now = bsp_time_get_ms();
+  if (dev->sampled && dev->sample_time == now) {
+    return dev->value;
+  }
+
+  dev->sampled = true;
+  dev->sample_time = now;
+
+  switch (dev->type) {
+    case SIM_DEVICE_GYRO:
+      dev->value[0] = rand_gauss(BSP_SIM_GYRO_NOISE);
+      dev->value[1] = rand_gauss(BSP_SIM_GYRO_NOISE);
+      dev->value[2] = BSP_SIM_GYRO_BIAS + rand_gauss(BSP_SIM_GYRO_NOISE);
+      break;
+    case SIM_DEVICE_ACCL:
+      dev->value[0] = rand_gauss(BSP_SIM_ACCL_NOISE);
+      dev->value[1] = rand_gauss(BSP_SIM_ACCL_NOISE);
+      dev->value[2] = BSP_SIM_GRAVITY + rand_gauss(BSP_SIM_ACCL_NOISE);
+      break;
+    case SIM_DEVICE_IMU: {
+      double yaw = fmod(BSP_SIM_GYRO_BIAS * now / 1000.0, 2.0 * M_PI);
+      if (yaw > M_PI) {
+        yaw -= 2.0 * M_PI;
+      }
+      dev->value[0] = rand_gauss(BSP_SIM_EULR_NOISE);
+      dev->value[1] = rand_gauss(BSP_SIM_EULR_NOISE);
+      dev->value[2] = yaw + rand_gauss(BSP_SIM_EULR_NOISE);
+      break;
+    }
+    default:
+      break;
+  }
+
+  return dev->value;
+}
+
+void bsp_sim_init(void) {
+  const char *env = getenv("XROBOT_SIM_SEED");
+  if (env) {
+    rand_state = strtoull(env, NULL, 0);
+  }
+  if (rand_state == 0) {
+    rand_state = 1;
+  }
+
+  env = getenv("XROBOT_SIM_MOTOR");
+  if (env == NULL) {
+    return;
+  }
+
+  char *buff = strdup(env);
+  char *save = NULL;
+  for (char *item = strtok_r(buff, ";", &save); item;
+       item = strtok_r(NULL, ";", &save)) {
+    char *name = item;
+    char *param = strchr(item, ':');
+    if (param == NULL) {
+      continue;
+    }
+    *param++ = '\0';
+
+    double value[3] = {BSP_SIM_MOTOR_INERTIA, BSP_SIM_MOTOR_DAMPING,
+                       BSP_SIM_MOTOR_FRICTION};
+    for (int i = 0; i < 3 && param && *param; i++) {
+      value[i] = strtod(param, &param);
+      if (*param == ':') {
+        param++;
+      }
+    }
+
+    bsp_sim_set_motor(name, value[0], value[1], value[2]);
+  }
+  free(buff);
+}
+
+bsp_status_t bsp_sim_set_motor(const char *name, double inertia, double damping,
+                               double friction) {
+  if (inertia <= 0.0 || damping < 0.0 || friction < 0.0) {
+    return BSP_ERR;
+  }
+
+  WbDeviceTag tag = wb_robot_get_device(name);
+  sim_device_t *dev = get_device(tag);
+  if (dev == NULL || dev->type != SIM_DEVICE_MOTOR) {
+    return BSP_ERR;
+  }
+
+  dev->inertia = inertia;
+  dev->damping = damping;
+  dev->friction = friction;
+
+  return BSP_OK;
+}
+
+void wb_robot_init(void) {}
+
+int wb_robot_step(int duration) {
+  (void)duration;
+  return 0;
+}
+
+void wb_robot_cleanup(void) {}
+
+double wb_robot_get_time(void) { return bsp_time_get_us() / 1000000.0; }
+
+double wb_robot_get_basic_time_step(void) { return 1.0; }
+
+WbDeviceTag wb_robot_get_device(const char *name) {
+  size_t len = strlen(name);
+  size_t suffix = strlen(SENSOR_SUFFIX);
+
+  /* 编码器与电机共用一个模型 */
+  sim_device_type_t type = SIM_DEVICE_MOTOR;
+  if (len > suffix && !strcmp(name + len - suffix, SENSOR_SUFFIX)) {
+    len -= suffix;
+  } else if (!strcmp(name, "imu")) {
+    type = SIM_DEVICE_IMU;
+  } else if (!strcmp(name, "gyro")) {
+    type = SIM_DEVICE_GYRO;
+  } else if (!strcmp(name, "accl")) {
+    type = SIM_DEVICE_ACCL;
+  } else if (!strcmp(name, "led") || !strcmp(name, "camera")) {
+    type = SIM_DEVICE_OTHER;
+  }
+
+  WbDeviceTag tag = find_device(name, len);
+  if (tag == 0) {
+    tag = add_device(name, len, type);
+  }
+
+  return tag;
+}
+
+void wb_motor_set_position(WbDeviceTag tag, double position) {
+  (void)tag;
+  (void)position;
+}
+
+void wb_motor_set_velocity(WbDeviceTag tag, double velocity) {
+  (void)tag;
+  (void)velocity;
+}
+
+void wb_motor_set_torque(WbDeviceTag tag, double torque) {
+  sim_device_t *dev = get_device(tag);
+  if (dev == NULL || dev->type != SIM_DEVICE_MOTOR) {
+    return;
+  }
+
+  motor_update(dev);
+  dev->torque = torque;
+}
+
+double wb_motor_get_torque_feedback(WbDeviceTag tag) {
+  sim_device_t *dev = get_device(tag);
+  return dev ? dev->torque : 0.0;
+}
+
+void wb_position_sensor_enable(WbDeviceTag tag, int sampling_period) {
+  (void)tag;
+  (void)sampling_period;
+}
+
+double wb_position_sensor_get_value(WbDeviceTag tag) {
+  const double res = 2.0 * M_PI / BSP_SIM_ENCODER_RES;
+
+  sim_device_t *dev = get_device(tag);
+  if (dev == NULL || dev->type != SIM_DEVICE_MOTOR) {
+    return 0.0;
+  }
+
+  motor_update(dev);
+
+  return floor(dev->pos / res) * res;
+}
+
+void wb_accelerometer_enable(WbDeviceTag tag, int sampling_period) {
+  (void)tag;
+  (void)sampling_period;
+}
+
+const double *wb_accelerometer_get_values(WbDeviceTag tag) {
+  return imu_sample(get_device(tag));
+}
+
+void wb_gyro_enable(WbDeviceTag tag, int sampling_period) {
+  (void)tag;
+  (void)sampling_period;
+}
+
+const double *wb_gyro_get_values(WbDeviceTag tag) {
+  return imu_sample(get_device(tag));
+}
+
+void wb_inertial_unit_enable(WbDeviceTag tag, int sampling_period) {
+  (void)tag;
+  (void)sampling_period;
+}
+
+const double *wb_inertial_unit_get_roll_pitch_yaw(WbDeviceTag tag) {
+  return imu_sample(get_device(tag));
+}
+
+void wb_keyboard_enable(int sampling_period) { (void)sampling_period; }
+
+void wb_keyboard_disable(void) {}
+
+/* 无头运行没有键盘输入 */
+int wb_keyboard_get_key(void) { return -1; }
+
+void wb_led_set(WbDeviceTag tag, int value) {
+  (void)tag;
+  (void)value;
+}
+
+void wb_camera_enable(WbDeviceTag tag, int sampling_period) {
+  (void)tag;
+  (void)sampling_period;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "bsp.h"
+
+/* 最大仿真设备数量 */
+#define BSP_SIM_DEVICE_NUM (32)
+/* 设备名最大长度（含结束符） */
+#define BSP_SIM_NAME_LEN (32)
+/* 电机模型积分步长，单位us */
+#define BSP_SIM_STEP_US (100)
+/* 电机转子等效转动惯量，单位kg*m^2 */
+#define BSP_SIM_MOTOR_INERTIA (0.005)
+/* 粘滞阻尼，单位N*m*s/rad */
+#define BSP_SIM_MOTOR_DAMPING (0.01)
+/* 库仑摩擦，单位N*m */
+#define BSP_SIM_MOTOR_FRICTION (0.005)
+/* 编码器分辨率 */
+#define BSP_SIM_ENCODER_RES (8192)
+/* 陀螺仪噪声标准差，单位rad/s */
+#define BSP_SIM_GYRO_NOISE (0.002)
+/* 陀螺仪零偏，单位rad/s */
+#define BSP_SIM_GYRO_BIAS (0.0005)
+/* 加速度计噪声标准差，单位m/s^2 */
+#define BSP_SIM_ACCL_NOISE (0.02)
+/* 姿态角噪声标准差，单位rad */
+#define BSP_SIM_EULR_NOISE (0.0005)
+/* 重力加速度 */
+#define BSP_SIM_GRAVITY (9.80665)
+
+/* 读取环境变量：
+ * XROBOT_SIM_SEED   噪声随机数种子
+ * XROBOT_SIM_MOTOR  按名称覆盖电机参数，格式为name:inertia:damping:friction，
+ *                   多个电机用分号分隔 */
+void bsp_sim_init(void);
+
+bsp_status_t bsp_sim_set_motor(const char *name, double inertia, double damping,
+                               double friction);
+
+#ifdef __cplusplus
+}
+#endif
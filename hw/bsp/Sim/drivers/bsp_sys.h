@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include "bsp_def.h"
+
+/* 软件复位 */
+__attribute__((always_inline, unused)) static inline void bsp_sys_reset(void) {
+  exit(EXIT_SUCCESS);
+}
+
+/* 关机 */
+__attribute__((always_inline, unused)) static inline void bsp_sys_shutdown(
+    void) {
+  exit(EXIT_SUCCESS);
+}
+
+/* 睡眠模式 */
+__attribute__((always_inline, unused)) static inline void bsp_sys_sleep(void) {}
+
+/* 停止模式 */
+__attribute__((always_inline, unused)) static inline void bsp_sys_stop(void) {}
+
+/* 中断状态 */
+__attribute__((always_inline, unused)) static inline bool bsp_sys_in_isr(void) {
+  return false;
+}
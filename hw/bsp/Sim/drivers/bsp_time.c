@@ -0,0 +1,11 @@
+#include "bsp_time.h"
+
+static uint64_t sim_time_us = 0;
+
+uint32_t bsp_time_get_ms() { return sim_time_us / 1000; }
+
+uint64_t bsp_time_get_us() { return sim_time_us; }
+
+uint64_t bsp_time_get() __attribute__((alias("bsp_time_get_us")));
+
+void bsp_time_set_us(uint64_t time) { sim_time_us = time; }
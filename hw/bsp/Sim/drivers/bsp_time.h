@@ -0,0 +1,20 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "bsp.h"
+
+uint32_t bsp_time_get_ms();
+
+uint64_t bsp_time_get_us();
+
+uint64_t bsp_time_get();
+
+/* 虚拟时钟只由执行器推进 */
+void bsp_time_set_us(uint64_t time);
+
+#ifdef __cplusplus
+}
+#endif
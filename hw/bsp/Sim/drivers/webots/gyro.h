@@ -0,0 +1,17 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_gyro_enable(WbDeviceTag tag, int sampling_period);
+
+const double *wb_gyro_get_values(WbDeviceTag tag);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_inertial_unit_enable(WbDeviceTag tag, int sampling_period);
+
+const double *wb_inertial_unit_get_roll_pitch_yaw(WbDeviceTag tag);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_keyboard_enable(int sampling_period);
+
+void wb_keyboard_disable(void);
+
+int wb_keyboard_get_key(void);
+
+#ifdef __cplusplus
+}
+#endif
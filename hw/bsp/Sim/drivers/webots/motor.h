@@ -0,0 +1,21 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_motor_set_position(WbDeviceTag tag, double position);
+
+void wb_motor_set_velocity(WbDeviceTag tag, double velocity);
+
+void wb_motor_set_torque(WbDeviceTag tag, double torque);
+
+double wb_motor_get_torque_feedback(WbDeviceTag tag);
+
+#ifdef __cplusplus
+}
+#endif
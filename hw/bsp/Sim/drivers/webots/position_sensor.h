@@ -0,0 +1,17 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_position_sensor_enable(WbDeviceTag tag, int sampling_period);
+
+double wb_position_sensor_get_value(WbDeviceTag tag);
+
+#ifdef __cplusplus
+}
+#endif
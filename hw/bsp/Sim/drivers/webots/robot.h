@@ -0,0 +1,25 @@
+#pragma once
+
+/* 无头仿真中的Webots接口子集，由bsp_sim.c中的模型实现 */
+
+#include "webots/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wb_robot_init(void);
+
+int wb_robot_step(int duration);
+
+void wb_robot_cleanup(void);
+
+double wb_robot_get_time(void);
+
+double wb_robot_get_basic_time_step(void);
+
+WbDeviceTag wb_robot_get_device(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,10 @@
+#include <executive.hpp>
+
+#include "bsp.h"
+#include "robot.hpp"
+
+int main() {
+  bsp_init();
+  robot_init();
+  return System::Executive::Run();
+}
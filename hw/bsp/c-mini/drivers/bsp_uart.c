@@ -53,10 +53,21 @@ static void bsp_uart_callback(bsp_uart_callback_t cb_type,
   bsp_uart_t bsp_uart = uart_get(huart);
   if (bsp_uart != BSP_UART_ERR) {
     bsp_callback_t cb = callback_list[bsp_uart][cb_type];
+    bool rx = cb_type == BSP_UART_RX_CPLT_CB ||
+              cb_type == BSP_UART_RX_HALF_CPLT_CB ||
+              cb_type == BSP_UART_IDLE_LINE_CB;
+
+    if (rx) {
+      XB_TRACE_ISR(BSP_TRACE_UART_RX, bsp_uart, true);
+    }
 
     if (cb.fn) {
       cb.fn(cb.arg);
     }
+
+    if (rx) {
+      XB_TRACE_ISR(BSP_TRACE_UART_RX, bsp_uart, false);
+    }
   }
 }
 
@@ -152,6 +152,11 @@ bsp_status_t bsp_can_register_callback(
   return BSP_OK;
 }
 
+bsp_can_format_t bsp_can_get_rx_format(bsp_can_t can) {
+  return rx_buff[can].header.IdType == FDCAN_EXTENDED_ID ? CAN_FORMAT_EXT
+                                                         : CAN_FORMAT_STD;
+}
+
 bsp_status_t bsp_can_trans_packet(bsp_can_t can, bsp_can_format_t format,
                                   uint32_t id, uint8_t *data) {
   FDCAN_TxHeaderTypeDef header;
@@ -48,6 +48,9 @@ bsp_status_t bsp_canfd_trans_packet(bsp_can_t can, bsp_can_format_t format,
 
 bsp_status_t bsp_can_get_msg(bsp_can_t can, uint8_t *data, uint32_t *index);
 
+/* 在接收回调中调用，返回当前帧的ID格式 */
+bsp_can_format_t bsp_can_get_rx_format(bsp_can_t can);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,11 @@ uint64_t bsp_time_get_us();
 
 uint64_t bsp_time_get();
 
+uint64_t bsp_time_get_ns();
+
+/* 阻塞到启动后time纳秒的绝对时刻 */
+void bsp_time_sleep_until_ns(uint64_t time);
+
 void bsp_time_init();
 
 #ifdef __cplusplus
@@ -137,6 +137,8 @@ static void can_rx_cb_fn(bsp_can_t can) {
     fifo = CAN_FILTER_FIFO1;
   }
 
+  XB_TRACE_ISR(BSP_TRACE_CAN_RX, can, true);
+
   if (callback_list[can][CAN_RX_MSG_CALLBACK].fn) {
     while (HAL_CAN_GetRxMessage(bsp_can_get_handle(can), fifo,
                                 &rx_buff[can].header,
@@ -152,6 +154,8 @@ static void can_rx_cb_fn(bsp_can_t can) {
       }
     }
   }
+
+  XB_TRACE_ISR(BSP_TRACE_CAN_RX, can, false);
 }
 
 void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
@@ -57,6 +57,14 @@
 extern uint32_t SystemCoreClock;
 void xPortSysTickHandler(void);
 /* USER CODE BEGIN 0 */
+/* 线程切换跟踪，由System::Trace实现，没有链接时为空指针 */
+void system_trace_task_switch(void *task) __attribute__((weak));
+#define traceTASK_SWITCHED_IN()               \
+  do {                                        \
+    if (system_trace_task_switch) {           \
+      system_trace_task_switch(pxCurrentTCB); \
+    }                                         \
+  } while (0)
 /* USER CODE END 0 */
 
 #endif
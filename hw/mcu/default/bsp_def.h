@@ -38,6 +38,22 @@ extern "C" {
     (type*)((char*)__mptr - ms_offset_of(type, member)); \
   })
 
+typedef enum {
+  BSP_TRACE_CAN_RX,
+  BSP_TRACE_UART_RX,
+} bsp_trace_isr_t;
+
+/* 中断跟踪钩子，由System::Trace实现，没有链接时为空指针 */
+void bsp_trace_isr(bsp_trace_isr_t type, uint32_t index, bool enter)
+    __attribute__((weak));
+
+#define XB_TRACE_ISR(_type, _index, _enter) \
+  do {                                      \
+    if (bsp_trace_isr) {                    \
+      bsp_trace_isr(_type, _index, _enter); \
+    }                                       \
+  } while (0)
+
 typedef enum {
   BSP_OK,
   BSP_ERR,
@@ -0,0 +1,389 @@
+/*
+  Madgwick姿态解算内核。
+*/
+
+#include "comp_ahrs.hpp"
+
+#include "bsp_time.h"
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+using namespace Component;
+
+Madgwick::Madgwick(const Param &param) : param_(param), q_{1.0f, 0, 0, 0} {
+  if (this->param_.correct_div == 0) {
+    this->param_.correct_div = 1;
+  }
+}
+
+void Madgwick::Reset(const Type::Quaternion &quat) {
+  this->q_[0] = quat.q0;
+  this->q_[1] = quat.q1;
+  this->q_[2] = quat.q2;
+  this->q_[3] = quat.q3;
+
+  this->accl_sum_ = {};
+  this->accl_num_ = 0;
+  this->dt_sum_ = 0.0f;
+}
+
+void Madgwick::SetMagn(const Type::Vector3 &magn) { this->magn_ = magn; }
+
+/* 梯度为J^T * f，f的每一项乘以J对应的一行再累加，
+ * 推导见Madgwick的论文，结果与原有的展开式相同 */
+void Madgwick::Correct(float *step) {
+  const float *q = this->q_;
+
+  float ax = this->accl_sum_.x;
+  float ay = this->accl_sum_.y;
+  float az = this->accl_sum_.z;
+
+  float norm = ax * ax + ay * ay + az * az;
+  if (norm == 0.0f) {
+    return;
+  }
+
+  float recip_norm = 1.0f / sqrtf(norm);
+  ax *= recip_norm;
+  ay *= recip_norm;
+  az *= recip_norm;
+
+  float q0q0 = q[0] * q[0], q1q1 = q[1] * q[1], q2q2 = q[2] * q[2];
+  float q3q3 = q[3] * q[3];
+
+  float f0 = 2.0f * (q[1] * q[3] - q[0] * q[2]) - ax;
+  float f1 = 2.0f * (q[0] * q[1] + q[2] * q[3]) - ay;
+  float f2 = 1.0f - 2.0f * (q1q1 + q2q2) - az;
+
+  vec4_t q2 = vec4_mul(vec4_load(q), vec4_dup(2.0f));
+  float _2q[4];
+  vec4_store(_2q, q2);
+
+  vec4_t s =
+      vec4_mul(vec4_dup(f0), vec4_set(-_2q[2], _2q[3], -_2q[0], _2q[1]));
+  s = vec4_madd(s, vec4_dup(f1), vec4_set(_2q[1], _2q[0], _2q[3], _2q[2]));
+  s = vec4_madd(s, vec4_dup(f2),
+                vec4_set(0.0f, -2.0f * _2q[1], -2.0f * _2q[2], 0.0f));
+
+  float beta = this->param_.beta_imu;
+
+  float mx = this->magn_.x;
+  float my = this->magn_.y;
+  float mz = this->magn_.z;
+
+  norm = mx * mx + my * my + mz * mz;
+  if (norm != 0.0f) {
+    beta = this->param_.beta_ahrs;
+
+    recip_norm = 1.0f / sqrtf(norm);
+    mx *= recip_norm;
+    my *= recip_norm;
+    mz *= recip_norm;
+
+    float q0q1 = q[0] * q[1], q0q2 = q[0] * q[2], q0q3 = q[0] * q[3];
+    float q1q2 = q[1] * q[2], q1q3 = q[1] * q[3], q2q3 = q[2] * q[3];
+
+    /* 把磁力计数据转到地理坐标系，只保留水平和竖直分量 */
+    float hx = mx * (q0q0 + q1q1 - q2q2 - q3q3) +
+               2.0f * my * (q1q2 - q0q3) + 2.0f * mz * (q0q2 + q1q3);
+    float hy = 2.0f * mx * (q1q2 + q0q3) + my * (q0q0 - q1q1 + q2q2 - q3q3) +
+               2.0f * mz * (q2q3 - q0q1);
+    float _2bx = sqrtf(hx * hx + hy * hy);
+    float _2bz = 2.0f * mx * (q1q3 - q0q2) + 2.0f * my * (q0q1 + q2q3) +
+                 mz * (q0q0 - q1q1 - q2q2 + q3q3);
+    float _4bx = 2.0f * _2bx;
+    float _4bz = 2.0f * _2bz;
+
+    float f3 = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+    float f4 = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+    float f5 = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+    s = vec4_madd(
+        s, vec4_dup(f3),
+        vec4_set(-_2bz * q[2], _2bz * q[3], -_4bx * q[2] - _2bz * q[0],
+                 -_4bx * q[3] + _2bz * q[1]));
+    s = vec4_madd(
+        s, vec4_dup(f4),
+        vec4_set(-_2bx * q[3] + _2bz * q[1], _2bx * q[2] + _2bz * q[0],
+                 _2bx * q[1] + _2bz * q[3], -_2bx * q[0] + _2bz * q[2]));
+    s = vec4_madd(s, vec4_dup(f5),
+                  vec4_set(_2bx * q[2], _2bx * q[3] - _4bz * q[1],
+                           _2bx * q[0] - _4bz * q[2], _2bx * q[1]));
+  }
+
+  norm = vec4_dot(s, s);
+  if (norm == 0.0f) {
+    return;
+  }
+
+  /* 校正量按两次校正间的总时间积分 */
+  vec4_t out = vec4_madd(vec4_load(step), s,
+                         vec4_dup(-beta * this->dt_sum_ / sqrtf(norm)));
+  vec4_store(step, out);
+}
+
+void Madgwick::Update(const Sample *sample, uint32_t num, float dt) {
+  float *q = this->q_;
+
+  for (uint32_t i = 0; i < num; i++) {
+    float h = 0.5f * dt;
+    float gx = sample[i].gyro.x * h;
+    float gy = sample[i].gyro.y * h;
+    float gz = sample[i].gyro.z * h;
+
+    /* q_dot = 0.5 * q ⊗ (0, g)，按q的四个分量展开为四次乘加 */
+    vec4_t step = vec4_mul(vec4_dup(q[0]), vec4_set(0.0f, gx, gy, gz));
+    step = vec4_madd(step, vec4_dup(q[1]), vec4_set(-gx, 0.0f, -gz, gy));
+    step = vec4_madd(step, vec4_dup(q[2]), vec4_set(-gy, gz, 0.0f, -gx));
+    step = vec4_madd(step, vec4_dup(q[3]), vec4_set(-gz, -gy, gx, 0.0f));
+
+    this->accl_sum_.x += sample[i].accl.x;
+    this->accl_sum_.y += sample[i].accl.y;
+    this->accl_sum_.z += sample[i].accl.z;
+    this->accl_num_++;
+    this->dt_sum_ += dt;
+
+    if (this->accl_num_ >= this->param_.correct_div) {
+      float tmp[4];
+      vec4_store(tmp, step);
+      /* 只用方向，不需要除以数量求平均 */
+      this->Correct(tmp);
+      step = vec4_load(tmp);
+
+      this->accl_sum_ = {};
+      this->accl_num_ = 0;
+      this->dt_sum_ = 0.0f;
+    }
+
+    vec4_store(q, vec4_add(vec4_load(q), step));
+  }
+
+  /* 每批数据只归一化一次 */
+  vec4_t qv = vec4_load(q);
+  float norm = vec4_dot(qv, qv);
+  if (norm > 0.0f) {
+    vec4_store(q, vec4_mul(qv, vec4_dup(1.0f / sqrtf(norm))));
+  }
+}
+
+void Madgwick::GetQuat(Type::Quaternion &quat) {
+  quat.q0 = this->q_[0];
+  quat.q1 = this->q_[1];
+  quat.q2 = this->q_[2];
+  quat.q3 = this->q_[3];
+}
+
+void Madgwick::GetEulr(Type::Eulr &eulr) {
+  const float *q = this->q_;
+
+  const float SINR_COSP = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+  const float COSR_COSP = 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]);
+  eulr.pit = atan2f(SINR_COSP, COSR_COSP);
+
+  const float SINP = 2.0f * (q[0] * q[2] - q[3] * q[1]);
+
+  if (fabsf(SINP) >= 1.0f) {
+    eulr.rol = copysignf(M_PI / 2.0f, SINP);
+  } else {
+    eulr.rol = asinf(SINP);
+  }
+
+  const float SINY_COSP = 2.0f * (q[0] * q[3] + q[1] * q[2]);
+  const float COSY_COSP = 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]);
+  eulr.yaw = atan2f(SINY_COSP, COSY_COSP);
+}
+
+void Madgwick::ReferenceUpdate(Type::Quaternion &quat, const Sample &sample,
+                               float beta, float dt) {
+  float ax = sample.accl.x;
+  float ay = sample.accl.y;
+  float az = sample.accl.z;
+
+  float gx = sample.gyro.x;
+  float gy = sample.gyro.y;
+  float gz = sample.gyro.z;
+
+  float q_dot1 = 0.5f * (-quat.q1 * gx - quat.q2 * gy - quat.q3 * gz);
+  float q_dot2 = 0.5f * (quat.q0 * gx + quat.q2 * gz - quat.q3 * gy);
+  float q_dot3 = 0.5f * (quat.q0 * gy - quat.q1 * gz + quat.q3 * gx);
+  float q_dot4 = 0.5f * (quat.q0 * gz + quat.q1 * gy - quat.q2 * gx);
+
+  if (!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
+    float recip_norm = inv_sqrtf(ax * ax + ay * ay + az * az);
+    ax *= recip_norm;
+    ay *= recip_norm;
+    az *= recip_norm;
+
+    float q_2q0 = 2.0f * quat.q0;
+    float q_2q1 = 2.0f * quat.q1;
+    float q_2q2 = 2.0f * quat.q2;
+    float q_2q3 = 2.0f * quat.q3;
+    float q_4q0 = 4.0f * quat.q0;
+    float q_4q1 = 4.0f * quat.q1;
+    float q_4q2 = 4.0f * quat.q2;
+    float q_8q1 = 8.0f * quat.q1;
+    float q_8q2 = 8.0f * quat.q2;
+    float q0q0 = quat.q0 * quat.q0;
+    float q1q1 = quat.q1 * quat.q1;
+    float q2q2 = quat.q2 * quat.q2;
+    float q3q3 = quat.q3 * quat.q3;
+
+    float s0 = q_4q0 * q2q2 + q_2q2 * ax + q_4q0 * q1q1 - q_2q1 * ay;
+    float s1 = q_4q1 * q3q3 - q_2q3 * ax + 4.0f * q0q0 * quat.q1 -
+               q_2q0 * ay - q_4q1 + q_8q1 * q1q1 + q_8q1 * q2q2 + q_4q1 * az;
+    float s2 = 4.0f * q0q0 * quat.q2 + q_2q0 * ax + q_4q2 * q3q3 -
+               q_2q3 * ay - q_4q2 + q_8q2 * q1q1 + q_8q2 * q2q2 + q_4q2 * az;
+    float s3 = 4.0f * q1q1 * quat.q3 - q_2q1 * ax + 4.0f * q2q2 * quat.q3 -
+               q_2q2 * ay;
+
+    recip_norm = inv_sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+
+    q_dot1 -= beta * s0 * recip_norm;
+    q_dot2 -= beta * s1 * recip_norm;
+    q_dot3 -= beta * s2 * recip_norm;
+    q_dot4 -= beta * s3 * recip_norm;
+  }
+
+  quat.q0 += q_dot1 * dt;
+  quat.q1 += q_dot2 * dt;
+  quat.q2 += q_dot3 * dt;
+  quat.q3 += q_dot4 * dt;
+
+  float recip_norm = inv_sqrtf(quat.q0 * quat.q0 + quat.q1 * quat.q1 +
+                               quat.q2 * quat.q2 + quat.q3 * quat.q3);
+  quat.q0 *= recip_norm;
+  quat.q1 *= recip_norm;
+  quat.q2 *= recip_norm;
+  quat.q3 *= recip_norm;
+}
+
+#if defined(__linux__)
+/* 主机上用单调时钟计时，仿真环境的bsp_time是虚拟时间 */
+static uint64_t bench_tick() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static float bench_tick_to_ns(uint64_t tick) {
+  return static_cast<float>(tick);
+}
+#elif defined(__ARM_ARCH_7EM__)
+/* Cortex-M4上用DWT周期计数器计时 */
+#define BENCH_DEMCR (*reinterpret_cast<volatile uint32_t *>(0xe000edfc))
+#define BENCH_DWT_CTRL (*reinterpret_cast<volatile uint32_t *>(0xe0001000))
+#define BENCH_DWT_CYCCNT (*reinterpret_cast<volatile uint32_t *>(0xe0001004))
+#define BENCH_CYCLE_COUNT
+
+extern "C" uint32_t SystemCoreClock;
+
+static uint64_t bench_tick() {
+  if (!(BENCH_DWT_CTRL & 1)) {
+    BENCH_DEMCR |= 1 << 24;
+    BENCH_DWT_CYCCNT = 0;
+    BENCH_DWT_CTRL |= 1;
+  }
+  return BENCH_DWT_CYCCNT;
+}
+
+static float bench_tick_to_ns(uint64_t tick) {
+  return static_cast<float>(tick) * 1e9f / static_cast<float>(SystemCoreClock);
+}
+#else
+static uint64_t bench_tick() { return bsp_time_get(); }
+
+static float bench_tick_to_ns(uint64_t tick) {
+  return static_cast<float>(tick) * 1000.0f;
+}
+#endif
+
+static void bench_print(const char *name, uint64_t tick, uint32_t num,
+                        const Type::Quaternion &quat,
+                        const Type::Quaternion &ref) {
+  /* 两个单位四元数的弦长为2sin(θ/4)，小角度下比acos精确 */
+  float dot = quat.q0 * ref.q0 + quat.q1 * ref.q1 + quat.q2 * ref.q2 +
+              quat.q3 * ref.q3;
+  float sign = dot < 0.0f ? -1.0f : 1.0f;
+  float d0 = quat.q0 - sign * ref.q0, d1 = quat.q1 - sign * ref.q1;
+  float d2 = quat.q2 - sign * ref.q2, d3 = quat.q3 - sign * ref.q3;
+  float chord = sqrtf(d0 * d0 + d1 * d1 + d2 * d2 + d3 * d3);
+  float err = 4.0f * asinf(MIN(chord / 2.0f, 1.0f)) * 180.0f / M_PI;
+
+#if defined(BENCH_CYCLE_COUNT)
+  printf("%-10s %8.1fns %8.1fcycle err:%.4fdeg\r\n", name,
+         bench_tick_to_ns(tick) / static_cast<float>(num),
+         static_cast<float>(tick) / static_cast<float>(num), err);
+#else
+  printf("%-10s %8.1fns err:%.4fdeg\r\n", name,
+         bench_tick_to_ns(tick) / static_cast<float>(num), err);
+#endif
+}
+
+void Madgwick::Benchmark(uint32_t num, uint32_t correct_div) {
+  const float DT = 0.001f;
+  const float BETA = 0.033f;
+
+  static Sample sample[AHRS_BENCH_BATCH * 8];
+  const uint32_t SAMPLE_NUM = sizeof(sample) / sizeof(sample[0]);
+
+  /* 缓慢转动加少量振动，保证校正项一直在起作用 */
+  for (uint32_t i = 0; i < SAMPLE_NUM; i++) {
+    float t = static_cast<float>(i) * 2.0f * M_PI / SAMPLE_NUM;
+    sample[i].gyro.x = 0.3f * sinf(t);
+    sample[i].gyro.y = 0.2f * cosf(3.0f * t);
+    sample[i].gyro.z = 0.5f;
+    sample[i].accl.x = 0.4f * sinf(5.0f * t);
+    sample[i].accl.y = 0.3f * cosf(7.0f * t);
+    sample[i].accl.z = 9.8f;
+  }
+
+  uint32_t round = (num + SAMPLE_NUM - 1) / SAMPLE_NUM;
+  num = round * SAMPLE_NUM;
+
+  Type::Eulr eulr;
+  Type::Quaternion ref = {1.0f, 0.0f, 0.0f, 0.0f};
+  Madgwick scalar({BETA, BETA, 1});
+
+  uint64_t start = bench_tick();
+  for (uint32_t n = 0; n < round; n++) {
+    for (uint32_t i = 0; i < SAMPLE_NUM; i++) {
+      ReferenceUpdate(ref, sample[i], BETA, DT);
+      scalar.Reset(ref);
+      scalar.GetEulr(eulr);
+    }
+  }
+  uint64_t ref_tick = bench_tick() - start;
+
+  Madgwick single({BETA, BETA, 1});
+  start = bench_tick();
+  for (uint32_t n = 0; n < round; n++) {
+    for (uint32_t i = 0; i < SAMPLE_NUM; i++) {
+      single.Update(&sample[i], 1, DT);
+      single.GetEulr(eulr);
+    }
+  }
+  uint64_t single_tick = bench_tick() - start;
+
+  Madgwick batch({BETA, BETA, correct_div});
+  start = bench_tick();
+  for (uint32_t n = 0; n < round; n++) {
+    for (uint32_t i = 0; i < SAMPLE_NUM; i += AHRS_BENCH_BATCH) {
+      batch.Update(&sample[i], AHRS_BENCH_BATCH, DT);
+      batch.GetEulr(eulr);
+    }
+  }
+  uint64_t batch_tick = bench_tick() - start;
+
+  printf("madgwick %s, %u samples, batch %d, correct_div %u, per sample:\r\n",
+         AHRS_SIMD_NAME, static_cast<unsigned int>(num), AHRS_BENCH_BATCH,
+         static_cast<unsigned int>(correct_div));
+
+  Type::Quaternion quat;
+  bench_print("reference", ref_tick, num, ref, ref);
+  single.GetQuat(quat);
+  bench_print("kernel", single_tick, num, quat, ref);
+  batch.GetQuat(quat);
+  bench_print("batch", batch_tick, num, quat, ref);
+}
@@ -0,0 +1,65 @@
+/*
+  Madgwick姿态解算内核。
+*/
+
+#pragma once
+
+#include <component.hpp>
+
+#include "comp_simd.hpp"
+
+/* 四元数按4路向量计算 */
+#define AHRS_SIMD_NAME SIMD_NAME
+
+#define AHRS_BENCH_BATCH (8) /* 基准测试中每批处理的数据组数 */
+
+namespace Component {
+/* 一次处理多组IMU数据，陀螺仪逐组积分，
+ * 加速度计/磁力计校正每correct_div组做一次，使用这段时间内的平均值 */
+class Madgwick {
+ public:
+  typedef struct {
+    float beta_imu;       /* 无磁力计时的梯度下降步长 */
+    float beta_ahrs;      /* 有磁力计时的梯度下降步长 */
+    uint32_t correct_div; /* 校正分频，1为每组数据都校正 */
+  } Param;
+
+  typedef struct {
+    Type::Vector3 accl;
+    Type::Vector3 gyro;
+  } Sample;
+
+  Madgwick(const Param &param);
+
+  void Reset(const Type::Quaternion &quat);
+
+  /* 最新的磁力计数据，全为0时只用加速度计校正 */
+  void SetMagn(const Type::Vector3 &magn);
+
+  /* dt为相邻两组数据的时间间隔，单位s */
+  void Update(const Sample *sample, uint32_t num, float dt);
+
+  void GetQuat(Type::Quaternion &quat);
+
+  void GetEulr(Type::Eulr &eulr);
+
+  /* 原有的逐组标量实现，作为精度和耗时的参照 */
+  static void ReferenceUpdate(Type::Quaternion &quat, const Sample &sample,
+                              float beta, float dt);
+
+  /* 对比参照实现和批处理内核，打印每组数据的耗时 */
+  static void Benchmark(uint32_t num, uint32_t correct_div);
+
+ private:
+  void Correct(float *step);
+
+  Param param_;
+
+  float q_[4];
+
+  Type::Vector3 magn_{};
+  Type::Vector3 accl_sum_{};
+  uint32_t accl_num_ = 0;
+  float dt_sum_ = 0.0f;
+};
+}  // namespace Component
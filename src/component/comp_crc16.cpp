@@ -2,7 +2,35 @@
 
 using namespace Component;
 
-static const std::array<uint16_t, 256> CRC16_TAB = {
+typedef std::array<std::array<uint16_t, 256>, CRC_SLICE_NUM> CRC16Table;
+
+/* 第k张表为在crc后追加k个0字节的结果，用于一次处理多个字节 */
+static constexpr CRC16Table crc16_generate_table() {
+  CRC16Table tab = {};
+
+  for (uint32_t i = 0; i < 256; i++) {
+    uint16_t crc = static_cast<uint16_t>(i);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? static_cast<uint16_t>((crc >> 1) ^ 0x8408)
+                      : static_cast<uint16_t>(crc >> 1);
+    }
+    tab[0][i] = crc;
+  }
+
+  for (uint32_t k = 1; k < CRC_SLICE_NUM; k++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      tab[k][i] = static_cast<uint16_t>((tab[k - 1][i] >> 8) ^
+                                        tab[0][tab[k - 1][i] & 0xff]);
+    }
+  }
+
+  return tab;
+}
+
+static constexpr CRC16Table CRC16_TAB = crc16_generate_table();
+
+/* 原先的查找表，编译期逐项校验生成的表 */
+static constexpr std::array<uint16_t, 256> CRC16_REF = {
     0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf, 0x8c48,
     0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7, 0x1081, 0x0108,
     0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e, 0x9cc9, 0x8d40, 0xbfdb,
@@ -33,11 +61,38 @@ static const std::array<uint16_t, 256> CRC16_TAB = {
     0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330, 0x7bc7, 0x6a4e, 0x58d5, 0x495c,
     0x3de3, 0x2c6a, 0x1ef1, 0x0f78};
 
+static constexpr bool crc16_table_check() {
+  for (uint32_t i = 0; i < 256; i++) {
+    if (CRC16_TAB[0][i] != CRC16_REF[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(crc16_table_check(), "CRC16 table mismatch.");
+
 static inline uint16_t crc16_byte(uint16_t crc, const uint8_t DATA) {
-  return (crc >> 8) ^ CRC16_TAB[(crc ^ DATA) & 0xff];
+  return (crc >> 8) ^ CRC16_TAB[0][(crc ^ DATA) & 0xff];
 }
 
 uint16_t CRC16::Calculate(const uint8_t *buf, size_t len, uint16_t crc) {
+  while (len >= CRC_SLICE_NUM) {
+    uint16_t ans = CRC16_TAB[CRC_SLICE_NUM - 1][(crc ^ buf[0]) & 0xff] ^
+                   CRC16_TAB[CRC_SLICE_NUM - 2][((crc >> 8) ^ buf[1]) & 0xff];
+    for (uint32_t k = 2; k < CRC_SLICE_NUM; k++) {
+      ans ^= CRC16_TAB[CRC_SLICE_NUM - 1 - k][buf[k]];
+    }
+    crc = ans;
+    buf += CRC_SLICE_NUM;
+    len -= CRC_SLICE_NUM;
+  }
+
+  return CalculateBytewise(buf, len, crc);
+}
+
+uint16_t CRC16::CalculateBytewise(const uint8_t *buf, size_t len,
+                                  uint16_t crc) {
   while (len--) {
     crc = crc16_byte(crc, *buf++);
   }
@@ -4,10 +4,42 @@
 
 #define CRC16_INIT 0XFFFF
 
+/* 切片查表每次处理的字节数，主机上为8，MCU上为4以节省flash */
+#ifndef CRC_SLICE_NUM
+#if defined(__linux__)
+#define CRC_SLICE_NUM (8)
+#else
+#define CRC_SLICE_NUM (4)
+#endif
+#endif
+
 namespace Component {
 class CRC16 {
  public:
+  /* 增量计算，数据可以分段输入，适合边接收边校验 */
+  class Stream {
+   public:
+    explicit Stream(uint16_t init = CRC16_INIT) : init_(init), crc_(init) {}
+
+    void Update(const uint8_t *buf, size_t len) {
+      crc_ = Calculate(buf, len, crc_);
+    }
+
+    void Reset() { crc_ = init_; }
+
+    uint16_t Value() const { return crc_; }
+
+    /* 输入的数据包含末尾小端序的校验值时，校验通过结果为0 */
+    bool Check() const { return crc_ == 0; }
+
+   private:
+    uint16_t init_;
+    uint16_t crc_;
+  };
+
   static uint16_t Calculate(const uint8_t *buf, size_t len, uint16_t crc);
+  static uint16_t CalculateBytewise(const uint8_t *buf, size_t len,
+                                    uint16_t crc);
   static bool Verify(const uint8_t *buf, size_t len);
 };
 }  // namespace Component
@@ -0,0 +1,74 @@
+#include "comp_crc32.hpp"
+
+using namespace Component;
+
+typedef std::array<std::array<uint32_t, 256>, CRC_SLICE_NUM> CRC32Table;
+
+/* 第k张表为在crc后追加k个0字节的结果，用于一次处理多个字节 */
+static constexpr CRC32Table crc32_generate_table() {
+  CRC32Table tab = {};
+
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    tab[0][i] = crc;
+  }
+
+  for (uint32_t k = 1; k < CRC_SLICE_NUM; k++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      tab[k][i] = (tab[k - 1][i] >> 8) ^ tab[0][tab[k - 1][i] & 0xff];
+    }
+  }
+
+  return tab;
+}
+
+static constexpr CRC32Table CRC32_TAB = crc32_generate_table();
+
+static_assert(CRC32_TAB[0][1] == 0x77073096 && CRC32_TAB[0][255] == 0x2d02ef8d,
+              "CRC32 table mismatch.");
+
+uint32_t CRC32::Calculate(const uint8_t *buf, size_t len, uint32_t crc) {
+  crc = ~crc;
+
+  while (len >= CRC_SLICE_NUM) {
+    uint32_t ans = 0;
+    for (uint32_t k = 0; k < CRC_SLICE_NUM; k++) {
+      uint8_t byte = buf[k];
+      if (k < sizeof(uint32_t)) {
+        byte ^= static_cast<uint8_t>(crc >> (8 * k));
+      }
+      ans ^= CRC32_TAB[CRC_SLICE_NUM - 1 - k][byte];
+    }
+    crc = ans;
+    buf += CRC_SLICE_NUM;
+    len -= CRC_SLICE_NUM;
+  }
+
+  while (len--) {
+    crc = (crc >> 8) ^ CRC32_TAB[0][(crc ^ *buf++) & 0xff];
+  }
+
+  return ~crc;
+}
+
+uint32_t CRC32::CalculateBytewise(const uint8_t *buf, size_t len,
+                                  uint32_t crc) {
+  crc = ~crc;
+  while (len--) {
+    crc = (crc >> 8) ^ CRC32_TAB[0][(crc ^ *buf++) & 0xff];
+  }
+  return ~crc;
+}
+
+bool CRC32::Verify(const uint8_t *buf, size_t len) {
+  if (len < sizeof(uint32_t)) {
+    return false;
+  }
+
+  uint32_t expected;
+  memcpy(&expected, buf + len - sizeof(uint32_t), sizeof(expected));
+  return Calculate(buf, len - sizeof(uint32_t), CRC32_INIT) == expected;
+}
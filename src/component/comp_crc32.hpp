@@ -0,0 +1,43 @@
+#pragma once
+
+#include <component.hpp>
+
+/* 与zlib.crc32一致，初值和结果都已取反，可以直接分段传入上次的结果 */
+#define CRC32_INIT 0
+
+/* 切片查表每次处理的字节数，主机上为8，MCU上为4以节省flash */
+#ifndef CRC_SLICE_NUM
+#if defined(__linux__)
+#define CRC_SLICE_NUM (8)
+#else
+#define CRC_SLICE_NUM (4)
+#endif
+#endif
+
+namespace Component {
+class CRC32 {
+ public:
+  /* 增量计算，数据可以分段输入，适合边接收边校验 */
+  class Stream {
+   public:
+    explicit Stream(uint32_t init = CRC32_INIT) : init_(init), crc_(init) {}
+
+    void Update(const uint8_t *buf, size_t len) {
+      crc_ = Calculate(buf, len, crc_);
+    }
+
+    void Reset() { crc_ = init_; }
+
+    uint32_t Value() const { return crc_; }
+
+   private:
+    uint32_t init_;
+    uint32_t crc_;
+  };
+
+  static uint32_t Calculate(const uint8_t *buf, size_t len, uint32_t crc);
+  static uint32_t CalculateBytewise(const uint8_t *buf, size_t len,
+                                    uint32_t crc);
+  static bool Verify(const uint8_t *buf, size_t len);
+};
+}  // namespace Component
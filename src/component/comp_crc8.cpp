@@ -6,7 +6,34 @@
 
 using namespace Component;
 
-static const std::array<uint8_t, 256> CRC8_TAB = {
+typedef std::array<std::array<uint8_t, 256>, CRC_SLICE_NUM> CRC8Table;
+
+/* 第k张表为在crc后追加k个0字节的结果，用于一次处理多个字节 */
+static constexpr CRC8Table crc8_generate_table() {
+  CRC8Table tab = {};
+
+  for (uint32_t i = 0; i < 256; i++) {
+    uint8_t crc = static_cast<uint8_t>(i);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? static_cast<uint8_t>((crc >> 1) ^ 0x8c)
+                      : static_cast<uint8_t>(crc >> 1);
+    }
+    tab[0][i] = crc;
+  }
+
+  for (uint32_t k = 1; k < CRC_SLICE_NUM; k++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      tab[k][i] = tab[0][tab[k - 1][i]];
+    }
+  }
+
+  return tab;
+}
+
+static constexpr CRC8Table CRC8_TAB = crc8_generate_table();
+
+/* 原先的查找表，编译期逐项校验生成的表 */
+static constexpr std::array<uint8_t, 256> CRC8_REF = {
     0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83, 0xc2, 0x9c, 0x7e, 0x20,
     0xa3, 0xfd, 0x1f, 0x41, 0x9d, 0xc3, 0x21, 0x7f, 0xfc, 0xa2, 0x40, 0x1e,
     0x5f, 0x01, 0xe3, 0xbd, 0x3e, 0x60, 0x82, 0xdc, 0x23, 0x7d, 0x9f, 0xc1,
@@ -30,10 +57,35 @@ static const std::array<uint8_t, 256> CRC8_TAB = {
     0x74, 0x2a, 0xc8, 0x96, 0x15, 0x4b, 0xa9, 0xf7, 0xb6, 0xe8, 0x0a, 0x54,
     0xd7, 0x89, 0x6b, 0x35};
 
+static constexpr bool crc8_table_check() {
+  for (uint32_t i = 0; i < 256; i++) {
+    if (CRC8_TAB[0][i] != CRC8_REF[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(crc8_table_check(), "CRC8 table mismatch.");
+
 uint8_t CRC8::Calculate(const uint8_t *buf, size_t len, uint8_t crc) {
+  while (len >= CRC_SLICE_NUM) {
+    uint8_t ans = CRC8_TAB[CRC_SLICE_NUM - 1][crc ^ buf[0]];
+    for (uint32_t k = 1; k < CRC_SLICE_NUM; k++) {
+      ans ^= CRC8_TAB[CRC_SLICE_NUM - 1 - k][buf[k]];
+    }
+    crc = ans;
+    buf += CRC_SLICE_NUM;
+    len -= CRC_SLICE_NUM;
+  }
+
+  return CalculateBytewise(buf, len, crc);
+}
+
+uint8_t CRC8::CalculateBytewise(const uint8_t *buf, size_t len, uint8_t crc) {
   /* loop over the buffer data */
   while (len-- > 0) {
-    crc = CRC8_TAB[(crc ^ *buf++) & 0xff];
+    crc = CRC8_TAB[0][(crc ^ *buf++) & 0xff];
   }
   return crc;
 }
@@ -24,27 +24,40 @@ LowPassFilter2p::LowPassFilter2p(float sample_freq, float cutoff_freq)
     : cutoff_freq_(cutoff_freq),
       delay_element_1_(0.0f),
       delay_element_2_(0.0f) {
-  if (this->cutoff_freq_ <= 0.0f) {
+  float coeff[5];
+  Coefficient(sample_freq, cutoff_freq, coeff);
+
+  this->b0_ = coeff[0];
+  this->b1_ = coeff[1];
+  this->b2_ = coeff[2];
+
+  this->a1_ = coeff[3];
+  this->a2_ = coeff[4];
+}
+
+void LowPassFilter2p::Coefficient(float sample_freq, float cutoff_freq,
+                                  float *coeff) {
+  if (cutoff_freq <= 0.0f) {
     /* no filtering */
-    this->b0_ = 1.0f;
-    this->b1_ = 0.0f;
-    this->b2_ = 0.0f;
+    coeff[0] = 1.0f;
+    coeff[1] = 0.0f;
+    coeff[2] = 0.0f;
 
-    this->a1_ = 0.0f;
-    this->a2_ = 0.0f;
+    coeff[3] = 0.0f;
+    coeff[4] = 0.0f;
 
     return;
   }
-  const float FR = sample_freq / this->cutoff_freq_;
+  const float FR = sample_freq / cutoff_freq;
   const float OHM = tanf(M_PI / FR);
   const float C = 1.0f + 2.0f * cosf(M_PI / 4.0f) * OHM + OHM * OHM;
 
-  this->b0_ = OHM * OHM / C;
-  this->b1_ = 2.0f * this->b0_;
-  this->b2_ = this->b0_;
+  coeff[0] = OHM * OHM / C;
+  coeff[1] = 2.0f * coeff[0];
+  coeff[2] = coeff[0];
 
-  this->a1_ = 2.0f * (OHM * OHM - 1.0f) / C;
-  this->a2_ = (1.0f - 2.0f * cosf(M_PI / 4.0f) * OHM + OHM * OHM) / C;
+  coeff[3] = 2.0f * (OHM * OHM - 1.0f) / C;
+  coeff[4] = (1.0f - 2.0f * cosf(M_PI / 4.0f) * OHM + OHM * OHM) / C;
 }
 
 float LowPassFilter2p::Apply(float sample) {
@@ -30,6 +30,9 @@ class LowPassFilter2p {
 
   float Reset(float sample);
 
+  /* 计算滤波器系数，依次为b0 b1 b2 a1 a2，截止频率不大于0时不滤波 */
+  static void Coefficient(float sample_freq, float cutoff_freq, float *coeff);
+
  private:
   float cutoff_freq_; /* 截止频率 */
 
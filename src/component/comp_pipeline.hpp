@@ -0,0 +1,225 @@
+/*
+  多通道融合控制流水线。
+*/
+
+#pragma once
+
+#include <component.hpp>
+
+#include "comp_actuator.hpp"
+#include "comp_filter.hpp"
+#include "comp_simd.hpp"
+
+namespace Component {
+/* 流水线中可选的环节，编译期确定 */
+enum : uint32_t {
+  PIPELINE_IN_LPF = 1 << 0,  /* 反馈二阶低通，对应SpeedActuator的in_ */
+  PIPELINE_OUT_LPF = 1 << 1, /* 输出二阶低通，返回滤波后的值 */
+  PIPELINE_CYCLE = 1 << 2,   /* 误差按循环角度计算，这一步逐通道进行 */
+};
+
+/* N个通道的 低通->PID->限幅->低通，参数和状态按通道连续存放，
+ * 每4个通道用一次向量运算完成，运算顺序与PID::Calculate和
+ * LowPassFilter2p::Apply相同，不开启浮点乘加融合时结果逐位一致。
+ * 所有通道共用同一个dt，适用于同一控制线程中的多个电机 */
+template <uint32_t N, uint32_t FLAG = PIPELINE_IN_LPF>
+class Pipeline {
+ public:
+  static const uint32_t LANE = (N + 3) / 4 * 4;
+
+  typedef std::array<SpeedActuator::Param, N> Param;
+
+  Pipeline(const Param &param, float sample_freq)
+      : dt_min_(1.0f / sample_freq) {
+    ASSERT(isfinite(this->dt_min_));
+
+    for (uint32_t i = 0; i < N; i++) {
+      const PID::Param &pid = param[i].speed;
+
+      this->k_[i] = pid.k;
+      this->p_[i] = pid.p;
+      this->i_[i] = pid.i;
+      this->d_[i] = pid.d;
+      this->i_limit_[i] = pid.i_limit;
+      this->out_limit_[i] = pid.out_limit;
+
+      ASSERT(!pid.cycle || (FLAG & PIPELINE_CYCLE));
+
+      this->in_.Init(i, sample_freq, param[i].in_cutoff_freq);
+      this->dfilter_.Init(i, sample_freq, pid.d_cutoff_freq);
+      this->out_.Init(i, sample_freq, param[i].out_cutoff_freq);
+    }
+
+    this->Reset();
+  }
+
+  /* sp、fb和out均为N个通道 */
+  void Calculate(const float *sp, const float *fb, float dt, float *out) {
+    float in[LANE] = {}, err[LANE] = {}, ans[LANE];
+
+    memcpy(err, sp, sizeof(float) * N);
+    memcpy(in, fb, sizeof(float) * N);
+
+    vec4m_t all = vec4_mask(true);
+
+    if (FLAG & PIPELINE_IN_LPF) {
+      for (uint32_t i = 0; i < LANE; i += 4) {
+        vec4_store(in + i, this->in_.Apply(i, vec4_load(in + i), all));
+      }
+    }
+
+    /* fmodf没有向量版本，循环角度的误差逐通道计算 */
+    if (FLAG & PIPELINE_CYCLE) {
+      for (uint32_t i = 0; i < N; i++) {
+        if (isfinite(err[i]) && isfinite(in[i])) {
+          err[i] = Type::CycleValue(err[i]) - in[i];
+        } else {
+          err[i] = NAN;
+        }
+      }
+    }
+
+    const vec4m_t DT_OK = vec4_mask(isfinite(dt));
+    const vec4_t DT = vec4_dup(dt);
+    const vec4_t DT_D = vec4_dup(fmaxf(dt, this->dt_min_));
+    const vec4_t ZERO = vec4_dup(0.0f);
+    const vec4_t SIGMA = vec4_dup(0.000001f);
+
+    for (uint32_t i = 0; i < LANE; i += 4) {
+      vec4_t fb_v = vec4_load(in + i);
+      vec4_t err_v = vec4_load(err + i);
+      vec4_t k = vec4_load(this->k_ + i);
+      vec4_t last_out = vec4_load(this->last_out_ + i);
+
+      /* 输入不是有限值时保持上次输出，D项滤波器也不更新 */
+      vec4m_t ok = vec4_and(vec4_and(vec4_finite(err_v), vec4_finite(fb_v)),
+                            DT_OK);
+
+      if (!(FLAG & PIPELINE_CYCLE)) {
+        err_v = vec4_sub(err_v, fb_v);
+      }
+
+      vec4_t k_err = vec4_mul(err_v, k);
+
+      /* 通过fb计算D，避免了由于sp变化导致err突变的问题 */
+      vec4_t k_fb = this->dfilter_.Apply(i, vec4_mul(k, fb_v), ok);
+      vec4_t last_k_fb = vec4_load(this->last_k_fb_ + i);
+      vec4_t d = vec4_div(vec4_sub(k_fb, last_k_fb), DT_D);
+      vec4_store(this->last_k_fb_ + i, vec4_select(ok, k_fb, last_k_fb));
+
+      d = vec4_select(vec4_finite(d), d, ZERO);
+
+      vec4_t output = vec4_sub(vec4_mul(k_err, vec4_load(this->p_ + i)),
+                               vec4_mul(d, vec4_load(this->d_ + i)));
+
+      /* 积分未饱和时才使用新积分 */
+      vec4_t ki = vec4_load(this->i_ + i);
+      vec4_t out_limit = vec4_load(this->out_limit_ + i);
+      vec4_t last_i = vec4_load(this->integral_ + i);
+      vec4_t integral = vec4_add(last_i, vec4_mul(k_err, DT));
+      vec4_t i_out = vec4_mul(integral, ki);
+
+      vec4m_t update = vec4_and(ok, vec4_gt(ki, SIGMA));
+      update = vec4_and(update, vec4_finite(integral));
+      update = vec4_and(
+          update, vec4_le(vec4_abs(vec4_add(output, i_out)), out_limit));
+      update = vec4_and(update, vec4_le(vec4_abs(integral),
+                                        vec4_load(this->i_limit_ + i)));
+      vec4_store(this->integral_ + i, vec4_select(update, integral, last_i));
+
+      output = vec4_add(output, i_out);
+      ok = vec4_and(ok, vec4_finite(output));
+
+      /* 限幅 */
+      vec4_t clamped =
+          vec4_min(out_limit, vec4_max(output, vec4_sub(ZERO, out_limit)));
+      output = vec4_select(vec4_gt(out_limit, SIGMA), clamped, output);
+
+      last_out = vec4_select(ok, output, last_out);
+      vec4_store(this->last_out_ + i, last_out);
+
+      if (FLAG & PIPELINE_OUT_LPF) {
+        last_out = this->out_.Apply(i, last_out, all);
+      }
+
+      vec4_store(ans + i, last_out);
+    }
+
+    memcpy(out, ans, sizeof(float) * N);
+  }
+
+  void Reset() {
+    memset(this->integral_, 0, sizeof(this->integral_));
+    memset(this->last_k_fb_, 0, sizeof(this->last_k_fb_));
+    memset(this->last_out_, 0, sizeof(this->last_out_));
+    this->in_.Reset();
+    this->dfilter_.Reset();
+    this->out_.Reset();
+  }
+
+ private:
+  /* N路二阶低通，与LowPassFilter2p的运算顺序相同 */
+  class Filter {
+   public:
+    void Init(uint32_t index, float sample_freq, float cutoff_freq) {
+      float coeff[5];
+      LowPassFilter2p::Coefficient(sample_freq, cutoff_freq, coeff);
+      b0_[index] = coeff[0];
+      b1_[index] = coeff[1];
+      b2_[index] = coeff[2];
+      a1_[index] = coeff[3];
+      a2_[index] = coeff[4];
+    }
+
+    void Reset() {
+      memset(z1_, 0, sizeof(z1_));
+      memset(z2_, 0, sizeof(z2_));
+    }
+
+    /* update为0的通道只计算输出，不更新状态 */
+    vec4_t Apply(uint32_t i, vec4_t sample, vec4m_t update) {
+      vec4_t z1 = vec4_load(z1_ + i);
+      vec4_t z2 = vec4_load(z2_ + i);
+
+      vec4_t z0 = vec4_sub(vec4_sub(sample, vec4_mul(z1, vec4_load(a1_ + i))),
+                           vec4_mul(z2, vec4_load(a2_ + i)));
+      z0 = vec4_select(vec4_inf(z0), sample, z0);
+
+      vec4_t out = vec4_add(vec4_add(vec4_mul(z0, vec4_load(b0_ + i)),
+                                     vec4_mul(z1, vec4_load(b1_ + i))),
+                            vec4_mul(z2, vec4_load(b2_ + i)));
+
+      vec4_store(z2_ + i, vec4_select(update, z1, z2));
+      vec4_store(z1_ + i, vec4_select(update, z0, z1));
+
+      return out;
+    }
+
+   private:
+    float b0_[LANE] = {};
+    float b1_[LANE] = {};
+    float b2_[LANE] = {};
+    float a1_[LANE] = {};
+    float a2_[LANE] = {};
+    float z1_[LANE] = {};
+    float z2_[LANE] = {};
+  };
+
+  float dt_min_; /* 最小调用间隔 */
+
+  float k_[LANE] = {};
+  float p_[LANE] = {};
+  float i_[LANE] = {};
+  float d_[LANE] = {};
+  float i_limit_[LANE] = {};
+  float out_limit_[LANE] = {};
+
+  float integral_[LANE];
+  float last_k_fb_[LANE];
+  float last_out_[LANE];
+
+  Filter in_;
+  Filter dfilter_;
+  Filter out_;
+};
+}  // namespace Component
@@ -0,0 +1,267 @@
+/*
+  4路浮点向量运算，供批处理内核使用。
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* 主机上使用SSE/NEON，MCU上由FPU逐路计算 */
+#if defined(__SSE__)
+#define SIMD_NAME "sse"
+#elif defined(__ARM_NEON)
+#define SIMD_NAME "neon"
+#else
+#define SIMD_NAME "fpu"
+#endif
+
+/* -Os下也要内联，否则每次运算都经过栈传递 */
+#define SIMD_INLINE static inline __attribute__((always_inline, unused))
+
+namespace Component {
+#if defined(__SSE__)
+typedef __m128 vec4_t;
+typedef __m128 vec4m_t; /* 比较结果，每路全1或全0 */
+
+SIMD_INLINE vec4_t vec4_load(const float *p) { return _mm_loadu_ps(p); }
+
+SIMD_INLINE void vec4_store(float *p, vec4_t a) { _mm_storeu_ps(p, a); }
+
+SIMD_INLINE vec4_t vec4_set(float a, float b, float c, float d) {
+  return _mm_setr_ps(a, b, c, d);
+}
+
+SIMD_INLINE vec4_t vec4_dup(float a) { return _mm_set1_ps(a); }
+
+SIMD_INLINE vec4_t vec4_add(vec4_t a, vec4_t b) { return _mm_add_ps(a, b); }
+
+SIMD_INLINE vec4_t vec4_sub(vec4_t a, vec4_t b) { return _mm_sub_ps(a, b); }
+
+SIMD_INLINE vec4_t vec4_mul(vec4_t a, vec4_t b) { return _mm_mul_ps(a, b); }
+
+SIMD_INLINE vec4_t vec4_div(vec4_t a, vec4_t b) { return _mm_div_ps(a, b); }
+
+/* a + b * c */
+SIMD_INLINE vec4_t vec4_madd(vec4_t a, vec4_t b, vec4_t c) {
+  return _mm_add_ps(a, _mm_mul_ps(b, c));
+}
+
+SIMD_INLINE float vec4_dot(vec4_t a, vec4_t b) {
+  vec4_t m = _mm_mul_ps(a, b);
+  m = _mm_add_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_add_ss(m, _mm_shuffle_ps(m, m, 1));
+  return _mm_cvtss_f32(m);
+}
+
+/* 与comp_utils中的MAX/MIN一致，a > b ? a : b和a < b ? a : b */
+SIMD_INLINE vec4_t vec4_max(vec4_t a, vec4_t b) { return _mm_max_ps(a, b); }
+
+SIMD_INLINE vec4_t vec4_min(vec4_t a, vec4_t b) { return _mm_min_ps(a, b); }
+
+SIMD_INLINE vec4_t vec4_abs(vec4_t a) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+SIMD_INLINE vec4m_t vec4_le(vec4_t a, vec4_t b) { return _mm_cmple_ps(a, b); }
+
+SIMD_INLINE vec4m_t vec4_gt(vec4_t a, vec4_t b) { return _mm_cmpgt_ps(a, b); }
+
+SIMD_INLINE vec4m_t vec4_eq(vec4_t a, vec4_t b) { return _mm_cmpeq_ps(a, b); }
+
+SIMD_INLINE vec4m_t vec4_and(vec4m_t a, vec4m_t b) {
+  return _mm_and_ps(a, b);
+}
+
+SIMD_INLINE vec4m_t vec4_mask(bool a) {
+  return a ? _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps())
+           : _mm_setzero_ps();
+}
+
+/* m ? a : b */
+SIMD_INLINE vec4_t vec4_select(vec4m_t m, vec4_t a, vec4_t b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+#elif defined(__ARM_NEON)
+typedef float32x4_t vec4_t;
+typedef uint32x4_t vec4m_t;
+
+SIMD_INLINE vec4_t vec4_load(const float *p) { return vld1q_f32(p); }
+
+SIMD_INLINE void vec4_store(float *p, vec4_t a) { vst1q_f32(p, a); }
+
+SIMD_INLINE vec4_t vec4_set(float a, float b, float c, float d) {
+  const float tmp[4] = {a, b, c, d};
+  return vld1q_f32(tmp);
+}
+
+SIMD_INLINE vec4_t vec4_dup(float a) { return vdupq_n_f32(a); }
+
+SIMD_INLINE vec4_t vec4_add(vec4_t a, vec4_t b) { return vaddq_f32(a, b); }
+
+SIMD_INLINE vec4_t vec4_sub(vec4_t a, vec4_t b) { return vsubq_f32(a, b); }
+
+SIMD_INLINE vec4_t vec4_mul(vec4_t a, vec4_t b) { return vmulq_f32(a, b); }
+
+/* ARMv7的NEON只有倒数估计，逐路相除以保证结果与标量一致 */
+SIMD_INLINE vec4_t vec4_div(vec4_t a, vec4_t b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  float x[4], y[4];
+  vst1q_f32(x, a);
+  vst1q_f32(y, b);
+  for (int i = 0; i < 4; i++) {
+    x[i] /= y[i];
+  }
+  return vld1q_f32(x);
+#endif
+}
+
+SIMD_INLINE vec4_t vec4_madd(vec4_t a, vec4_t b, vec4_t c) {
+  return vmlaq_f32(a, b, c);
+}
+
+SIMD_INLINE float vec4_dot(vec4_t a, vec4_t b) {
+  float32x4_t m = vmulq_f32(a, b);
+  float32x2_t s = vadd_f32(vget_low_f32(m), vget_high_f32(m));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+SIMD_INLINE vec4_t vec4_max(vec4_t a, vec4_t b) { return vmaxq_f32(a, b); }
+
+SIMD_INLINE vec4_t vec4_min(vec4_t a, vec4_t b) { return vminq_f32(a, b); }
+
+SIMD_INLINE vec4_t vec4_abs(vec4_t a) { return vabsq_f32(a); }
+
+SIMD_INLINE vec4m_t vec4_le(vec4_t a, vec4_t b) { return vcleq_f32(a, b); }
+
+SIMD_INLINE vec4m_t vec4_gt(vec4_t a, vec4_t b) { return vcgtq_f32(a, b); }
+
+SIMD_INLINE vec4m_t vec4_eq(vec4_t a, vec4_t b) { return vceqq_f32(a, b); }
+
+SIMD_INLINE vec4m_t vec4_and(vec4m_t a, vec4m_t b) { return vandq_u32(a, b); }
+
+SIMD_INLINE vec4m_t vec4_mask(bool a) { return vdupq_n_u32(a ? ~0u : 0u); }
+
+SIMD_INLINE vec4_t vec4_select(vec4m_t m, vec4_t a, vec4_t b) {
+  return vbslq_f32(m, a, b);
+}
+#else
+/* Cortex-M4的SIMD指令只支持整数，浮点由FPU逐路计算。
+ * 逐路写出而不用循环，-O2下长度为4的循环不一定展开 */
+typedef struct {
+  float v[4];
+} vec4_t;
+
+typedef struct {
+  bool v[4];
+} vec4m_t;
+
+SIMD_INLINE vec4_t vec4_load(const float *p) {
+  return vec4_t{{p[0], p[1], p[2], p[3]}};
+}
+
+SIMD_INLINE void vec4_store(float *p, vec4_t a) {
+  p[0] = a.v[0];
+  p[1] = a.v[1];
+  p[2] = a.v[2];
+  p[3] = a.v[3];
+}
+
+SIMD_INLINE vec4_t vec4_set(float a, float b, float c, float d) {
+  return vec4_t{{a, b, c, d}};
+}
+
+SIMD_INLINE vec4_t vec4_dup(float a) { return vec4_t{{a, a, a, a}}; }
+
+SIMD_INLINE vec4_t vec4_add(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+                 a.v[3] + b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_sub(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+                 a.v[3] - b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_mul(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2],
+                 a.v[3] * b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_div(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2],
+                 a.v[3] / b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_madd(vec4_t a, vec4_t b, vec4_t c) {
+  return vec4_add(a, vec4_mul(b, c));
+}
+
+SIMD_INLINE float vec4_dot(vec4_t a, vec4_t b) {
+  return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] +
+         a.v[3] * b.v[3];
+}
+
+SIMD_INLINE vec4_t vec4_max(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] > b.v[0] ? a.v[0] : b.v[0],
+                 a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+                 a.v[2] > b.v[2] ? a.v[2] : b.v[2],
+                 a.v[3] > b.v[3] ? a.v[3] : b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_min(vec4_t a, vec4_t b) {
+  return vec4_t{{a.v[0] < b.v[0] ? a.v[0] : b.v[0],
+                 a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+                 a.v[2] < b.v[2] ? a.v[2] : b.v[2],
+                 a.v[3] < b.v[3] ? a.v[3] : b.v[3]}};
+}
+
+SIMD_INLINE vec4_t vec4_abs(vec4_t a) {
+  return vec4_t{{fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])}};
+}
+
+SIMD_INLINE vec4m_t vec4_le(vec4_t a, vec4_t b) {
+  return vec4m_t{{a.v[0] <= b.v[0], a.v[1] <= b.v[1], a.v[2] <= b.v[2],
+                  a.v[3] <= b.v[3]}};
+}
+
+SIMD_INLINE vec4m_t vec4_gt(vec4_t a, vec4_t b) {
+  return vec4m_t{{a.v[0] > b.v[0], a.v[1] > b.v[1], a.v[2] > b.v[2],
+                  a.v[3] > b.v[3]}};
+}
+
+SIMD_INLINE vec4m_t vec4_eq(vec4_t a, vec4_t b) {
+  return vec4m_t{{a.v[0] == b.v[0], a.v[1] == b.v[1], a.v[2] == b.v[2],
+                  a.v[3] == b.v[3]}};
+}
+
+SIMD_INLINE vec4m_t vec4_and(vec4m_t a, vec4m_t b) {
+  return vec4m_t{{a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2],
+                  a.v[3] && b.v[3]}};
+}
+
+SIMD_INLINE vec4m_t vec4_mask(bool a) { return vec4m_t{{a, a, a, a}}; }
+
+SIMD_INLINE vec4_t vec4_select(vec4m_t m, vec4_t a, vec4_t b) {
+  return vec4_t{{m.v[0] ? a.v[0] : b.v[0], m.v[1] ? a.v[1] : b.v[1],
+                 m.v[2] ? a.v[2] : b.v[2], m.v[3] ? a.v[3] : b.v[3]}};
+}
+#endif
+
+/* 有限值，NaN和无穷大为0 */
+SIMD_INLINE vec4m_t vec4_finite(vec4_t a) {
+  return vec4_le(vec4_abs(a), vec4_dup(FLT_MAX));
+}
+
+SIMD_INLINE vec4m_t vec4_inf(vec4_t a) {
+  return vec4_eq(vec4_abs(a), vec4_dup(INFINITY));
+}
+}  // namespace Component
@@ -10,63 +10,88 @@
 #define BETA_IMU (0.033f)
 using namespace Device;
 
+static const Component::Madgwick::Param MADGWICK_PARAM = {
+    .beta_imu = BETA_IMU,
+    .beta_ahrs = BETA_IMU,
+    .correct_div = AHRS_CORRECT_DIV,
+};
+
 AHRS::AHRS()
     : quat_tp_("imu_quat"),
       eulr_tp_("imu_eulr"),
+      madgwick_(MADGWICK_PARAM),
       cmd_(this, AHRS::ShowCMD, "AHRS", System::Term::DevDir()),
-      accl_ready_(false),
-      gyro_ready_(false),
+      gyro_queue_(AHRS_BATCH_NUM),
       ready_(false) {
   this->quat_.q0 = -1.0f;
   this->quat_.q1 = 0.0f;
   this->quat_.q2 = 0.0f;
   this->quat_.q3 = 0.0f;
 
+  this->madgwick_.Reset(this->quat_);
+
   auto ahrs_thread = [](AHRS *ahrs) {
     Message::Subscriber<Component::Type::Vector3> accl_sub("imu_accl");
-    Message::Subscriber<Component::Type::Vector3> gyro_sub("imu_gyro");
 
-    auto accl_cb = [](Component::Type::Vector3 &accl, AHRS *ahrs) {
-      static_cast<void>(accl);
-
-      ahrs->ready_.Post();
-
-      ahrs->accl_ready_.Post();
+    /* IMU在每组陀螺仪数据之前发布采样时间，没有时使用收到数据的时间 */
+    auto time_cb = [](uint64_t &time, AHRS *ahrs) {
+      ahrs->gyro_time_ = time;
 
       return true;
     };
 
+    /* 陀螺仪数据连同时间戳一起排队，批量处理时不会丢失积分 */
     auto gyro_cb = [](Component::Type::Vector3 &gyro, AHRS *ahrs) {
-      static_cast<void>(gyro);
+      GyroData data = {gyro, ahrs->gyro_time_ ? ahrs->gyro_time_
+                                              : bsp_time_get()};
 
-      ahrs->ready_.Post();
+      if (!ahrs->gyro_queue_.Send(data)) {
+        ahrs->gyro_drop_++;
+      }
 
-      ahrs->gyro_ready_.Post();
+      ahrs->ready_.Post();
 
       return true;
     };
 
-    (Message::Topic<Component::Type::Vector3>(
-         Message::Topic<Component::Type::Vector3>::Find("imu_accl")))
-        .RegisterCallback(accl_cb, ahrs);
-
     (Message::Topic<Component::Type::Vector3>(
          Message::Topic<Component::Type::Vector3>::Find("imu_gyro")))
         .RegisterCallback(gyro_cb, ahrs);
 
+    auto time_tp = Message::Topic<uint64_t>::Find("imu_time");
+    if (time_tp != NULL) {
+      Message::Topic<uint64_t>(time_tp).RegisterCallback(time_cb, ahrs);
+    }
+
     System::Thread::Sleep(10);
 
+    ahrs->last_wakeup_ = bsp_time_get();
+
+    Component::Madgwick::Sample sample[AHRS_BATCH_NUM];
+
     while (1) {
       ahrs->ready_.Wait(UINT32_MAX);
 
-      if (ahrs->accl_ready_.Wait(0)) {
-        accl_sub.DumpData(ahrs->accl_);
+      uint32_t num = 0;
+      GyroData data;
+
+      accl_sub.DumpData(ahrs->accl_);
+
+      /* 同一批数据使用最新的加速度计数据 */
+      while (num < AHRS_BATCH_NUM && ahrs->gyro_queue_.Receive(data)) {
+        sample[num].accl = ahrs->accl_;
+        sample[num].gyro = data.gyro;
+        ahrs->now_ = data.time;
+        num++;
       }
-      if (ahrs->gyro_ready_.Wait(0)) {
-        gyro_sub.DumpData(ahrs->gyro_);
+
+      if (num == 0) {
+        continue;
       }
 
-      ahrs->Update();
+      ahrs->gyro_ = sample[num - 1].gyro;
+
+      ahrs->Update(sample, num);
 
       /* 根据解析出来的四元数计算欧拉角 */
       ahrs->GetEulr();
@@ -83,6 +108,17 @@ AHRS::AHRS()
 int AHRS::ShowCMD(AHRS *ahrs, int argc, char **argv) {
   if (argc == 1) {
     printf("[show] [time] [delay] 在time时间内每隔delay打印一次数据\r\n");
+    printf("[bench] [num] 对比原有实现和批处理内核的耗时\r\n");
+    printf("[info] 查看丢弃的陀螺仪数据数量\r\n");
+  } else if (argc == 2) {
+    if (strcmp(argv[1], "info") == 0) {
+      printf("batch:%d correct_div:%d drop:%u\r\n", AHRS_BATCH_NUM,
+             AHRS_CORRECT_DIV, static_cast<unsigned int>(ahrs->gyro_drop_));
+    }
+  } else if (argc == 3) {
+    if (strcmp(argv[1], "bench") == 0) {
+      Component::Madgwick::Benchmark(std::stoi(argv[2]), AHRS_CORRECT_DIV);
+    }
   } else if (argc == 4) {
     if (strcmp(argv[1], "show") == 0) {
       int time = std::stoi(argv[2]);
@@ -111,118 +147,17 @@ int AHRS::ShowCMD(AHRS *ahrs, int argc, char **argv) {
   return 0;
 }
 
-static float recip_norm;
-static float s0, s1, s2, s3;
-static float q_dot1, q_dot2, q_dot3, q_dot4;
-static float q_2q0, q_2q1, q_2q2, q_2q3, q_4q0, q_4q1, q_4q2, q_8q1, q_8q2,
-    q0q0, q1q1, q2q2, q3q3;
+/* 时间间隔在批内平均分配，FIFO一次读出多组数据时时间戳相同也能正确积分 */
+void AHRS::Update(const Component::Madgwick::Sample *sample, uint32_t num) {
+  if (this->now_ < this->last_wakeup_) {
+    this->now_ = this->last_wakeup_;
+  }
 
-void AHRS::Update() {
-  this->now_ = bsp_time_get();
-  this->dt_ = TIME_DIFF(this->last_wakeup_, this->now_);
+  this->dt_ = TIME_DIFF(this->last_wakeup_, this->now_) / num;
   this->last_wakeup_ = this->now_;
 
-  float ax = this->accl_.x;
-  float ay = this->accl_.y;
-  float az = this->accl_.z;
-
-  float gx = this->gyro_.x;
-  float gy = this->gyro_.y;
-  float gz = this->gyro_.z;
-
-  /* Rate of change of quaternion from gyroscope */
-  q_dot1 =
-      0.5f * (-this->quat_.q1 * gx - this->quat_.q2 * gy - this->quat_.q3 * gz);
-  q_dot2 =
-      0.5f * (this->quat_.q0 * gx + this->quat_.q2 * gz - this->quat_.q3 * gy);
-  q_dot3 =
-      0.5f * (this->quat_.q0 * gy - this->quat_.q1 * gz + this->quat_.q3 * gx);
-  q_dot4 =
-      0.5f * (this->quat_.q0 * gz + this->quat_.q1 * gy - this->quat_.q2 * gx);
-
-  /* Compute feedback only if accelerometer measurement valid (avoids NaN in
-   * accelerometer normalisation) */
-  if (!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
-    /* Normalise accelerometer measurement */
-    recip_norm = inv_sqrtf(ax * ax + ay * ay + az * az);
-    ax *= recip_norm;
-    ay *= recip_norm;
-    az *= recip_norm;
-
-    /* Auxiliary variables to avoid repeated arithmetic */
-    q_2q0 = 2.0f * this->quat_.q0;
-    q_2q1 = 2.0f * this->quat_.q1;
-    q_2q2 = 2.0f * this->quat_.q2;
-    q_2q3 = 2.0f * this->quat_.q3;
-    q_4q0 = 4.0f * this->quat_.q0;
-    q_4q1 = 4.0f * this->quat_.q1;
-    q_4q2 = 4.0f * this->quat_.q2;
-    q_8q1 = 8.0f * this->quat_.q1;
-    q_8q2 = 8.0f * this->quat_.q2;
-    q0q0 = this->quat_.q0 * this->quat_.q0;
-    q1q1 = this->quat_.q1 * this->quat_.q1;
-    q2q2 = this->quat_.q2 * this->quat_.q2;
-    q3q3 = this->quat_.q3 * this->quat_.q3;
-
-    /* Gradient decent algorithm corrective step */
-    s0 = q_4q0 * q2q2 + q_2q2 * ax + q_4q0 * q1q1 - q_2q1 * ay;
-    s1 = q_4q1 * q3q3 - q_2q3 * ax + 4.0f * q0q0 * this->quat_.q1 - q_2q0 * ay -
-         q_4q1 + q_8q1 * q1q1 + q_8q1 * q2q2 + q_4q1 * az;
-    s2 = 4.0f * q0q0 * this->quat_.q2 + q_2q0 * ax + q_4q2 * q3q3 - q_2q3 * ay -
-         q_4q2 + q_8q2 * q1q1 + q_8q2 * q2q2 + q_4q2 * az;
-    s3 = 4.0f * q1q1 * this->quat_.q3 - q_2q1 * ax +
-         4.0f * q2q2 * this->quat_.q3 - q_2q2 * ay;
-
-    /* normalise step magnitude */
-    recip_norm = inv_sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
-
-    s0 *= recip_norm;
-    s1 *= recip_norm;
-    s2 *= recip_norm;
-    s3 *= recip_norm;
-
-    /* Apply feedback step */
-    q_dot1 -= BETA_IMU * s0;
-    q_dot2 -= BETA_IMU * s1;
-    q_dot3 -= BETA_IMU * s2;
-    q_dot4 -= BETA_IMU * s3;
-  }
-
-  /* Integrate rate of change of quaternion to yield quaternion */
-  this->quat_.q0 += q_dot1 * this->dt_;
-  this->quat_.q1 += q_dot2 * this->dt_;
-  this->quat_.q2 += q_dot3 * this->dt_;
-  this->quat_.q3 += q_dot4 * this->dt_;
-
-  /* Normalise quaternion */
-  recip_norm = inv_sqrtf(
-      this->quat_.q0 * this->quat_.q0 + this->quat_.q1 * this->quat_.q1 +
-      this->quat_.q2 * this->quat_.q2 + this->quat_.q3 * this->quat_.q3);
-  this->quat_.q0 *= recip_norm;
-  this->quat_.q1 *= recip_norm;
-  this->quat_.q2 *= recip_norm;
-  this->quat_.q3 *= recip_norm;
+  this->madgwick_.Update(sample, num, this->dt_);
+  this->madgwick_.GetQuat(this->quat_);
 }
 
-void AHRS::GetEulr() {
-  const float SINR_COSP = 2.0f * (this->quat_.q0 * this->quat_.q1 +
-                                  this->quat_.q2 * this->quat_.q3);
-  const float COSR_COSP = 1.0f - 2.0f * (this->quat_.q1 * this->quat_.q1 +
-                                         this->quat_.q2 * this->quat_.q2);
-  this->eulr_.pit = atan2f(SINR_COSP, COSR_COSP);
-
-  const float SINP = 2.0f * (this->quat_.q0 * this->quat_.q2 -
-                             this->quat_.q3 * this->quat_.q1);
-
-  if (fabsf(SINP) >= 1.0f) {
-    this->eulr_.rol = copysignf(M_PI / 2.0f, SINP);
-  } else {
-    this->eulr_.rol = asinf(SINP);
-  }
-
-  const float SINY_COSP = 2.0f * (this->quat_.q0 * this->quat_.q3 +
-                                  this->quat_.q1 * this->quat_.q2);
-  const float COSY_COSP = 1.0f - 2.0f * (this->quat_.q2 * this->quat_.q2 +
-                                         this->quat_.q3 * this->quat_.q3);
-  this->eulr_.yaw = atan2f(SINY_COSP, COSY_COSP);
-}
+void AHRS::GetEulr() { this->madgwick_.GetEulr(this->eulr_); }
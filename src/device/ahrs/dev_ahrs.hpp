@@ -7,18 +7,28 @@
 
 #include <device.hpp>
 
+#include "comp_ahrs.hpp"
+
+#define AHRS_BATCH_NUM (8)   /* 每次唤醒最多处理的陀螺仪数据组数 */
+#define AHRS_CORRECT_DIV (1) /* 每几组数据做一次加速度计校正 */
+
 namespace Device {
 class AHRS {
  public:
   AHRS();
 
-  void Update();
+  void Update(const Component::Madgwick::Sample *sample, uint32_t num);
 
   void GetEulr();
 
   static int ShowCMD(AHRS *ahrs, int argc, char **argv);
 
  private:
+  typedef struct {
+    Component::Type::Vector3 gyro;
+    uint64_t time;
+  } GyroData;
+
   uint64_t last_wakeup_ = 0;
   uint64_t now_ = 0;
   float dt_ = 0.0f;
@@ -35,10 +45,14 @@ class AHRS {
   Component::Type::Vector3 accl_{};
   Component::Type::Vector3 gyro_{};
 
+  Component::Madgwick madgwick_;
+
   System::Term::Command<AHRS *> cmd_;
 
-  System::Semaphore accl_ready_;
-  System::Semaphore gyro_ready_;
+  System::Queue<GyroData> gyro_queue_;
+  uint32_t gyro_drop_ = 0;
+  uint64_t gyro_time_ = 0; /* IMU发布的陀螺仪数据时间 */
+
   System::Semaphore ready_;
 };
 }  // namespace Device
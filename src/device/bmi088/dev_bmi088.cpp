@@ -28,10 +28,15 @@
 #define BMI088_REG_ACCL_INT_STAT_1 (0x1D)
 #define BMI088_REG_ACCL_TEMP_MSB (0x22)
 #define BMI088_REG_ACCL_TEMP_LSB (0x23)
+#define BMI088_REG_ACCL_FIFO_LENGTH_0 (0x24)
+#define BMI088_REG_ACCL_FIFO_LENGTH_1 (0x25)
+#define BMI088_REG_ACCL_FIFO_DATA (0x26)
 #define BMI088_REG_ACCL_CONF (0x40)
 #define BMI088_REG_ACCL_RANGE (0x41)
 #define BMI088_REG_ACCL_INT1_IO_CONF (0x53)
 #define BMI088_REG_ACCL_INT2_IO_CONF (0x54)
+#define BMI088_REG_ACCL_FIFO_CONFIG_0 (0x48)
+#define BMI088_REG_ACCL_FIFO_CONFIG_1 (0x49)
 #define BMI088_REG_ACCL_INT1_INT2_MAP_DATA (0x58)
 #define BMI088_REG_ACCL_SELF_TEST (0x6D)
 #define BMI088_REG_ACCL_PWR_CONF (0x7C)
@@ -46,6 +51,7 @@
 #define BMI088_REG_GYRO_Z_LSB (0x06)
 #define BMI088_REG_GYRO_Z_MSB (0x07)
 #define BMI088_REG_GYRO_INT_STAT_1 (0x0A)
+#define BMI088_REG_GYRO_FIFO_STATUS (0x0E)
 #define BMI088_REG_GYRO_RANGE (0x0F)
 #define BMI088_REG_GYRO_BANDWIDTH (0x10)
 #define BMI088_REG_GYRO_LPM1 (0x11)
@@ -53,7 +59,11 @@
 #define BMI088_REG_GYRO_INT_CTRL (0x15)
 #define BMI088_REG_GYRO_INT3_INT4_IO_CONF (0x16)
 #define BMI088_REG_GYRO_INT3_INT4_IO_MAP (0x18)
+#define BMI088_REG_GYRO_FIFO_WM_ENABLE (0x1E)
 #define BMI088_REG_GYRO_SELF_TEST (0x3C)
+#define BMI088_REG_GYRO_FIFO_CONFIG_0 (0x3D)
+#define BMI088_REG_GYRO_FIFO_CONFIG_1 (0x3E)
+#define BMI088_REG_GYRO_FIFO_DATA (0x3F)
 
 #define BMI088_CHIP_ID_ACCL (0x1E)
 #define BMI088_CHIP_ID_GYRO (0x0F)
@@ -61,9 +71,19 @@
 #define BMI088_ACCL_RX_BUFF_LEN (19)
 #define BMI088_GYRO_RX_BUFF_LEN (6)
 
+#define BMI088_GYRO_FRAME_LEN (6) /* 陀螺仪FIFO每组数据的长度 */
+#define BMI088_ACCL_FRAME_LEN (7) /* 加速度计FIFO每帧长度，含帧头 */
+#define BMI088_FIFO_BUFF_LEN (BMI088_FIFO_MAX_FRAME * BMI088_ACCL_FRAME_LEN + 1)
+
 static uint8_t tx_rx_buf[2];
 
 static uint8_t dma_buf[BMI088_ACCL_RX_BUFF_LEN + BMI088_GYRO_RX_BUFF_LEN];
+
+#if BMI088_FIFO_WATERMARK
+static_assert(BMI088_FIFO_BUFF_LEN <= UINT8_MAX, "FIFO read too long");
+
+static uint8_t fifo_buf[BMI088_FIFO_BUFF_LEN];
+#endif
 static Component::PID::Param imu_temp_ctrl_pid_param = {
     .k = 0.1f,
     .p = 1.0f,
@@ -124,6 +144,14 @@ void BMI088::Read(BMI088::DeviceType type, uint8_t reg, uint8_t *data,
   bsp_spi_mem_read(BSP_SPI_IMU, reg, data, len, false);
 }
 
+/* 不带延时的阻塞读取，用于在采样线程中读取FIFO长度等短数据 */
+void BMI088::ReadBlock(BMI088::DeviceType type, uint8_t reg, uint8_t *data,
+                       uint8_t len) {
+  this->Select(type);
+  bsp_spi_mem_read(BSP_SPI_IMU, reg, data, len, true);
+  this->Unselect(type);
+}
+
 BMI088::BMI088(BMI088::Rotation &rot)
     : cali_("bmi088_cali"),
       rot_(rot),
@@ -134,6 +162,7 @@ BMI088::BMI088(BMI088::Rotation &rot)
       new_(0),
       accl_tp_("imu_accl"),
       gyro_tp_("imu_gyro"),
+      time_tp_("imu_time"),
       cmd_(this, this->CaliCMD, "bmi088") {
   auto recv_cplt_callback = [](void *arg) {
     BMI088 *bmi088 = static_cast<BMI088 *>(arg);
@@ -156,6 +185,7 @@ BMI088::BMI088(BMI088::Rotation &rot)
 
   auto gyro_int_callback = [](void *arg) {
     BMI088 *bmi088 = static_cast<BMI088 *>(arg);
+    bmi088->int_time_ = bsp_time_get();
     bmi088->new_.Post();
     bmi088->gyro_new_.Post();
   };
@@ -183,6 +213,9 @@ BMI088::BMI088(BMI088::Rotation &rot)
        * 一次只能开启一个DMA
        */
       if (bmi088->new_.Wait(20)) {
+#if BMI088_FIFO_WATERMARK
+        bmi088->ReadFifo();
+#else
         if (bmi088->accl_new_.Wait(0)) {
           bmi088->StartRecvAccel();
           bmi088->accl_raw_.Wait(UINT32_MAX);
@@ -195,8 +228,10 @@ BMI088::BMI088(BMI088::Rotation &rot)
           bmi088->StartRecvGyro();
           bmi088->gyro_raw_.Wait(UINT32_MAX);
           bmi088->PraseGyro();
+          bmi088->time_tp_.Publish(bmi088->int_time_);
           bmi088->gyro_tp_.Publish(bmi088->gyro_);
         }
+#endif
 
         /* PID控制IMU温度，PWM输出 */
         bsp_pwm_set_comp(BSP_PWM_IMU_HEAT,
@@ -221,11 +256,15 @@ int BMI088::CaliCMD(BMI088 *bmi088, int argc, char **argv) {
     printf("show [time] [delay] 在time时间内每隔delay打印一次数据\r\n");
     printf("list 列出校准数据\r\n");
     printf("cali 开始校准\r\n");
+    printf("fifo 查看FIFO状态\r\n");
   } else if (argc == 2) {
     if (strcmp(argv[1], "list") == 0) {
       printf("校准数据 x:%f y:%f z:%f\r\n", bmi088->cali_.data_.gyro_offset.x,
              bmi088->cali_.data_.gyro_offset.y,
              bmi088->cali_.data_.gyro_offset.z);
+    } else if (strcmp(argv[1], "fifo") == 0) {
+      printf("watermark:%d overrun:%u\r\n", BMI088_FIFO_WATERMARK,
+             static_cast<unsigned int>(bmi088->fifo_overrun_));
     } else if (strcmp(argv[1], "cali") == 0) {
       printf("开始校准，请保持陀螺仪稳定\r\n");
       double x = 0.0f, y = 0.0f, z = 0.0f;
@@ -336,7 +375,13 @@ bool BMI088::Init() {
   WriteSingle(BMI_ACCL, BMI088_REG_ACCL_PWR_CTRL, 0x04);
   System::Thread::Sleep(50);
 
+#if BMI088_FIFO_WATERMARK
+  /* Stream mode. Accl data in FIFO. Read together with gyro FIFO. */
+  WriteSingle(BMI_ACCL, BMI088_REG_ACCL_FIFO_CONFIG_0, 0x02);
+  WriteSingle(BMI_ACCL, BMI088_REG_ACCL_FIFO_CONFIG_1, 0x50);
+#else
   bsp_gpio_enable_irq(BSP_GPIO_IMU_ACCL_INT);
+#endif
 
   /* Gyro init. */
   /* 0x00: +-2000. 0x01: +-1000. 0x02: +-500. 0x03: +-250. 0x04: +-125. */
@@ -349,11 +394,26 @@ bool BMI088::Init() {
   /* INT3 and INT4 as output. Push-pull. Active low. */
   WriteSingle(BMI_GYRO, BMI088_REG_GYRO_INT3_INT4_IO_CONF, 0x00);
 
+#if BMI088_FIFO_WATERMARK
+  /* Stream mode. X, Y, Z data. */
+  WriteSingle(BMI_GYRO, BMI088_REG_GYRO_FIFO_CONFIG_1, 0x80);
+
+  /* Watermark level in frames. */
+  WriteSingle(BMI_GYRO, BMI088_REG_GYRO_FIFO_CONFIG_0, BMI088_FIFO_WATERMARK);
+  WriteSingle(BMI_GYRO, BMI088_REG_GYRO_FIFO_WM_ENABLE, 0x88);
+
+  /* Map FIFO interrupt to INT3. */
+  WriteSingle(BMI_GYRO, BMI088_REG_GYRO_INT3_INT4_IO_MAP, 0x04);
+
+  /* Enable FIFO interrupt. */
+  WriteSingle(BMI_GYRO, BMI088_REG_GYRO_INT_CTRL, 0x40);
+#else
   /* Map data ready interrupt to INT3. */
   WriteSingle(BMI_GYRO, BMI088_REG_GYRO_INT3_INT4_IO_MAP, 0x01);
 
   /* Enable new data interrupt. */
   WriteSingle(BMI_GYRO, BMI088_REG_GYRO_INT_CTRL, 0x80);
+#endif
 
   System::Thread::Sleep(50);
   bsp_gpio_enable_irq(BSP_GPIO_IMU_GYRO_INT);
@@ -362,10 +422,14 @@ bool BMI088::Init() {
 }
 
 void BMI088::PraseGyro() {
+  this->ConvertGyro(dma_buf + BMI088_ACCL_RX_BUFF_LEN);
+}
+
+void BMI088::ConvertGyro(const uint8_t *raw) {
   int16_t raw_x = 0, raw_y = 0, raw_z = 0;
-  memcpy(&raw_x, dma_buf + BMI088_ACCL_RX_BUFF_LEN, sizeof(raw_x));
-  memcpy(&raw_y, dma_buf + BMI088_ACCL_RX_BUFF_LEN + 2, sizeof(raw_y));
-  memcpy(&raw_z, dma_buf + BMI088_ACCL_RX_BUFF_LEN + 4, sizeof(raw_z));
+  memcpy(&raw_x, raw, sizeof(raw_x));
+  memcpy(&raw_y, raw + 2, sizeof(raw_y));
+  memcpy(&raw_z, raw + 4, sizeof(raw_z));
 
   std::array<float, 3> gyro = {static_cast<float>(raw_x),
                                static_cast<float>(raw_y),
@@ -393,10 +457,23 @@ void BMI088::PraseGyro() {
 }
 
 void BMI088::PraseAccel() {
+  this->ConvertAccel(dma_buf + 1);
+
+  int16_t raw_temp =
+      static_cast<int16_t>((dma_buf[17] << 3) | (dma_buf[18] >> 5));
+
+  if (raw_temp > 1023) {
+    raw_temp -= 2048;
+  }
+
+  this->temp_ = static_cast<float>(raw_temp) * 0.125f + 23.0f;
+}
+
+void BMI088::ConvertAccel(const uint8_t *raw) {
   int16_t raw_x = 0, raw_y = 0, raw_z = 0;
-  memcpy(&raw_x, dma_buf + 1, sizeof(raw_x));
-  memcpy(&raw_y, dma_buf + 3, sizeof(raw_y));
-  memcpy(&raw_z, dma_buf + 5, sizeof(raw_z));
+  memcpy(&raw_x, raw, sizeof(raw_x));
+  memcpy(&raw_y, raw + 2, sizeof(raw_y));
+  memcpy(&raw_z, raw + 4, sizeof(raw_z));
 
   std::array<float, 3> accl = {static_cast<float>(raw_x),
                                static_cast<float>(raw_y),
@@ -407,15 +484,6 @@ void BMI088::PraseAccel() {
     it /= 5640.0f;
   }
 
-  int16_t raw_temp =
-      static_cast<int16_t>((dma_buf[17] << 3) | (dma_buf[18] >> 5));
-
-  if (raw_temp > 1023) {
-    raw_temp -= 2048;
-  }
-
-  this->temp_ = static_cast<float>(raw_temp) * 0.125f + 23.0f;
-
   memset(&(this->accl_), 0, sizeof(this->accl_));
 
   for (int i = 0; i < 3; i++) {
@@ -435,3 +503,90 @@ bool BMI088::StartRecvAccel() {
   Read(BMI_ACCL, BMI088_REG_ACCL_X_LSB, dma_buf, BMI088_ACCL_RX_BUFF_LEN);
   return true;
 }
+
+#if BMI088_FIFO_WATERMARK
+/* 一次读出两个FIFO中的数据，先发布加速度计，再逐组发布陀螺仪。
+ * 陀螺仪数据的时间在上一组和本次最后一组之间线性插值 */
+void BMI088::ReadFifo() {
+  uint64_t now = bsp_time_get();
+
+  /* 陀螺仪FIFO状态，低7位为数据组数，最高位为溢出标志 */
+  this->ReadBlock(BMI_GYRO, BMI088_REG_GYRO_FIFO_STATUS, fifo_buf, 1);
+  uint8_t gyro_num = fifo_buf[0] & 0x7f;
+  if (fifo_buf[0] & 0x80) {
+    this->fifo_overrun_++;
+  }
+
+  /* 加速度计读取的第一个字节无效 */
+  this->ReadBlock(BMI_ACCL, BMI088_REG_ACCL_FIFO_LENGTH_0, fifo_buf, 3);
+  uint16_t accl_len = static_cast<uint16_t>((fifo_buf[1] | fifo_buf[2] << 8) &
+                                            0x3fff);
+  if (accl_len > BMI088_FIFO_BUFF_LEN - 1) {
+    accl_len = BMI088_FIFO_BUFF_LEN - 1;
+  }
+
+  if (accl_len > 0) {
+    this->Read(BMI_ACCL, BMI088_REG_ACCL_FIFO_DATA, fifo_buf, accl_len + 1);
+    this->accl_raw_.Wait(UINT32_MAX);
+
+    /* 只处理完整的帧，没读完的帧下次会重新读出 */
+    for (uint16_t pos = 1; pos < accl_len + 1;) {
+      uint8_t header = fifo_buf[pos] & 0xfc;
+      if (header == 0x84) {
+        if (pos + BMI088_ACCL_FRAME_LEN > accl_len + 1) {
+          break;
+        }
+        this->ConvertAccel(fifo_buf + pos + 1);
+        this->accl_tp_.Publish(this->accl_);
+        pos += BMI088_ACCL_FRAME_LEN;
+      } else if (header == 0x40 || header == 0x48 || header == 0x50) {
+        /* 跳过帧、配置变化帧、丢弃帧 */
+        pos += 2;
+      } else if (header == 0x44) {
+        /* 传感器时间帧 */
+        pos += 4;
+      } else {
+        break;
+      }
+    }
+  }
+
+  this->ReadBlock(BMI_ACCL, BMI088_REG_ACCL_TEMP_MSB, fifo_buf, 3);
+  int16_t raw_temp =
+      static_cast<int16_t>((fifo_buf[1] << 3) | (fifo_buf[2] >> 5));
+  if (raw_temp > 1023) {
+    raw_temp -= 2048;
+  }
+  this->temp_ = static_cast<float>(raw_temp) * 0.125f + 23.0f;
+
+  if (gyro_num == 0) {
+    return;
+  }
+
+  if (gyro_num > BMI088_FIFO_MAX_FRAME) {
+    gyro_num = BMI088_FIFO_MAX_FRAME;
+    /* 没读完的数据不会再触发水位中断 */
+    this->new_.Post();
+  }
+
+  this->Read(BMI_GYRO, BMI088_REG_GYRO_FIFO_DATA, fifo_buf,
+             gyro_num * BMI088_GYRO_FRAME_LEN);
+  this->gyro_raw_.Wait(UINT32_MAX);
+
+  /* 正好达到水位时最后一组数据在中断时产生，否则按读取时间估计 */
+  uint64_t last = gyro_num == BMI088_FIFO_WATERMARK ? this->int_time_ : now;
+  if (this->last_time_ == 0 || last < this->last_time_) {
+    this->last_time_ = last;
+  }
+
+  uint64_t span = last - this->last_time_;
+
+  for (uint8_t i = 0; i < gyro_num; i++) {
+    this->ConvertGyro(fifo_buf + i * BMI088_GYRO_FRAME_LEN);
+    this->time_tp_.Publish(this->last_time_ + span * (i + 1) / gyro_num);
+    this->gyro_tp_.Publish(this->gyro_);
+  }
+
+  this->last_time_ = last;
+}
+#endif
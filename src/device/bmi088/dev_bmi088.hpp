@@ -5,6 +5,12 @@
 
 #include "dev_ahrs.hpp"
 
+/* FIFO水位，达到后一次读出FIFO中的全部数据，0为每组数据中断一次 */
+#ifndef BMI088_FIFO_WATERMARK
+#define BMI088_FIFO_WATERMARK (0)
+#endif
+#define BMI088_FIFO_MAX_FRAME (32) /* 每次最多读出的数据组数 */
+
 namespace Device {
 class BMI088 {
  public:
@@ -34,6 +40,8 @@ class BMI088 {
 
   bool StartRecvAccel();
 
+  void ReadFifo();
+
   void Select(DeviceType type);
 
   void Unselect(DeviceType type);
@@ -44,9 +52,15 @@ class BMI088 {
 
   void Read(DeviceType type, uint8_t reg, uint8_t *data, uint8_t len);
 
+  void ReadBlock(DeviceType type, uint8_t reg, uint8_t *data, uint8_t len);
+
   static int CaliCMD(BMI088 *bmi088, int argc, char **argv);
 
  private:
+  void ConvertGyro(const uint8_t *raw);
+
+  void ConvertAccel(const uint8_t *raw);
+
   System::Database::Key<Calibration> cali_;
   Rotation &rot_;
 
@@ -58,10 +72,15 @@ class BMI088 {
 
   float temp_ = 0.0f; /* 温度 */
 
+  uint64_t int_time_ = 0;  /* 陀螺仪中断时间 */
+  uint64_t last_time_ = 0; /* 上一组陀螺仪数据的时间 */
+  uint32_t fifo_overrun_ = 0;
+
   System::Thread thread_accl_, thread_gyro_;
 
   Message::Topic<Component::Type::Vector3> accl_tp_;
   Message::Topic<Component::Type::Vector3> gyro_tp_;
+  Message::Topic<uint64_t> time_tp_;
 
   Component::Type::Vector3 accl_{};
   Component::Type::Vector3 gyro_{};
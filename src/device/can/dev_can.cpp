@@ -8,15 +8,32 @@ std::array<Message::Topic<Can::Pack>*, BSP_CAN_NUM> Can::can_tp_;
 
 std::array<System::Semaphore*, BSP_CAN_NUM> Can::can_sem_;
 
+std::array<Can::Dispatcher*, BSP_CAN_NUM> Can::dispatcher_;
+
+std::array<Can::Scheduler*, BSP_CAN_NUM> Can::scheduler_;
+
+System::Semaphore* Can::tx_sem_;
+
 static std::array<Can::Pack, BSP_CAN_NUM> pack;
 
-Can::Can() {
+static System::Semaphore* rtt_sem;
+static uint32_t rtt_rx_cycle;
+
+Can::Can()
+    : cmd_(this, ShowInfo, "can", System::Term::DevDir()),
+      rtt_bench_("can_rtt", RttSample, NULL, RttSetup) {
   for (int i = 0; i < BSP_CAN_NUM; i++) {
     can_tp_[i] =
         new Message::Topic<Can::Pack>(("dev_can_" + std::to_string(i)).c_str());
     can_sem_[i] = new System::Semaphore(true);
+    dispatcher_[i] = new Dispatcher();
+    scheduler_[i] = new Scheduler();
   }
 
+  tx_sem_ = new System::Semaphore(0);
+
+  rtt_sem = new System::Semaphore(0);
+
   auto rx_callback = [](bsp_can_t can, uint32_t id, uint8_t* data, void* arg) {
     XB_UNUSED(arg);
 
@@ -24,7 +41,33 @@ Can::Can() {
 
     memcpy(pack[can].data, data, sizeof(pack[can].data));
 
+    dispatcher_[can]->Dispatch(pack[can]);
+
     can_tp_[can]->Publish(pack[can]);
+
+    if (scheduler_[can]->Sync(id)) {
+      tx_sem_->Post();
+    }
+  };
+
+  auto tx_thread = [](void* arg) {
+    XB_UNUSED(arg);
+
+    while (1) {
+      /* 没有写入者时一直等待，由WriteTx或同步帧唤醒 */
+      bool busy = false;
+      for (int i = 0; i < BSP_CAN_NUM; i++) {
+        busy = busy || !scheduler_[i]->Idle();
+      }
+
+      tx_sem_->Wait(busy ? DEV_CAN_TX_TIMEOUT : UINT32_MAX);
+
+      for (int i = 0; i < BSP_CAN_NUM; i++) {
+        if (scheduler_[i]->Due()) {
+          scheduler_[i]->Flush(static_cast<bsp_can_t>(i));
+        }
+      }
+    }
   };
 
   for (int i = 0; i < BSP_CAN_NUM; i++) {
@@ -33,11 +76,16 @@ Can::Can() {
   }
 
   bsp_can_init();
+
+  this->tx_thread_.Create(tx_thread, static_cast<void*>(NULL), "can_tx",
+                          DEV_CAN_TX_TASK_STACK_DEPTH,
+                          System::Thread::REALTIME);
 }
 
 bool Can::SendPack(bsp_can_t can, bsp_can_format_t format, Pack& pack) {
   can_sem_[can]->Wait(UINT32_MAX);
   bool ans = bsp_can_trans_packet(can, format, pack.index, pack.data) == BSP_OK;
+  scheduler_[can]->Count(format);
   can_sem_[can]->Post();
   return ans;
 }
@@ -46,6 +94,7 @@ bool Can::SendStdPack(bsp_can_t can, Pack& pack) {
   can_sem_[can]->Wait(UINT32_MAX);
   bool ans = bsp_can_trans_packet(can, CAN_FORMAT_STD, pack.index, pack.data) ==
              BSP_OK;
+  scheduler_[can]->Count(CAN_FORMAT_STD);
   can_sem_[can]->Post();
   return ans;
 }
@@ -54,6 +103,7 @@ bool Can::SendExtPack(bsp_can_t can, Pack& pack) {
   can_sem_[can]->Wait(UINT32_MAX);
   bool ans = bsp_can_trans_packet(can, CAN_FORMAT_EXT, pack.index, pack.data) ==
              BSP_OK;
+  scheduler_[can]->Count(CAN_FORMAT_EXT);
   can_sem_[can]->Post();
   return ans;
 }
@@ -62,7 +112,474 @@ bool Can::Subscribe(Message::Topic<Can::Pack>& tp, bsp_can_t can,
                     uint32_t index, uint32_t num) {
   ASSERT(num > 0);
 
-  can_tp_[can]->RangeDivide(tp, sizeof(Pack), offsetof(Pack, index),
-                            om_member_size_of(Pack, index), index, num);
+  auto publish_fn = [](Pack& pack, void* arg) {
+    static_cast<Message::Topic<Can::Pack>*>(arg)->Publish(pack);
+  };
+
+  bool ans = dispatcher_[can]->Add(index, num, publish_fn,
+                                   new Message::Topic<Can::Pack>(tp));
+  ASSERT(ans);
+
+  return ans;
+}
+
+bool Can::AddHandler(bsp_can_t can, uint32_t index, uint32_t num,
+                     Dispatcher::Handler fn, void* arg) {
+  ASSERT(num > 0);
+
+  bool ans = dispatcher_[can]->Add(index, num, fn, arg);
+  ASSERT(ans);
+
+  return ans;
+}
+
+bool Can::Dispatcher::Add(uint32_t index, uint32_t num, Handler fn,
+                          void* arg) {
+  lock_.Lock();
+
+  if (slot_num_ >= DEV_CAN_DISPATCH_SLOT_NUM) {
+    lock_.Unlock();
+    return false;
+  }
+
+  /* 槽位只有在被节点或范围表引用后才会被中断读到 */
+  uint8_t slot = slot_num_ + 1;
+  slot_[slot] = {fn, arg, index, num};
+  slot_num_++;
+
+  /* 范围过大或展开后空间不足时退化为逐个比较。
+   * 先检查全部容量再展开，不会出现只有部分ID生效的情况 */
+  if (num > DEV_CAN_DISPATCH_RANGE_MAX ||
+      node_num_ + num > DEV_CAN_DISPATCH_NODE_NUM || !ExtFits(index, num)) {
+    uint8_t range_num = range_num_.load(std::memory_order_relaxed);
+    range_[range_num] = slot;
+    range_num_.store(range_num + 1, std::memory_order_release);
+  } else {
+    for (uint32_t i = 0; i < num; i++) {
+      Link(index + i, slot);
+    }
+  }
+
+  lock_.Unlock();
+
+  return true;
+}
+
+bool Can::Dispatcher::ExtFits(uint32_t index, uint32_t num) {
+  uint32_t need = 0, free = 0;
+
+  for (uint32_t i = 0; i < num; i++) {
+    uint32_t id = index + i;
+    if (id >= DEV_CAN_STD_ID_NUM && FindExt(id) == 0) {
+      need++;
+    }
+  }
+
+  if (need == 0) {
+    return true;
+  }
+
+  for (auto& entry : ext_table_) {
+    if (entry.node.load(std::memory_order_relaxed) == 0) {
+      free++;
+    }
+  }
+
+  return need <= free;
+}
+
+bool Can::Dispatcher::Link(uint32_t id, uint8_t slot) {
+  uint8_t node = node_num_ + 1;
+  node_[node].slot = slot;
+
+  /* 节点写完后再发布为链表头，中断中读到的链表始终完整 */
+  if (id < DEV_CAN_STD_ID_NUM) {
+    node_[node].next = std_table_[id].load(std::memory_order_relaxed);
+    node_num_++;
+    std_table_[id].store(node, std::memory_order_release);
+    return true;
+  }
+
+  for (uint32_t i = 0, pos = Hash(id); i < DEV_CAN_EXT_HASH_SIZE;
+       i++, pos = (pos + 1) & (DEV_CAN_EXT_HASH_SIZE - 1)) {
+    ExtEntry& entry = ext_table_[pos];
+    uint8_t head = entry.node.load(std::memory_order_relaxed);
+    if (head == 0 || entry.id == id) {
+      node_[node].next = head;
+      node_num_++;
+      entry.id = id;
+      entry.node.store(node, std::memory_order_release);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool Can::AddTxSlot(bsp_can_t can, bsp_can_format_t format, uint32_t index,
+                    uint8_t offset, uint8_t len, uint32_t sync_id,
+                    Scheduler::Slot& slot) {
+  bool ans = scheduler_[can]->Add(format, index, offset, len, sync_id, slot);
+  ASSERT(ans);
+
+  return ans;
+}
+
+bool Can::Scheduler::Add(bsp_can_format_t format, uint32_t index,
+                         uint8_t offset, uint8_t len, uint32_t sync_id,
+                         Slot& slot) {
+  if (len == 0 || offset + len > 8) {
+    return false;
+  }
+
+  uint8_t frame = 0;
+  while (frame < frame_num_ &&
+         (frame_[frame].index != index || frame_[frame].format != format)) {
+    frame++;
+  }
+
+  if (frame == frame_num_) {
+    if (frame_num_ >= DEV_CAN_TX_FRAME_NUM) {
+      return false;
+    }
+    frame_[frame].index = index;
+    frame_[frame].format = format;
+  }
+
+  Frame& target = frame_[frame];
+  if (target.writer_num >= DEV_CAN_TX_WRITER_NUM) {
+    return false;
+  }
+
+  Writer& writer = target.writer[target.writer_num];
+  writer.offset = offset;
+  writer.len = len;
+
+  slot.frame = frame;
+  slot.writer = target.writer_num;
+
+  target.writer_num++;
+
+  /* 以第一个注册的反馈帧作为发送相位基准，都不同步时按周期发送 */
+  if (sync_id_ == DEV_CAN_TX_NO_SYNC) {
+    sync_id_ = sync_id;
+  }
+
+  if (frame == frame_num_) {
+    frame_num_++;
+  }
+
   return true;
 }
+
+bool Can::Scheduler::Compose(Frame& frame, uint32_t now) {
+  bool active = false, fresh = true;
+
+  for (uint8_t j = 0; j < frame.writer_num; j++) {
+    Writer& writer = frame.writer[j];
+    uint32_t seq = writer.seq.load(std::memory_order_acquire);
+
+    /* 清除或超时的写入者清零，避免停止控制的模块的输出被一直重发。
+     * 写入时间可能晚于now，按有符号数比较 */
+    if (seq == 0 ||
+        static_cast<int32_t>(now - writer.time) > DEV_CAN_TX_HOLD) {
+      memset(frame.data + writer.offset, 0, writer.len);
+      writer.last_seq = 0;
+      continue;
+    }
+
+    active = true;
+
+    if (seq == writer.last_seq) {
+      fresh = false;
+      continue;
+    }
+
+    /* 发送线程优先级更高，不能等待被打断的写入者，沿用上一次的数据 */
+    uint8_t data[8];
+    memcpy(data, writer.data, writer.len);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((seq & 1) || writer.seq.load(std::memory_order_relaxed) != seq) {
+      fresh = false;
+      continue;
+    }
+
+    memcpy(frame.data + writer.offset, data, writer.len);
+    writer.last_seq = seq;
+  }
+
+  if (active && !fresh) {
+    frame.miss++;
+  }
+
+  return active;
+}
+
+void Can::Scheduler::Flush(bsp_can_t can) {
+  can_sem_[can]->Wait(UINT32_MAX);
+
+  uint32_t now = bsp_time_get_ms();
+  uint64_t start = bsp_time_get_us();
+  bool active = false;
+
+  /* 先假设空闲，合并期间的写入会看到idle_并唤醒发送线程 */
+  idle_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  for (uint8_t i = 0; i < frame_num_; i++) {
+    Frame& frame = frame_[i];
+
+    if (!Compose(frame, now)) {
+      continue;
+    }
+
+    active = true;
+
+    if (bsp_can_trans_packet(can, frame.format, frame.index, frame.data) ==
+        BSP_OK) {
+      frame.sent++;
+      Count(frame.format);
+    }
+  }
+
+  can_sem_[can]->Post();
+
+  if (pending_) {
+    phase_last_ = static_cast<uint32_t>(start - sync_time_);
+    phase_sum_ += phase_last_;
+    if (phase_last_ > phase_max_) {
+      phase_max_ = phase_last_;
+    }
+    burst_count_++;
+  } else {
+    timeout_count_++;
+  }
+
+  last_flush_ = start;
+  pending_ = false;
+
+  if (active) {
+    idle_.store(false, std::memory_order_relaxed);
+  }
+}
+
+bool Can::Scheduler::Check() {
+  static Scheduler scheduler;
+  static Slot slot[2];
+  const uint8_t a[4] = {1, 2, 3, 4}, b[4] = {5, 6, 7, 8};
+  const uint8_t both[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t only_b[8] = {0, 0, 0, 0, 5, 6, 7, 8};
+
+  if (scheduler.frame_num_ == 0) {
+    scheduler.Add(CAN_FORMAT_STD, 0x200, 0, 4, 0x201, slot[0]);
+    scheduler.Add(CAN_FORMAT_STD, 0x200, 4, 4, 0x201, slot[1]);
+  }
+
+  Frame& frame = scheduler.frame_[0];
+  Writer& writer = frame.writer[slot[0].writer];
+
+  scheduler.Write(slot[0], a);
+  scheduler.Write(slot[1], b);
+  uint32_t now = writer.time;
+  bool ans = scheduler.Compose(frame, now) &&
+             memcmp(frame.data, both, sizeof(both)) == 0;
+
+  /* 第一个写入者停止更新 */
+  writer.time = now - DEV_CAN_TX_HOLD - 1;
+  scheduler.Write(slot[1], b);
+  ans = ans && scheduler.Compose(frame, now) &&
+        memcmp(frame.data, only_b, sizeof(only_b)) == 0;
+
+  /* 恢复写入后立即重新发送 */
+  scheduler.Write(slot[0], a);
+  now = writer.time;
+  ans = ans && scheduler.Compose(frame, now) &&
+        memcmp(frame.data, both, sizeof(both)) == 0;
+
+  return ans;
+}
+
+void Can::Scheduler::ShowInfo(int can) {
+  uint32_t now = bsp_time_get_ms();
+  uint32_t bits = tx_bits_ + rx_bits_;
+  float load = 0.0f;
+
+  /* 负载按两次查询之间的平均值计算 */
+  if (load_time_ != 0 && now != load_time_) {
+    load = static_cast<float>(bits - load_bits_) * 100.0f /
+           (static_cast<float>(now - load_time_) * DEV_CAN_BITRATE / 1000.0f);
+  }
+  load_bits_ = bits;
+  load_time_ = now;
+
+  uint32_t avg =
+      burst_count_ ? static_cast<uint32_t>(phase_sum_ / burst_count_) : 0;
+
+  printf("can%d\tload:%.1f%%\tsync:0x%x\tburst:%u\ttimeout:%u\r\n", can, load,
+         static_cast<unsigned int>(sync_id_),
+         static_cast<unsigned int>(burst_count_),
+         static_cast<unsigned int>(timeout_count_));
+  printf("\tphase(us) last:%u\tmax:%u\tavg:%u\r\n",
+         static_cast<unsigned int>(phase_last_),
+         static_cast<unsigned int>(phase_max_), static_cast<unsigned int>(avg));
+
+  for (uint8_t i = 0; i < frame_num_; i++) {
+    printf("\tframe 0x%x\twriter:%d\tsent:%u\tmiss:%u\r\n",
+           static_cast<unsigned int>(frame_[i].index), frame_[i].writer_num,
+           static_cast<unsigned int>(frame_[i].sent),
+           static_cast<unsigned int>(frame_[i].miss));
+  }
+}
+
+int Can::ShowInfo(Can* can, int argc, char** argv) {
+  XB_UNUSED(can);
+
+  if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+    Benchmark();
+    return 0;
+  } else if (argc == 2 && strcmp(argv[1], "check") == 0) {
+    printf("tx stale writer check: %s\r\n",
+           Scheduler::Check() ? "pass" : "fail");
+    return 0;
+  } else if (argc != 1) {
+    printf("can        show dispatch table and tx scheduler of each bus.\r\n");
+    printf("can bench  compare dispatch table with topic range filter.\r\n");
+    printf("can check  self-test the tx scheduler stale writer handling.\r\n");
+    return 0;
+  }
+
+  for (int i = 0; i < BSP_CAN_NUM; i++) {
+    printf("can%d\tsubscriber:%d\tid:%d\trange:%d\r\n", i,
+           dispatcher_[i]->SlotNum(), dispatcher_[i]->NodeNum(),
+           dispatcher_[i]->RangeNum());
+  }
+
+  for (int i = 0; i < BSP_CAN_NUM; i++) {
+    scheduler_[i]->ShowInfo(i);
+  }
+
+  return 0;
+}
+
+/* 没有对端回复时跳过，不影响其他测试。
+ * 回复的ID在第一次测试时才订阅，平时不占用总线0的ID */
+bool Can::RttSetup(void* arg) {
+  static bool subscribed = false;
+
+  if (!subscribed) {
+    /* 回复在接收中断中分发，直接记录时间戳 */
+    auto rtt_fn = [](Pack& pack, void* fn_arg) {
+      XB_UNUSED(pack);
+      XB_UNUSED(fn_arg);
+      rtt_rx_cycle = System::Benchmark::Now();
+      rtt_sem->Post();
+    };
+
+    subscribed =
+        dispatcher_[DEV_CAN_BENCH_BUS]->Add(DEV_CAN_BENCH_ID + 1, 1, rtt_fn,
+                                            NULL);
+    if (!subscribed) {
+      return false;
+    }
+  }
+
+  while (rtt_sem->Wait(0)) {
+  }
+  return RttSample(arg) >= 0.0f;
+}
+
+float Can::RttSample(void* arg) {
+  XB_UNUSED(arg);
+  static uint32_t count = 0;
+
+  Pack pack = {};
+  pack.index = DEV_CAN_BENCH_ID;
+  memcpy(pack.data, &count, sizeof(count));
+  count++;
+
+  uint32_t start = System::Benchmark::Now();
+  SendStdPack(static_cast<bsp_can_t>(DEV_CAN_BENCH_BUS), pack);
+
+  if (!rtt_sem->Wait(DEV_CAN_BENCH_TIMEOUT)) {
+    return -1.0f;
+  }
+
+  return System::Benchmark::ToNs(rtt_rx_cycle - start);
+}
+
+/* 原先的订阅方式，每个订阅者是总线话题上的一个范围过滤器。
+ * 话题无法删除，只在第一次测试时创建 */
+static Message::Topic<Can::Pack>* bench_topic(uint32_t sub_num) {
+  static Message::Topic<Can::Pack>* source[DEV_CAN_DISPATCH_SLOT_NUM + 1] = {};
+  static Message::Topic<Can::Pack>* sub[DEV_CAN_DISPATCH_SLOT_NUM] = {};
+
+  if (source[sub_num] == NULL) {
+    source[sub_num] = new Message::Topic<Can::Pack>(
+        ("can_bench_" + std::to_string(sub_num)).c_str());
+    for (uint32_t i = 0; i < sub_num; i++) {
+      if (sub[i] == NULL) {
+        sub[i] = new Message::Topic<Can::Pack>(
+            ("can_bench_sub_" + std::to_string(i)).c_str());
+      }
+      source[sub_num]->RangeDivide(*sub[i], sizeof(Can::Pack),
+                                   offsetof(Can::Pack, index),
+                                   om_member_size_of(Can::Pack, index),
+                                   0x201 + i, 1);
+    }
+  }
+
+  return source[sub_num];
+}
+
+void Can::Benchmark() {
+  const uint32_t FRAME_NUM = 100000;
+
+  static uint32_t counter = 0;
+  auto count_fn = [](Pack& pack, void* arg) {
+    XB_UNUSED(pack);
+    XB_UNUSED(arg);
+    counter++;
+  };
+
+  printf("*** CAN Dispatch Test Start ***\r\n");
+  printf("\t%u frames, microseconds per frame\r\n",
+         static_cast<unsigned int>(FRAME_NUM));
+  printf("\tsubscriber\ttable\t\ttopic\r\n");
+
+  Pack pack = {};
+
+  for (uint32_t sub_num = 1; sub_num <= DEV_CAN_DISPATCH_SLOT_NUM;
+       sub_num *= 2) {
+    auto dispatcher = new Dispatcher();
+    for (uint32_t i = 0; i < sub_num; i++) {
+      dispatcher->Add(0x201 + i, 1, count_fn, NULL);
+    }
+
+    /* 帧ID均匀分布在已订阅的ID上，与电机反馈的情况一致 */
+    counter = 0;
+    auto time = bsp_time_get_us();
+    for (uint32_t i = 0; i < FRAME_NUM; i++) {
+      pack.index = 0x201 + i % sub_num;
+      dispatcher->Dispatch(pack);
+    }
+    float table = static_cast<float>(bsp_time_get_us() - time) /
+                  static_cast<float>(FRAME_NUM);
+
+    /* 与原先经过总线话题逐个范围过滤的方式对比 */
+    auto topic = bench_topic(sub_num);
+    time = bsp_time_get_us();
+    for (uint32_t i = 0; i < FRAME_NUM; i++) {
+      pack.index = 0x201 + i % sub_num;
+      topic->Publish(pack);
+    }
+    float range = static_cast<float>(bsp_time_get_us() - time) /
+                  static_cast<float>(FRAME_NUM);
+
+    printf("\t%u\t\t%f\t%f\r\n", static_cast<unsigned int>(sub_num), table,
+           range);
+
+    delete dispatcher;
+  }
+
+  printf("*** CAN Dispatch Test End ***\r\n");
+}
@@ -1,8 +1,49 @@
 #pragma once
 
+#include <atomic>
+#include <benchmark.hpp>
 #include <device.hpp>
 
 #include "bsp_can.h"
+#include "bsp_time.h"
+
+/* 标准帧ID数量，直接查表 */
+#define DEV_CAN_STD_ID_NUM (0x800)
+/* 每条总线最多的订阅数量 */
+#define DEV_CAN_DISPATCH_SLOT_NUM (32)
+/* 每条总线最多展开的ID数量 */
+#define DEV_CAN_DISPATCH_NODE_NUM (64)
+/* 扩展帧ID哈希表大小，必须为2的幂 */
+#define DEV_CAN_EXT_HASH_SIZE (64)
+/* 超过此数量的ID范围不展开，改为逐个比较 */
+#define DEV_CAN_DISPATCH_RANGE_MAX (16)
+/* 每条总线合并发送的帧数量 */
+#define DEV_CAN_TX_FRAME_NUM (8)
+/* 每帧最多的写入者数量 */
+#define DEV_CAN_TX_WRITER_NUM (4)
+/* 收不到同步帧时的发送周期，单位ms */
+#define DEV_CAN_TX_TIMEOUT (2)
+/* 不以反馈帧同步，按DEV_CAN_TX_TIMEOUT周期发送。
+ * 应答式电机每收到一帧回复一帧，以自身反馈同步会形成自激的发送环路 */
+#define DEV_CAN_TX_NO_SYNC (UINT32_MAX)
+/* 两次突发发送的最小间隔，单位us，防止应答式电机形成环路 */
+#define DEV_CAN_TX_MIN_CYCLE_US (900)
+/* 写入者超过此时间未更新后不再发送，单位ms */
+#define DEV_CAN_TX_HOLD (20)
+/* 发送线程栈大小 */
+#define DEV_CAN_TX_TASK_STACK_DEPTH (256)
+/* 总线波特率，用于估算负载 */
+#define DEV_CAN_BITRATE (1000000)
+/* 含平均位填充的8字节标准帧/扩展帧长度，单位bit */
+#define DEV_CAN_STD_FRAME_BITS (125)
+#define DEV_CAN_EXT_FRAME_BITS (150)
+/* 往返延迟测试发送的ID，对端收到后以ID + 1原样返回 */
+#ifndef DEV_CAN_BENCH_ID
+#define DEV_CAN_BENCH_ID (0x7f0)
+#endif
+#define DEV_CAN_BENCH_BUS (0)
+/* 等待回复的时间，单位ms */
+#define DEV_CAN_BENCH_TIMEOUT (10)
 
 namespace Device {
 class Can {
@@ -12,6 +53,222 @@ class Can {
     uint8_t data[8];
   } Pack;
 
+  /* 按CAN ID分发数据包，标准帧直接索引，扩展帧查哈希表，均为O(1)。
+   * Add之间用锁互斥，新条目写完后才以release发布，接收中断无需加锁 */
+  class Dispatcher {
+   public:
+    typedef void (*Handler)(Pack& pack, void* arg);
+
+    /* 标准帧表在启动时一次申请，之后Add不再申请内存 */
+    Dispatcher()
+        : std_table_(new std::atomic<uint8_t>[DEV_CAN_STD_ID_NUM]()) {}
+
+    ~Dispatcher() { delete[] std_table_; }
+
+    bool Add(uint32_t index, uint32_t num, Handler fn, void* arg);
+
+    void Dispatch(Pack& pack) {
+      uint32_t id = pack.index;
+      uint8_t node = 0;
+
+      if (id < DEV_CAN_STD_ID_NUM) {
+        node = std_table_[id].load(std::memory_order_acquire);
+      } else {
+        node = FindExt(id);
+      }
+
+      while (node) {
+        Slot& slot = slot_[node_[node].slot];
+        slot.fn(pack, slot.arg);
+        node = node_[node].next;
+      }
+
+      uint8_t range_num = range_num_.load(std::memory_order_acquire);
+      for (uint8_t i = 0; i < range_num; i++) {
+        Slot& slot = slot_[range_[i]];
+        if (id - slot.index < slot.num) {
+          slot.fn(pack, slot.arg);
+        }
+      }
+    }
+
+    uint8_t SlotNum() const { return slot_num_; }
+
+    uint8_t NodeNum() const { return node_num_; }
+
+    uint8_t RangeNum() const {
+      return range_num_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    typedef struct {
+      Handler fn;
+      void* arg;
+      uint32_t index;
+      uint32_t num;
+    } Slot;
+
+    typedef struct {
+      uint8_t slot;
+      uint8_t next;
+    } Node;
+
+    typedef struct {
+      uint32_t id;
+      std::atomic<uint8_t> node; /* 最后写入，非0时id有效 */
+    } ExtEntry;
+
+    static uint32_t Hash(uint32_t id) {
+      return (id * 2654435761u) & (DEV_CAN_EXT_HASH_SIZE - 1);
+    }
+
+    uint8_t FindExt(uint32_t id) {
+      for (uint32_t i = 0, pos = Hash(id); i < DEV_CAN_EXT_HASH_SIZE;
+           i++, pos = (pos + 1) & (DEV_CAN_EXT_HASH_SIZE - 1)) {
+        uint8_t node = ext_table_[pos].node.load(std::memory_order_acquire);
+        if (node == 0) {
+          return 0;
+        }
+        if (ext_table_[pos].id == id) {
+          return node;
+        }
+      }
+      return 0;
+    }
+
+    /* 扩展帧哈希表是否能放下范围内的全部新ID */
+    bool ExtFits(uint32_t index, uint32_t num);
+
+    bool Link(uint32_t id, uint8_t slot);
+
+    std::atomic<uint8_t>* std_table_;
+    ExtEntry ext_table_[DEV_CAN_EXT_HASH_SIZE] = {};
+    Slot slot_[DEV_CAN_DISPATCH_SLOT_NUM + 1] = {};
+    Node node_[DEV_CAN_DISPATCH_NODE_NUM + 1] = {};
+    uint8_t range_[DEV_CAN_DISPATCH_SLOT_NUM] = {};
+    uint8_t slot_num_ = 0;
+    uint8_t node_num_ = 0;
+    std::atomic<uint8_t> range_num_{0};
+    System::Mutex lock_;
+  };
+
+  /* 合并发送调度器，多个模块写入同一帧的不同字节，
+   * 收到同步反馈帧后由发送线程一次性连续发出 */
+  class Scheduler {
+   public:
+    typedef struct {
+      uint8_t frame;
+      uint8_t writer;
+    } Slot;
+
+    Scheduler() {}
+
+    bool Add(bsp_can_format_t format, uint32_t index, uint8_t offset,
+             uint8_t len, uint32_t sync_id, Slot& slot);
+
+    /* 无锁写入，可在任意线程调用，返回true时需要唤醒发送线程 */
+    bool Write(const Slot& slot, const uint8_t* data) {
+      Writer& writer = frame_[slot.frame].writer[slot.writer];
+      uint32_t seq = writer.seq.load(std::memory_order_relaxed);
+      writer.seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      memcpy(writer.data, data, writer.len);
+      writer.time = bsp_time_get_ms();
+      writer.seq.store(seq + 2, std::memory_order_release);
+
+      /* 与Flush中先置idle_再读取seq配对，两边至少有一方看到对方 */
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (idle_.load(std::memory_order_relaxed)) {
+        idle_.store(false, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    }
+
+    /* 停止发送该写入者的数据，下次Write后恢复 */
+    void Clear(const Slot& slot) {
+      frame_[slot.frame].writer[slot.writer].seq.store(
+          0, std::memory_order_release);
+    }
+
+    /* 在接收中断中调用，返回true时需要唤醒发送线程 */
+    bool Sync(uint32_t id) {
+      rx_bits_ += id < DEV_CAN_STD_ID_NUM ? DEV_CAN_STD_FRAME_BITS
+                                          : DEV_CAN_EXT_FRAME_BITS;
+      if (id != sync_id_ || frame_num_ == 0 || pending_) {
+        return false;
+      }
+      uint64_t now = bsp_time_get_us();
+      if (now - last_flush_ < DEV_CAN_TX_MIN_CYCLE_US) {
+        return false;
+      }
+      sync_time_ = now;
+      pending_ = true;
+      return true;
+    }
+
+    bool Due() {
+      return frame_num_ > 0 &&
+             (pending_ ||
+              bsp_time_get_us() - last_flush_ >= DEV_CAN_TX_TIMEOUT * 1000);
+    }
+
+    void Flush(bsp_can_t can);
+
+    /* 上次发送时没有有效的写入者，发送线程无需定时唤醒 */
+    bool Idle() const { return idle_.load(std::memory_order_relaxed); }
+
+    void Count(bsp_can_format_t format) {
+      tx_bits_ += format == CAN_FORMAT_STD ? DEV_CAN_STD_FRAME_BITS
+                                           : DEV_CAN_EXT_FRAME_BITS;
+    }
+
+    void ShowInfo(int can);
+
+    /* 检查超时的写入者是否以0发出 */
+    static bool Check();
+
+   private:
+    typedef struct {
+      std::atomic<uint32_t> seq; /* 奇数表示正在写入 */
+      uint32_t time;
+      uint32_t last_seq;
+      uint8_t offset;
+      uint8_t len;
+      uint8_t data[8];
+    } Writer;
+
+    typedef struct {
+      uint32_t index;
+      bsp_can_format_t format;
+      uint8_t writer_num;
+      Writer writer[DEV_CAN_TX_WRITER_NUM];
+      uint8_t data[8];
+      uint32_t sent;
+      uint32_t miss; /* 发送时有写入者未更新的次数 */
+    } Frame;
+
+    /* 合并各写入者的数据，没有有效写入者时返回false */
+    bool Compose(Frame& frame, uint32_t now);
+
+    Frame frame_[DEV_CAN_TX_FRAME_NUM] = {};
+    uint8_t frame_num_ = 0;
+    uint32_t sync_id_ = DEV_CAN_TX_NO_SYNC;
+    volatile bool pending_ = false;
+    std::atomic<bool> idle_{true};
+    uint64_t sync_time_ = 0;
+    uint64_t last_flush_ = 0;
+    uint32_t burst_count_ = 0;
+    uint32_t timeout_count_ = 0;
+    uint32_t phase_last_ = 0;
+    uint32_t phase_max_ = 0;
+    uint64_t phase_sum_ = 0;
+    volatile uint32_t tx_bits_ = 0;
+    volatile uint32_t rx_bits_ = 0;
+    uint32_t load_bits_ = 0;
+    uint32_t load_time_ = 0;
+  };
+
   Can();
 
   static bool SendPack(bsp_can_t can, bsp_can_format_t format, Pack& pack);
@@ -23,7 +280,45 @@ class Can {
   static bool Subscribe(Message::Topic<Can::Pack>& tp, bsp_can_t can,
                         uint32_t index, uint32_t num);
 
+  /* 直接在接收中断中处理，不经过话题，适合需要自行分发的设备 */
+  static bool AddHandler(bsp_can_t can, uint32_t index, uint32_t num,
+                         Dispatcher::Handler fn, void* arg);
+
+  /* 注册合并发送的字节段，sync_id为触发发送的反馈帧ID，
+   * 为DEV_CAN_TX_NO_SYNC时按固定周期发送 */
+  static bool AddTxSlot(bsp_can_t can, bsp_can_format_t format,
+                        uint32_t index, uint8_t offset, uint8_t len,
+                        uint32_t sync_id, Scheduler::Slot& slot);
+
+  static void WriteTx(bsp_can_t can, const Scheduler::Slot& slot,
+                      const uint8_t* data) {
+    if (scheduler_[can]->Write(slot, data)) {
+      tx_sem_->Post();
+    }
+  }
+
+  static void ClearTx(bsp_can_t can, const Scheduler::Slot& slot) {
+    scheduler_[can]->Clear(slot);
+  }
+
+  static int ShowInfo(Can* can, int argc, char** argv);
+
+  static void Benchmark();
+
+  static bool RttSetup(void* arg);
+
+  static float RttSample(void* arg);
+
   static std::array<Message::Topic<Can::Pack>*, BSP_CAN_NUM> can_tp_;
   static std::array<System::Semaphore*, BSP_CAN_NUM> can_sem_;
+  static std::array<Dispatcher*, BSP_CAN_NUM> dispatcher_;
+  static std::array<Scheduler*, BSP_CAN_NUM> scheduler_;
+  static System::Semaphore* tx_sem_;
+
+  System::Thread tx_thread_;
+
+  System::Term::Command<Can*> cmd_;
+
+  System::Benchmark rtt_bench_;
 };
 }  // namespace Device
@@ -27,6 +27,7 @@ Can::Can() {
     XB_UNUSED(arg);
 
     pack[can].index = id;
+    pack[can].format = bsp_can_get_rx_format(can);
 
     memcpy(pack[can].data, data, sizeof(pack[can].data));
 
@@ -38,6 +39,7 @@ Can::Can() {
     XB_UNUSED(arg);
 
     fd_pack[can].index = id;
+    fd_pack[can].format = bsp_can_get_rx_format(can);
 
     memcpy(&fd_pack[can].info, data, sizeof(bsp_canfd_data_t));
 
@@ -10,11 +10,13 @@ class Can {
   typedef struct {
     uint32_t index;
     uint8_t data[8];
+    bsp_can_format_t format; /* 接收到的帧的ID格式，发送时不使用 */
   } Pack;
 
   typedef struct {
     uint32_t index;
     bsp_canfd_data_t info;
+    bsp_can_format_t format;
   } FDPack;
 
   Can();
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <database.hpp>
 #include <list.hpp>
+#include <log.hpp>
 #include <memory.hpp>
 #include <queue.hpp>
 #include <semaphore.hpp>
@@ -13,8 +13,18 @@
 #include "bsp_time.h"
 #include "comp_pid.hpp"
 
+#define ICM42688_FIFO_PACKET_LEN (16) /* 帧头、加速度计、陀螺仪、温度、时间戳 */
+#define ICM42688_FIFO_BUFF_LEN \
+  (ICM42688_FIFO_MAX_FRAME * ICM42688_FIFO_PACKET_LEN)
+
 static uint8_t dma_buf[14];
 
+#if ICM42688_FIFO_WATERMARK
+static_assert(ICM42688_FIFO_BUFF_LEN <= UINT8_MAX, "FIFO read too long");
+
+static uint8_t fifo_buf[ICM42688_FIFO_BUFF_LEN];
+#endif
+
 using namespace Device;
 
 void ICM42688::WriteSingle(uint8_t reg, uint8_t data) {
@@ -37,6 +47,13 @@ void ICM42688::Read(uint8_t reg, uint8_t *data, uint8_t len) {
   bsp_spi_mem_read(BSP_SPI_IMU, reg, data, len, false);
 }
 
+/* 不带延时的阻塞读取，用于在采样线程中读取FIFO长度等短数据 */
+void ICM42688::ReadBlock(uint8_t reg, uint8_t *data, uint8_t len) {
+  this->Select();
+  bsp_spi_mem_read(BSP_SPI_IMU, reg, data, len, true);
+  this->Unselect();
+}
+
 ICM42688::ICM42688(ICM42688::Rotation &rot)
     : cali_("icm42688_cali"),
       rot_(rot),
@@ -44,6 +61,7 @@ ICM42688::ICM42688(ICM42688::Rotation &rot)
       new_(0),
       accl_tp_("imu_accl"),
       gyro_tp_("imu_gyro"),
+      time_tp_("imu_time"),
       cmd_(this, this->CaliCMD, "icm42688") {
   auto recv_cplt_callback = [](void *arg) {
     ICM42688 *icm42688 = static_cast<ICM42688 *>(arg);
@@ -53,6 +71,7 @@ ICM42688::ICM42688(ICM42688::Rotation &rot)
 
   auto int_callback = [](void *arg) {
     ICM42688 *icm42688 = static_cast<ICM42688 *>(arg);
+    icm42688->int_time_ = bsp_time_get();
     icm42688->new_.Post();
   };
 
@@ -75,12 +94,17 @@ ICM42688::ICM42688(ICM42688::Rotation &rot)
        * 一次只能开启一个DMA
        */
       if (icm42688->new_.Wait(20)) {
+#if ICM42688_FIFO_WATERMARK
+        icm42688->ReadFifo();
+#else
         icm42688->StartRecv();
         icm42688->raw_.Wait(UINT32_MAX);
         icm42688->Prase();
 
         icm42688->accl_tp_.Publish(icm42688->accl_);
+        icm42688->time_tp_.Publish(icm42688->int_time_);
         icm42688->gyro_tp_.Publish(icm42688->gyro_);
+#endif
 
       } else {
         OMLOG_ERROR("ICM42688 wait timeout.");
@@ -98,11 +122,15 @@ int ICM42688::CaliCMD(ICM42688 *icm42688, int argc, char **argv) {
     printf("show [time] [delay] 在time时间内每隔delay打印一次数据\r\n");
     printf("list 列出校准数据\r\n");
     printf("cali 开始校准\r\n");
+    printf("fifo 查看FIFO状态\r\n");
   } else if (argc == 2) {
     if (strcmp(argv[1], "list") == 0) {
       printf("校准数据 x:%f y:%f z:%f\r\n", icm42688->cali_.data_.gyro_offset.x,
              icm42688->cali_.data_.gyro_offset.y,
              icm42688->cali_.data_.gyro_offset.z);
+    } else if (strcmp(argv[1], "fifo") == 0) {
+      printf("watermark:%d drop:%u\r\n", ICM42688_FIFO_WATERMARK,
+             static_cast<unsigned int>(icm42688->fifo_drop_));
     } else if (strcmp(argv[1], "cali") == 0) {
       printf("开始校准，请保持陀螺仪稳定\r\n");
       double x = 0.0f, y = 0.0f, z = 0.0f;
@@ -208,8 +236,22 @@ bool ICM42688::Init() {
   WriteSingle(0x63, 0x00);  // Null
   /*INT_CONFIG1*/
   WriteSingle(0x64, 0x00);  //中断引脚正常启用
+#if ICM42688_FIFO_WATERMARK
+  /*INTF_CONFIG0*/
+  WriteSingle(0x4C, 0x70);  // FIFO计数单位为帧，大端
+  /*FIFO_CONFIG1*/
+  WriteSingle(0x5F, 0x27);  // ACCEL GYRO TEMP入FIFO，超过水位持续触发
+  /*FIFO_CONFIG2 FIFO_CONFIG3*/
+  WriteSingle(0x60, ICM42688_FIFO_WATERMARK & 0xff);
+  WriteSingle(0x61, (ICM42688_FIFO_WATERMARK >> 8) & 0x0f);
+  /*FIFO_CONFIG*/
+  WriteSingle(0x16, 0x40);  // Stream-to-FIFO
+  /*INT_SOURCE0*/
+  WriteSingle(0x65, 0x04);  // FIFO水位 INT1
+#else
   /*INT_SOURCE0*/
   WriteSingle(0x65, 0x08);  // DRDY INT1
+#endif
   /*INT_SOURCE1*/
   WriteSingle(0x66, 0x00);  // Null
   /*INT_SOURCE3*/
@@ -259,10 +301,19 @@ bool ICM42688::Init() {
 }
 
 void ICM42688::Prase() {
+  this->ConvertAccel(dma_buf + 2);
+  this->ConvertGyro(dma_buf + 8);
+
+  int16_t raw_temp = static_cast<int16_t>(dma_buf[0] << 8 | dma_buf[1]);
+
+  this->temp_ = raw_temp;
+}
+
+void ICM42688::ConvertAccel(const uint8_t *raw) {
   int16_t raw_x = 0, raw_y = 0, raw_z = 0;
-  raw_x = static_cast<int16_t>(dma_buf[2] << 8 | dma_buf[3]);
-  raw_y = static_cast<int16_t>(dma_buf[4] << 8 | dma_buf[5]);
-  raw_z = static_cast<int16_t>(dma_buf[6] << 8 | dma_buf[7]);
+  raw_x = static_cast<int16_t>(raw[0] << 8 | raw[1]);
+  raw_y = static_cast<int16_t>(raw[2] << 8 | raw[3]);
+  raw_z = static_cast<int16_t>(raw[4] << 8 | raw[5]);
 
   std::array<float, 3> accl = {static_cast<float>(raw_x),
                                static_cast<float>(raw_y),
@@ -279,10 +330,13 @@ void ICM42688::Prase() {
     this->accl_.y += this->rot_.rot_mat[1][i] * accl[i];
     this->accl_.z += this->rot_.rot_mat[2][i] * accl[i];
   }
+}
 
-  raw_x = static_cast<int16_t>(dma_buf[8] << 8 | dma_buf[9]);
-  raw_y = static_cast<int16_t>(dma_buf[10] << 8 | dma_buf[11]);
-  raw_z = static_cast<int16_t>(dma_buf[12] << 8 | dma_buf[13]);
+void ICM42688::ConvertGyro(const uint8_t *raw) {
+  int16_t raw_x = 0, raw_y = 0, raw_z = 0;
+  raw_x = static_cast<int16_t>(raw[0] << 8 | raw[1]);
+  raw_y = static_cast<int16_t>(raw[2] << 8 | raw[3]);
+  raw_z = static_cast<int16_t>(raw[4] << 8 | raw[5]);
 
   std::array<float, 3> gyro = {static_cast<float>(raw_x),
                                static_cast<float>(raw_y),
@@ -303,13 +357,63 @@ void ICM42688::Prase() {
   this->gyro_.x -= this->cali_.data_.gyro_offset.x;
   this->gyro_.y -= this->cali_.data_.gyro_offset.y;
   this->gyro_.z -= this->cali_.data_.gyro_offset.z;
-
-  int16_t raw_temp = static_cast<int16_t>(dma_buf[0] << 8 | dma_buf[1]);
-
-  this->temp_ = raw_temp;
 }
 
 bool ICM42688::StartRecv() {
   Read(0x1d, dma_buf, sizeof(dma_buf));
   return true;
 }
+
+#if ICM42688_FIFO_WATERMARK
+/* 一次读出FIFO中的全部数据，逐组发布。
+ * 每组数据的时间在上一组和本次最后一组之间线性插值 */
+void ICM42688::ReadFifo() {
+  uint64_t now = bsp_time_get();
+
+  /* FIFO_COUNTH FIFO_COUNTL，单位为帧 */
+  this->ReadBlock(0x2E, fifo_buf, 2);
+  uint16_t num = static_cast<uint16_t>(fifo_buf[0] << 8 | fifo_buf[1]);
+
+  if (num == 0) {
+    return;
+  }
+
+  if (num > ICM42688_FIFO_MAX_FRAME) {
+    num = ICM42688_FIFO_MAX_FRAME;
+    /* 超过水位会持续触发中断，这里补一次避免等待超时 */
+    this->new_.Post();
+  }
+
+  this->Read(0x30, fifo_buf, num * ICM42688_FIFO_PACKET_LEN);
+  this->raw_.Wait(UINT32_MAX);
+
+  /* 正好达到水位时最后一组数据在中断时产生，否则按读取时间估计 */
+  uint64_t last = num == ICM42688_FIFO_WATERMARK ? this->int_time_ : now;
+  if (this->last_time_ == 0 || last < this->last_time_) {
+    this->last_time_ = last;
+  }
+
+  uint64_t span = last - this->last_time_;
+
+  for (uint16_t i = 0; i < num; i++) {
+    const uint8_t *packet = fifo_buf + i * ICM42688_FIFO_PACKET_LEN;
+
+    /* 最高位为FIFO空标志，同时包含加速度计和陀螺仪数据才处理 */
+    if ((packet[0] & 0x80) || (packet[0] & 0x60) != 0x60) {
+      this->fifo_drop_++;
+      continue;
+    }
+
+    this->ConvertAccel(packet + 1);
+    this->ConvertGyro(packet + 7);
+    this->temp_ = static_cast<float>(static_cast<int8_t>(packet[13])) / 2.07f +
+                  25.0f;
+
+    this->accl_tp_.Publish(this->accl_);
+    this->time_tp_.Publish(this->last_time_ + span * (i + 1) / num);
+    this->gyro_tp_.Publish(this->gyro_);
+  }
+
+  this->last_time_ = last;
+}
+#endif
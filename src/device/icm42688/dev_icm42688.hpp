@@ -6,6 +6,12 @@
 #include "bsp_gpio.h"
 #include "dev_ahrs.hpp"
 
+/* FIFO水位，达到后一次读出FIFO中的全部数据，0为每组数据中断一次 */
+#ifndef ICM42688_FIFO_WATERMARK
+#define ICM42688_FIFO_WATERMARK (0)
+#endif
+#define ICM42688_FIFO_MAX_FRAME (12) /* 每次最多读出的数据组数 */
+
 namespace Device {
 class ICM42688 {
  public:
@@ -26,6 +32,8 @@ class ICM42688 {
 
   bool StartRecv();
 
+  void ReadFifo();
+
   void Select() { bsp_gpio_write_pin(BSP_GPIO_IMU_CS, false); }
 
   void Unselect() { bsp_gpio_write_pin(BSP_GPIO_IMU_CS, true); }
@@ -36,9 +44,15 @@ class ICM42688 {
 
   void Read(uint8_t reg, uint8_t *data, uint8_t len);
 
+  void ReadBlock(uint8_t reg, uint8_t *data, uint8_t len);
+
   static int CaliCMD(ICM42688 *icm42688, int argc, char **argv);
 
  private:
+  void ConvertAccel(const uint8_t *raw);
+
+  void ConvertGyro(const uint8_t *raw);
+
   System::Database::Key<Calibration> cali_;
   Rotation &rot_;
 
@@ -47,10 +61,15 @@ class ICM42688 {
 
   float temp_ = 0.0f; /* 温度 */
 
+  uint64_t int_time_ = 0;  /* 中断时间 */
+  uint64_t last_time_ = 0; /* 上一组数据的时间 */
+  uint32_t fifo_drop_ = 0;
+
   System::Thread thread_accl_, thread_gyro_;
 
   Message::Topic<Component::Type::Vector3> accl_tp_;
   Message::Topic<Component::Type::Vector3> gyro_tp_;
+  Message::Topic<uint64_t> time_tp_;
 
   Component::Type::Vector3 accl_{};
   Component::Type::Vector3 gyro_{};
@@ -26,70 +26,69 @@ static const uint8_t RESET_CMD[8] = {0XFF, 0XFF, 0XFF, 0XFF,
                                      0XFF, 0XFF, 0XFF, 0XFD};
 */
 
-static std::array<bool, BSP_CAN_NUM> initd = {false};
-
-std::array<Message::Topic<Can::Pack> *, BSP_CAN_NUM> MitMotor::mit_tp_;
+std::array<MitMotor::Demux *, BSP_CAN_NUM> MitMotor::demux_;
 
 MitMotor::MitMotor(const Param &param, const char *name)
     : BaseMotor(name, param.reverse), param_(param) {
-  auto rx_callback = [](Can::Pack &rx, MitMotor *motor) {
-    if (rx.data[0] == motor->param_.id) {
-      motor->recv_.Overwrite(rx);
-    }
-
-    return true;
-  };
-
-  if (!initd[this->param_.can]) {
-    MitMotor::mit_tp_[this->param_.can] =
-        static_cast<Message::Topic<Can::Pack> *>(
-            System::Memory::Malloc(sizeof(Message::Topic<Can::Pack>)));
-    *MitMotor::mit_tp_[this->param_.can] = Message::Topic<Can::Pack>(
-        (std::string("mit_motor_can") + std::to_string(this->param_.can))
-            .c_str());
-
-    Can::Subscribe(*MitMotor::mit_tp_[this->param_.can], this->param_.can, 0,
-                   1);
-
-    initd[this->param_.can] = true;
+  ASSERT(this->param_.id < sizeof(Demux::index));
+
+  Demux *&demux = demux_[this->param_.can];
+
+  /* 每条总线只向Can注册一次，反馈帧在接收中断中直接查表分发 */
+  if (demux == NULL) {
+    demux = new Demux();
+    Can::AddHandler(this->param_.can, DEV_MIT_MOTOR_FEEDBACK_ID, 1, Receive,
+                    demux);
   }
 
-  Message::Topic<Can::Pack> motor_tp(name);
+  /* 编号从1开始，0表示该ID没有电机 */
+  ASSERT(demux->num < DEV_MIT_MOTOR_NUM);
+  ASSERT(demux->index[this->param_.id] == 0);
+  demux->motor[++demux->num] = this;
+  demux->index[this->param_.id] = demux->num;
 
-  motor_tp.RegisterCallback(rx_callback, this);
+  /* 电机每收到一帧命令回复一帧反馈，不能以反馈同步，按固定周期发送 */
+  Can::AddTxSlot(this->param_.can, CAN_FORMAT_STD, this->param_.id, 0, 8,
+                 DEV_CAN_TX_NO_SYNC, this->tx_slot_);
+}
 
-  motor_tp.Link(*this->mit_tp_[this->param_.can]);
+void MitMotor::Receive(Can::Pack &rx, void *arg) {
+  auto demux = static_cast<Demux *>(arg);
+  uint8_t index = demux->index[rx.data[0]];
+
+  if (index) {
+    demux->motor[index]->Decode(rx);
+  }
 }
 
 bool MitMotor::Update() {
-  Can::Pack pack;
+  RawFeedback fb;
 
-  while (this->recv_.Receive(pack)) {
-    this->Decode(pack);
+  if (this->recv_.Read(fb, this->recv_version_)) {
+    raw_pos_ = fb.pos;
+    this->feedback_.rotational_speed = fb.speed;
+    this->feedback_.rotor_abs_angle = fb.pos;
+    this->feedback_.torque_current = fb.current;
     last_online_time_ = bsp_time_get_ms();
   }
 
   return true;
 }
 
+/* 在接收中断中调用，只写入recv_，feedback_由控制线程更新 */
 void MitMotor::Decode(Can::Pack &rx) {
-  if (this->param_.id != rx.data[0]) {
-    return;
-  }
-
   uint16_t raw_position = rx.data[1] << 8 | rx.data[2];
 
   uint16_t raw_speed = (rx.data[3] << 4) | (rx.data[4] >> 4);
 
   uint16_t raw_current = (rx.data[4] & 0x0f) << 8 | rx.data[5];
 
-  raw_pos_ = uint_to_float(raw_position, P_MIN, P_MAX, 16);
-  float speed = uint_to_float(raw_speed, V_MIN, V_MAX, 12);
-  float current = uint_to_float(raw_current, -T_MAX, T_MAX, 12);
+  RawFeedback fb;
+  fb.pos = uint_to_float(raw_position, P_MIN, P_MAX, 16);
+  fb.speed = uint_to_float(raw_speed, V_MIN, V_MAX, 12);
+  fb.current = uint_to_float(raw_current, -T_MAX, T_MAX, 12);
 
-  this->feedback_.rotational_speed = speed;
-  this->feedback_.rotor_abs_angle = raw_pos_;
-  this->feedback_.torque_current = current;
+  this->recv_.Write(fb);
 }
 
 /* MIT电机协议只提供pd位置控制 */
@@ -101,7 +100,7 @@ void MitMotor::Control(float output) {
 void MitMotor::SetCurrent(float current) {
   if (this->feedback_.temp > 75.0f) {
     Relax();
-    OMLOG_WARNING("motor %s high temperature detected", name_);
+    XB_LOG_WARNING("motor %s high temperature detected", name_);
     return;
   }
 
@@ -115,7 +114,7 @@ void MitMotor::SetCurrent(float current) {
 void MitMotor::SetPos(float pos) {
   if (this->feedback_.temp > 75.0f) {
     Relax();
-    OMLOG_WARNING("motor %s high temperature detected", name_);
+    XB_LOG_WARNING("motor %s high temperature detected", name_);
     return;
   }
 
@@ -143,26 +142,27 @@ void MitMotor::SetPos(float pos) {
   int kd_int = float_to_uint(this->param_.kd, KD_MIN, KD_MAX, 12);
   int t_int = float_to_uint(this->current_, T_MIN, T_MAX, 12);
 
-  Can::Pack tx_buff;
-
-  tx_buff.index = this->param_.id;
+  uint8_t data[8];
 
-  tx_buff.data[0] = p_int >> 8;
-  tx_buff.data[1] = p_int & 0xFF;
-  tx_buff.data[2] = v_int >> 4;
-  tx_buff.data[3] = ((v_int & 0xF) << 4) | (kp_int >> 8);
-  tx_buff.data[4] = kp_int & 0xFF;
-  tx_buff.data[5] = kd_int >> 4;
-  tx_buff.data[6] = ((kd_int & 0xF) << 4) | (t_int >> 8);
-  tx_buff.data[7] = t_int & 0xff;
+  data[0] = p_int >> 8;
+  data[1] = p_int & 0xFF;
+  data[2] = v_int >> 4;
+  data[3] = ((v_int & 0xF) << 4) | (kp_int >> 8);
+  data[4] = kp_int & 0xFF;
+  data[5] = kd_int >> 4;
+  data[6] = ((kd_int & 0xF) << 4) | (t_int >> 8);
+  data[7] = t_int & 0xff;
 
-  Can::SendStdPack(this->param_.can, tx_buff);
+  Can::WriteTx(this->param_.can, this->tx_slot_, data);
 }
 
+/* 与Enable一样单独发送一次，并停止重发之前的位置命令 */
 void MitMotor::Relax() {
+  Can::ClearTx(this->param_.can, this->tx_slot_);
+
   Can::Pack tx_buff;
 
-  tx_buff.index = this->param_.id;
+  tx_buff.index = param_.id;
 
   memcpy(tx_buff.data, RELAX_CMD, sizeof(RELAX_CMD));
 
@@ -1,10 +1,18 @@
 #pragma once
 
 #include <device.hpp>
+#include <latest.hpp>
 
 #include "dev_can.hpp"
 #include "dev_motor.hpp"
 
+/* 每条总线上MIT电机的最大数量 */
+#ifndef DEV_MIT_MOTOR_NUM
+#define DEV_MIT_MOTOR_NUM (8)
+#endif
+/* 所有MIT电机共用的反馈帧ID，以data[0]区分电机 */
+#define DEV_MIT_MOTOR_FEEDBACK_ID (0)
+
 namespace Device {
 class MitMotor : public BaseMotor {
  public:
@@ -18,6 +26,20 @@ class MitMotor : public BaseMotor {
     bool reverse;
   } Param;
 
+  /* 接收中断中解码的反馈，控制线程在Update中取最新的一份 */
+  typedef struct {
+    float pos;
+    float speed;
+    float current;
+  } RawFeedback;
+
+  /* 每条总线一个，按data[0]中的电机ID查表，每帧只交给一个电机 */
+  typedef struct {
+    uint8_t index[256];
+    MitMotor *motor[DEV_MIT_MOTOR_NUM + 1];
+    uint8_t num;
+  } Demux;
+
   MitMotor(const Param &param, const char *name);
 
   void Control(float output);
@@ -28,6 +50,8 @@ class MitMotor : public BaseMotor {
 
   void Decode(Can::Pack &rx);
 
+  static void Receive(Can::Pack &rx, void *arg);
+
   void SetCurrent(float current);
 
   void SetPos(float pos);
@@ -41,8 +65,12 @@ class MitMotor : public BaseMotor {
 
   float current_ = 0.0f;
 
-  System::Queue<Can::Pack> recv_ = System::Queue<Can::Pack>(1);
+  Can::Scheduler::Slot tx_slot_;
+
+  System::LatestSlot<RawFeedback> recv_;
+
+  uint32_t recv_version_ = 0;
 
-  static std::array<Message::Topic<Can::Pack> *, BSP_CAN_NUM> mit_tp_;
+  static std::array<Demux *, BSP_CAN_NUM> demux_;
 };
 }  // namespace Device
@@ -17,12 +17,6 @@
 
 using namespace Device;
 
-uint8_t RMMotor::motor_tx_buff_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER][8];
-
-uint8_t RMMotor::motor_tx_flag_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER];
-
-uint8_t RMMotor::motor_tx_map_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER];
-
 RMMotor::RMMotor(const Param &param, const char *name)
     : BaseMotor(name, param.reverse), param_(param) {
   strncpy(this->name_, name, sizeof(this->name_));
@@ -79,7 +73,9 @@ RMMotor::RMMotor(const Param &param, const char *name)
 
   Can::Subscribe(motor_tp, this->param_.can, this->param_.id_feedback, 1);
 
-  motor_tx_map_[this->param_.can][this->index_] |= 1 << (this->num_);
+  /* 同一控制帧的电机各写两字节，由CAN发送线程合并发送 */
+  Can::AddTxSlot(this->param_.can, CAN_FORMAT_STD, this->param_.id_control,
+                 2 * this->num_, 2, this->param_.id_feedback, this->tx_slot_);
 }
 
 bool RMMotor::Update() {
@@ -127,7 +123,7 @@ float RMMotor::GetLSB() {
 void RMMotor::Control(float out) {
   if (this->feedback_.temp > 75.0f) {
     out = 0.0f;
-    OMLOG_WARNING("motor %s high temperature detected", name_);
+    XB_LOG_WARNING("motor %s high temperature detected", name_);
   }
 
   clampf(&out, -1.0f, 1.0f);
@@ -140,34 +136,12 @@ void RMMotor::Control(float out) {
 
   if (lsb != 0.0f) {
     int16_t ctrl_cmd = static_cast<int16_t>(this->output_ * lsb);
-    motor_tx_buff_[this->param_.can][this->index_][2 * this->num_] =
-        static_cast<uint8_t>((ctrl_cmd >> 8) & 0xFF);
-    motor_tx_buff_[this->param_.can][this->index_][2 * this->num_ + 1] =
-        static_cast<uint8_t>(ctrl_cmd & 0xFF);
-    motor_tx_flag_[this->param_.can][this->index_] |= 1 << (this->num_);
-
-    if (((~motor_tx_flag_[this->param_.can][this->index_]) &
-         (motor_tx_map_[this->param_.can][this->index_])) == 0) {
-      this->SendData();
-    }
+    uint8_t data[2] = {static_cast<uint8_t>((ctrl_cmd >> 8) & 0xFF),
+                       static_cast<uint8_t>(ctrl_cmd & 0xFF)};
+    Can::WriteTx(this->param_.can, this->tx_slot_, data);
   }
 }
 
-bool RMMotor::SendData() {
-  Can::Pack tx_buff;
-
-  tx_buff.index = this->param_.id_control;
-
-  memcpy(tx_buff.data, motor_tx_buff_[this->param_.can][this->index_],
-         sizeof(tx_buff.data));
-
-  Can::SendStdPack(this->param_.can, tx_buff);
-
-  motor_tx_flag_[this->param_.can][this->index_] = 0;
-
-  return true;
-}
-
 void RMMotor::Offline() {
   memset(&(this->feedback_), 0, sizeof(this->feedback_));
 }
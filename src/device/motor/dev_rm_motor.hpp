@@ -52,8 +52,6 @@ class RMMotor : public BaseMotor {
 
   bool Update();
 
-  bool SendData();
-
   void Control(float output);
 
   void Offline();
@@ -71,11 +69,7 @@ class RMMotor : public BaseMotor {
 
   float output_;
 
-  static uint8_t motor_tx_buff_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER][8];
-
-  static uint8_t motor_tx_flag_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER];
-
-  static uint8_t motor_tx_map_[BSP_CAN_NUM][MOTOR_CTRL_ID_NUMBER];
+  Can::Scheduler::Slot tx_slot_;
 
   System::Queue<Can::Pack> recv_ = System::Queue<Can::Pack>(1);
 };
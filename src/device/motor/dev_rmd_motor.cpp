@@ -10,12 +10,6 @@
 
 using namespace Device;
 
-uint8_t RMDMotor::motor_tx_buff_[BSP_CAN_NUM][8];
-
-uint8_t RMDMotor::motor_tx_flag_[BSP_CAN_NUM];
-
-uint8_t RMDMotor::motor_tx_map_[BSP_CAN_NUM];
-
 RMDMotor::RMDMotor(const Param &param, const char *name)
     : BaseMotor(name, param.reverse), param_(param) {
   strncpy(this->name_, name, sizeof(this->name_));
@@ -36,7 +30,9 @@ RMDMotor::RMDMotor(const Param &param, const char *name)
 
   Can::Subscribe(motor_tp, this->param_.can, this->param_.num + 0x141, 1);
 
-  motor_tx_map_[this->param_.can] |= 1 << (this->param_.num);
+  /* 电机收到多电机命令后逐个回复，不能以反馈同步，按固定周期发送 */
+  Can::AddTxSlot(this->param_.can, CAN_FORMAT_STD, 0x280, 2 * this->param_.num,
+                 2, DEV_CAN_TX_NO_SYNC, this->tx_slot_);
 }
 
 bool RMDMotor::Update() {
@@ -65,7 +61,7 @@ void RMDMotor::Decode(Can::Pack &rx) {
 void RMDMotor::Control(float out) {
   if (this->feedback_.temp > 75.0f) {
     out = 0.0f;
-    OMLOG_WARNING("motor %s high temperature detected", name_);
+    XB_LOG_WARNING("motor %s high temperature detected", name_);
   }
 
   clampf(&out, -1.0f, 1.0f);
@@ -79,33 +75,12 @@ void RMDMotor::Control(float out) {
 
   if (lsb != 0.0f) {
     int16_t ctrl_cmd = static_cast<int16_t>(this->output_ * lsb);
-    motor_tx_buff_[this->param_.can][2 * this->param_.num + 1] =
-        static_cast<uint8_t>((ctrl_cmd >> 8) & 0xFF);
-    motor_tx_buff_[this->param_.can][2 * this->param_.num] =
-        static_cast<uint8_t>(ctrl_cmd & 0xFF);
-    motor_tx_flag_[this->param_.can] |= 1 << (this->param_.num);
-
-    if (((~motor_tx_flag_[this->param_.can]) &
-         (motor_tx_map_[this->param_.can])) == 0) {
-      this->SendData();
-    }
+    uint8_t data[2] = {static_cast<uint8_t>(ctrl_cmd & 0xFF),
+                       static_cast<uint8_t>((ctrl_cmd >> 8) & 0xFF)};
+    Can::WriteTx(this->param_.can, this->tx_slot_, data);
   }
 }
 
-bool RMDMotor::SendData() {
-  Can::Pack tx_buff;
-
-  tx_buff.index = 0x280;
-
-  memcpy(tx_buff.data, motor_tx_buff_[this->param_.can], sizeof(tx_buff.data));
-
-  Can::SendStdPack(this->param_.can, tx_buff);
-
-  motor_tx_flag_[this->param_.can] = 0;
-
-  return true;
-}
-
 void RMDMotor::Offline() {
   memset(&(this->feedback_), 0, sizeof(this->feedback_));
 }
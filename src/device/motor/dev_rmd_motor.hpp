@@ -23,8 +23,6 @@ class RMDMotor : public BaseMotor {
 
   bool Update();
 
-  bool SendData();
-
   void Control(float output);
 
   void Offline();
@@ -36,11 +34,7 @@ class RMDMotor : public BaseMotor {
 
   float output_;
 
-  static uint8_t motor_tx_buff_[BSP_CAN_NUM][8];
-
-  static uint8_t motor_tx_flag_[BSP_CAN_NUM];
-
-  static uint8_t motor_tx_map_[BSP_CAN_NUM];
+  Can::Scheduler::Slot tx_slot_;
 
   System::Queue<Can::Pack> recv_ = System::Queue<Can::Pack>(1);
 };
@@ -32,14 +32,172 @@
 #define REF_UI_MODE_OFFSET_4_LEFT (174)
 #define REF_UI_MODE_OFFSET_4_RIGHT (222)
 
+#define REF_LEN_FRAME_OVERHEAD \
+  (sizeof(Referee::Header) + sizeof(uint16_t) + sizeof(Referee::Tail))
+
+#define REF_BENCH_LOOP (100) /* 解析基准测试默认回放次数 */
+
 using namespace Device;
 
 static uint8_t rxbuf[REF_LEN_RX_BUFF];
 
+#define REF_FIELD(_cmd, _member)                                    \
+  table[Referee::Parser::CmdIndex(Referee::_cmd)] = {               \
+      static_cast<uint16_t>(offsetof(Referee::Data, _member)),      \
+      static_cast<uint16_t>(sizeof(static_cast<Referee::Data *>(0)->_member))}
+
+/* 命令码到Data字段的查找表，编译期生成 */
+static constexpr std::array<Referee::Parser::Field, REF_CMD_TABLE_SIZE>
+ref_field_table() {
+  std::array<Referee::Parser::Field, REF_CMD_TABLE_SIZE> table{};
+  REF_FIELD(REF_CMD_ID_GAME_STATUS, game_status);
+  REF_FIELD(REF_CMD_ID_GAME_RESULT, game_result);
+  REF_FIELD(REF_CMD_ID_GAME_ROBOT_HP, game_robot_hp);
+  REF_FIELD(REF_CMD_ID_DART_STATUS, dart_status);
+  REF_FIELD(REF_CMD_ID_ICRA_ZONE_STATUS, icra_zone);
+  REF_FIELD(REF_CMD_ID_FIELD_EVENTS, field_event);
+  REF_FIELD(REF_CMD_ID_SUPPLY_ACTION, supply_action);
+  REF_FIELD(REF_CMD_ID_WARNING, warning);
+  REF_FIELD(REF_CMD_ID_DART_COUNTDOWN, dart_countdown);
+  REF_FIELD(REF_CMD_ID_ROBOT_STATUS, robot_status);
+  REF_FIELD(REF_CMD_ID_POWER_HEAT_DATA, power_heat);
+  REF_FIELD(REF_CMD_ID_ROBOT_POS, robot_pos);
+  REF_FIELD(REF_CMD_ID_ROBOT_BUFF, robot_buff);
+  REF_FIELD(REF_CMD_ID_DRONE_ENERGY, drone_energy);
+  REF_FIELD(REF_CMD_ID_ROBOT_DMG, robot_damage);
+  REF_FIELD(REF_CMD_ID_LAUNCHER_DATA, launcher_data);
+  REF_FIELD(REF_CMD_ID_BULLET_REMAINING, bullet_remain);
+  REF_FIELD(REF_CMD_ID_RFID, rfid);
+  REF_FIELD(REF_CMD_ID_DART_CLIENT, dart_client);
+  REF_FIELD(REF_CMD_ID_ROBOT_POS_TO_SENTRY, robot_pos_for_snetry);
+  REF_FIELD(REF_CMD_ID_RADAR_MARK, radar_mark_progress);
+  REF_FIELD(REF_CMD_ID_INTER_STUDENT_CUSTOM, custom_controller);
+  REF_FIELD(REF_CMD_ID_CLIENT_MAP, client_map);
+  REF_FIELD(REF_CMD_ID_KEYBOARD_MOUSE, keyboard_mouse);
+  REF_FIELD(REF_CMD_ID_CUSTOM_KEYBOARD_MOUSE, custom_key_mouse_data);
+  REF_FIELD(REF_CMD_ID_SENTRY_POS_DATA, sentry_postion);
+  return table;
+}
+
+static constexpr std::array<Referee::Parser::Field, REF_CMD_TABLE_SIZE>
+    REF_FIELD_TABLE = ref_field_table();
+
+static_assert(REF_FIELD_TABLE[Referee::Parser::CmdIndex(
+                  Referee::REF_CMD_ID_POWER_HEAT_DATA)]
+                      .size == sizeof(Referee::PowerHeat),
+              "referee field table mismatch");
+
 Referee::UIPack Referee::ui_pack_;
 Referee *Referee::self_;
 
-Referee::Referee() : event_(Message::Event::FindEvent("cmd_event")) {
+/* 元素名称转换为索引，最高位置1与空闲标记区分 */
+static uint32_t ui_key(const uint8_t *name) {
+  return 0x80000000u | name[0] | (name[1] << 8) | (name[2] << 16);
+}
+
+/* 发送优先级，数值越小越优先
+ * 0: 待删除元素与等待过久的元素，保证每次都变化的动态图形不会饿死其他元素
+ * 1: 动态元素
+ * 2: 其余内容变化的元素
+ * 3: 内容未变化，只用于填充数据包 */
+static uint32_t ui_priority(const Referee::UIState &state, uint32_t now) {
+  if (!state.key) {
+    return UINT32_MAX;
+  }
+  if (!state.dirty) {
+    return 3;
+  }
+  if (state.remove || now - state.since > REF_UI_MAX_DELAY) {
+    return 0;
+  }
+  if (state.dynamic) {
+    return 1;
+  }
+  return 2;
+}
+
+/* 按优先级选出最多max_num个元素，同优先级中最久未发送的在前 */
+template <typename Node, size_t Num>
+static uint32_t ui_select(std::array<Node, Num> &node, uint32_t now,
+                          uint32_t max_prio, Node **ans, uint32_t max_num) {
+  uint32_t num = 0;
+
+  while (num < max_num) {
+    Node *best = NULL;
+    uint32_t best_prio = max_prio, best_age = 0;
+
+    for (auto &item : node) {
+      uint32_t prio = ui_priority(item.state, now);
+      uint32_t age = now - item.state.last_sent;
+
+      if (prio > best_prio ||
+          (best != NULL && prio == best_prio && age <= best_age)) {
+        continue;
+      }
+
+      bool selected = false;
+      for (uint32_t i = 0; i < num; i++) {
+        if (ans[i] == &item) {
+          selected = true;
+          break;
+        }
+      }
+      if (selected) {
+        continue;
+      }
+
+      best = &item;
+      best_prio = prio;
+      best_age = age;
+    }
+
+    if (best == NULL) {
+      break;
+    }
+    ans[num++] = best;
+  }
+
+  return num;
+}
+
+template <typename Node, size_t Num>
+static Node *ui_find(std::array<Node, Num> &node, uint32_t key) {
+  Node *empty = NULL;
+  for (auto &item : node) {
+    if (item.state.key == key) {
+      return &item;
+    }
+    if (empty == NULL && !item.state.key) {
+      empty = &item;
+    }
+  }
+  return empty;
+}
+
+/* 场景中的元素发生变化时标记为待发送 */
+static void ui_update(Referee::UIState &state, uint32_t key, bool changed,
+                      bool dynamic, bool remove) {
+  uint32_t now = bsp_time_get_ms();
+
+  if (state.key != key) {
+    memset(&state, 0, sizeof(state));
+    state.key = key;
+    state.last_sent = now;
+    changed = true;
+  }
+
+  if (changed && !state.dirty) {
+    state.dirty = true;
+    state.since = now;
+  }
+  state.dynamic = dynamic;
+  state.remove = remove;
+}
+
+Referee::Referee()
+    : event_(Message::Event::FindEvent("cmd_event")),
+      cmd_(this, ShowUI, "ref_ui", System::Term::DevDir()),
+      parser_cmd_(this, ShowParser, "ref_parse", System::Term::DevDir()) {
   self_ = this;
 
   auto rx_cplt_callback = [](void *arg) {
@@ -75,6 +233,8 @@ Referee::Referee() : event_(Message::Event::FindEvent("cmd_event")) {
 #endif
 
   auto ref_recv_thread = [](Referee *ref) {
+    Status last_status = OFFLINE;
+
     while (1) {
       ref->StartRecv();
 
@@ -89,8 +249,13 @@ Referee::Referee() : event_(Message::Event::FindEvent("cmd_event")) {
       }
 #endif
 
-      /* 发布裁判系统数据 */
-      ref->ref_data_tp_.Publish(ref->ref_data_);
+      /* 只在数据或在线状态变化时发布裁判系统数据 */
+      if (ref->parser_.changed_ || ref->ref_data_.status != last_status) {
+        ref->ref_data_tp_.Publish(ref->ref_data_);
+        ref->ref_changed_tp_.Publish(ref->parser_.changed_);
+        ref->parser_.changed_ = 0;
+        last_status = ref->ref_data_.status;
+      }
     }
   };
 
@@ -102,7 +267,7 @@ Referee::Referee() : event_(Message::Event::FindEvent("cmd_event")) {
 
     while (1) {
       ref->UpdateUI();
-      ref->trans_thread_.SleepUntil(40, last_online_time);
+      ref->trans_thread_.SleepUntil(REF_UI_CYCLE, last_online_time);
     }
   };
   this->trans_thread_.Create(ref_trans_thread, this, "ref_trans_thread",
@@ -119,171 +284,17 @@ bool Referee::StartRecv() {
 
 void Referee::Prase() {
   this->ref_data_.status = RUNNING;
-  size_t data_length = bsp_uart_get_count(BSP_UART_REF);
 
-  const uint8_t *index = rxbuf; /* const 保护原始rxbuf不被修改 */
-  const uint8_t *const RXBUF_END = rxbuf + data_length;
+  this->parser_.Parse(rxbuf, bsp_uart_get_count(BSP_UART_REF));
 
-  while (index < RXBUF_END) {
-    /* 1.处理帧头 */
-    /* 1.1遍历所有找到SOF */
-    while ((*index != REF_HEADER_SOF) && (index < RXBUF_END)) {
-      index++;
-    }
-    /* 1.2将剩余数据当做帧头部 */
-    const Referee::Header *header =
-        reinterpret_cast<const Referee::Header *>(index);
-
-    /* 1.3验证完整性 */
-    if (!Component::CRC8::Verify(reinterpret_cast<const uint8_t *>(header),
-                                 sizeof(*header))) {
-      index++;
-      continue;
-    }
-    index += sizeof(*header);
-
-    /* 2.处理CMD ID */
-    /* 2.1将剩余数据当做CMD ID处理 */
-    const Referee::CMDID *cmd_id =
-        reinterpret_cast<const Referee::CMDID *>(index);
-    index += sizeof(*cmd_id);
-
-    /* 3.处理数据段 */
-    const void *source = index;
-    void *destination = NULL;
-    size_t size = 0;
-
-    switch (static_cast<int>(*cmd_id)) {
-      case REF_CMD_ID_GAME_STATUS:
-        destination = &(this->ref_data_.game_status);
-        size = sizeof(this->ref_data_.game_status);
-        break;
-      case REF_CMD_ID_GAME_RESULT:
-        destination = &(this->ref_data_.game_result);
-        size = sizeof(this->ref_data_.game_result);
-        break;
-      case REF_CMD_ID_GAME_ROBOT_HP:
-        destination = &(this->ref_data_.game_robot_hp);
-        size = sizeof(this->ref_data_.game_robot_hp);
-        break;
-      case REF_CMD_ID_DART_STATUS:
-        destination = &(this->ref_data_.dart_status);
-        size = sizeof(this->ref_data_.dart_status);
-        break;
-      case REF_CMD_ID_ICRA_ZONE_STATUS:
-        destination = &(this->ref_data_.icra_zone);
-        size = sizeof(this->ref_data_.icra_zone);
-        break;
-      case REF_CMD_ID_FIELD_EVENTS:
-        destination = &(this->ref_data_.field_event);
-        size = sizeof(this->ref_data_.field_event);
-        break;
-      case REF_CMD_ID_SUPPLY_ACTION:
-        destination = &(this->ref_data_.supply_action);
-        size = sizeof(this->ref_data_.supply_action);
-        break;
-      case REF_CMD_ID_WARNING:
-        destination = &(this->ref_data_.warning);
-        size = sizeof(this->ref_data_.warning);
-        break;
-      case REF_CMD_ID_DART_COUNTDOWN:
-        destination = &(this->ref_data_.dart_countdown);
-        size = sizeof(this->ref_data_.dart_countdown);
-        break;
-      case REF_CMD_ID_ROBOT_STATUS:
-        destination = &(this->ref_data_.robot_status);
-        size = sizeof(this->ref_data_.robot_status);
-        break;
-      case REF_CMD_ID_POWER_HEAT_DATA:
-        destination = &(this->ref_data_.power_heat);
-        size = sizeof(this->ref_data_.power_heat);
-        break;
-      case REF_CMD_ID_ROBOT_POS:
-        destination = &(this->ref_data_.robot_pos);
-        size = sizeof(this->ref_data_.robot_pos);
-        break;
-      case REF_CMD_ID_ROBOT_BUFF:
-        destination = &(this->ref_data_.robot_buff);
-        size = sizeof(this->ref_data_.robot_buff);
-        break;
-      case REF_CMD_ID_DRONE_ENERGY:
-        destination = &(this->ref_data_.drone_energy);
-        size = sizeof(this->ref_data_.drone_energy);
-        break;
-      case REF_CMD_ID_ROBOT_DMG:
-        destination = &(this->ref_data_.robot_damage);
-        size = sizeof(this->ref_data_.robot_damage);
-        break;
-      case REF_CMD_ID_LAUNCHER_DATA:
-        destination = &(this->ref_data_.launcher_data);
-        size = sizeof(this->ref_data_.launcher_data);
-        break;
-      case REF_CMD_ID_BULLET_REMAINING:
-        destination = &(this->ref_data_.bullet_remain);
-        size = sizeof(this->ref_data_.bullet_remain);
-        break;
-      case REF_CMD_ID_RFID:
-        destination = &(this->ref_data_.rfid);
-        size = sizeof(this->ref_data_.rfid);
-        break;
-      case REF_CMD_ID_DART_CLIENT:
-        destination = &(this->ref_data_.dart_client);
-        size = sizeof(this->ref_data_.dart_client);
-        break;
-      case REF_CMD_ID_ROBOT_POS_TO_SENTRY:
-        destination = &(this->ref_data_.robot_pos_for_snetry);
-        size = sizeof(this->ref_data_.robot_pos_for_snetry);
-        break;
-      case REF_CMD_ID_RADAR_MARK:
-        destination = &(this->ref_data_.radar_mark_progress);
-        size = sizeof(this->ref_data_.radar_mark_progress);
-        break;
-      case REF_CMD_ID_INTER_STUDENT_CUSTOM:
-        destination = &(this->ref_data_.custom_controller);
-        size = sizeof(this->ref_data_.custom_controller);
-        break;
-      case REF_CMD_ID_CLIENT_MAP:
-        destination = &(this->ref_data_.client_map);
-        size = sizeof(this->ref_data_.client_map);
-        break;
-      case REF_CMD_ID_KEYBOARD_MOUSE:
-        destination = &(this->ref_data_.keyboard_mouse);
-        size = sizeof(this->ref_data_.keyboard_mouse);
-        break;
-      case REF_CMD_ID_CUSTOM_KEYBOARD_MOUSE:
-        destination = &(this->ref_data_.custom_key_mouse_data);
-        size = sizeof(this->ref_data_.custom_key_mouse_data);
-        break;
-      case REF_CMD_ID_SENTRY_POS_DATA:
-        destination = &(this->ref_data_.sentry_postion);
-        size = sizeof(this->ref_data_.sentry_postion);
-        break;
-
-      default:
-        return;
-    }
-    index += size;
-
-    /* 4.处理帧尾 */
-    index += sizeof(Referee::Tail);
-
-    /* 验证无误则接受数据 */
-    if (Component::CRC16::Verify(
-            reinterpret_cast<const uint8_t *>((header)),
-            static_cast<uint8_t>(
-                index - reinterpret_cast<const uint8_t *>((header))))) {
-      memcpy(destination, source, size);
-    }
-    if (ref_data_.robot_damage.damage_type == 0x0 &&
-        !last_data_.robot_damage.damage_type) {
-      this->event_.Active(REF_ATTACKED);
-    }
-    if (ref_data_.game_status.game_progress == 4 &&
-        !last_data_.game_status.game_progress) {
-      this->event_.Active(REF_GAME_START);
-    }
-    memcpy(&(this->last_data_), &(destination), sizeof(Data));
+  if (this->parser_.event_ & Parser::EVENT_ATTACKED) {
+    this->event_.Active(REF_ATTACKED);
+  }
+  if (this->parser_.event_ & Parser::EVENT_GAME_START) {
+    this->event_.Active(REF_GAME_START);
   }
+  this->parser_.event_ = 0;
+
 #if REF_VIRTUAL
 #if REF_FORCE_ONLINE
   this->ref_data_.status = RUNNING;
@@ -297,133 +308,239 @@ void Referee::Prase() {
 #endif
 }
 
+void Referee::Parser::Parse(const uint8_t *buf, size_t len) {
+  this->byte_count_ += len;
+
+  while (len > 0) {
+    if (this->frame_len_ == 0) {
+      /* 直接在输入缓冲区中查找并解析完整的帧 */
+      const uint8_t *sof =
+          static_cast<const uint8_t *>(memchr(buf, REF_HEADER_SOF, len));
+      if (sof == NULL) {
+        return;
+      }
+      len -= sof - buf;
+      buf = sof;
+
+      uint32_t used = this->ParseFrame(buf, len);
+      if (used == 0) {
+        /* 帧被DMA数据块截断，暂存到下一次解析 */
+        memcpy(this->frame_, buf, len);
+        this->frame_len_ = len;
+        this->split_count_++;
+        return;
+      }
+      buf += used;
+      len -= used;
+    } else {
+      /* 只补齐当前帧需要的字节数 */
+      uint32_t need = sizeof(Header);
+      if (this->frame_len_ >= sizeof(Header)) {
+        need = REF_LEN_FRAME_OVERHEAD +
+               reinterpret_cast<const Header *>(this->frame_)->data_length;
+        if (need > REF_LEN_FRAME_MAX) {
+          need = REF_LEN_FRAME_MAX;
+        }
+      }
+      need -= this->frame_len_;
+      if (need > len) {
+        need = len;
+      }
+
+      memcpy(this->frame_ + this->frame_len_, buf, need);
+      this->frame_len_ += need;
+      buf += need;
+      len -= need;
+
+      uint32_t used = this->ParseFrame(this->frame_, this->frame_len_);
+      if (used == this->frame_len_) {
+        this->frame_len_ = 0;
+      } else if (used != 0) {
+        /* 暂存的数据不是有效帧，从下一个字节开始重新同步 */
+        uint8_t remain[REF_LEN_FRAME_MAX];
+        uint32_t remain_len = this->frame_len_ - used;
+        memcpy(remain, this->frame_ + used, remain_len);
+        this->frame_len_ = 0;
+        this->byte_count_ -= remain_len;
+        this->Parse(remain, remain_len);
+      }
+    }
+  }
+}
+
+/* 返回消耗的字节数，0表示数据不完整，1表示丢弃SOF重新同步 */
+uint32_t Referee::Parser::ParseFrame(const uint8_t *buf, size_t len) {
+  if (len < sizeof(Header)) {
+    return 0;
+  }
+
+  if (!Component::CRC8::Verify(buf, sizeof(Header))) {
+    return 1;
+  }
+
+  const Header *header = reinterpret_cast<const Header *>(buf);
+  uint32_t frame_len = REF_LEN_FRAME_OVERHEAD + header->data_length;
+
+  if (frame_len > REF_LEN_FRAME_MAX) {
+    return 1;
+  }
+
+  if (len < frame_len) {
+    return 0;
+  }
+
+  if (!Component::CRC16::Verify(buf, frame_len)) {
+    this->crc_error_count_++;
+    return 1;
+  }
+
+  uint16_t cmd_id = 0;
+  memcpy(&cmd_id, buf + sizeof(Header), sizeof(cmd_id));
+
+  this->frame_count_++;
+  this->Dispatch(cmd_id, buf + sizeof(Header) + sizeof(cmd_id),
+                 header->data_length);
+
+  return frame_len;
+}
+
+void Referee::Parser::Dispatch(uint16_t cmd_id, const uint8_t *data,
+                               uint16_t len) {
+  uint32_t index = CmdIndex(cmd_id);
+  if (index >= REF_CMD_TABLE_SIZE || REF_FIELD_TABLE[index].size == 0) {
+    this->unknown_count_++;
+    return;
+  }
+
+  const Field &field = REF_FIELD_TABLE[index];
+  uint8_t *dest = reinterpret_cast<uint8_t *>(&this->data_) + field.offset;
+  uint16_t size = len < field.size ? len : field.size;
+
+  if (cmd_id == REF_CMD_ID_ROBOT_DMG) {
+    const RobotDamage *damage = reinterpret_cast<const RobotDamage *>(data);
+    if (size == sizeof(RobotDamage) && damage->damage_type == 0) {
+      this->event_ |= EVENT_ATTACKED;
+    }
+  } else if (cmd_id == REF_CMD_ID_GAME_STATUS) {
+    const GameStatus *status = reinterpret_cast<const GameStatus *>(data);
+    if (size == sizeof(GameStatus) && status->game_progress == 4 &&
+        this->data_.game_status.game_progress != 4) {
+      this->event_ |= EVENT_GAME_START;
+    }
+  }
+
+  if (memcmp(dest, data, size) != 0) {
+    memcpy(dest, data, size);
+    this->changed_ |= 1ULL << index;
+  }
+}
+
 bool Referee::UpdateUI() {
+  static const uint8_t ELE_PACK_NUM[] = {1, 2, 5, 7};
+  static const CMDID ELE_PACK_CMD[] = {
+      REF_STDNT_CMD_ID_UI_DRAW1, REF_STDNT_CMD_ID_UI_DRAW2,
+      REF_STDNT_CMD_ID_UI_DRAW5, REF_STDNT_CMD_ID_UI_DRAW7};
+  static const uint32_t ELE_PACK_SIZE[] = {
+      sizeof(UIElePack_1), sizeof(UIElePack_2), sizeof(UIElePack_5),
+      sizeof(UIElePack_7)};
+
   this->packet_sent_.Wait(UINT32_MAX);
 
   this->ui_lock_.Wait(UINT32_MAX);
 
-  bool done = false;
-  uint32_t ele_counter = 0;
-  uint32_t pack_size = 0;
-  CMDID cmd_id = REF_STDNT_CMD_ID_UI_DEL;
-  Component::UI::GraphicOperation op = Component::UI::UI_GRAPHIC_OP_NOTHING;
+  uint32_t now = bsp_time_get_ms();
 
-  if (!done && this->static_del_data_.Size() > 0) {
-    cmd_id = REF_STDNT_CMD_ID_UI_DEL;
-    pack_size = sizeof(UIDelPack);
-    done = true;
-    op = Component::UI::UI_GRAPHIC_OP_ADD;
+  /* 按带宽预算累积可发送字节数 */
+  uint32_t elapsed = now - this->ui_last_time_;
+  this->ui_last_time_ = now;
+  if (elapsed > REF_UI_LINK_BURST * 1000 / REF_UI_LINK_BUDGET) {
+    this->ui_token_ = REF_UI_LINK_BURST;
+  } else {
+    this->ui_token_ += elapsed * REF_UI_LINK_BUDGET / 1000;
+    if (this->ui_token_ > REF_UI_LINK_BURST) {
+      this->ui_token_ = REF_UI_LINK_BURST;
+    }
   }
 
-  if (bsp_time_get_ms() % 6000 > 3000) {
-    if (!done && this->static_string_data_.Size() > 0) {
-      cmd_id = REF_STDNT_CMD_ID_UI_STR;
-      pack_size = sizeof(UIStringPack);
-      done = true;
-      op = Component::UI::UI_GRAPHIC_OP_ADD;
+  /* 定期重新添加全部元素，客户端重启后可以恢复UI */
+  if (now - this->ui_refresh_time_ >= REF_UI_REFRESH_CYCLE) {
+    this->ui_refresh_time_ = now;
+    for (auto &node : this->ele_node_) {
+      if (!node.state.key) {
+        continue;
+      }
+      node.state.synced = false;
+      ui_update(node.state, node.state.key, true, node.state.dynamic,
+                node.state.remove);
     }
-
-    static_ele_data_.Reset();
-  } else {
-    if (!done && this->static_ele_data_.Size() > 0) {
-      switch (this->static_ele_data_.Size()) {
-        case 0:
-          break;
-        case 1:
-          cmd_id = REF_STDNT_CMD_ID_UI_DRAW1;
-          done = true;
-          op = Component::UI::UI_GRAPHIC_OP_ADD;
-          ele_counter = 1;
-          pack_size = sizeof(UIElePack_1);
-          break;
-        case 2:
-        case 3:
-        case 4:
-          cmd_id = REF_STDNT_CMD_ID_UI_DRAW2;
-          done = true;
-          op = Component::UI::UI_GRAPHIC_OP_ADD;
-          ele_counter = 2;
-          pack_size = sizeof(UIElePack_2);
-          break;
-        case 5:
-        case 6:
-          cmd_id = REF_STDNT_CMD_ID_UI_DRAW5;
-          done = true;
-          op = Component::UI::UI_GRAPHIC_OP_ADD;
-          ele_counter = 5;
-          pack_size = sizeof(UIElePack_5);
-          break;
-        default:
-          cmd_id = REF_STDNT_CMD_ID_UI_DRAW7;
-          done = true;
-          op = Component::UI::UI_GRAPHIC_OP_ADD;
-          ele_counter = 7;
-          pack_size = sizeof(UIElePack_7);
-          break;
+    for (auto &node : this->str_node_) {
+      if (!node.state.key) {
+        continue;
       }
+      node.state.synced = false;
+      ui_update(node.state, node.state.key, true, node.state.dynamic,
+                node.state.remove);
     }
-
-    static_string_data_.Reset();
   }
 
-  if (!done && this->del_data_.Size() > 0) {
+  UIEleNode *ele[UI_MAX_GRAPHIC_NUM];
+  UIStrNode *str = NULL;
+  uint32_t ele_num = 0;
+  uint32_t pack_size = 0;
+  CMDID cmd_id = REF_STDNT_CMD_ID_UI_DEL;
+
+  if (this->del_data_.Size() > 0) {
+    /* 删除命令最先发送，保证与之后添加的元素顺序一致 */
     cmd_id = REF_STDNT_CMD_ID_UI_DEL;
     pack_size = sizeof(UIDelPack);
-    done = true;
-    op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-  }
-
-  if (!done && this->string_data_.Size() > 0) {
-    cmd_id = REF_STDNT_CMD_ID_UI_STR;
-    pack_size = sizeof(UIStringPack);
-    done = true;
-    op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-  }
-
-  if (!done && this->ele_data_.Size() > 0) {
-    switch (this->ele_data_.Size()) {
-      case 0:
-        break;
-      case 1:
-        cmd_id = REF_STDNT_CMD_ID_UI_DRAW1;
-        done = true;
-        op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-        ele_counter = 1;
-        pack_size = sizeof(UIElePack_1);
-        break;
-      case 2:
-      case 3:
-      case 4:
-        cmd_id = REF_STDNT_CMD_ID_UI_DRAW2;
-        done = true;
-        op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-        ele_counter = 2;
-        pack_size = sizeof(UIElePack_2);
-        break;
-      case 5:
-      case 6:
-        cmd_id = REF_STDNT_CMD_ID_UI_DRAW5;
-        done = true;
-        op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-        ele_counter = 5;
-        pack_size = sizeof(UIElePack_5);
-        break;
-      default:
-        cmd_id = REF_STDNT_CMD_ID_UI_DRAW7;
-        done = true;
-        ele_counter = 7;
-        op = Component::UI::UI_GRAPHIC_OP_REWRITE;
-        pack_size = sizeof(UIElePack_7);
-        break;
+  } else {
+    ele_num = ui_select(this->ele_node_, now, 2, ele, UI_MAX_GRAPHIC_NUM);
+    ui_select(this->str_node_, now, 2, &str, 1);
+
+    uint32_t ele_prio =
+        ele_num ? ui_priority(ele[0]->state, now) : UINT32_MAX;
+    uint32_t str_prio = str ? ui_priority(str->state, now) : UINT32_MAX;
+
+    /* 优先级相同时发送等待更久的一方 */
+    bool send_ele = ele_num > 0 &&
+                    (ele_prio < str_prio ||
+                     (ele_prio == str_prio &&
+                      now - ele[0]->state.since >= now - str->state.since));
+
+    if (send_ele) {
+      uint32_t total = 0;
+      for (auto &node : this->ele_node_) {
+        total += node.state.key != 0;
+      }
+
+      /* 选择能装下所有待发送图形的最小数据包，空位用未变化的图形填充 */
+      uint32_t pack = 0;
+      while (pack < 3 && ELE_PACK_NUM[pack] < ele_num) {
+        pack++;
+      }
+      while (pack > 0 && ELE_PACK_NUM[pack] > total) {
+        pack--;
+      }
+
+      ele_num = ui_select(this->ele_node_, now, 3, ele, ELE_PACK_NUM[pack]);
+      cmd_id = ELE_PACK_CMD[pack];
+      pack_size = ELE_PACK_SIZE[pack];
+      str = NULL;
+    } else if (str != NULL) {
+      cmd_id = REF_STDNT_CMD_ID_UI_STR;
+      pack_size = sizeof(UIStringPack);
+      ele_num = 0;
     }
   }
 
-  if (!done) {
+  if (pack_size == 0 || this->ui_token_ < pack_size) {
     this->ui_lock_.Post();
     this->packet_sent_.Post();
     return false;
   }
 
+  this->ui_token_ -= pack_size;
+
   this->ui_pack_.raw.cmd_id = REF_CMD_ID_INTER_STUDENT;
 
   SetUIHeader(this->ui_pack_.raw.student_header, cmd_id,
@@ -431,42 +548,62 @@ bool Referee::UpdateUI() {
 
   SetPacketHeader(this->ui_pack_.raw.frame_header, pack_size - 9);
 
-  if (ele_counter) {
-    for (uint32_t i = 0; i < ele_counter; i++) {
-      if (op == Component::UI::UI_GRAPHIC_OP_REWRITE) {
-        this->ele_data_.Receive(this->ui_pack_.ele_7.ele_data[i]);
+  if (ele_num) {
+    for (uint32_t i = 0; i < ele_num; i++) {
+      UIState &state = ele[i]->state;
+      Component::UI::Ele &data = this->ui_pack_.ele_7.ele_data[i];
+
+      data = ele[i]->ele;
+      if (state.remove) {
+        data.op = Component::UI::UI_GRAPHIC_OP_DEL;
+      } else if (state.synced) {
+        data.op = Component::UI::UI_GRAPHIC_OP_REWRITE;
       } else {
-        this->static_ele_data_.Receive(this->ui_pack_.ele_7.ele_data[i]);
+        data.op = Component::UI::UI_GRAPHIC_OP_ADD;
+      }
+
+      if (state.remove) {
+        state.key = 0;
       }
+      state.dirty = false;
+      state.synced = true;
+      state.last_sent = now;
     }
 
     uint16_t *crc_addr = reinterpret_cast<uint16_t *>(
-        &this->ui_pack_.ele_7.ele_data[ele_counter]);
+        &this->ui_pack_.ele_7.ele_data[ele_num]);
 
     *crc_addr = Component::CRC16::Calculate(
         reinterpret_cast<const uint8_t *>(&this->ui_pack_),
         pack_size - sizeof(uint16_t), CRC16_INIT);
   } else if (cmd_id == REF_STDNT_CMD_ID_UI_DEL) {
-    if (op == Component::UI::UI_GRAPHIC_OP_REWRITE) {
-      this->del_data_.Receive(this->ui_pack_.del.del_data);
-    } else {
-      this->static_del_data_.Receive(this->ui_pack_.del.del_data);
-    }
+    this->del_data_.Receive(this->ui_pack_.del.del_data);
     this->ui_pack_.del.crc16 = Component::CRC16::Calculate(
         reinterpret_cast<const uint8_t *>(&this->ui_pack_),
         pack_size - sizeof(uint16_t), CRC16_INIT);
 
   } else if (cmd_id == REF_STDNT_CMD_ID_UI_STR) {
-    if (op == Component::UI::UI_GRAPHIC_OP_REWRITE) {
-      this->string_data_.Receive(this->ui_pack_.str.str_data);
+    this->ui_pack_.str.str_data = str->str;
+    if (str->state.remove) {
+      this->ui_pack_.str.str_data.graphic.op = Component::UI::UI_GRAPHIC_OP_DEL;
+      str->state.key = 0;
+    } else if (str->state.synced) {
+      this->ui_pack_.str.str_data.graphic.op =
+          Component::UI::UI_GRAPHIC_OP_REWRITE;
     } else {
-      this->static_string_data_.Receive(this->ui_pack_.str.str_data);
+      this->ui_pack_.str.str_data.graphic.op = Component::UI::UI_GRAPHIC_OP_ADD;
     }
+    str->state.dirty = false;
+    str->state.synced = true;
+    str->state.last_sent = now;
     this->ui_pack_.str.crc16 = Component::CRC16::Calculate(
         reinterpret_cast<const uint8_t *>(&this->ui_pack_),
         pack_size - sizeof(uint16_t), CRC16_INIT);
   }
 
+  this->ui_packet_count_++;
+  this->ui_byte_count_ += pack_size;
+
   bsp_uart_transmit(BSP_UART_REF, reinterpret_cast<uint8_t *>(&this->ui_pack_),
                     pack_size, false);
 
@@ -475,13 +612,32 @@ bool Referee::UpdateUI() {
   return true;
 }
 
+/* 图形按名称保存在场景中，内容未变化时不会重复发送 */
 bool Referee::AddUI(Component::UI::Ele ui_data) {
+  uint32_t key = ui_key(ui_data.name);
+  bool dynamic = ui_data.op == Component::UI::UI_GRAPHIC_OP_REWRITE;
+  bool remove = ui_data.op == Component::UI::UI_GRAPHIC_OP_DEL;
+  ui_data.op = Component::UI::UI_GRAPHIC_OP_NOTHING;
+
   self_->ui_lock_.Wait(UINT32_MAX);
-  if (ui_data.op == Component::UI::UI_GRAPHIC_OP_ADD) {
-    self_->static_ele_data_.Send(ui_data);
-  } else {
-    self_->ele_data_.Send(ui_data);
+
+  UIEleNode *node = ui_find(self_->ele_node_, key);
+  if (node == NULL) {
+    self_->ui_drop_count_++;
+    self_->ui_lock_.Post();
+    return false;
   }
+
+  bool changed = node->state.key != key ||
+                 memcmp(&node->ele, &ui_data, sizeof(ui_data)) != 0 ||
+                 remove != node->state.remove;
+  if (!changed) {
+    self_->ui_skip_count_++;
+  }
+
+  node->ele = ui_data;
+  ui_update(node->state, key, changed, dynamic, remove);
+
   self_->ui_lock_.Post();
 
   return true;
@@ -489,24 +645,113 @@ bool Referee::AddUI(Component::UI::Ele ui_data) {
 
 bool Referee::AddUI(Component::UI::Del ui_data) {
   self_->ui_lock_.Wait(UINT32_MAX);
-  self_->del_data_.Send(ui_data);
+
+  /* 队列已满时场景保持不变，否则客户端上仍显示的元素不会再被重绘 */
+  if (!self_->del_data_.Send(ui_data)) {
+    self_->ui_lock_.Post();
+    return false;
+  }
+
+  /* 被删除的元素从场景中移除，之后重新绘制时会再次添加 */
+  if (ui_data.op == Component::UI::UI_DEL_OP_DEL_ALL) {
+    for (auto &node : self_->ele_node_) {
+      node.state.key = 0;
+    }
+    for (auto &node : self_->str_node_) {
+      node.state.key = 0;
+    }
+  } else if (ui_data.op == Component::UI::UI_DEL_OP_DEL) {
+    for (auto &node : self_->ele_node_) {
+      if (node.ele.layer == ui_data.layer) {
+        node.state.key = 0;
+      }
+    }
+    for (auto &node : self_->str_node_) {
+      if (node.str.graphic.layer == ui_data.layer) {
+        node.state.key = 0;
+      }
+    }
+  }
+
   self_->ui_lock_.Post();
 
   return true;
 }
 
 bool Referee::AddUI(Component::UI::Str ui_data) {
+  uint32_t key = ui_key(ui_data.graphic.name);
+  bool dynamic = ui_data.graphic.op == Component::UI::UI_GRAPHIC_OP_REWRITE;
+  bool remove = ui_data.graphic.op == Component::UI::UI_GRAPHIC_OP_DEL;
+  ui_data.graphic.op = Component::UI::UI_GRAPHIC_OP_NOTHING;
+
   self_->ui_lock_.Wait(UINT32_MAX);
-  if (ui_data.graphic.op == Component::UI::UI_GRAPHIC_OP_ADD) {
-    self_->static_string_data_.Send(ui_data);
-  } else {
-    self_->string_data_.Send(ui_data);
+
+  UIStrNode *node = ui_find(self_->str_node_, key);
+  if (node == NULL) {
+    self_->ui_drop_count_++;
+    self_->ui_lock_.Post();
+    return false;
   }
+
+  bool changed = node->state.key != key ||
+                 memcmp(&node->str, &ui_data, sizeof(ui_data)) != 0 ||
+                 remove != node->state.remove;
+  if (!changed) {
+    self_->ui_skip_count_++;
+  }
+
+  node->str = ui_data;
+  ui_update(node->state, key, changed, dynamic, remove);
+
   self_->ui_lock_.Post();
 
   return true;
 }
 
+int Referee::ShowUI(Referee *ref, int argc, char **argv) {
+  XB_UNUSED(argv);
+
+  if (argc != 1) {
+    printf("ref_ui  show retained UI elements and link usage.\r\n");
+    return 0;
+  }
+
+  uint32_t now = bsp_time_get_ms();
+
+  printf("packet:%u bytes:%u skip:%u drop:%u\r\n",
+         static_cast<unsigned int>(ref->ui_packet_count_),
+         static_cast<unsigned int>(ref->ui_byte_count_),
+         static_cast<unsigned int>(ref->ui_skip_count_),
+         static_cast<unsigned int>(ref->ui_drop_count_));
+  printf("%-6s%-6s%-6s%-6s%-8s%-8s\r\n", "name", "type", "layer", "prio",
+         "synced", "age(ms)");
+
+  ref->ui_lock_.Wait(UINT32_MAX);
+
+  for (auto &node : ref->ele_node_) {
+    if (node.state.key) {
+      printf("%-6.3s%-6s%-6u%-6u%-8d%-8u\r\n", node.ele.name, "ele",
+             static_cast<unsigned int>(node.ele.layer),
+             static_cast<unsigned int>(ui_priority(node.state, now)),
+             node.state.synced,
+             static_cast<unsigned int>(now - node.state.last_sent));
+    }
+  }
+  for (auto &node : ref->str_node_) {
+    if (node.state.key) {
+      printf("%-6.3s%-6s%-6u%-6u%-8d%-8u\r\n", node.str.graphic.name, "str",
+             static_cast<unsigned int>(node.str.graphic.layer),
+             static_cast<unsigned int>(ui_priority(node.state, now)),
+             node.state.synced,
+             static_cast<unsigned int>(now - node.state.last_sent));
+    }
+  }
+
+  ref->ui_lock_.Post();
+
+  return 0;
+}
+
 void Referee::SetUIHeader(Referee::InterStudentHeader &header,
                           const Referee::CMDID CMD_ID,
                           Referee::RobotID robot_id) {
@@ -528,3 +773,113 @@ void Referee::SetPacketHeader(Referee::Header &header, uint16_t data_length) {
       reinterpret_cast<const uint8_t *>(&header),
       sizeof(Referee::Header) - sizeof(uint8_t), CRC8_INIT);
 }
+
+int Referee::ShowParser(Referee *ref, int argc, char **argv) {
+  if (argc == 1) {
+    Parser &parser = ref->parser_;
+    printf("bytes:%u frames:%u crc_error:%u unknown:%u split:%u\r\n",
+           static_cast<unsigned int>(parser.byte_count_),
+           static_cast<unsigned int>(parser.frame_count_),
+           static_cast<unsigned int>(parser.crc_error_count_),
+           static_cast<unsigned int>(parser.unknown_count_),
+           static_cast<unsigned int>(parser.split_count_));
+  } else if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+    static uint8_t traffic[3072];
+    static Data data;
+
+    /* 按比赛中的发送频率生成1秒的裁判系统数据，夹杂未知命令与干扰字节 */
+    static const struct {
+      uint16_t cmd_id;
+      uint16_t size;
+      uint16_t rate;
+    } SOURCE[] = {
+        {REF_CMD_ID_GAME_STATUS, sizeof(GameStatus), 3},
+        {REF_CMD_ID_GAME_ROBOT_HP, sizeof(RobotHP), 3},
+        {REF_CMD_ID_FIELD_EVENTS, sizeof(FieldEvents), 3},
+        {REF_CMD_ID_ROBOT_STATUS, sizeof(RobotStatus), 10},
+        {REF_CMD_ID_POWER_HEAT_DATA, sizeof(PowerHeat), 50},
+        {REF_CMD_ID_ROBOT_POS, sizeof(RobotPOS), 10},
+        {REF_CMD_ID_ROBOT_BUFF, sizeof(RobotBuff), 3},
+        {REF_CMD_ID_LAUNCHER_DATA, sizeof(LauncherData), 10},
+        {REF_CMD_ID_BULLET_REMAINING, sizeof(BulletRemain), 10},
+        {REF_CMD_ID_RFID, sizeof(RFID), 3},
+        {REF_CMD_ID_INTER_STUDENT, 20, 10},
+    };
+
+    uint32_t traffic_len = 0, frame_num = 0;
+    uint8_t seq = 0;
+
+    for (uint16_t tick = 0; tick < 50; tick++) {
+      for (auto &src : SOURCE) {
+        if (tick % (50 / src.rate) != 0 ||
+            traffic_len + REF_LEN_FRAME_OVERHEAD + src.size + 1 >
+                sizeof(traffic)) {
+          continue;
+        }
+
+        uint8_t *frame = traffic + traffic_len;
+        Header *header = reinterpret_cast<Header *>(frame);
+        header->sof = REF_HEADER_SOF;
+        header->data_length = src.size;
+        header->seq = seq++;
+        header->crc8 = Component::CRC8::Calculate(
+            frame, sizeof(Header) - sizeof(uint8_t), CRC8_INIT);
+        memcpy(frame + sizeof(Header), &src.cmd_id, sizeof(src.cmd_id));
+        for (uint16_t i = 0; i < src.size; i++) {
+          frame[sizeof(Header) + sizeof(uint16_t) + i] =
+              static_cast<uint8_t>(tick * 7 + i);
+        }
+        uint32_t len = REF_LEN_FRAME_OVERHEAD + src.size;
+        uint16_t crc = Component::CRC16::Calculate(
+            frame, len - sizeof(Tail), CRC16_INIT);
+        memcpy(frame + len - sizeof(Tail), &crc, sizeof(crc));
+
+        traffic_len += len;
+        frame_num++;
+
+        /* 每隔几帧插入一个伪造的SOF */
+        if (seq % 5 == 0) {
+          traffic[traffic_len++] = REF_HEADER_SOF;
+        }
+      }
+    }
+
+    uint32_t loop =
+        argc == 3 ? static_cast<uint32_t>(atoi(argv[2])) : REF_BENCH_LOOP;
+    Parser parser(data);
+
+    /* 按不同长度切块回放，模拟空闲中断分包 */
+    uint64_t start = bsp_time_get_us();
+    for (uint32_t i = 0; i < loop; i++) {
+      uint32_t offset = 0, chunk = 1;
+      while (offset < traffic_len) {
+        uint32_t len = traffic_len - offset;
+        if (len > chunk) {
+          len = chunk;
+        }
+        parser.Parse(traffic + offset, len);
+        offset += len;
+        chunk = chunk * 5 % 97 + 1;
+      }
+    }
+    uint64_t time = bsp_time_get_us() - start;
+
+    uint64_t bytes = static_cast<uint64_t>(traffic_len) * loop;
+    printf("replay %u bytes x %u, %u frames per loop\r\n",
+           static_cast<unsigned int>(traffic_len),
+           static_cast<unsigned int>(loop),
+           static_cast<unsigned int>(frame_num));
+    printf("parsed:%u crc_error:%u unknown:%u split:%u\r\n",
+           static_cast<unsigned int>(parser.frame_count_),
+           static_cast<unsigned int>(parser.crc_error_count_),
+           static_cast<unsigned int>(parser.unknown_count_),
+           static_cast<unsigned int>(parser.split_count_));
+    printf("time:%uus %u ns/byte\r\n", static_cast<unsigned int>(time),
+           bytes ? static_cast<unsigned int>(time * 1000 / bytes) : 0u);
+  } else {
+    printf("ref_parse              show parser statistics.\r\n");
+    printf("ref_parse bench [loop] replay generated match traffic.\r\n");
+  }
+
+  return 0;
+}
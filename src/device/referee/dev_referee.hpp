@@ -34,6 +34,19 @@
 #define REF_UI_MODE_OFFSET_3_RIGHT (162)
 #define REF_UI_MODE_OFFSET_4_LEFT (174)
 #define REF_UI_MODE_OFFSET_4_RIGHT (222)
+
+#define REF_UI_ELE_NUM (48)         /* UI场景中图形的最大数量 */
+#define REF_UI_STR_NUM (12)         /* UI场景中字符串的最大数量 */
+#define REF_UI_DEL_NUM (8)          /* 删除命令缓存数量 */
+#define REF_UI_CYCLE (40)           /* UI发送线程周期，单位ms */
+#define REF_UI_LINK_BUDGET (3000)   /* UI上行带宽预算，单位字节/秒 */
+#define REF_UI_LINK_BURST (360)     /* 带宽预算最多累积的字节数 */
+#define REF_UI_REFRESH_CYCLE (5000) /* 重新添加全部元素的周期，单位ms */
+#define REF_UI_MAX_DELAY (1000)     /* 低优先级元素最长等待时间，单位ms */
+
+#define REF_LEN_FRAME_MAX (128) /* 单帧最大长度，超过时按错误帧处理 */
+#define REF_CMD_TABLE_SIZE (64) /* 命令码查找表大小，覆盖0x00~0x03命令组 */
+
 namespace Device {
 class Referee {
  public:
@@ -401,6 +414,50 @@ class Referee {
     CustomKeyMouseData custom_key_mouse_data;
   } Data;
 
+  /* 流式解析器，在DMA数据块之间保存未完成的帧
+   * 完整位于输入缓冲区中的帧直接拷贝到目标字段，只有跨块的帧需要暂存 */
+  class Parser {
+   public:
+    typedef enum {
+      EVENT_ATTACKED = 1 << 0,
+      EVENT_GAME_START = 1 << 1,
+    } Event;
+
+    typedef struct {
+      uint16_t offset; /* 在Data中的偏移，size为0表示不解析该命令 */
+      uint16_t size;
+    } Field;
+
+    explicit Parser(Data &data) : data_(data) {}
+
+    void Parse(const uint8_t *buf, size_t len);
+
+    /* 命令码映射到查找表下标，不在表内时返回REF_CMD_TABLE_SIZE */
+    static constexpr uint32_t CmdIndex(uint16_t cmd_id) {
+      if ((cmd_id & 0xf0) || (cmd_id >> 8) >= REF_CMD_TABLE_SIZE / 16) {
+        return REF_CMD_TABLE_SIZE;
+      }
+      return ((cmd_id >> 8) << 4) | (cmd_id & 0x0f);
+    }
+
+    uint64_t changed_ = 0; /* 按CmdIndex置位的已更新字段 */
+    uint32_t event_ = 0;
+    uint32_t frame_count_ = 0;
+    uint32_t crc_error_count_ = 0;
+    uint32_t unknown_count_ = 0;
+    uint32_t split_count_ = 0;
+    uint32_t byte_count_ = 0;
+
+   private:
+    uint32_t ParseFrame(const uint8_t *buf, size_t len);
+
+    void Dispatch(uint16_t cmd_id, const uint8_t *data, uint16_t len);
+
+    Data &data_;
+    uint8_t frame_[REF_LEN_FRAME_MAX];
+    uint32_t frame_len_ = 0;
+  };
+
   typedef struct __attribute__((packed)) {
     Header frame_header;
     uint16_t cmd_id;
@@ -449,6 +506,27 @@ class Referee {
     uint16_t crc16;
   } UIStringPack;
 
+  /* 保留模式UI场景中元素的发送状态，按3字节名称索引 */
+  typedef struct {
+    uint32_t key;       /* 元素名称，0表示空闲 */
+    bool dynamic;       /* 最近一次以REWRITE提交，优先发送 */
+    bool dirty;         /* 内容与客户端不一致 */
+    bool synced;        /* 客户端已添加该元素 */
+    bool remove;        /* 发送删除操作后释放 */
+    uint32_t since;     /* 开始等待发送的时间 */
+    uint32_t last_sent; /* 上次发送的时间 */
+  } UIState;
+
+  typedef struct {
+    UIState state;
+    Component::UI::Ele ele;
+  } UIEleNode;
+
+  typedef struct {
+    UIState state;
+    Component::UI::Str str;
+  } UIStrNode;
+
   union UIPack {
     UIElePack_7 ele_7;
     UIStringPack str;
@@ -483,6 +561,10 @@ class Referee {
 
   bool StartTrans();
 
+  static int ShowUI(Referee *ref, int argc, char **argv);
+
+  static int ShowParser(Referee *ref, int argc, char **argv);
+
   void SetUIHeader(InterStudentHeader &header, const CMDID CMD_ID,
                    RobotID robot_id);
 
@@ -497,32 +579,37 @@ class Referee {
 
   Message::Topic<Data> ref_data_tp_ = Message::Topic<Data>("referee");
 
-  System::Queue<Component::UI::Ele> ele_data_ =
-      System::Queue<Component::UI::Ele>(10);
-
-  System::Queue<Component::UI::Str> string_data_ =
-      System::Queue<Component::UI::Str>(10);
-
-  System::Queue<Component::UI::Del> del_data_ =
-      System::Queue<Component::UI::Del>(10);
+  /* 每次解析后发布本次更新的字段，位定义见Parser::CmdIndex */
+  Message::Topic<uint64_t> ref_changed_tp_ =
+      Message::Topic<uint64_t>("referee_changed");
 
-  System::Queue<Component::UI::Ele> static_ele_data_ =
-      System::Queue<Component::UI::Ele>(10);
+  std::array<UIEleNode, REF_UI_ELE_NUM> ele_node_{};
 
-  System::Queue<Component::UI::Str> static_string_data_ =
-      System::Queue<Component::UI::Str>(10);
+  std::array<UIStrNode, REF_UI_STR_NUM> str_node_{};
 
-  System::Queue<Component::UI::Del> static_del_data_ =
-      System::Queue<Component::UI::Del>(10);
+  System::Queue<Component::UI::Del> del_data_ =
+      System::Queue<Component::UI::Del>(REF_UI_DEL_NUM);
 
   System::Semaphore ui_lock_ = System::Semaphore(true);
 
   Data ref_data_;
 
-  Data last_data_;
+  Parser parser_ = Parser(ref_data_);
 
   Message::Event event_;
 
+  uint32_t ui_token_ = 0;
+  uint32_t ui_last_time_ = 0;
+  uint32_t ui_refresh_time_ = 0;
+  uint32_t ui_packet_count_ = 0;
+  uint32_t ui_byte_count_ = 0;
+  uint32_t ui_skip_count_ = 0;
+  uint32_t ui_drop_count_ = 0;
+
+  System::Term::Command<Referee *> cmd_;
+
+  System::Term::Command<Referee *> parser_cmd_;
+
   static UIPack ui_pack_;
 
   static Referee *self_;
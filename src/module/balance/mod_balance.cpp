@@ -24,7 +24,8 @@ Balance<Motor, MotorParam>::Balance(Param& param, float control_freq)
     : param_(param),
       offset_pid_(param.offset_pid, control_freq),
       speed_filter_(control_freq, param.speed_filter_cutoff_freq),
-      ctrl_lock_(true) {
+      ctrl_lock_(true),
+      trigger_("balance", 2, control_freq) {
   constexpr auto WHELL_NAMES = magic_enum::enum_names<Wheel>();
 
   memset(&this->move_vec_, 0, sizeof(this->move_vec_));
@@ -67,23 +68,27 @@ Balance<Motor, MotorParam>::Balance(Param& param, float control_freq)
                                                         this->param_.EVENT_MAP);
 
   auto chassis_thread = [](Balance* chassis) {
-    auto raw_ref_sub = Message::Subscriber<Device::Referee::Data>("referee");
-    auto cmd_sub =
-        Message::Subscriber<Component::CMD::ChassisCMD>("cmd_chassis");
-    auto eulr_sub = Message::Subscriber<Component::Type::Eulr>("chassis_eulr");
-    auto gyro_sub =
-        Message::Subscriber<Component::Type::Vector3>("chassis_gyro");
-    auto yaw_sub = Message::Subscriber<float>("chassis_yaw");
-    auto leg_sub =
-        Message::Subscriber<Component::Type::Polar2>("leg_whell_polor");
-    auto cap_sub = Message::Subscriber<Device::Cap::Info>("cap_info");
-
-    uint32_t last_online_time = bsp_time_get_ms();
+    auto raw_ref_sub = System::Latest<Device::Referee::Data>("referee");
+    auto cmd_sub = System::Latest<Component::CMD::ChassisCMD>("cmd_chassis");
+    auto eulr_sub = System::Latest<Component::Type::Eulr>("chassis_eulr");
+    auto gyro_sub = System::Latest<Component::Type::Vector3>("chassis_gyro");
+    auto yaw_sub = System::Latest<float>("chassis_yaw");
+    auto leg_sub = System::Latest<Component::Type::Polar2>("leg_whell_polor");
+    auto cap_sub = System::Latest<Device::Cap::Info>("cap_info");
+
+    /* 以底盘姿态为准，轮子电机反馈只记录到达时间 */
+    chassis->trigger_.template Watch<Component::Type::Eulr>("chassis_eulr");
+    for (uint8_t i = 0; i < WHEEL_NUM; i++) {
+      chassis->trigger_.template Watch<Device::Can::Pack>(
+          chassis->motor_[i]->name_, false);
+    }
 
     while (1) {
       /* 读取控制指令、电容、裁判系统、电机反馈 */
       cmd_sub.DumpData(chassis->cmd_);
-      raw_ref_sub.DumpData(chassis->raw_ref_);
+      raw_ref_sub.DumpField(chassis->raw_ref_, &Device::Referee::Data::status,
+                            &Device::Referee::Data::robot_status,
+                            &Device::Referee::Data::power_heat);
       eulr_sub.DumpData(chassis->eulr_);
       gyro_sub.DumpData(chassis->gyro_);
       yaw_sub.DumpData(chassis->yaw_);
@@ -97,9 +102,10 @@ Balance<Motor, MotorParam>::Balance(Param& param, float control_freq)
       chassis->UpdateStatus();
       chassis->Control();
       chassis->ctrl_lock_.Post();
+      chassis->trigger_.Done();
 
-      /* 运行结束，等待下一次唤醒 */
-      chassis->thread_.SleepUntil(2, last_online_time);
+      /* 运行结束，等待下一次输入 */
+      chassis->trigger_.Wait();
     }
   };
 
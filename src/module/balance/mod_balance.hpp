@@ -149,6 +149,8 @@ class Balance {
   Component::LowPassFilter2p speed_filter_;
 
   System::Semaphore ctrl_lock_;
+
+  System::Trigger trigger_;
   Device::Referee::Data raw_ref_;
 
   Component::CMD::ChassisCMD cmd_;
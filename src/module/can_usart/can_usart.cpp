@@ -7,8 +7,7 @@ using namespace Module;
 
 CantoUsart::CantoUsart()
     : uart_recv_buff_addr_(&uart_recv_buff_1_),
-      tx_cplt_(true),
-      tx_ready_(false) {
+      cmd_(this, ShowInfo, "can_usart") {
   auto rx_callback_fn = [](void *arg) {
     CantoUsart *can_uart = static_cast<CantoUsart *>(arg);
 
@@ -52,19 +51,31 @@ CantoUsart::CantoUsart()
   auto tx_cplt_cb = [](void *arg) {
     CantoUsart *can_uart = static_cast<CantoUsart *>(arg);
 
-    can_uart->tx_cplt_.Post();
+    can_uart->ContinueTransmit();
   };
 
   bsp_uart_register_callback(BSP_UART_MCU, BSP_UART_TX_CPLT_CB, tx_cplt_cb,
                              this);
 
   auto rx_callback = [](Device::Can::Pack &rx, CantoUsart *can_uart) {
-    can_uart->uart_trans_buff_.start_frame = START;
-    can_uart->uart_trans_buff_.id = rx.index;
-    can_uart->uart_trans_buff_.type = CAN_FORMAT_STD;
-    memcpy(&can_uart->uart_trans_buff_.data, rx.data, sizeof(rx.data));
-    can_uart->uart_trans_buff_.end_frame = END;
-    can_uart->tx_ready_.Post();
+    uint32_t tail = can_uart->ring_tail_.load(std::memory_order_relaxed);
+    uint32_t head = can_uart->ring_head_.load(std::memory_order_acquire);
+
+    can_uart->rx_count_++;
+
+    if (tail - head >= CANUSART_RING_SIZE) {
+      can_uart->overflow_count_++;
+    } else {
+      UartData &pack = can_uart->ring_[tail & (CANUSART_RING_SIZE - 1)];
+      pack.start_frame = START;
+      pack.id = rx.index;
+      pack.type = CAN_FORMAT_STD;
+      memcpy(&pack.data, rx.data, sizeof(rx.data));
+      pack.end_frame = END;
+      can_uart->ring_tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    can_uart->StartTransmit();
     return true;
   };
 
@@ -73,16 +84,84 @@ CantoUsart::CantoUsart()
 
   Device::Can::Subscribe(cap_tp, BSP_CAN_1, 0, UINT32_MAX);
 
-  auto uart_send_fn = [](CantoUsart *can_uart) {
-    while (1) {
-      can_uart->tx_ready_.Wait(UINT32_MAX);
-      can_uart->tx_cplt_.Wait(UINT32_MAX);
-      bsp_uart_transmit(
-          BSP_UART_MCU,
-          reinterpret_cast<uint8_t *>(&can_uart->uart_trans_buff_),
-          sizeof(UartData), false);
+  /* 发送由中断驱动，定时器只负责统计与兜底 */
+  auto stat_fn = [](CantoUsart *can_uart) {
+    can_uart->fps_ = can_uart->tx_count_ - can_uart->last_tx_count_;
+    can_uart->last_tx_count_ = can_uart->tx_count_;
+    if (can_uart->fps_ > can_uart->max_fps_) {
+      can_uart->max_fps_ = can_uart->fps_;
     }
+    can_uart->StartTransmit();
   };
 
-  System::Timer::Create(uart_send_fn, this, 0);
+  System::Timer::Create(stat_fn, this, 1000);
+}
+
+void CantoUsart::StartTransmit() {
+  bool busy = false;
+  if (!tx_busy_.compare_exchange_strong(busy, true,
+                                        std::memory_order_acquire)) {
+    return;
+  }
+
+  ContinueTransmit();
+}
+
+void CantoUsart::ContinueTransmit() {
+  uint32_t head = ring_head_.load(std::memory_order_relaxed);
+  uint32_t tail = ring_tail_.load(std::memory_order_acquire);
+  uint32_t num = tail - head;
+
+  if (num == 0) {
+    tx_busy_.store(false, std::memory_order_release);
+    /* 释放发送权前可能有新帧写入 */
+    if (ring_tail_.load(std::memory_order_acquire) != head) {
+      StartTransmit();
+    }
+    return;
+  }
+
+  if (num > CANUSART_BURST_NUM) {
+    num = CANUSART_BURST_NUM;
+  }
+
+  for (uint32_t i = 0; i < num; i++) {
+    uart_trans_buff_[i] = ring_[(head + i) & (CANUSART_RING_SIZE - 1)];
+  }
+
+  ring_head_.store(head + num, std::memory_order_release);
+
+  tx_count_ += num;
+  burst_count_++;
+
+  if (bsp_uart_transmit(BSP_UART_MCU,
+                        reinterpret_cast<uint8_t *>(&uart_trans_buff_[0]),
+                        sizeof(UartData) * num, false) != BSP_OK) {
+    tx_count_ -= num;
+    overflow_count_ += num;
+    tx_busy_.store(false, std::memory_order_release);
+  }
+}
+
+int CantoUsart::ShowInfo(CantoUsart *can_uart, int argc, char **argv) {
+  XB_UNUSED(argv);
+
+  if (argc != 1) {
+    printf("can_usart  show forwarded frames and overflow.\r\n");
+    return 0;
+  }
+
+  printf("rx:%u tx:%u overflow:%u\r\n",
+         static_cast<unsigned int>(can_uart->rx_count_),
+         static_cast<unsigned int>(can_uart->tx_count_),
+         static_cast<unsigned int>(can_uart->overflow_count_));
+  printf("burst:%u frame per burst:%f\r\n",
+         static_cast<unsigned int>(can_uart->burst_count_),
+         can_uart->burst_count_ ? static_cast<float>(can_uart->tx_count_) /
+                                      static_cast<float>(can_uart->burst_count_)
+                                : 0.0f);
+  printf("frame/s:%u max:%u\r\n", static_cast<unsigned int>(can_uart->fps_),
+         static_cast<unsigned int>(can_uart->max_fps_));
+
+  return 0;
 }
@@ -1,6 +1,15 @@
+#pragma once
+
+#include <atomic>
+
 #include "dev_can.hpp"
 #include "module.hpp"
 
+/* CAN中断与发送之间的帧缓冲数量，必须为2的幂 */
+#define CANUSART_RING_SIZE (64)
+/* 单次UART DMA发送的最大帧数 */
+#define CANUSART_BURST_NUM (8)
+
 namespace Module {
 class CantoUsart {
  public:
@@ -17,11 +26,37 @@ class CantoUsart {
   CantoUsart();
 
  private:
+  static_assert((CANUSART_RING_SIZE & (CANUSART_RING_SIZE - 1)) == 0,
+                "CANUSART_RING_SIZE must be a power of 2.");
+
+  /* 尝试取得发送权，取得后开始一次DMA发送 */
+  void StartTransmit();
+
+  /* 持有发送权时调用，从环形缓冲区取出多帧合并发送 */
+  void ContinueTransmit();
+
+  static int ShowInfo(CantoUsart* can_uart, int argc, char** argv);
+
   std::array<uint8_t, sizeof(UartData) * 2> uart_recv_buff_1_;
   std::array<uint8_t, sizeof(UartData) * 2> uart_recv_buff_2_;
   std::array<uint8_t, sizeof(UartData) * 2>* uart_recv_buff_addr_;
-  UartData uart_trans_buff_;
-  System::Semaphore tx_cplt_;
-  System::Semaphore tx_ready_;
+
+  /* 单生产者(CAN中断)单消费者(持有发送权者)的无锁环形缓冲区 */
+  std::array<UartData, CANUSART_RING_SIZE> ring_;
+  std::atomic<uint32_t> ring_head_{0};
+  std::atomic<uint32_t> ring_tail_{0};
+
+  std::array<UartData, CANUSART_BURST_NUM> uart_trans_buff_;
+  std::atomic<bool> tx_busy_{false};
+
+  uint32_t rx_count_ = 0;
+  uint32_t tx_count_ = 0;
+  uint32_t overflow_count_ = 0;
+  uint32_t burst_count_ = 0;
+  uint32_t last_tx_count_ = 0;
+  uint32_t fps_ = 0;
+  uint32_t max_fps_ = 0;
+
+  System::Term::Command<CantoUsart*> cmd_;
 };
 }  // namespace Module
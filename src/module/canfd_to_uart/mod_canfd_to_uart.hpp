@@ -1,8 +1,13 @@
+#include <atomic>
+
 #include "bsp_uart.h"
 #include "comp_crc8.hpp"
 #include "dev_can.hpp"
 #include "module.hpp"
 
+/* 单个DMA发送缓冲区大小，两块交替使用 */
+#define FDCAN_TO_UART_TX_BUFF_SIZE (512)
+
 namespace Module {
 class FDCanToUart {
  public:
@@ -16,7 +21,16 @@ class FDCanToUart {
     uint8_t crc8;
   } UartDataHeader;
 
-  FDCanToUart() : uart_received(0), uart_sent(1) {
+  /* 发送状态打包在一个原子变量中，CAN中断与UART发送完成中断均可无锁访问
+   * bit0: 正在填充的缓冲区 bit1: DMA发送中 bit2-7: 正在写入的帧数
+   * bit8-31: 已预留的长度 */
+  static constexpr uint32_t TX_INDEX = 1U << 0;
+  static constexpr uint32_t TX_BUSY = 1U << 1;
+  static constexpr uint32_t TX_WRITER = 1U << 2;
+  static constexpr uint32_t TX_WRITER_MASK = 0x3fU << 2;
+  static constexpr uint32_t TX_LEN_SHIFT = 8;
+
+  FDCanToUart() : cmd_(this, ShowInfo, "canfd_to_uart") {
     self_ = this;
 
     om_fifo_create(&uart_rx_fifo, new uint8_t[256], 256, sizeof(uint8_t));
@@ -26,12 +40,11 @@ class FDCanToUart {
 
     for (int i = 0; i < BSP_CAN_NUM; i++) {
       can_id_[i] = i;
-      curr_uart_tx_buff[i] = uart_tx_buff[i][0];
     }
 
     auto uart_tx_cplt_cb = [](void* arg) {
       XB_UNUSED(arg);
-      self_->uart_sent.Post();
+      self_->TxComplete();
     };
 
     auto uart_rx_cplt_cb = [](void* arg) {
@@ -99,65 +112,14 @@ class FDCanToUart {
 
     auto canfd_rx_fun = [](Device::Can::FDPack& pack, uint8_t* can) {
       XB_ASSERT(pack.info.size <= 64);
-
-      if (self_->curr_uart_tx_buff[*can] == self_->uart_tx_buff[*can][0]) {
-        self_->curr_uart_tx_buff[*can] = self_->uart_tx_buff[*can][1];
-      } else {
-        self_->curr_uart_tx_buff[*can] = self_->uart_tx_buff[*can][0];
-      }
-
-      uint8_t* buff = self_->curr_uart_tx_buff[*can];
-      UartDataHeader* header = reinterpret_cast<UartDataHeader*>(buff);
-      buff += sizeof(UartDataHeader);
-
-      header->prefix = 0xa5;
-      header->data_len = pack.info.size;
-      header->id = *can;
-      header->index = pack.index;
-      header->fd = true;
-      header->crc8 = Component::CRC8::Calculate(
-          reinterpret_cast<uint8_t*>(header),
-          sizeof(UartDataHeader) - sizeof(uint8_t), CRC8_INIT);
-      memcpy(buff, pack.info.data, pack.info.size);
-      buff += pack.info.size;
-      *buff = Component::CRC8::Calculate(
-          reinterpret_cast<uint8_t*>(header),
-          sizeof(UartDataHeader) + pack.info.size, CRC8_INIT);
-      if (self_->uart_sent.Wait(UINT32_MAX)) {
-        bsp_uart_transmit(
-            BSP_UART_MCU, reinterpret_cast<uint8_t*>(header),
-            sizeof(UartDataHeader) + pack.info.size + sizeof(uint8_t), false);
-      }
+      self_->Encode(*can, pack.index, pack.format, pack.info.data,
+                    pack.info.size, true);
       return false;
     };
 
     auto can_rx_fun = [](Device::Can::Pack& pack, uint8_t* can) {
-      if (self_->curr_uart_tx_buff[*can] == self_->uart_tx_buff[*can][0]) {
-        self_->curr_uart_tx_buff[*can] = self_->uart_tx_buff[*can][1];
-      } else {
-        self_->curr_uart_tx_buff[*can] = self_->uart_tx_buff[*can][0];
-      }
-
-      uint8_t* buff = self_->curr_uart_tx_buff[*can];
-      UartDataHeader* header = reinterpret_cast<UartDataHeader*>(buff);
-      buff += sizeof(UartDataHeader);
-
-      header->prefix = 0xa5;
-      header->data_len = 8;
-      header->id = *can;
-      header->index = pack.index;
-      header->fd = false;
-      header->crc8 = Component::CRC8::Calculate(
-          reinterpret_cast<uint8_t*>(header),
-          sizeof(UartDataHeader) - sizeof(uint8_t), CRC8_INIT);
-      memcpy(buff, pack.data, 8);
-      buff += 8;
-      *buff = Component::CRC8::Calculate(reinterpret_cast<uint8_t*>(header),
-                                         sizeof(UartDataHeader) + 8, CRC8_INIT);
-      if (self_->uart_sent.Wait(UINT32_MAX)) {
-        bsp_uart_transmit(BSP_UART_MCU, buff,
-                          sizeof(UartDataHeader) + 8 + sizeof(uint8_t), false);
-      }
+      self_->Encode(*can, pack.index, pack.format, pack.data,
+                    sizeof(pack.data), false);
       return false;
     };
 
@@ -180,21 +142,123 @@ class FDCanToUart {
                      sizeof(self_->uart_rx_buff), false);
   }
 
-  struct __attribute__((packed)) {
-    UartDataHeader header;
-    uint8_t buff[65];
-  } can_buff_[BSP_CAN_NUM];
+  /* 直接在DMA缓冲区中编码一帧，DMA空闲时立即发送，否则等待发送完成后合并发送 */
+  void Encode(uint8_t can, uint32_t index, bsp_can_format_t format,
+              const uint8_t* data, uint8_t len, bool fd) {
+    uint32_t size = sizeof(UartDataHeader) + len + sizeof(uint8_t);
+    uint32_t state = tx_state_.load(std::memory_order_relaxed);
+    uint32_t offset = 0;
+
+    do {
+      offset = state >> TX_LEN_SHIFT;
+      if (offset + size > FDCAN_TO_UART_TX_BUFF_SIZE ||
+          (state & TX_WRITER_MASK) == TX_WRITER_MASK) {
+        drop_count_[can]++;
+        return;
+      }
+    } while (!tx_state_.compare_exchange_weak(
+        state, state + (size << TX_LEN_SHIFT) + TX_WRITER,
+        std::memory_order_acquire, std::memory_order_relaxed));
+
+    uint8_t* buff = uart_tx_buff_[state & TX_INDEX] + offset;
+    UartDataHeader* header = reinterpret_cast<UartDataHeader*>(buff);
+
+    header->prefix = 0xa5;
+    header->id = can;
+    header->index = index;
+    header->data_len = len;
+    header->ext = format == CAN_FORMAT_EXT;
+    header->fd = fd;
+    header->crc8 = Component::CRC8::Calculate(
+        buff, sizeof(UartDataHeader) - sizeof(uint8_t), CRC8_INIT);
+    memcpy(buff + sizeof(UartDataHeader), data, len);
+    buff[sizeof(UartDataHeader) + len] = Component::CRC8::Calculate(
+        buff, sizeof(UartDataHeader) + len, CRC8_INIT);
+
+    frame_count_[can]++;
+
+    /* 最后一个写入者在DMA空闲时负责发送 */
+    state = tx_state_.load(std::memory_order_relaxed);
+    uint32_t next = 0;
+    do {
+      next = state - TX_WRITER;
+      if ((next & (TX_WRITER_MASK | TX_BUSY)) == 0) {
+        next = ((state & TX_INDEX) ^ TX_INDEX) | TX_BUSY;
+      }
+    } while (!tx_state_.compare_exchange_weak(state, next,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed));
+
+    if ((next & TX_BUSY) && !(state & TX_BUSY)) {
+      Transmit(state);
+    }
+  }
+
+  void TxComplete() {
+    uint32_t state = tx_state_.load(std::memory_order_relaxed);
+    uint32_t next = 0;
+    do {
+      if ((state & TX_WRITER_MASK) == 0 && (state >> TX_LEN_SHIFT) > 0) {
+        next = ((state & TX_INDEX) ^ TX_INDEX) | TX_BUSY;
+      } else {
+        next = state & ~TX_BUSY;
+      }
+    } while (!tx_state_.compare_exchange_weak(state, next,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed));
+
+    if (next & TX_BUSY) {
+      Transmit(state);
+    }
+  }
+
+  /* 发送state中正在填充的缓冲区，调用前已切换到另一块缓冲区 */
+  void Transmit(uint32_t state) {
+    batch_count_++;
+    bsp_uart_transmit(BSP_UART_MCU, uart_tx_buff_[state & TX_INDEX],
+                      state >> TX_LEN_SHIFT, false);
+  }
+
+  static int ShowInfo(FDCanToUart* self, int argc, char** argv) {
+    XB_UNUSED(argv);
+
+    if (argc != 1) {
+      printf("canfd_to_uart  show forwarded and dropped frames.\r\n");
+      return 0;
+    }
 
-  uint8_t* curr_uart_tx_buff[BSP_CAN_NUM];
+    uint32_t frame_sum = 0;
+    for (int i = 0; i < BSP_CAN_NUM; i++) {
+      printf("can%d\tframe:%u\tdrop:%u\r\n", i,
+             static_cast<unsigned int>(self->frame_count_[i]),
+             static_cast<unsigned int>(self->drop_count_[i]));
+      frame_sum += self->frame_count_[i];
+    }
+
+    printf("uart batch:%u\tframe per batch:%f\r\n",
+           static_cast<unsigned int>(self->batch_count_),
+           self->batch_count_ ? static_cast<float>(frame_sum) /
+                                    static_cast<float>(self->batch_count_)
+                              : 0.0f);
+
+    return 0;
+  }
 
   uint8_t uart_rx_buff[256] = {};
-  uint8_t uart_tx_buff[BSP_CAN_NUM][2][256] = {};
+  uint8_t uart_tx_buff_[2][FDCAN_TO_UART_TX_BUFF_SIZE] = {};
+
+  std::atomic<uint32_t> tx_state_{0};
+
+  uint32_t frame_count_[BSP_CAN_NUM] = {};
+  uint32_t drop_count_[BSP_CAN_NUM] = {};
+  uint32_t batch_count_ = 0;
 
-  System::Semaphore uart_received, uart_sent;
   om_fifo_t uart_rx_fifo;
 
   uint8_t can_id_[BSP_CAN_NUM];
 
+  System::Term::Command<FDCanToUart*> cmd_;
+
   static FDCanToUart* self_;
 };
 }  // namespace Module
@@ -47,7 +47,8 @@ Chassis<Motor, MotorParam>::Chassis(Param& param, float control_freq)
       mode_(Chassis::RELAX),
       mixer_(param.type),
       follow_pid_(param.follow_pid_param, control_freq),
-      ctrl_lock_(true) {
+      ctrl_lock_(true),
+      trigger_("chassis", 2, control_freq) {
   memset(&(this->cmd_), 0, sizeof(this->cmd_));
 
   for (uint8_t i = 0; i < this->mixer_.len_; i++) {
@@ -91,20 +92,26 @@ Chassis<Motor, MotorParam>::Chassis(Param& param, float control_freq)
                                                         this->param_.EVENT_MAP);
 
   auto chassis_thread = [](Chassis* chassis) {
-    auto raw_ref_sub = Message::Subscriber<Device::Referee::Data>("referee");
-    auto cmd_sub =
-        Message::Subscriber<Component::CMD::ChassisCMD>("cmd_chassis");
+    auto raw_ref_sub = System::Latest<Device::Referee::Data>("referee");
+    auto cmd_sub = System::Latest<Component::CMD::ChassisCMD>("cmd_chassis");
 
-    auto yaw_sub = Message::Subscriber<float>("chassis_yaw");
+    auto yaw_sub = System::Latest<float>("chassis_yaw");
 
-    auto cap_sub = Message::Subscriber<Device::Cap::Info>("cap_info");
+    auto cap_sub = System::Latest<Device::Cap::Info>("cap_info");
 
-    uint32_t last_online_time = bsp_time_get_ms();
+    /* 所有轮子的电机反馈到齐后控制 */
+    for (uint8_t i = 0; i < chassis->mixer_.len_; i++) {
+      chassis->trigger_.template Watch<Device::Can::Pack>(
+          chassis->motor_[i]->name_);
+    }
 
     while (1) {
       /* 读取控制指令、电容、裁判系统、电机反馈 */
       cmd_sub.DumpData(chassis->cmd_);
-      raw_ref_sub.DumpData(chassis->raw_ref_);
+      /* 裁判系统数据只用到功率相关的部分 */
+      raw_ref_sub.DumpField(chassis->raw_ref_, &Device::Referee::Data::status,
+                            &Device::Referee::Data::robot_status,
+                            &Device::Referee::Data::power_heat);
       yaw_sub.DumpData(chassis->yaw_);
       cap_sub.DumpData(chassis->cap_);
 
@@ -115,9 +122,10 @@ Chassis<Motor, MotorParam>::Chassis(Param& param, float control_freq)
       chassis->UpdateFeedback();
       chassis->Control();
       chassis->ctrl_lock_.Post();
+      chassis->trigger_.Done();
 
-      /* 运行结束，等待下一次唤醒 */
-      chassis->thread_.SleepUntil(2, last_online_time);
+      /* 运行结束，等待下一次输入 */
+      chassis->trigger_.Wait();
     }
   };
 
@@ -121,6 +121,8 @@ class Chassis {
 
   System::Semaphore ctrl_lock_;
 
+  System::Trigger trigger_;
+
   float yaw_;
   Device::Referee::Data raw_ref_;
   Component::CMD::ChassisCMD cmd_;
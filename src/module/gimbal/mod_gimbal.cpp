@@ -21,7 +21,8 @@ Gimbal::Gimbal(Param& param, float control_freq)
       pit_actuator_(this->param_.pit_actr, control_freq),
       yaw_motor_(this->param_.yaw_motor, "Gimbal_Yaw"),
       pit_motor_(this->param_.pit_motor, "Gimbal_Pitch"),
-      ctrl_lock_(true) {
+      ctrl_lock_(true),
+      trigger_("gimbal", 2, control_freq) {
   auto event_callback = [](GimbalEvent event, Gimbal* gimbal) {
     gimbal->ctrl_lock_.Wait(UINT32_MAX);
 
@@ -44,13 +45,18 @@ Gimbal::Gimbal(Param& param, float control_freq)
                                                       this->param_.EVENT_MAP);
 
   auto gimbal_thread = [](Gimbal* gimbal) {
-    auto eulr_sub = Message::Subscriber<Component::Type::Eulr>("imu_eulr");
+    auto eulr_sub = System::Latest<Component::Type::Eulr>("imu_eulr");
 
-    auto gyro_sub = Message::Subscriber<Component::Type::Vector3>("imu_gyro");
+    auto gyro_sub = System::Latest<Component::Type::Vector3>("imu_gyro");
 
-    auto cmd_sub = Message::Subscriber<Component::CMD::GimbalCMD>("cmd_gimbal");
+    auto cmd_sub = System::Latest<Component::CMD::GimbalCMD>("cmd_gimbal");
 
-    uint32_t last_online_time = bsp_time_get_ms();
+    /* 姿态解算完成后立即控制，电机反馈只记录到达时间 */
+    gimbal->trigger_.Watch<Component::Type::Eulr>("imu_eulr");
+    gimbal->trigger_.Watch<Device::Can::Pack>(gimbal->yaw_motor_.name_,
+                                              false);
+    gimbal->trigger_.Watch<Device::Can::Pack>(gimbal->pit_motor_.name_,
+                                              false);
 
     while (1) {
       /* 读取控制指令、姿态、IMU、电机反馈 */
@@ -62,11 +68,12 @@ Gimbal::Gimbal(Param& param, float control_freq)
       gimbal->UpdateFeedback();
       gimbal->Control();
       gimbal->ctrl_lock_.Post();
+      gimbal->trigger_.Done();
 
       gimbal->yaw_tp_.Publish(gimbal->yaw_);
 
-      /* 运行结束，等待下一次唤醒 */
-      gimbal->thread_.SleepUntil(2, last_online_time);
+      /* 运行结束，等待下一次输入 */
+      gimbal->trigger_.Wait();
     }
   };
 
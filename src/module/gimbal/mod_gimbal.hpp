@@ -102,6 +102,8 @@ class Gimbal {
 
   System::Semaphore ctrl_lock_;
 
+  System::Trigger trigger_;
+
   Message::Topic<float> yaw_tp_ = Message::Topic<float>("chassis_yaw");
 
   float yaw_;
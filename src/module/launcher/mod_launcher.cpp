@@ -19,7 +19,7 @@
 using namespace Module;
 
 Launcher::Launcher(Param& param, float control_freq)
-    : param_(param), ctrl_lock_(true) {
+    : param_(param), ctrl_lock_(true), trigger_("launcher", 2, control_freq) {
   for (size_t i = 0; i < LAUNCHER_ACTR_TRIG_NUM; i++) {
     this->trig_actuator_.at(i) =
         new Component::PosActuator(param.trig_actr.at(i), control_freq);
@@ -80,12 +80,21 @@ Launcher::Launcher(Param& param, float control_freq)
   bsp_pwm_set_comp(BSP_PWM_LAUNCHER_SERVO, this->param_.cover_close_duty);
 
   auto launcher_thread = [](Launcher* launcher) {
-    auto ref_sub = Message::Subscriber<Device::Referee::Data>("referee");
+    auto ref_sub = System::Latest<Device::Referee::Data>("referee");
 
-    uint32_t last_online_time = bsp_time_get_ms();
+    /* 摩擦轮的反馈到齐后控制，拨弹电机只记录到达时间 */
+    for (auto motor : launcher->fric_motor_) {
+      launcher->trigger_.Watch<Device::Can::Pack>(motor->name_);
+    }
+    for (auto motor : launcher->trig_motor_) {
+      launcher->trigger_.Watch<Device::Can::Pack>(motor->name_, false);
+    }
 
     while (1) {
-      ref_sub.DumpData(launcher->raw_ref_);
+      ref_sub.DumpField(launcher->raw_ref_, &Device::Referee::Data::status,
+                        &Device::Referee::Data::power_heat,
+                        &Device::Referee::Data::robot_status,
+                        &Device::Referee::Data::launcher_data);
 
       launcher->PraseRef();
 
@@ -95,9 +104,10 @@ Launcher::Launcher(Param& param, float control_freq)
       launcher->Control();
 
       launcher->ctrl_lock_.Post();
+      launcher->trigger_.Done();
 
-      /* 运行结束，等待下一次唤醒 */
-      launcher->thread_.SleepUntil(2, last_online_time);
+      /* 运行结束，等待下一次输入 */
+      launcher->trigger_.Wait();
     }
   };
 
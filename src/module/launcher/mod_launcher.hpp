@@ -184,6 +184,8 @@ class Launcher {
 
   System::Semaphore ctrl_lock_;
 
+  System::Trigger trigger_;
+
   Device::Referee::Data raw_ref_;
 
   Component::UI::String string_;
@@ -8,7 +8,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <database.hpp>
+#include <latest.hpp>
 #include <list.hpp>
+#include <log.hpp>
 #include <memory.hpp>
 #include <queue.hpp>
 #include <semaphore.hpp>
@@ -17,6 +19,7 @@
 #include <term.hpp>
 #include <thread.hpp>
 #include <timer.hpp>
+#include <trigger.hpp>
 
 #include "comp_type.hpp"
 #include "comp_utils.hpp"
@@ -1,5 +1,574 @@
 #include "mod_performance.hpp"
 
+#include "bsp_def.h"
+#include "comp_actuator.hpp"
+#include "comp_crc16.hpp"
+#include "comp_crc8.hpp"
+#include "comp_filter.hpp"
+#include "comp_mixer.hpp"
+#include "comp_pid.hpp"
+#include "comp_pipeline.hpp"
+
+#ifdef XROBOT_BOARD
+#define PERF_BOARD_NAME XB_DEF2STR(XROBOT_BOARD)
+#else
+#define PERF_BOARD_NAME "unknown"
+#endif
+
 using namespace Module;
 
-uint8_t Performance::static_mem_[64];
+typedef struct {
+  uint8_t data[PERF_TOPIC_DATA_SIZE];
+} TopicData;
+
+typedef struct {
+  System::Semaphore ping{0};
+  System::Semaphore pong{0};
+  System::Thread thread;
+} PingPong;
+
+typedef struct {
+  System::Semaphore sem{0};
+  System::Timer::TimerHandle handle;
+  uint64_t time;
+  uint64_t begin;
+} TimerJitter;
+
+typedef Component::Pipeline<PERF_BENCH_PIPELINE_NUM> BenchPipeline;
+
+typedef struct {
+  BenchPipeline::Param param;
+  BenchPipeline* pipeline;
+  std::array<Component::SpeedActuator*, PERF_BENCH_PIPELINE_NUM> actuator;
+  float sp[PERF_BENCH_PIPELINE_NUM];
+  float fb[PERF_BENCH_PIPELINE_NUM];
+  float out[PERF_BENCH_PIPELINE_NUM];
+} PipelineBench;
+
+static uint8_t static_mem[64];
+
+/* 话题和订阅者无法删除，只在第一次测试时创建 */
+static Message::Topic<TopicData>* bench_topic() {
+  static Message::Topic<TopicData>* topic = NULL;
+  if (topic == NULL) {
+    topic = new Message::Topic<TopicData>("perf_topic", true);
+  }
+  return topic;
+}
+
+/* 每个电机的参数略有不同，与实际的多电机配置相近 */
+static PipelineBench* bench_pipeline() {
+  static PipelineBench* bench = NULL;
+  if (bench == NULL) {
+    bench = new PipelineBench;
+    for (uint32_t i = 0; i < PERF_BENCH_PIPELINE_NUM; i++) {
+      float scale = 1.0f + static_cast<float>(i) * 0.1f;
+      bench->param[i] = {
+          .speed =
+              {
+                  .k = 0.2f * scale,
+                  .p = 1.0f,
+                  .i = i % 4 == 3 ? 0.0f : 0.5f,
+                  .d = 0.01f,
+                  .i_limit = 0.5f,
+                  .out_limit = 1.0f,
+                  .d_cutoff_freq = -1.0f,
+                  .cycle = false,
+              },
+          .in_cutoff_freq = 50.0f * scale,
+          .out_cutoff_freq = -1.0f,
+      };
+      bench->actuator[i] =
+          new Component::SpeedActuator(bench->param[i], 500.0f);
+    }
+    bench->pipeline = new BenchPipeline(bench->param, 500.0f);
+  }
+  return bench;
+}
+
+/* 伪随机的设定值和反馈，周期性插入非有限值 */
+static void pipeline_input(PipelineBench* bench, uint32_t step) {
+  static uint32_t seed = 1;
+  for (uint32_t i = 0; i < PERF_BENCH_PIPELINE_NUM; i++) {
+    seed = seed * 1103515245u + 12345u;
+    bench->sp[i] = static_cast<float>((seed >> 8) & 0xfff) * 0.01f - 20.0f;
+    bench->fb[i] = static_cast<float>((seed >> 20) & 0xfff) * 0.01f - 20.0f;
+  }
+  if (step % 97 == 0) {
+    bench->sp[step % PERF_BENCH_PIPELINE_NUM] = NAN;
+  }
+  if (step % 131 == 0) {
+    bench->fb[(step + 1) % PERF_BENCH_PIPELINE_NUM] = INFINITY;
+  }
+}
+
+template <typename CrcType>
+static float crc_sample(CrcType (*fun)(const uint8_t*, size_t, CrcType)) {
+  static uint8_t buff[PERF_BENCH_CRC_SIZE];
+  for (uint32_t i = 0; i < PERF_BENCH_CRC_SIZE; i++) {
+    buff[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+
+  volatile CrcType crc = 0;
+
+  auto start = System::Benchmark::Now();
+  for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+    crc = fun(buff, PERF_BENCH_CRC_SIZE, crc);
+  }
+  return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+}
+
+/* 分别测试System::Memory和平台原有的堆，对比申请释放的耗时 */
+template <void* (*Malloc)(size_t), void (*Free)(void*)>
+class HeapTest {
+ public:
+  /* 先连续申请再全部释放，大小在16到256字节之间变化 */
+  static float Sample(void* arg) {
+    XB_UNUSED(arg);
+    void* block[PERF_BENCH_BATCH];
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      block[i] = Malloc(16 << (i % 5));
+    }
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      Free(block[i]);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  }
+
+  /* 随机位置随机大小的申请和释放，一半左右的块保持占用，
+   * 模拟长时间运行后的碎片，p99反映最坏情况 */
+  static float Random(void* arg) {
+    XB_UNUSED(arg);
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      seed_ = seed_ * 1103515245 + 12345;
+      uint32_t index = (seed_ >> 16) % PERF_BENCH_HEAP_SLOT;
+      if (slot_[index] != NULL) {
+        Free(slot_[index]);
+        slot_[index] = NULL;
+      } else {
+        slot_[index] = Malloc(8 + (seed_ >> 8) % 249);
+      }
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  }
+
+  static void Clear(void* arg) {
+    XB_UNUSED(arg);
+    for (auto& block : slot_) {
+      Free(block);
+      block = NULL;
+    }
+  }
+
+ private:
+  static inline void* slot_[PERF_BENCH_HEAP_SLOT] = {};
+  static inline uint32_t seed_ = 1;
+};
+
+Performance::Performance() : test_cmd_(this, Test, "perf") {
+  /* 队列：同一线程内发送并接收一个元素 */
+  auto queue_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static System::Queue<uint32_t> queue(PERF_QUEUE_LENGTH);
+    uint32_t value = 0;
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      queue.Send(i);
+      queue.Receive(value);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  /* 信号量：不发生阻塞的一次Post和Wait */
+  auto sem_sample = [](void* arg) {
+    auto sem = static_cast<System::Semaphore*>(arg);
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      sem->Post();
+      sem->Wait(UINT32_MAX);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  /* 信号量：两个线程之间往返一次，包含两次线程切换 */
+  auto pingpong_setup = [](void* arg) {
+    auto test = static_cast<PingPong*>(arg);
+
+    auto thread_fn = [](PingPong* test) {
+      while (1) {
+        test->ping.Wait();
+        test->pong.Post();
+      }
+    };
+
+    test->thread.Create(thread_fn, test, "perf_pingpong", 512,
+                        System::Thread::MEDIUM);
+
+    test->ping.Post();
+    if (!test->pong.Wait(PERF_BENCH_TIMEOUT)) {
+      test->thread.Delete();
+      return false;
+    }
+    return true;
+  };
+
+  auto pingpong_sample = [](void* arg) {
+    auto test = static_cast<PingPong*>(arg);
+
+    auto start = System::Benchmark::Now();
+    test->ping.Post();
+    if (!test->pong.Wait(PERF_BENCH_TIMEOUT)) {
+      return -1.0f;
+    }
+    return System::Benchmark::Elapsed(start);
+  };
+
+  auto pingpong_teardown = [](void* arg) {
+    static_cast<PingPong*>(arg)->thread.Delete();
+  };
+
+  /* 话题：发布一次后所有订阅者各读取一次 */
+  auto topic_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static std::array<Message::Subscriber<TopicData>*, PERF_TOPIC_SUBER_NUM>
+        suber = {};
+    static TopicData data, buff;
+    auto topic = bench_topic();
+    if (suber[0] == NULL) {
+      for (auto& sub : suber) {
+        sub = new Message::Subscriber<TopicData>("perf_topic");
+      }
+    }
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      data.data[i]++;
+      topic->Publish(data);
+      for (auto sub : suber) {
+        sub->DumpData(buff);
+      }
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  /* 同上，订阅者换成System::Latest */
+  auto latest_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static std::array<System::Latest<TopicData>*, PERF_TOPIC_SUBER_NUM> suber =
+        {};
+    static TopicData data, buff;
+    auto topic = bench_topic();
+    if (suber[0] == NULL) {
+      for (auto& sub : suber) {
+        sub = new System::Latest<TopicData>("perf_topic");
+      }
+    }
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      data.data[i]++;
+      topic->Publish(data);
+      for (auto sub : suber) {
+        sub->DumpData(buff);
+      }
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  /* 定时器：回调实际执行时刻与周期网格的偏差，使用墙上时间，
+   * 仿真时间不前进时没有意义，跳过 */
+  auto timer_setup = [](void* arg) {
+    auto test = static_cast<TimerJitter*>(arg);
+    if (!System::Benchmark::Calibrated()) {
+      return false;
+    }
+
+    auto timer_fn = [](TimerJitter* test) {
+      test->time = bsp_time_get_us();
+      test->sem.Post();
+    };
+
+    test->handle =
+        System::Timer::Create(timer_fn, test, PERF_BENCH_TIMER_CYCLE);
+
+    if (!test->sem.Wait(PERF_BENCH_TIMEOUT)) {
+      System::Timer::Delete(test->handle);
+      return false;
+    }
+    test->begin = test->time;
+    return true;
+  };
+
+  auto timer_sample = [](void* arg) {
+    auto test = static_cast<TimerJitter*>(arg);
+    if (!test->sem.Wait(PERF_BENCH_TIMEOUT)) {
+      return -1.0f;
+    }
+
+    /* 错过的周期不累积误差，按距离最近的网格点计算 */
+    uint32_t period = PERF_BENCH_TIMER_CYCLE * 1000;
+    uint32_t offset =
+        static_cast<uint32_t>((test->time - test->begin) % period);
+    uint32_t jitter = offset < period - offset ? offset : period - offset;
+    return static_cast<float>(jitter) * 1000.0f;
+  };
+
+  auto timer_teardown = [](void* arg) {
+    auto test = static_cast<TimerJitter*>(arg);
+    System::Timer::Delete(test->handle);
+    /* 清掉删除前已经触发的计数 */
+    while (test->sem.Wait(0)) {
+    }
+  };
+
+  auto crc8_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    return crc_sample(Component::CRC8::Calculate);
+  };
+
+  auto crc8_bytewise_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    return crc_sample(Component::CRC8::CalculateBytewise);
+  };
+
+  auto crc16_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    return crc_sample(Component::CRC16::Calculate);
+  };
+
+  auto crc16_bytewise_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    return crc_sample(Component::CRC16::CalculateBytewise);
+  };
+
+  /* 控制器：与500Hz控制线程中的调用方式一致 */
+  auto pid_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static Component::PID::Param param = {
+        .k = 1.0f,
+        .p = 2.0f,
+        .i = 0.5f,
+        .d = 0.01f,
+        .i_limit = 1.0f,
+        .out_limit = 10.0f,
+        .d_cutoff_freq = 100.0f,
+        .cycle = false,
+    };
+    static Component::PID pid(param, 500.0f);
+    volatile float out = 0.0f;
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      out = pid.Calculate(static_cast<float>(i) * 0.1f, out, 0.002f);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  auto lpf_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static Component::LowPassFilter2p filter(500.0f, 50.0f);
+    volatile float out = 0.0f;
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      out = filter.Apply(static_cast<float>(i & 1));
+    }
+    XB_UNUSED(out);
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  auto mixer_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    static Component::Mixer mixer(Component::Mixer::MECANUM);
+    Component::Type::MoveVector move_vec = {0.5f, -0.3f, 0.2f};
+    float out[4];
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      move_vec.wz = static_cast<float>(i) * 0.01f;
+      mixer.Apply(move_vec, out);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  /* 流水线与逐个调用SpeedActuator结果逐位一致时才测试 */
+  auto pipeline_setup = [](void* arg) {
+    XB_UNUSED(arg);
+    auto bench = bench_pipeline();
+    uint32_t mismatch = 0;
+    float diff = 0.0f;
+
+    bench->pipeline->Reset();
+    for (auto actuator : bench->actuator) {
+      actuator->Reset();
+    }
+
+    for (uint32_t step = 0; step < PERF_BENCH_PIPELINE_CHECK; step++) {
+      pipeline_input(bench, step);
+      float dt = step % 251 == 0 ? NAN : 0.002f;
+      bench->pipeline->Calculate(bench->sp, bench->fb, dt, bench->out);
+      for (uint32_t i = 0; i < PERF_BENCH_PIPELINE_NUM; i++) {
+        float ref =
+            bench->actuator[i]->Calculate(bench->sp[i], bench->fb[i], dt);
+        if (memcmp(&ref, &bench->out[i], sizeof(float)) != 0) {
+          mismatch++;
+          diff = MAX(diff, fabsf(ref - bench->out[i]));
+        }
+      }
+    }
+
+    if (mismatch != 0) {
+      printf("ERR:pipeline(%s) differs in %u outputs, max %f.\r\n",
+             SIMD_NAME, static_cast<unsigned int>(mismatch), diff);
+      return false;
+    }
+    return true;
+  };
+
+  /* 单个电机的耗时，与pipeline_ref比较 */
+  auto pipeline_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    auto bench = bench_pipeline();
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      bench->pipeline->Calculate(bench->sp, bench->fb, 0.002f, bench->out);
+    }
+    return System::Benchmark::Elapsed(
+        start, PERF_BENCH_BATCH * PERF_BENCH_PIPELINE_NUM);
+  };
+
+  auto pipeline_ref_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    auto bench = bench_pipeline();
+
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      for (uint32_t j = 0; j < PERF_BENCH_PIPELINE_NUM; j++) {
+        bench->out[j] =
+            bench->actuator[j]->Calculate(bench->sp[j], bench->fb[j], 0.002f);
+      }
+    }
+    return System::Benchmark::Elapsed(
+        start, PERF_BENCH_BATCH * PERF_BENCH_PIPELINE_NUM);
+  };
+
+  auto memset_heap_sample = [](void* arg) {
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      memset(arg, static_cast<int>(i), 1024);
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  auto memset_static_sample = [](void* arg) {
+    XB_UNUSED(arg);
+    auto start = System::Benchmark::Now();
+    for (uint32_t i = 0; i < PERF_BENCH_BATCH; i++) {
+      memset(static_mem, static_cast<int>(i), sizeof(static_mem));
+    }
+    return System::Benchmark::Elapsed(start, PERF_BENCH_BATCH);
+  };
+
+  new System::Benchmark("queue", queue_sample);
+  new System::Benchmark("sem", sem_sample, new System::Semaphore(0));
+  new System::Benchmark("sem_pingpong", pingpong_sample, new PingPong,
+                        pingpong_setup, pingpong_teardown);
+  new System::Benchmark("topic", topic_sample);
+  new System::Benchmark("latest", latest_sample);
+  new System::Benchmark("timer_jitter", timer_sample, new TimerJitter,
+                        timer_setup, timer_teardown);
+  new System::Benchmark("crc8", crc8_sample);
+  new System::Benchmark("crc8_bytewise", crc8_bytewise_sample);
+  new System::Benchmark("crc16", crc16_sample);
+  new System::Benchmark("crc16_bytewise", crc16_bytewise_sample);
+  new System::Benchmark("pid", pid_sample);
+  new System::Benchmark("lpf", lpf_sample);
+  new System::Benchmark("mixer", mixer_sample);
+  new System::Benchmark("pipeline", pipeline_sample, NULL, pipeline_setup);
+  new System::Benchmark("pipeline_ref", pipeline_ref_sample, NULL,
+                        pipeline_setup);
+  new System::Benchmark("heap", HeapTest<System::Memory::Malloc,
+                                         System::Memory::Free>::Sample);
+  new System::Benchmark("heap_backend",
+                        HeapTest<System::Pool::BackendMalloc,
+                                 System::Pool::BackendFree>::Sample);
+  new System::Benchmark(
+      "heap_random",
+      HeapTest<System::Memory::Malloc, System::Memory::Free>::Random, NULL,
+      NULL, HeapTest<System::Memory::Malloc, System::Memory::Free>::Clear);
+  new System::Benchmark("heap_random_backend",
+                        HeapTest<System::Pool::BackendMalloc,
+                                 System::Pool::BackendFree>::Random,
+                        NULL, NULL,
+                        HeapTest<System::Pool::BackendMalloc,
+                                 System::Pool::BackendFree>::Clear);
+  new System::Benchmark("memset_1k", memset_heap_sample,
+                        System::Memory::Malloc(1024));
+  new System::Benchmark("memset_64", memset_static_sample);
+}
+
+void Performance::BenchPrint(System::Benchmark* bench, bool json) {
+  System::Benchmark::Result result;
+  bool ok = bench->Run(result);
+
+  if (json) {
+    if (ok) {
+      printf(
+          "{\"board\":\"%s\",\"bench\":\"%s\",\"unit\":\"%s\",\"min\":%.1f,"
+          "\"median\":%.1f,\"p99\":%.1f,\"max\":%.1f,\"num\":%u}\r\n",
+          PERF_BOARD_NAME, bench->Name(), System::Benchmark::Unit(),
+          result.min, result.median, result.p99, result.max,
+          static_cast<unsigned int>(result.num));
+    } else {
+      printf("{\"board\":\"%s\",\"bench\":\"%s\",\"skip\":true}\r\n",
+             PERF_BOARD_NAME, bench->Name());
+    }
+  } else if (ok) {
+    printf("\t%-16s%12.1f%12.1f%12.1f%12.1f\r\n", bench->Name(), result.min,
+           result.median, result.p99, result.max);
+  } else {
+    printf("\t%-16sskipped\r\n", bench->Name());
+  }
+}
+
+void Performance::BenchAll(const char* name, bool json) {
+  if (name != NULL && strcmp(name, "all") == 0) {
+    name = NULL;
+  }
+
+  System::Benchmark::Calibrate();
+
+  if (!json) {
+    printf("*** Benchmark Start ***\r\n");
+    printf("\t%s, %s per operation, %d warmup, %d samples\r\n",
+           PERF_BOARD_NAME, System::Benchmark::Unit(), BENCHMARK_WARMUP_NUM,
+           BENCHMARK_SAMPLE_NUM);
+    printf("\t%-16s%12s%12s%12s%12s\r\n", "name", "min", "median", "p99",
+           "max");
+  }
+
+  bool found = false;
+
+  for (auto bench = System::Benchmark::Head(); bench != NULL;
+       bench = bench->Next()) {
+    if (name == NULL || strcmp(name, bench->Name()) == 0) {
+      BenchPrint(bench, json);
+      found = true;
+    }
+  }
+
+  if (!found) {
+    printf("ERR:No benchmark named %s.\r\n", name);
+  }
+
+  if (!json) {
+    printf("*** Benchmark End ***\r\n");
+  }
+}
@@ -1,158 +1,362 @@
+#include <benchmark.hpp>
+#include <mutex.hpp>
+
 #include "bsp_time.h"
 #include "module.hpp"
 
+#define PERF_QUEUE_LENGTH (64)
+#define PERF_QUEUE_ITEM_NUM (20000)
+#define PERF_QUEUE_MAX_PRODUCER (8)
+#define PERF_QUEUE_TIMEOUT (20000)
+/* 默认与底盘/云台控制周期一致 */
+#define PERF_JITTER_CYCLE (2)
+#define PERF_JITTER_COUNT (5000)
+#define PERF_CYCLIC_MAX_THREAD (8)
+/* 基准测试每次采样重复的次数，用于放大单次很短的操作 */
+#define PERF_BENCH_BATCH (32)
+/* 跨线程和定时器测试的等待时间，单位ms */
+#define PERF_BENCH_TIMEOUT (100)
+#define PERF_BENCH_TIMER_CYCLE (2)
+/* 随机申请释放测试同时占用的块数上限 */
+#define PERF_BENCH_HEAP_SLOT (64)
+/* 与一帧裁判系统数据的长度接近 */
+#define PERF_BENCH_CRC_SIZE (64)
+/* 与舵轮底盘的电机数一致，流水线每4路一组 */
+#define PERF_BENCH_PIPELINE_NUM (8)
+/* 流水线与SpeedActuator逐位比较的步数 */
+#define PERF_BENCH_PIPELINE_CHECK (1000)
+/* 与控制线程读取裁判系统数据的规模接近 */
+#define PERF_TOPIC_SUBER_NUM (10)
+#define PERF_TOPIC_DATA_SIZE (256)
+
 namespace Module {
 class Performance {
  public:
-  System::Thread thread_test;
-
-  System::Term::Command<Performance*> test_cmd_;
-
-  System::Semaphore sem_1_, sem_2_;
-
-  static uint8_t static_mem_[64];
+  /* 互斥锁保护的fifo，作为System::Queue的对照组 */
+  template <typename Data>
+  class MutexQueue {
+   public:
+    MutexQueue(uint16_t length)
+        : buff_(System::Memory::Malloc(length * sizeof(Data))) {
+      om_fifo_create(&fifo_, buff_, length, sizeof(Data));
+    }
 
-  static int Test(Performance* perf, int argc, char** argv) {
-    XB_UNUSED(argc);
-    XB_UNUSED(argv);
+    ~MutexQueue() { System::Memory::Free(buff_); }
 
-    printf("XRobot performance start running.\r\n");
+    bool Send(const Data& data) {
+      mutex_.Lock();
+      bool ans = om_fifo_write(&fifo_, &data) == OM_OK;
+      mutex_.Unlock();
+      return ans;
+    }
 
-    auto thread_test_fn = [](Performance* perf) {
-      /* Semaphore */
-      perf->sem_1_.Post();
+    bool Receive(Data& data) {
+      mutex_.Lock();
+      bool ans = om_fifo_read(&fifo_, &data) == OM_OK;
+      mutex_.Unlock();
+      return ans;
+    }
 
-      /* post and wait */
-      perf->sem_2_.Wait();
-      for (uint32_t i = 0; i < 500000; i++) {
-        perf->sem_1_.Post();
-        if (!perf->sem_2_.Wait(1000)) {
-          OMLOG_ERROR("123 %d", i);
+   private:
+    void* buff_;
+    om_fifo_t fifo_;
+    System::Mutex mutex_;
+  };
+
+  template <typename QueueType>
+  class QueueTest {
+   public:
+    QueueTest(uint32_t producer_num)
+        : queue_(PERF_QUEUE_LENGTH),
+          ready_(0),
+          start_(0),
+          done_(0),
+          producer_num_(producer_num) {}
+
+    QueueType queue_;
+    System::Semaphore ready_, start_, done_;
+    std::array<System::Thread, PERF_QUEUE_MAX_PRODUCER> producer_;
+    System::Thread consumer_;
+    uint32_t producer_num_;
+    uint64_t time_ = 0;
+  };
+
+  /* 多个生产者与一个消费者同时读写队列，返回每个元素的平均耗时(us) */
+  template <typename QueueType>
+  static float QueueTestRun(uint32_t producer_num) {
+    auto test = new QueueTest<QueueType>(producer_num);
+
+    auto producer_fn = [](QueueTest<QueueType>* test) {
+      test->ready_.Post();
+      test->start_.Wait();
+
+      for (uint32_t i = 0; i < PERF_QUEUE_ITEM_NUM; i++) {
+        while (!test->queue_.Send(i)) {
+          System::Thread::Yield();
         }
       }
-      System::Thread::Sleep(100);
 
-      /* post */
-      for (int i = 0; i < 1000000; i++) {
-        perf->sem_1_.Post();
+      System::Thread::Sleep(UINT32_MAX);
+    };
+
+    auto consumer_fn = [](QueueTest<QueueType>* test) {
+      for (uint32_t i = 0; i < test->producer_num_; i++) {
+        test->ready_.Wait();
       }
-      perf->sem_2_.Post();
 
-      System::Thread::Sleep(100);
-      perf->sem_1_.Post();
+      uint32_t value = 0;
       uint64_t time = bsp_time_get();
-      for (int i = 0; i < 1000000; i++) {
-        perf->sem_1_.Post();
-      }
-      time = bsp_time_get() - time;
 
-      printf("\tPost millon times\r\n");
+      for (uint32_t i = 0; i < test->producer_num_; i++) {
+        test->start_.Post();
+      }
 
-      printf("\t\t%f microseconds per session\r\n",
-             static_cast<float>(time) / 1000.0f / 1000000.0f);
+      for (uint32_t i = 0; i < test->producer_num_ * PERF_QUEUE_ITEM_NUM;
+           i++) {
+        while (!test->queue_.Receive(value)) {
+          System::Thread::Yield();
+        }
+      }
 
-      perf->sem_2_.Post();
+      test->time_ = bsp_time_get() - time;
+      test->done_.Post();
 
       System::Thread::Sleep(UINT32_MAX);
     };
 
-    perf->thread_test.Create(thread_test_fn, perf, "perf_thread", 1024,
-                             System::Thread::MEDIUM);
+    for (uint32_t i = 0; i < producer_num; i++) {
+      test->producer_[i].Create(producer_fn, test, "perf_producer", 512,
+                                System::Thread::MEDIUM);
+    }
 
-    bool thread_support = perf->sem_1_.Wait(200);
+    test->consumer_.Create(consumer_fn, test, "perf_consumer", 512,
+                           System::Thread::MEDIUM);
 
-    if (!thread_support) {
-      printf("ERR:This device does not support multithreading.\r\n");
-    } else {
-      printf("*** Semaphore Test Start ***\r\n");
-      /* post and wait */
-      System::Thread::Sleep(200);
-      perf->sem_2_.Post();
-      auto time = bsp_time_get();
-
-      for (uint32_t i = 0; i < 500000; i++) {
-        perf->sem_1_.Wait(UINT32_MAX);
-        perf->sem_2_.Post();
-      }
+    float ans = -1.0f;
 
-      System::Thread::Sleep(200);
+    if (test->done_.Wait(PERF_QUEUE_TIMEOUT)) {
+      ans = static_cast<float>(test->time_) /
+            static_cast<float>(producer_num * PERF_QUEUE_ITEM_NUM);
+    }
 
-      time = bsp_time_get() - time;
+    for (uint32_t i = 0; i < producer_num; i++) {
+      test->producer_[i].Delete();
+    }
+    test->consumer_.Delete();
 
-      printf("\tWait and post millon times\r\n");
+    delete test;
 
-      printf("\t\t%f microseconds per session\r\n",
-             static_cast<float>(time) / 1000.0f / 1000000.0f);
+    return ans;
+  }
 
-      /* post */
-      perf->sem_2_.Wait();
-      time = bsp_time_get();
-      for (int i = 0; i < 1000000; i++) {
-        if (!perf->sem_1_.Wait(1000)) {
-          OMLOG_ERROR("%d", i);
-        }
+  static void QueueTestAll() {
+    printf("*** Queue Test Start ***\r\n");
+    printf("\t%d items per producer, microseconds per item\r\n",
+           PERF_QUEUE_ITEM_NUM);
+    printf("\tproducer\tSystem::Queue\tmutex queue\r\n");
+
+    for (uint32_t i = 1; i <= PERF_QUEUE_MAX_PRODUCER; i++) {
+      float lock_free = QueueTestRun<System::Queue<uint32_t>>(i);
+      float mutex = QueueTestRun<MutexQueue<uint32_t>>(i);
+
+      if (lock_free < 0.0f || mutex < 0.0f) {
+        printf("ERR:This device does not support multithreading.\r\n");
+        break;
       }
-      time = bsp_time_get() - time;
 
-      printf("\tWait millon times\r\n");
+      printf("\t%d\t\t%f\t%f\r\n", i, lock_free, mutex);
+    }
 
-      printf("\t\t%f microseconds per session\r\n",
-             static_cast<float>(time) / 1000.0f / 1000000.0f);
+    printf("*** Queue Test End ***\r\n");
+  }
 
-      perf->sem_2_.Wait(UINT32_MAX);
+  /* 统计SleepUntil实际唤醒时刻与理论时刻的偏差分布 */
+  static void JitterTest(uint32_t cycle, uint32_t count) {
+    static const uint32_t BUCKET[] = {5, 10, 20, 50, 100, 200, 500, 1000};
+    static const uint32_t BUCKET_NUM = sizeof(BUCKET) / sizeof(BUCKET[0]);
 
-      printf("*** Semaphore Test End ***\r\n\n");
-    }
+    uint32_t hist[BUCKET_NUM + 1] = {};
+    uint64_t sum = 0;
+    uint32_t max = 0;
 
-    perf->thread_test.Delete();
+    printf("*** Jitter Test Start ***\r\n");
+    printf("\tcycle %dms, %d times\r\n", cycle, count);
 
-    printf("*** Memory Test Start ***\r\n");
+    auto thread = System::Thread::Current();
+    uint32_t last_wakeup_time = bsp_time_get_ms();
+    uint64_t expected = static_cast<uint64_t>(last_wakeup_time) * 1000;
 
-    void* mem = malloc(1024);
+    for (uint32_t i = 0; i < count; i++) {
+      thread.SleepUntil(cycle, last_wakeup_time);
+      uint64_t now = bsp_time_get_us();
+      expected += cycle * 1000;
 
-    auto time = bsp_time_get();
+      uint32_t jitter = static_cast<uint32_t>(now > expected ? now - expected
+                                                             : expected - now);
 
-    for (int i = 0; i < 10000; i++) {
-      memset(mem, 0, 1024);
+      uint32_t index = 0;
+      while (index < BUCKET_NUM && jitter >= BUCKET[index]) {
+        index++;
+      }
+      hist[index]++;
+
+      sum += jitter;
+      if (jitter > max) {
+        max = jitter;
+      }
     }
 
-    time = bsp_time_get() - time;
+    for (uint32_t i = 0; i <= BUCKET_NUM; i++) {
+      if (i < BUCKET_NUM) {
+        printf("\t< %4dus", BUCKET[i]);
+      } else {
+        printf("\t>=%4dus", BUCKET[BUCKET_NUM - 1]);
+      }
+      printf("\t%d\t%f%%\r\n", hist[i],
+             static_cast<float>(hist[i]) * 100.0f / static_cast<float>(count));
+    }
 
-    printf("\tOverwrite 1k length memory in heap 10000 times\r\n");
-    printf("\t\t%f Mb/s\r\n",
-           10000.0 / static_cast<float>(time) / 1024.0 * 1000000);
+    printf("\tavg %fus, max %dus\r\n",
+           static_cast<float>(sum) / static_cast<float>(count), max);
 
-    time = bsp_time_get();
+    printf("*** Jitter Test End ***\r\n");
+  }
 
-    for (int i = 0; i < 10000 * 16; i++) {
-      memset(mem, 0, 64);
-    }
+  /* 参考cyclictest，多个实时线程同时以不同周期唤醒，统计最坏延迟 */
+  class CyclicTest {
+   public:
+    CyclicTest() : done_(0) {}
+
+    typedef struct {
+      CyclicTest* test;
+      uint32_t cycle;
+      uint32_t min;
+      uint32_t max;
+      uint64_t sum;
+    } Result;
+
+    uint32_t count_;
+    Result result_[PERF_CYCLIC_MAX_THREAD];
+    System::Thread thread_[PERF_CYCLIC_MAX_THREAD];
+    System::Semaphore done_;
+  };
+
+  static void CyclicTestRun(uint32_t thread_num, uint32_t count) {
+    auto test = new CyclicTest;
+    test->count_ = count;
+
+    auto thread_fn = [](CyclicTest::Result* result) {
+      auto thread = System::Thread::Current();
+      uint32_t last_wakeup_time = bsp_time_get_ms();
+      uint64_t expected = static_cast<uint64_t>(last_wakeup_time) * 1000;
+
+      result->min = UINT32_MAX;
+
+      for (uint32_t i = 0; i < result->test->count_; i++) {
+        thread.SleepUntil(result->cycle, last_wakeup_time);
+        uint64_t now = bsp_time_get_us();
+        expected += result->cycle * 1000;
+
+        uint32_t latency = now > expected
+                               ? static_cast<uint32_t>(now - expected)
+                               : 0;
+        result->sum += latency;
+        if (latency < result->min) {
+          result->min = latency;
+        }
+        if (latency > result->max) {
+          result->max = latency;
+        }
+      }
 
-    time = bsp_time_get() - time;
+      result->test->done_.Post();
 
-    printf("\tOverwrite 64byte length memory in heap 160000 times\r\n");
-    printf("\t\t%f Mb/s\r\n",
-           10000.0 / static_cast<float>(time) / 1024.0 * 1000000);
+      System::Thread::Sleep(UINT32_MAX);
+    };
+
+    printf("*** Cyclic Test Start ***\r\n");
+    printf("\t%d threads, %d loops\r\n", thread_num, count);
+
+    for (uint32_t i = 0; i < thread_num; i++) {
+      test->result_[i] = {test, 1 + i, 0, 0, 0};
+      test->thread_[i].Create(thread_fn, &test->result_[i], "perf_cyclic", 512,
+                              System::Thread::REALTIME);
+    }
 
-    free(mem);
+    bool done = true;
+    for (uint32_t i = 0; i < thread_num; i++) {
+      done = done && test->done_.Wait((thread_num + 1) * count + 1000);
+    }
 
-    time = bsp_time_get();
+    if (done) {
+      printf("\tthread\tcycle(ms)\tmin(us)\tavg(us)\t\tmax(us)\r\n");
+      for (uint32_t i = 0; i < thread_num; i++) {
+        auto& result = test->result_[i];
+        printf("\t%d\t%d\t\t%d\t%f\t%d\r\n", i, result.cycle, result.min,
+               static_cast<float>(result.sum) / static_cast<float>(count),
+               result.max);
+      }
+    } else {
+      printf("ERR:This device does not support multithreading.\r\n");
+    }
 
-    for (int i = 0; i < 10000 * 16; i++) {
-      memset(static_mem_, 0, 64);
+    for (uint32_t i = 0; i < thread_num; i++) {
+      test->thread_[i].Delete();
     }
 
-    time = bsp_time_get() - time;
+    delete test;
+
+    printf("*** Cyclic Test End ***\r\n");
+  }
+
+  /* 运行名称匹配的基准测试，name为NULL或all时运行全部 */
+  static void BenchAll(const char* name, bool json);
 
-    printf("\tOverwrite 64byte length memory in stack 160000 times\r\n");
-    printf("\t\t%f Mb/s\r\n",
-           10000.0 / static_cast<float>(time) / 1024.0 * 1000000);
+  static void BenchPrint(System::Benchmark* bench, bool json);
 
-    printf("*** Memory Test End ***\r\n");
+  System::Term::Command<Performance*> test_cmd_;
+
+  static int Test(Performance* perf, int argc, char** argv) {
+    XB_UNUSED(perf);
+
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "json") == 0)) {
+      BenchAll(NULL, argc == 2);
+    } else if (argc == 2 && strcmp(argv[1], "list") == 0) {
+      for (auto bench = System::Benchmark::Head(); bench != NULL;
+           bench = bench->Next()) {
+        printf("%s\r\n", bench->Name());
+      }
+    } else if (argc >= 3 && argc <= 4 && strcmp(argv[1], "bench") == 0 &&
+               (argc == 3 || strcmp(argv[3], "json") == 0)) {
+      BenchAll(argv[2], argc == 4);
+    } else if (argc == 2 && strcmp(argv[1], "queue") == 0) {
+      QueueTestAll();
+    } else if (argc >= 2 && argc <= 4 && strcmp(argv[1], "jitter") == 0) {
+      uint32_t cycle = argc >= 3 ? strtoul(argv[2], NULL, 10) : 0;
+      uint32_t count = argc >= 4 ? strtoul(argv[3], NULL, 10) : 0;
+      JitterTest(cycle ? cycle : PERF_JITTER_CYCLE,
+                 count ? count : PERF_JITTER_COUNT);
+    } else if (argc >= 2 && argc <= 4 && strcmp(argv[1], "cyclic") == 0) {
+      uint32_t thread_num = argc >= 3 ? strtoul(argv[2], NULL, 10) : 0;
+      uint32_t count = argc >= 4 ? strtoul(argv[3], NULL, 10) : 0;
+      if (thread_num == 0 || thread_num > PERF_CYCLIC_MAX_THREAD) {
+        thread_num = PERF_CYCLIC_MAX_THREAD / 2;
+      }
+      CyclicTestRun(thread_num, count ? count : PERF_JITTER_COUNT);
+    } else {
+      printf("perf [json]                run all benchmarks.\r\n");
+      printf("perf list                  list registered benchmarks.\r\n");
+      printf("perf bench <name> [json]   run one benchmark, or all.\r\n");
+      printf("perf queue                 run queue contention test.\r\n");
+      printf(
+          "perf jitter [cycle] [num]  run SleepUntil wakeup jitter test.\r\n");
+      printf(
+          "perf cyclic [thread] [num] run multi-thread wakeup latency test.\r\n");
+    }
 
     return 0;
   }
 
-  Performance() : test_cmd_(this, Test, "perf"), sem_1_(0), sem_2_(0) {}
+  Performance();
 };
 }  // namespace Module
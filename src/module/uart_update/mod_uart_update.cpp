@@ -4,12 +4,19 @@
 #include "bsp_sys.h"
 #include "bsp_uart.h"
 #include "bsp_usb.h"
+#include "comp_crc32.hpp"
 #include "om_core.h"
 
 using namespace Module;
 
 static uint8_t uart_buff[BSP_FLASH_BLOCK_SIZE * 2];
 
+/* 流式升级的接收缓冲区，按接收顺序依次写入flash */
+static struct {
+  UartUpdate::Frame frame;
+  uint8_t data[BSP_FLASH_BLOCK_SIZE];
+} stream_slot[UART_UPDATE_WINDOW];
+
 void UartUpdate::Update() {
   remote_.AddTopic(data_topic_);
   remote_.AddTopic(cmd_topic_);
@@ -67,3 +74,132 @@ void UartUpdate::Update() {
     remote_.PraseData(uart_buff, sizeof(CommandPack));
   }
 }
+
+void UartUpdate::ReadAll(void* buff, size_t len) {
+  auto data = static_cast<uint8_t*>(buff);
+  while (len > 0) {
+    size_t ans = bsp_usb_read(data, len);
+    data += ans;
+    len -= ans;
+  }
+}
+
+/* 逐字节移动直到找到帧头，丢弃中间的数据 */
+void UartUpdate::ReadFrame(Frame& frame) {
+  auto raw = reinterpret_cast<uint8_t*>(&frame);
+
+  ReadAll(raw, sizeof(frame.magic));
+  while (frame.magic != UART_UPDATE_MAGIC) {
+    memmove(raw, raw + 1, sizeof(frame.magic) - 1);
+    ReadAll(raw + sizeof(frame.magic) - 1, 1);
+  }
+
+  ReadAll(raw + sizeof(frame.magic), sizeof(Frame) - sizeof(frame.magic));
+}
+
+void UartUpdate::Reply(uint32_t type, uint32_t index, uint32_t len,
+                       uint32_t crc) {
+  Frame frame = {UART_UPDATE_MAGIC, type, index, len, crc};
+  bsp_usb_transmit(reinterpret_cast<uint8_t*>(&frame), sizeof(frame));
+}
+
+uint32_t UartUpdate::FlashCrc(uint32_t offset, uint32_t len) {
+  return Component::CRC32::Calculate(
+      reinterpret_cast<const uint8_t*>(BSP_FLASH_APP_ADDR + offset), len,
+      CRC32_INIT);
+}
+
+/* 校验后写入一整块，不足一块的部分补0xFF，回读校验通过才回复ACK */
+void UartUpdate::Program(const Frame& frame, uint8_t* data) {
+  uint32_t offset = frame.index * BSP_FLASH_BLOCK_SIZE;
+
+  if (Component::CRC32::Calculate(data, frame.len, CRC32_INIT) != frame.crc) {
+    Reply(FRAME_DATA | FRAME_NAK, frame.index, frame.len, frame.crc);
+    return;
+  }
+
+  memset(data + frame.len, 0xff, BSP_FLASH_BLOCK_SIZE - frame.len);
+  bsp_flash_wirte(reinterpret_cast<void*>(BSP_FLASH_APP_ADDR + offset),
+                  BSP_FLASH_BLOCK_SIZE, data);
+
+  uint32_t crc = FlashCrc(offset, frame.len);
+  Reply(FRAME_DATA | (crc == frame.crc ? FRAME_ACK : FRAME_NAK), frame.index,
+        frame.len, crc);
+}
+
+void UartUpdate::Stream() {
+  uint32_t head = 0, num = 0;
+  Frame frame;
+
+  bsp_uart_abort_receive(BSP_UART_MCU);
+
+  auto program = [&]() {
+    Program(stream_slot[head].frame, stream_slot[head].data);
+    head = (head + 1) % UART_UPDATE_WINDOW;
+    num--;
+  };
+
+  /* 查询和校验前先写完所有已接收的块 */
+  auto flush = [&]() {
+    while (num > 0) {
+      program();
+    }
+  };
+
+  while (1) {
+    /* 缓冲区满或者暂时没有新数据时写入最早收到的一块，
+     * 写入期间USB继续在后台接收主机发来的下一块 */
+    if (num == UART_UPDATE_WINDOW || (num > 0 && bsp_usb_avail() == 0)) {
+      program();
+      continue;
+    }
+
+    ReadFrame(frame);
+
+    switch (frame.type) {
+      case FRAME_INFO:
+        Reply(FRAME_INFO | FRAME_ACK, param_.board_id, BSP_FLASH_BLOCK_SIZE,
+              UART_UPDATE_WINDOW);
+        break;
+      case FRAME_DATA:
+        /* 长度错误时不读取数据，由帧头同步跳过 */
+        if (frame.len > BSP_FLASH_BLOCK_SIZE ||
+            frame.index >= BSP_FLASH_APP_SIZE / BSP_FLASH_BLOCK_SIZE) {
+          Reply(FRAME_DATA | FRAME_NAK, frame.index, frame.len, frame.crc);
+        } else {
+          auto& slot = stream_slot[(head + num) % UART_UPDATE_WINDOW];
+          slot.frame = frame;
+          ReadAll(slot.data, frame.len);
+          num++;
+        }
+        break;
+      case FRAME_QUERY:
+        flush();
+        if (frame.len > BSP_FLASH_BLOCK_SIZE ||
+            frame.index >= BSP_FLASH_APP_SIZE / BSP_FLASH_BLOCK_SIZE) {
+          Reply(FRAME_QUERY | FRAME_NAK, frame.index, frame.len, 0);
+        } else {
+          Reply(FRAME_QUERY | FRAME_ACK, frame.index, frame.len,
+                FlashCrc(frame.index * BSP_FLASH_BLOCK_SIZE, frame.len));
+        }
+        break;
+      case FRAME_FINISH:
+        flush();
+        if (frame.len <= BSP_FLASH_APP_SIZE &&
+            FlashCrc(0, frame.len) == frame.crc) {
+          Reply(FRAME_FINISH | FRAME_ACK, 0, frame.len, frame.crc);
+        } else {
+          Reply(FRAME_FINISH | FRAME_NAK, 0, frame.len, frame.crc);
+        }
+        break;
+      case FRAME_JUMP:
+        flush();
+        Reply(FRAME_JUMP | FRAME_ACK, 0, 0, 0);
+        bsp_sys_jump_app();
+        break;
+      default:
+        Reply(frame.type | FRAME_NAK, frame.index, frame.len, frame.crc);
+        break;
+    }
+  }
+}
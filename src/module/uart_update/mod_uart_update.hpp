@@ -3,6 +3,13 @@
 #include "bsp_usb.h"
 #include "module.hpp"
 
+/* 流式升级中同时在途的块数，也是接收缓冲区的数量，2即双缓冲 */
+#ifndef UART_UPDATE_WINDOW
+#define UART_UPDATE_WINDOW (2)
+#endif
+/* 流式升级帧头，小端序的"XRUP" */
+#define UART_UPDATE_MAGIC (0x50555258)
+
 namespace Module {
 class UartUpdate {
  public:
@@ -15,7 +22,36 @@ class UartUpdate {
     uint8_t raw[BSP_FLASH_BLOCK_SIZE];
   } Data;
 
-  typedef enum { ACK = 'x', ERROR, GET_ID, WRITE, DATA_SIZE, JUMP_APP } Command;
+  typedef enum {
+    ACK = 'x',
+    ERROR,
+    GET_ID,
+    WRITE,
+    DATA_SIZE,
+    JUMP_APP,
+    STREAM, /* 握手时发送，进入流式升级 */
+  } Command;
+
+  /* 流式升级不经过Message::Remote，每帧为帧头加上可选的数据，
+   * 主机最多有UART_UPDATE_WINDOW个未回复的DATA帧，
+   * 接收下一块的同时写入上一块，每块写入后回读校验再回复 */
+  typedef enum : uint32_t {
+    FRAME_INFO,   /* 回复中index为板子ID，len为块大小，crc为窗口大小 */
+    FRAME_DATA,   /* 第index块，len字节数据，crc为数据的CRC32 */
+    FRAME_QUERY,  /* 回复flash中第index块前len字节的CRC32，用于断点续传 */
+    FRAME_FINISH, /* 校验前len字节整个固件的CRC32 */
+    FRAME_JUMP,   /* 回复后跳转到APP */
+    FRAME_ACK = 0x100, /* 回复为请求类型加上ACK或NAK */
+    FRAME_NAK = 0x200,
+  } FrameType;
+
+  typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t index;
+    uint32_t len;
+    uint32_t crc;
+  } Frame;
 
   typedef struct {
     uint8_t command;
@@ -35,14 +71,16 @@ class UartUpdate {
         cmd_topic_("xrobot_update_cmd"),
         remote_(2 * BSP_FLASH_BLOCK_SIZE, 2),
         param_(param) {
-    bool update = false;
+    bool update = false, stream = false;
 
     printf("Uart wait for command...\r\n");
 
     uint32_t i = bsp_time_get_ms();
     while (i + param.timeout > bsp_time_get_ms()) {
-      if (bsp_usb_read_char() == ACK) {
+      char cmd = bsp_usb_read_char();
+      if (cmd == ACK || cmd == STREAM) {
         update = true;
+        stream = cmd == STREAM;
         break;
       }
     }
@@ -54,9 +92,26 @@ class UartUpdate {
 
     printf("Get command, start to update by uart.\r\n");
 
-    this->Update();
+    if (stream) {
+      this->Stream();
+    } else {
+      this->Update();
+    }
   }
 
   void Update();
+
+  void Stream();
+
+  static void ReadAll(void* buff, size_t len);
+
+  static void ReadFrame(Frame& frame);
+
+  static void Reply(uint32_t type, uint32_t index, uint32_t len,
+                    uint32_t crc);
+
+  static void Program(const Frame& frame, uint8_t* data);
+
+  static uint32_t FlashCrc(uint32_t offset, uint32_t len);
 };
 }  // namespace Module
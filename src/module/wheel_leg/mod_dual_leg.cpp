@@ -10,7 +10,10 @@ using namespace Module;
 using namespace Component::Type;
 
 WheelLeg::WheelLeg(WheelLeg::Param &param, float sample_freq)
-    : param_(param), wheel_polor_("leg_whell_polor"), ctrl_lock_(true) {
+    : param_(param),
+      wheel_polor_("leg_whell_polor"),
+      ctrl_lock_(true),
+      trigger_("wheel_leg", 5, sample_freq) {
   constexpr auto LEG_NAMES = magic_enum::enum_names<Leg>();
   constexpr auto MOTOR_NAMES = magic_enum::enum_names<LegMotor>();
   for (uint8_t i = 0; i < LEG_NUM; i++) {
@@ -65,7 +68,7 @@ WheelLeg::WheelLeg(WheelLeg::Param &param, float sample_freq)
     auto gyro_sub =
         Message::Subscriber<Component::Type::Vector3>("chassis_gyro");
 
-    uint32_t last_online_time = bsp_time_get_ms();
+    leg->trigger_.Watch<Component::Type::Eulr>("chassis_eulr");
 
     while (1) {
       eulr_sub.DumpData(leg->eulr_);
@@ -74,10 +77,11 @@ WheelLeg::WheelLeg(WheelLeg::Param &param, float sample_freq)
       leg->UpdateFeedback();
 
       leg->Control();
+      leg->trigger_.Done();
 
       leg->wheel_polor_.Publish(leg->feedback_[0].whell_polar);
 
-      leg->thread_.SleepUntil(5, last_online_time);
+      leg->trigger_.Wait();
     }
   };
 
@@ -112,6 +112,8 @@ class WheelLeg {
 
   System::Semaphore ctrl_lock_;
 
+  System::Trigger trigger_;
+
   System::Thread thread_;
 };
 }  // namespace Module
@@ -4,6 +4,15 @@
 
 using namespace System;
 
-void* operator new(std::size_t size) { return pvPortMalloc(size); }
+void* Pool::BackendMalloc(size_t size) { return pvPortMalloc(size); }
 
-void operator delete(void* ptr) noexcept { vPortFree(ptr); }
+void Pool::BackendFree(void* block) { vPortFree(block); }
+
+void* operator new(std::size_t size) { return Pool::Alloc(size); }
+
+void operator delete(void* ptr) noexcept { Pool::Free(ptr); }
+
+void operator delete(void* ptr, std::size_t size) noexcept {
+  XB_UNUSED(size);
+  Pool::Free(ptr);
+}
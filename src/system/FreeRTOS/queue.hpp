@@ -45,6 +45,17 @@ class Queue {
     }
   }
 
+  bool Receive(Data& data, uint32_t timeout) {
+    if (bsp_sys_in_isr()) {
+      return Receive(data);
+    } else {
+      /* 超时单位为ms，UINT32_MAX表示一直等待 */
+      TickType_t ticks =
+          timeout == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout);
+      return xQueueReceive(queue_, &data, ticks) == pdTRUE;
+    }
+  }
+
   bool Overwrite(const Data& data) {
     if (bsp_sys_in_isr()) {
       BaseType_t xHigherPriorityTaskWoken;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <trace.hpp>
 
 #include "FreeRTOS.h"
 #include "bsp_sys.h"
@@ -15,6 +16,8 @@ class Semaphore {
   ~Semaphore() { vSemaphoreDelete(handle_); }
 
   void Post() {
+    Trace::Record(Trace::SEM_POST, this);
+
     if (bsp_sys_in_isr()) {
       BaseType_t px_higher_priority_task_woken = 0;
       xSemaphoreGiveFromISR(this->handle_, &px_higher_priority_task_woken);
@@ -28,7 +31,10 @@ class Semaphore {
 
   bool Wait(uint32_t timeout = UINT32_MAX) {
     if (!bsp_sys_in_isr()) {
-      return xSemaphoreTake(this->handle_, timeout) == pdTRUE;
+      Trace::Record(Trace::SEM_WAIT, this);
+      bool ans = xSemaphoreTake(this->handle_, timeout) == pdTRUE;
+      Trace::Record(Trace::SEM_WAKE, this, ans);
+      return ans;
     } else {
       BaseType_t px_higher_priority_task_woken = 0;
       BaseType_t ans =
@@ -1,11 +1,13 @@
 #include <database.hpp>
 #include <functional>
+#include <log.hpp>
 #include <memory.hpp>
 #include <queue.hpp>
 #include <semaphore.hpp>
 #include <term.hpp>
 #include <thread.hpp>
 #include <timer.hpp>
+#include <trace.hpp>
 
 #include "om.hpp"
 
@@ -21,11 +23,26 @@ void Start(RobotParam... param) {
     new (database) Database();
     Timer* timer = static_cast<Timer*>(pvPortMalloc(sizeof(Timer)));
     new (timer) Timer();
+#ifdef SYSTEM_TRACE
+    Trace* trace = static_cast<Trace*>(pvPortMalloc(sizeof(Trace)));
+    new (trace) Trace();
+#endif
+#ifdef SYSTEM_LOG_DEFERRED
+    Log* log = static_cast<Log*>(pvPortMalloc(sizeof(Log)));
+    new (log) Log();
+#endif
+    Pool* pool = static_cast<Pool*>(pvPortMalloc(sizeof(Pool)));
+    new (pool) Pool();
 
     static auto xrobot_debug_handle = new RobotType(param...);
 
     XB_UNUSED(xrobot_debug_handle);
 
+    /* 之后再申请内存视为错误 */
+#ifdef SYSTEM_POOL_FREEZE
+    Pool::Freeze();
+#endif
+
     while (1) {
       System::Thread::Sleep(UINT32_MAX);
     }
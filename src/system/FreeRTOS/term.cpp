@@ -1,6 +1,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <log.hpp>
 #include <term.hpp>
 #include <thread.hpp>
 
@@ -38,6 +39,15 @@ static om_status_t print_log(om_msg_t *msg, void *arg) {
   return OM_OK;
 }
 
+/* 在log_drain线程中格式化，USB未连接时直接丢弃 */
+static void print_deferred_log(const char *text, size_t len) {
+  XB_UNUSED(len);
+
+  if (bsp_usb_connect()) {
+    ms_printf_insert("%s", text);
+  }
+}
+
 static int term_write(const char *data, size_t len) {
   bsp_usb_transmit(reinterpret_cast<const uint8_t *>(data), len);
   return static_cast<int>(len);
@@ -63,6 +73,8 @@ Term::Term() {
 
   om_config_topic(om_get_log_handle(), "d", print_log, NULL);
 
+  Log::SetOutput(print_deferred_log, NULL);
+
 #ifdef MCU_DEBUG_BUILD
 
   auto task_cmd_fn = [](ms_item_t *item, int argc, char **argv) {
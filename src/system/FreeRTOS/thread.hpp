@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <memory.hpp>
 #include <string>
+#include <trace.hpp>
 
 #include "FreeRTOS.h"
 #include "bsp_time.h"
@@ -22,12 +24,14 @@ class Thread {
     (void)static_cast<void (*)(ArgType)>(fun);
 
     TypeErasure<void, ArgType>* type = static_cast<TypeErasure<void, ArgType>*>(
-        pvPortMalloc(sizeof(TypeErasure<void, ArgType>)));
+        System::Memory::Malloc(sizeof(TypeErasure<void, ArgType>)));
 
     *type = TypeErasure<void, ArgType>(fun, arg);
 
     xTaskCreate(type->Port, name, stack_depth, type, priority,
                 &(this->handle_));
+
+    Trace::Thread(this->handle_, pcTaskGetName(this->handle_));
   }
 
   static Thread Current(void) { return Thread(xTaskGetCurrentTaskHandle()); }
@@ -4,36 +4,22 @@
 
 using namespace System;
 
-Timer* Timer::self_ = NULL;
-
-Timer::Timer() {
-  self_ = this;
-
-  auto thread_fn = [](void* arg) {
-    XB_UNUSED(arg);
+Timer::Timer() : TimerCore(FREERTOS_TIMER_TASK_STACK_DEPTH) {
+  auto thread_fn = [](Timer* timer) {
     uint32_t last_online_time = bsp_time_get_ms();
+    timer->start_time_ = bsp_time_get_us();
+
     while (1) {
-      Timer::self_->list_.Foreach(Timer::Refresh, NULL);
-      Timer::self_->thread_.SleepUntil(1, last_online_time);
+      /* 同时记录当前时间，用于把周期计数换算为时间 */
+      Trace::Record(Trace::TIMER_BEGIN,
+                    static_cast<uint32_t>(bsp_time_get_us()));
+      timer->Refresh();
+      Trace::Record(Trace::TIMER_END, 0U);
+
+      timer->thread_.SleepUntil(1, last_online_time);
     }
   };
 
-  this->thread_.Create(thread_fn, static_cast<void*>(NULL), "timer_task",
+  this->thread_.Create(thread_fn, this, "timer_task",
                        FREERTOS_TIMER_TASK_STACK_DEPTH, Thread::HIGH);
 }
-
-bool Timer::Refresh(ControlBlock& block, void* arg) {
-  XB_UNUSED(arg);
-
-  if (!block.running) {
-    return true;
-  }
-
-  block.count++;
-  if (block.cycle <= block.count) {
-    block.count = 0;
-    block.fun(block.type);
-  }
-
-  return true;
-}
@@ -1,22 +1,66 @@
+#include <fcntl.h>
 #include <poll.h>
 #include <stdint.h>
+#include <sys/mman.h>
 
 #include <array>
 #include <database.hpp>
 #include <term.hpp>
 
+#include "bsp_time.h"
 #include "ms.h"
 
+/* 记录头魔数"XRDB" */
+#define DATABASE_MAGIC (0x42445258)
+/* 记录按4字节对齐 */
+#define DATABASE_ALIGN(_len) (((_len) + 3u) & ~3u)
+/* 尚未写入日志的键 */
+#define DATABASE_NO_RECORD (UINT32_MAX)
+
 using namespace System;
 
 static ms_item_t sn_tools;
 
+static uint32_t crc32_table[256];
+
 std::string Database::path_(std::string(getenv("HOME")) + "/.rm_database/");
 
-Database::Key<std::array<uint8_t, 32>> *sn;
+Database* Database::self_ = NULL;
+
+Database::Key<std::array<uint8_t, 32>>* sn;
+
+static void crc32_init() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    crc32_table[i] = crc;
+  }
+}
+
+static uint32_t crc32_calc(const uint8_t* buf, size_t len) {
+  uint32_t crc = 0xffffffff;
+  while (len--) {
+    crc = crc32_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+static uint32_t record_len(const Database::Record* record) {
+  return DATABASE_ALIGN(sizeof(Database::Record) + record->name_len +
+                        record->size);
+}
 
-Database::Database() {
-  auto sn_cmd_fn = [](ms_item_t *item, int argc, char **argv) {
+static uint32_t record_crc(const Database::Record* record) {
+  return crc32_calc(reinterpret_cast<const uint8_t*>(&record->seq),
+                    sizeof(Database::Record) -
+                        offsetof(Database::Record, seq) + record->name_len +
+                        record->size);
+}
+
+Database::Database() : cmd_(this, Command, "db") {
+  auto sn_cmd_fn = [](ms_item_t* item, int argc, char** argv) {
     OM_UNUSED(item);
 
     if (argc == 1) {
@@ -61,13 +105,555 @@ Database::Database() {
     return 0;
   };
 
+  auto flush_fn = [](Database* db) {
+    while (1) {
+      Thread::SleepMilliseconds(db->flush_cycle_);
+      Flush();
+    }
+  };
+
+  self_ = this;
+
+  for (auto& entry : entry_) {
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = DATABASE_NO_RECORD;
+  }
+
+  crc32_init();
+
   poll(NULL, 0, 1);
 
   mkdir(path_.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
 
+  Load();
+
+  const char* cycle = getenv("XROBOT_DATABASE_FLUSH");
+  if (cycle != NULL) {
+    flush_cycle_ = static_cast<uint32_t>(strtoul(cycle, NULL, 10));
+  }
+
+  if (flush_cycle_ > 0) {
+    thread_.Create(flush_fn, this, "database", 256, Thread::LOW);
+  }
+
+  /* 正常退出时写入剩余的脏数据 */
+  atexit([]() { Flush(); });
+
   sn = new Database::Key<std::array<uint8_t, 32>>("SN");
 
   ms_file_init(&sn_tools, "sn_tools", sn_cmd_fn, &(sn->data_),
                sizeof(sn->data_), false);
   ms_cmd_add(&sn_tools);
 }
+
+Database::Entry* Database::Find(const char* name) {
+  for (auto& entry : entry_) {
+    if (entry.name[0] != '\0' &&
+        strncmp(entry.name, name, DATABASE_NAME_LEN) == 0) {
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+Database::Entry* Database::Alloc(const char* name) {
+  for (auto& entry : entry_) {
+    if (entry.name[0] == '\0') {
+      strncpy(entry.name, name, DATABASE_NAME_LEN - 1);
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+void Database::Load() {
+  std::string log_path = path_ + DATABASE_LOG_NAME;
+
+  fd_ = open(log_path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd_ < 0) {
+    printf("Can not open database %s.\r\n", log_path.c_str());
+    return;
+  }
+
+  struct stat st;
+  fstat(fd_, &st);
+
+  map_size_ = DATABASE_LOG_SIZE;
+  while (map_size_ < static_cast<uint64_t>(st.st_size)) {
+    map_size_ *= 2;
+  }
+  if (static_cast<uint64_t>(st.st_size) < map_size_) {
+    static_cast<void>(ftruncate(fd_, map_size_));
+  }
+
+  void* map =
+      mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    printf("Can not map database %s.\r\n", log_path.c_str());
+    close(fd_);
+    fd_ = -1;
+    map_size_ = 0;
+    return;
+  }
+  map_ = static_cast<uint8_t*>(map);
+
+  /* 顺序回放日志，遇到魔数、序号或CRC不正确的记录即认为到达末尾 */
+  uint32_t offset = 0;
+  while (offset + sizeof(Record) <= map_size_) {
+    Record* record = reinterpret_cast<Record*>(map_ + offset);
+
+    if (record->magic != DATABASE_MAGIC || record->seq <= seq_ ||
+        record->name_len == 0 || record->name_len >= DATABASE_NAME_LEN ||
+        record->size > map_size_ ||
+        offset + record_len(record) > map_size_ ||
+        record_crc(record) != record->crc) {
+      break;
+    }
+
+    uint32_t len = record_len(record);
+    char name[DATABASE_NAME_LEN] = {};
+    memcpy(name, record + 1, record->name_len);
+    Entry* entry = Find(name);
+
+    if (entry != NULL && entry->offset != DATABASE_NO_RECORD) {
+      live_ -= record_len(reinterpret_cast<Record*>(map_ + entry->offset));
+    }
+
+    if (record->size == 0) {
+      if (entry != NULL) {
+        free(entry->data);
+        memset(entry, 0, sizeof(*entry));
+        entry->offset = DATABASE_NO_RECORD;
+      }
+    } else {
+      if (entry == NULL) {
+        entry = Alloc(name);
+      }
+
+      if (entry != NULL) {
+        if (entry->size != record->size) {
+          entry->data =
+              static_cast<uint8_t*>(realloc(entry->data, record->size));
+          entry->size = record->size;
+        }
+        memcpy(entry->data,
+               reinterpret_cast<uint8_t*>(record + 1) + record->name_len,
+               record->size);
+        entry->offset = offset;
+        live_ += len;
+      }
+    }
+
+    seq_ = record->seq;
+    offset += len;
+  }
+
+  tail_ = offset;
+}
+
+bool Database::LoadLegacy(const char* name, void* data, uint32_t size) {
+  /* 兼容旧版本每个键一个文件的存储方式 */
+  FILE* fd = fopen((path_ + name).c_str(), "r");
+  if (fd == NULL) {
+    return false;
+  }
+
+  uint8_t* buff = static_cast<uint8_t*>(malloc(size));
+  bool ans = fread(buff, size, 1, fd) == 1;
+  static_cast<void>(fclose(fd));
+
+  if (ans) {
+    memcpy(data, buff, size);
+  }
+  free(buff);
+
+  return ans;
+}
+
+uint32_t Database::Open(const char* name, void* data, uint32_t size) {
+  Database* db = self_;
+
+  if (strlen(name) >= DATABASE_NAME_LEN) {
+    printf("Database key name too long: %s\r\n", name);
+    return DATABASE_NO_RECORD;
+  }
+
+  db->mutex_.Lock();
+
+  Entry* entry = db->Find(name);
+
+  if (entry != NULL && entry->size == size) {
+    memcpy(data, entry->data, size);
+    db->mutex_.Unlock();
+    return static_cast<uint32_t>(entry - db->entry_.data());
+  }
+
+  if (entry == NULL) {
+    entry = db->Alloc(name);
+    if (entry == NULL) {
+      db->mutex_.Unlock();
+      printf("Database full, key %s will not be saved.\r\n", name);
+      return DATABASE_NO_RECORD;
+    }
+  }
+
+  /* 新键或数据长度变化时，优先迁移旧文件，否则写入初始值 */
+  db->LoadLegacy(name, data, size);
+
+  entry->data = static_cast<uint8_t*>(realloc(entry->data, size));
+  entry->size = size;
+  memcpy(entry->data, data, size);
+  entry->dirty = true;
+
+  db->mutex_.Unlock();
+
+  return static_cast<uint32_t>(entry - db->entry_.data());
+}
+
+bool Database::Write(uint32_t index, const void* data, uint32_t size) {
+  if (index >= DATABASE_KEY_NUM) {
+    return false;
+  }
+
+  Database* db = self_;
+  Entry& entry = db->entry_[index];
+
+  db->mutex_.Lock();
+  if (entry.size != size) {
+    db->mutex_.Unlock();
+    return false;
+  }
+  memcpy(entry.data, data, size);
+  entry.dirty = true;
+  db->mutex_.Unlock();
+
+  return true;
+}
+
+bool Database::Read(uint32_t index, void* data, uint32_t size) {
+  if (index >= DATABASE_KEY_NUM) {
+    return false;
+  }
+
+  Database* db = self_;
+  Entry& entry = db->entry_[index];
+
+  db->mutex_.Lock();
+  if (entry.size != size) {
+    db->mutex_.Unlock();
+    return false;
+  }
+  memcpy(data, entry.data, size);
+  db->mutex_.Unlock();
+
+  return true;
+}
+
+bool Database::Stage(Entry& entry, uint32_t& name_len, uint32_t& size) {
+  mutex_.Lock();
+
+  if (entry.name[0] == '\0' || !entry.dirty) {
+    mutex_.Unlock();
+    return false;
+  }
+
+  if (entry.size > stage_size_) {
+    stage_ = static_cast<uint8_t*>(realloc(stage_, entry.size));
+    stage_size_ = entry.size;
+  }
+
+  name_len = static_cast<uint32_t>(strlen(entry.name));
+  size = entry.size;
+  memcpy(stage_, entry.data, size);
+  entry.dirty = false;
+
+  mutex_.Unlock();
+
+  return true;
+}
+
+bool Database::Append(const char* name, uint32_t name_len, const void* data,
+                      uint32_t size, uint32_t& offset) {
+  uint32_t len = DATABASE_ALIGN(sizeof(Record) + name_len + size);
+  if (map_ == NULL || tail_ + len > map_size_) {
+    return false;
+  }
+
+  Record* record = reinterpret_cast<Record*>(map_ + tail_);
+  uint8_t* payload = reinterpret_cast<uint8_t*>(record + 1);
+
+  memcpy(payload, name, name_len);
+  if (size > 0) {
+    memcpy(payload + name_len, data, size);
+  }
+  record->seq = ++seq_;
+  record->name_len = name_len;
+  record->size = size;
+  record->crc = record_crc(record);
+  record->magic = DATABASE_MAGIC;
+
+  offset = tail_;
+  tail_ += len;
+  record_count_++;
+
+  return true;
+}
+
+bool Database::Compact(uint32_t need) {
+  std::string log_path = path_ + DATABASE_LOG_NAME;
+  std::string tmp_path = log_path + ".tmp";
+
+  uint32_t size = map_size_ ? map_size_ : DATABASE_LOG_SIZE;
+  while ((live_ + need) * 2 > size) {
+    size *= 2;
+  }
+
+  int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return false;
+  }
+
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    return false;
+  }
+
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  /* 只复制每个键的最新记录，并重新编号 */
+  /* 记录位置只在持有log_mutex_时修改，复制时不需要mutex_ */
+  uint8_t* dest = static_cast<uint8_t*>(map);
+  std::array<uint32_t, DATABASE_KEY_NUM> moved;
+  uint32_t offset = 0;
+  seq_ = 0;
+
+  for (uint32_t i = 0; i < DATABASE_KEY_NUM; i++) {
+    Entry& entry = entry_[i];
+    moved[i] = entry.offset;
+    if (entry.name[0] == '\0' || entry.offset == DATABASE_NO_RECORD) {
+      continue;
+    }
+
+    Record* record = reinterpret_cast<Record*>(dest + offset);
+    uint32_t len = record_len(reinterpret_cast<Record*>(map_ + entry.offset));
+    memcpy(record, map_ + entry.offset, len);
+    record->seq = ++seq_;
+    record->crc = record_crc(record);
+    moved[i] = offset;
+    offset += len;
+  }
+
+  msync(map, offset, MS_SYNC);
+  static_cast<void>(rename(tmp_path.c_str(), log_path.c_str()));
+
+  if (map_ != NULL) {
+    munmap(map_, map_size_);
+    close(fd_);
+  }
+
+  mutex_.Lock();
+  for (uint32_t i = 0; i < DATABASE_KEY_NUM; i++) {
+    entry_[i].offset = moved[i];
+  }
+  mutex_.Unlock();
+
+  fd_ = fd;
+  map_ = dest;
+  map_size_ = size;
+  tail_ = offset;
+  live_ = offset;
+  compact_count_++;
+
+  return true;
+}
+
+void Database::Flush() {
+  Database* db = self_;
+  if (db == NULL) {
+    return;
+  }
+
+  db->log_mutex_.Lock();
+
+  uint32_t start = db->tail_;
+
+  while (true) {
+    uint32_t need = 0;
+
+    /* 键名只在持有log_mutex_时才会被删除，解锁后entry仍然有效 */
+    for (auto& entry : db->entry_) {
+      uint32_t name_len = 0, size = 0, offset = 0;
+
+      if (!db->Stage(entry, name_len, size)) {
+        continue;
+      }
+
+      if (!db->Append(entry.name, name_len, db->stage_, size, offset)) {
+        db->mutex_.Lock();
+        entry.dirty = true;
+        db->mutex_.Unlock();
+        need = DATABASE_ALIGN(sizeof(Record) + name_len + size);
+        break;
+      }
+
+      /* 数据写入日志后再发布新的位置 */
+      db->mutex_.Lock();
+      if (entry.offset != DATABASE_NO_RECORD) {
+        db->live_ -=
+            record_len(reinterpret_cast<Record*>(db->map_ + entry.offset));
+      }
+      db->live_ += db->tail_ - offset;
+      entry.offset = offset;
+      db->mutex_.Unlock();
+    }
+
+    if (need == 0) {
+      break;
+    }
+
+    /* 空间不足时先同步已追加的部分，再压缩到新文件 */
+    if (db->map_ != NULL) {
+      msync(db->map_, db->tail_, MS_SYNC);
+    }
+    if (!db->Compact(need)) {
+      printf("Database compact failed.\r\n");
+      break;
+    }
+    start = db->tail_;
+  }
+
+  if (db->tail_ != start) {
+    msync(db->map_, db->tail_, MS_SYNC);
+    db->flush_count_++;
+  }
+
+  if (db->tail_ > DATABASE_LOG_SIZE / 2 &&
+      (db->tail_ - db->live_) * 100 > db->tail_ * DATABASE_COMPACT_RATIO) {
+    db->Compact(0);
+  }
+
+  db->log_mutex_.Unlock();
+}
+
+void Database::Erase(const char* name) {
+  Database* db = self_;
+
+  db->log_mutex_.Lock();
+  db->mutex_.Lock();
+
+  Entry* entry = db->Find(name);
+
+  if (entry == NULL) {
+    db->mutex_.Unlock();
+    db->log_mutex_.Unlock();
+    return;
+  }
+
+  uint32_t old = entry->offset;
+  free(entry->data);
+  memset(entry, 0, sizeof(*entry));
+  entry->offset = DATABASE_NO_RECORD;
+
+  db->mutex_.Unlock();
+
+  /* 已写入日志的键需要追加删除记录 */
+  if (old != DATABASE_NO_RECORD) {
+    uint32_t name_len = static_cast<uint32_t>(strlen(name));
+    uint32_t offset = 0;
+    db->live_ -= record_len(reinterpret_cast<Record*>(db->map_ + old));
+    if (!db->Append(name, name_len, NULL, 0, offset)) {
+      /* 删除后的键不会被复制，压缩本身就完成了删除 */
+      db->Compact(0);
+    } else {
+      msync(db->map_, db->tail_, MS_SYNC);
+    }
+  }
+
+  db->log_mutex_.Unlock();
+}
+
+int Database::Command(Database* db, int argc, char** argv) {
+  if (argc == 1) {
+    uint32_t key_num = 0, dirty_num = 0;
+
+    db->mutex_.Lock();
+    for (auto& entry : db->entry_) {
+      if (entry.name[0] != '\0') {
+        key_num++;
+        dirty_num += entry.dirty;
+      }
+    }
+    db->mutex_.Unlock();
+
+    db->log_mutex_.Lock();
+    printf("path:%s%s\r\n", path_.c_str(), DATABASE_LOG_NAME);
+    printf("flush cycle:%ums\r\n", db->flush_cycle_);
+    printf("keys:%u dirty:%u\r\n", key_num, dirty_num);
+    printf("size:%u used:%u live:%u\r\n", db->map_size_, db->tail_,
+           db->live_);
+    printf("records:%u flush:%u compact:%u\r\n", db->record_count_,
+           db->flush_count_, db->compact_count_);
+    db->log_mutex_.Unlock();
+  } else if (argc == 2 && strcmp(argv[1], "flush") == 0) {
+    Flush();
+  } else if (argc == 2 && strcmp(argv[1], "compact") == 0) {
+    db->log_mutex_.Lock();
+    db->Compact(0);
+    db->log_mutex_.Unlock();
+  } else if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+    uint32_t num = argc == 3 ? static_cast<uint32_t>(atoi(argv[2]))
+                             : DATABASE_BENCH_NUM;
+    std::array<uint8_t, 64> buff = {};
+    std::string file_path = path_ + "__bench";
+
+    /* 旧方式：每次更新打开并重写一个文件 */
+    uint64_t start = bsp_time_get_us();
+    for (uint32_t i = 0; i < num; i++) {
+      buff[0] = static_cast<uint8_t>(i);
+      FILE* fd = fopen(file_path.c_str(), "w+");
+      static_cast<void>(fwrite(buff.data(), buff.size(), 1, fd));
+      static_cast<void>(fclose(fd));
+    }
+    uint64_t file_time = bsp_time_get_us() - start;
+    unlink(file_path.c_str());
+
+    uint64_t set_time = 0, flush_time = 0;
+    {
+      Key<std::array<uint8_t, 64>> key("__bench");
+
+      start = bsp_time_get_us();
+      for (uint32_t i = 0; i < num; i++) {
+        buff[0] = static_cast<uint8_t>(i);
+        key.Set(buff);
+      }
+      set_time = bsp_time_get_us() - start;
+
+      start = bsp_time_get_us();
+      Flush();
+      flush_time = bsp_time_get_us() - start;
+    }
+    Erase("__bench");
+
+    printf("%u updates of %u bytes\r\n", num,
+           static_cast<unsigned int>(buff.size()));
+    printf("file  :%10lluus %10.0f/s\r\n",
+           static_cast<unsigned long long>(file_time),
+           file_time ? num * 1e6 / static_cast<double>(file_time) : 0.0);
+    printf("store :%10lluus %10.0f/s flush:%lluus\r\n",
+           static_cast<unsigned long long>(set_time),
+           set_time ? num * 1e6 / static_cast<double>(set_time) : 0.0,
+           static_cast<unsigned long long>(flush_time));
+  } else {
+    printf("db               show database status.\r\n");
+    printf("db flush         write dirty keys to disk.\r\n");
+    printf("db compact       drop stale records.\r\n");
+    printf("db bench [num]   compare with one file per key.\r\n");
+  }
+
+  return 0;
+}
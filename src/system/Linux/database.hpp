@@ -1,80 +1,158 @@
 #pragma once
 
-#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <array>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex.hpp>
 #include <string>
+#include <term.hpp>
+#include <thread.hpp>
+
+/* 日志文件名，位于path_目录下 */
+#define DATABASE_LOG_NAME "database.log"
+/* 日志文件初始大小，空间不足时压缩并按需翻倍 */
+#define DATABASE_LOG_SIZE (64 * 1024)
+/* 最大键数量 */
+#define DATABASE_KEY_NUM (64)
+/* 键名最大长度（含结束符） */
+#define DATABASE_NAME_LEN (32)
+/* 后台写入周期，单位ms，0表示只在Flush时写入
+ * 可由环境变量XROBOT_DATABASE_FLUSH覆盖 */
+#define DATABASE_FLUSH_CYCLE (1000)
+/* 失效记录超过日志已用空间的百分比后压缩 */
+#define DATABASE_COMPACT_RATIO (50)
+/* db bench默认更新次数 */
+#define DATABASE_BENCH_NUM (10000)
 
 namespace System {
+/* 单文件日志结构存储，所有键追加写入同一个mmap文件
+ * Set()只更新内存中的副本并标记为脏，由后台线程合并写入日志，
+ * Get()直接读取内存副本，控制线程不会阻塞在文件IO上 */
 class Database {
  public:
+  typedef struct {
+    uint32_t magic;
+    uint32_t crc; /* 覆盖seq之后的头部、键名与数据 */
+    uint32_t seq;
+    uint32_t name_len;
+    uint32_t size; /* 为0时表示删除 */
+  } Record;
+
+  typedef struct {
+    char name[DATABASE_NAME_LEN];
+    uint8_t* data;
+    uint32_t size;
+    uint32_t offset; /* 最新记录在日志中的位置 */
+    bool dirty;
+  } Entry;
+
   Database();
 
   template <typename Data>
   class Key {
    public:
     Key(const char* name) : name_(name) {
-      FILE* fd = NULL;
-      if (!access((path_ + name).c_str(), W_OK)) {
-        fd = fopen((path_ + name).c_str(), "r");
-        static_cast<void>(fread(&this->data_, sizeof(Data), 1, fd));
-        static_cast<void>(fclose(fd));
-      } else {
-        fd = fopen((path_ + name).c_str(), "w+");
-        memset(&this->data_, 0, sizeof(Data));
-        static_cast<void>(fwrite(&this->data_, sizeof(Data), 1, fd));
-        static_cast<void>(fclose(fd));
-      }
+      memset(&this->data_, 0, sizeof(Data));
+      this->index_ = Open(name, &this->data_, sizeof(Data));
     }
 
     Key(const char* name, const Data& init_value) : name_(name) {
-      FILE* fd = NULL;
-      if (!access((path_ + name).c_str(), W_OK)) {
-        fd = fopen((path_ + name).c_str(), "r");
-        static_cast<void>(fread(&this->data_, sizeof(Data), 1, fd));
-        static_cast<void>(fclose(fd));
-      } else {
-        fd = fopen((path_ + name).c_str(), "w+");
-        this->data_ = init_value;
-        static_cast<void>(fwrite(&this->data_, sizeof(Data), 1, fd));
-        static_cast<void>(fclose(fd));
-      }
+      this->data_ = init_value;
+      this->index_ = Open(name, &this->data_, sizeof(Data));
     }
 
     void Set() {
-      FILE* fd = NULL;
-      fd = fopen((path_ + name_).c_str(), "w+");
-      static_cast<void>(fwrite(&this->data_, sizeof(Data), 1, fd));
-      static_cast<void>(fclose(fd));
+      if (!Write(this->index_, &this->data_, sizeof(Data))) {
+        Warn();
+      }
     }
 
     void Set(const Data& data) {
       this->data_ = data;
-      FILE* fd = NULL;
-      fd = fopen((path_ + name_).c_str(), "w+");
-      static_cast<void>(fwrite(&this->data_, sizeof(Data), 1, fd));
-      static_cast<void>(fclose(fd));
+      Set();
     }
 
     void Get() {
-      FILE* fd = NULL;
-      fd = fopen((path_ + name_).c_str(), "r");
-      static_cast<void>(fread(&this->data_, sizeof(Data), 1, fd));
-      static_cast<void>(fclose(fd));
+      if (!Read(this->index_, &this->data_, sizeof(Data))) {
+        Warn();
+      }
     }
 
     operator Data() { return data_; }
 
     Data data_;
     const char* name_;
+    uint32_t index_;
+
+   private:
+    /* 打开失败的键只提示一次，避免在控制循环中刷屏 */
+    void Warn() {
+      if (!warned_) {
+        printf("Database key %s is not stored.\r\n", name_);
+        warned_ = true;
+      }
+    }
+
+    bool warned_ = false;
   };
 
+  static uint32_t Open(const char* name, void* data, uint32_t size);
+
+  /* 键未打开或长度不一致时返回false */
+  static bool Write(uint32_t index, const void* data, uint32_t size);
+
+  static bool Read(uint32_t index, void* data, uint32_t size);
+
+  /* 把所有脏数据写入日志并同步到磁盘 */
+  static void Flush();
+
+  static void Erase(const char* name);
+
+  static int Command(Database* db, int argc, char** argv);
+
   static std::string path_;
+
+  static Database* self_;
+
+ private:
+  Entry* Find(const char* name);
+
+  Entry* Alloc(const char* name);
+
+  bool Append(const char* name, uint32_t name_len, const void* data,
+              uint32_t size, uint32_t& offset);
+
+  bool Compact(uint32_t need);
+
+  void Load();
+
+  /* 在mutex_下复制键的数据，写入日志时不再持有mutex_ */
+  bool Stage(Entry& entry, uint32_t& name_len, uint32_t& size);
+
+  bool LoadLegacy(const char* name, void* data, uint32_t size);
+
+  Mutex mutex_;     /* 保护entry_与内存副本 */
+  Mutex log_mutex_; /* 保护日志文件与映射 */
+  std::array<Entry, DATABASE_KEY_NUM> entry_;
+  int fd_ = -1;
+  uint8_t* map_ = NULL;
+  uint32_t map_size_ = 0;
+  uint32_t tail_ = 0;
+  uint32_t live_ = 0;
+  uint32_t seq_ = 0;
+  uint8_t* stage_ = NULL;
+  uint32_t stage_size_ = 0;
+  uint32_t flush_cycle_ = DATABASE_FLUSH_CYCLE;
+  uint32_t record_count_ = 0;
+  uint32_t flush_count_ = 0;
+  uint32_t compact_count_ = 0;
+  Thread thread_;
+  Term::Command<Database*> cmd_;
 };
 }  // namespace System
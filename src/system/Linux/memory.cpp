@@ -0,0 +1,18 @@
+#include <memory.hpp>
+
+#include <cstdlib>
+
+using namespace System;
+
+void* Pool::BackendMalloc(size_t size) { return malloc(size); }
+
+void Pool::BackendFree(void* block) { free(block); }
+
+void* operator new(std::size_t size) { return Pool::Alloc(size); }
+
+void operator delete(void* ptr) noexcept { Pool::Free(ptr); }
+
+void operator delete(void* ptr, std::size_t size) noexcept {
+  XB_UNUSED(size);
+  Pool::Free(ptr);
+}
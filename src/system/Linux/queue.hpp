@@ -1,62 +1,160 @@
 #pragma once
 
-#include <mutex.hpp>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
 
 #include "bsp_time.h"
-#include "om.hpp"
 
 namespace System {
+/* 基于序号的无锁环形队列，支持多生产者/多消费者，单生产者时CAS无竞争
+ * 槽位序号为偶数时可写入，为奇数时可读取，长度为1时也不会混淆 */
 template <typename Data>
 class Queue {
  public:
-  Queue(uint16_t length) {
-    om_fifo_create(&fifo_, malloc(length * sizeof(Data)), length, sizeof(Data));
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  Queue(uint16_t length) : length_(length), slots_(new Slot[length]) {
+    for (uint16_t i = 0; i < length; i++) {
+      slots_[i].seq.store(i * 2, std::memory_order_relaxed);
+    }
   }
 
   bool Send(const Data& data) {
-    mutex_.Lock();
-    if (om_fifo_write(&fifo_, &data) == OM_OK) {
-      mutex_.Unlock();
-      return true;
+    uint64_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot = NULL;
+
+    while (true) {
+      slot = &slots_[pos % length_];
+      uint64_t seq = slot->seq.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq - pos * 2);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->data = data;
+    slot->seq.store(pos * 2 + 1, std::memory_order_release);
+
+    ready_.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+      Wake();
     }
-    mutex_.Unlock();
-    return false;
+
+    return true;
   }
 
   bool Receive(Data& data) {
-    mutex_.Lock();
-    if (om_fifo_read(&fifo_, &data) == OM_OK) {
-      mutex_.Unlock();
+    uint64_t pos = head_.load(std::memory_order_relaxed);
+    Slot* slot = NULL;
+
+    while (true) {
+      slot = &slots_[pos % length_];
+      uint64_t seq = slot->seq.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq - (pos * 2 + 1));
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+
+    data = slot->data;
+    slot->seq.store((pos + length_) * 2, std::memory_order_release);
+
+    return true;
+  }
+
+  /* 队列为空时阻塞等待，超时单位为毫秒 */
+  bool Receive(Data& data, uint32_t timeout) {
+    if (Receive(data)) {
       return true;
-    } else {
-      mutex_.Unlock();
-      return false;
+    }
+
+    uint64_t deadline =
+        bsp_time_get_us() + static_cast<uint64_t>(timeout) * 1000;
+
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+
+    while (true) {
+      uint32_t ticket = ready_.load(std::memory_order_seq_cst);
+
+      if (Receive(data)) {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      uint64_t now = bsp_time_get_us();
+      if (now >= deadline) {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      Wait(ticket, deadline - now);
     }
   }
 
+  /* 队列已满时丢弃最旧的数据 */
   bool Overwrite(const Data& data) {
-    mutex_.Lock();
-    bool ans = om_fifo_overwrite(&fifo_, &data) == OM_OK;
-    mutex_.Unlock();
-    return ans;
+    Data drop;
+    while (!Send(data)) {
+      static_cast<void>(Receive(drop));
+    }
+    return true;
   }
 
   bool Reset() {
-    mutex_.Lock();
-    bool ans = om_fifo_reset(&fifo_) == OM_OK;
-    mutex_.Unlock();
-
-    return ans;
+    Data drop;
+    while (Receive(drop)) {
+    }
+    return true;
   }
 
   uint32_t Size() {
-    mutex_.Lock();
-    return om_fifo_readable_item_count(&fifo_);
-    mutex_.Unlock();
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? static_cast<uint32_t>(tail - head) : 0;
   }
 
  private:
-  om_fifo_t fifo_;
-  System::Mutex mutex_;
+  typedef struct {
+    std::atomic<uint64_t> seq;
+    Data data;
+  } Slot;
+
+  void Wait(uint32_t ticket, uint64_t timeout_us) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout_us / 1000000);
+    ts.tv_nsec = static_cast<long>(timeout_us % 1000000 * 1000);
+    syscall(SYS_futex, &ready_, FUTEX_WAIT_PRIVATE, ticket, &ts, NULL, 0);
+  }
+
+  void Wake() {
+    syscall(SYS_futex, &ready_, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
+
+  const uint32_t length_;
+  Slot* slots_;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> ready_{0};
+  std::atomic<uint32_t> waiters_{0};
 };
 }  // namespace System
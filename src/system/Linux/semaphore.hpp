@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <thread.hpp>
+#include <trace.hpp>
 
 #include "bsp_time.h"
 
@@ -16,7 +17,10 @@ class Semaphore {
 
   ~Semaphore() { sem_destroy(&this->handle_); }
 
-  void Post() { sem_post(&this->handle_); }
+  void Post() {
+    Trace::Record(Trace::SEM_POST, this);
+    sem_post(&this->handle_);
+  }
 
   bool Wait(uint32_t timeout = UINT32_MAX) {
     struct timespec ts;
@@ -30,7 +34,11 @@ class Semaphore {
     ts.tv_sec += (add + secs);
     ts.tv_nsec = raw_time % (1000U * 1000U * 1000U);
 
-    return sem_timedwait(&handle_, &ts) == 0;
+    Trace::Record(Trace::SEM_WAIT, this);
+    bool ans = sem_timedwait(&handle_, &ts) == 0;
+    Trace::Record(Trace::SEM_WAKE, this, ans);
+
+    return ans;
   }
 
   uint32_t Value() {
@@ -1,12 +1,14 @@
 #include <cstdint>
 #include <database.hpp>
 #include <functional>
+#include <log.hpp>
 #include <memory.hpp>
 #include <queue.hpp>
 #include <semaphore.hpp>
 #include <term.hpp>
 #include <thread.hpp>
 #include <timer.hpp>
+#include <trace.hpp>
 
 #include "om.hpp"
 
@@ -18,11 +20,23 @@ void Start(RobotParam... param) {
     new Term();
     new Database();
     new Timer();
+#ifdef SYSTEM_TRACE
+    new Trace();
+#endif
+#ifdef SYSTEM_LOG_DEFERRED
+    new Log();
+#endif
+    new Pool();
 
     static auto xrobot_debug_handle = new RobotType(param...);
 
     XB_UNUSED(xrobot_debug_handle);
 
+    /* 之后再申请内存视为错误 */
+#ifdef SYSTEM_POOL_FREEZE
+    Pool::Freeze();
+#endif
+
     while (1) {
       poll(NULL, 0, UINT32_MAX);
     }
@@ -35,6 +49,14 @@ void Start(RobotParam... param) {
     (*init_fun)();
   };
 
+  /* 设置环境变量XROBOT_MLOCK后锁定内存并预先访问线程栈 */
+  const char* mlock = getenv("XROBOT_MLOCK");
+  if (mlock != NULL && strcmp(mlock, "0") != 0) {
+    if (!System::Thread::LockMemory()) {
+      printf("mlockall failed, running without locked memory.\r\n");
+    }
+  }
+
   System::Thread init_thread;
 
   init_thread.Create(init_thread_fn, init_fun_call, "init_thread_fn",
@@ -5,6 +5,7 @@
 #include <unistd.h>
 
 #include <cstddef>
+#include <log.hpp>
 #include <term.hpp>
 #include <thread.hpp>
 
@@ -43,9 +44,7 @@ static int kbhit() {
 }
 
 int show_fun(const char *data, size_t len) {
-  while (len--) {
-    putchar(*data++);
-  }
+  fwrite(data, 1, len, stdout);
 
   return 0;
 }
@@ -53,28 +52,41 @@ int show_fun(const char *data, size_t len) {
 static om_status_t print_log(om_msg_t *msg, void *arg) {
   XB_UNUSED(arg);
 
-  static char time_print_buff[20];
+  static char print_buff[OM_LOG_MAX_LEN + 20];
 
   om_log_t *log = static_cast<om_log_t *>(msg->buff);
 
-  (void)snprintf(time_print_buff, sizeof(time_print_buff), "%-.4f ",
-                 static_cast<float>(bsp_time_get()) / 1000000.0f);
+  /* 时间和内容一次格式化，只发送一个数据报 */
+  int len = snprintf(print_buff, sizeof(print_buff), "%-.4f %s",
+                     static_cast<float>(bsp_time_get()) / 1000000.0f,
+                     log->data);
+  if (len < 0) {
+    return OM_ERROR;
+  }
 
 #ifdef TERM_LOG_UDP_SERVER
   bsp_udp_server_transmit(&term_udp_server,
-                          reinterpret_cast<const uint8_t *>(time_print_buff),
-                          strlen(time_print_buff));
-
-  bsp_udp_server_transmit(&term_udp_server,
-                          reinterpret_cast<const uint8_t *>(log->data),
-                          strlen(log->data));
+                          reinterpret_cast<const uint8_t *>(print_buff),
+                          strnlen(print_buff, sizeof(print_buff)));
 #endif
 
-  ms_printf_insert("%s%s", time_print_buff, log->data);
+  ms_printf_insert("%s", print_buff);
 
   return OM_OK;
 }
 
+static void print_deferred_log(const char *text, size_t len) {
+  XB_UNUSED(len);
+  ms_printf_insert("%s", text);
+}
+
+#ifdef TERM_LOG_UDP_SERVER
+/* 二进制日志由主机上的log_decode.py格式化 */
+static void send_deferred_log(const uint8_t *data, size_t len) {
+  bsp_udp_server_transmit(&term_udp_server, data, len);
+}
+#endif
+
 Term::Term() {
   system("stty -icanon");
   system("stty -echo");
@@ -92,12 +104,27 @@ Term::Term() {
 #ifdef TERM_LOG_UDP_SERVER
   bsp_udp_server_init(&term_udp_server, TERM_LOG_UDP_SERVER_PORT);
 
+  /* 数据报发往最近一次发来数据的地址，新的接收端需要重新获得格式字符串 */
+  auto term_udp_rx_fn = [](void *arg, void *data, uint32_t size) {
+    XB_UNUSED(arg);
+    XB_UNUSED(data);
+    XB_UNUSED(size);
+    Log::Resend();
+  };
+
+  bsp_udp_server_register_callback(&term_udp_server, BSP_UDP_RX_CPLT_CB,
+                                   term_udp_rx_fn, NULL);
+
+  Log::SetOutput(print_deferred_log, send_deferred_log);
+
   term_udp_thread.Create(term_udp_thread_fn, static_cast<void *>(0),
                          "term_udp_thread", 512, System::Thread::HIGH);
 #else
   XB_UNUSED(term_udp_server);
   XB_UNUSED(term_udp_thread_fn);
   XB_UNUSED(term_udp_thread);
+
+  Log::SetOutput(print_deferred_log, NULL);
 #endif
 
   om_config_topic(om_get_log_handle(), "d", print_log, NULL);
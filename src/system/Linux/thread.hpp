@@ -2,17 +2,36 @@
 
 #include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
+#include <cerrno>
+#include <climits>
 #include <csignal>
+#include <cstdlib>
 #include <cstring>
 #include <memory.hpp>
 #include <string>
+#include <trace.hpp>
 
 #include "bsp_def.h"
 #include "bsp_time.h"
 #include "system_ext.hpp"
 
+/* 线程最小栈空间，单位字节 */
+#define LINUX_THREAD_STACK_MIN (128 * 1024)
+/* 锁定内存后每个线程启动时预先访问的栈空间，单位字节 */
+#define LINUX_THREAD_STACK_PREFAULT (64 * 1024)
+/* IDLE/LOW/MEDIUM/HIGH/REALTIME对应的SCHED_FIFO优先级，0表示普通调度。
+ * 只有REALTIME进入实时调度，其余线程忙等时不会饿死主机上的其他进程 */
+#define LINUX_THREAD_FIFO_PRIORITY {0, 0, 0, 0, 80}
+/* 普通调度的线程按nice值区分优先级 */
+#define LINUX_THREAD_NICE {19, 10, 0, -10, 0}
+
 namespace System {
 class Thread {
  public:
@@ -24,9 +43,6 @@ class Thread {
   template <typename FunType, typename ArgType>
   void Create(FunType fun, ArgType arg, const char* name, size_t stack_depth,
               Priority priority) {
-    XB_UNUSED(name);
-    XB_UNUSED(priority);
-
     XB_UNUSED(static_cast<void (*)(ArgType)>(fun));
 
     class ThreadBlock {
@@ -39,29 +55,160 @@ class Thread {
       }
       TypeErasure<void, ArgType> type_;
       char* name_;
+      uint8_t trace_id_;
+      int nice_;
     };
 
+    static const int NICE[] = LINUX_THREAD_NICE;
+
     auto block = new ThreadBlock(fun, arg, name);
+    block->trace_id_ = Trace::Thread(block, block->name_);
+    block->nice_ = NICE[priority];
 
     auto port = [](void* arg) {
       ThreadBlock* block = static_cast<ThreadBlock*>(arg);
       const char* name = block->name_;
-      XB_UNUSED(name);
       sigset_t waitset;
       sigfillset(&waitset);
       pthread_sigmask(SIG_BLOCK, &waitset, NULL);
+
+      char short_name[16];
+      strncpy(short_name, name, sizeof(short_name) - 1);
+      short_name[sizeof(short_name) - 1] = '\0';
+      pthread_setname_np(pthread_self(), short_name);
+
+      SetAffinity(name);
+
+      /* nice值按线程设置，没有权限时无法降低nice值，保持默认 */
+      if (block->nice_ != 0) {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+                    block->nice_);
+      }
+
+      if (memory_locked_) {
+        PrefaultStack();
+      }
+
+      Trace::SetThread(block->trace_id_);
+
       block->type_.fun_(block->type_.arg_);
       return static_cast<void*>(NULL);
     };
 
+    /* stack_depth与FreeRTOS一致按字为单位 */
+    size_t stack_size = stack_depth * sizeof(uint32_t);
+    if (stack_size < LINUX_THREAD_STACK_MIN) {
+      stack_size = LINUX_THREAD_STACK_MIN;
+    }
+    if (stack_size < static_cast<size_t>(PTHREAD_STACK_MIN)) {
+      stack_size = static_cast<size_t>(PTHREAD_STACK_MIN);
+    }
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    stack_size = (stack_size + page_size - 1) / page_size * page_size;
+
+    static const int FIFO_PRIORITY[] = LINUX_THREAD_FIFO_PRIORITY;
+
     pthread_attr_t attr;
     pthread_attr_init(&attr);
-    if (stack_depth > 256) {
-      pthread_attr_setstacksize(&attr, stack_depth / 1024 * 4);
+    pthread_attr_setstacksize(&attr, stack_size);
+
+    /* 显式设置调度策略，避免继承创建者的实时优先级 */
+    struct sched_param param = {};
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    if (FIFO_PRIORITY[priority] > 0) {
+      param.sched_priority = FIFO_PRIORITY[priority];
+      pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
     } else {
-      pthread_attr_setstacksize(&attr, 1);
+      pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    }
+    pthread_attr_setschedparam(&attr, &param);
+
+    if (pthread_create(&this->handle_, &attr, port, block) == EPERM) {
+      /* 没有CAP_SYS_NICE权限时退回普通调度 */
+      param.sched_priority = 0;
+      pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+      pthread_attr_setschedparam(&attr, &param);
+      pthread_create(&this->handle_, &attr, port, block);
+    }
+
+    pthread_attr_destroy(&attr);
+  }
+
+  /* 锁定当前与之后分配的全部内存，避免实时线程因缺页被阻塞 */
+  static bool LockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+      return false;
+    }
+
+    memory_locked_ = true;
+    PrefaultStack();
+
+    return true;
+  }
+
+  /* 环境变量XROBOT_THREAD_AFFINITY指定线程绑定的CPU
+   * 格式为"线程名:CPU列表;..."，例如"timer_task:3;can_*:2,3;*:0-1"
+   * 线程名以*结尾时按前缀匹配 */
+  static void SetAffinity(const char* name) {
+    const char* config = getenv("XROBOT_THREAD_AFFINITY");
+    if (config == NULL) {
+      return;
+    }
+
+    while (*config) {
+      const char* end = strchr(config, ';');
+      size_t len = end ? static_cast<size_t>(end - config) : strlen(config);
+      const char* sep = static_cast<const char*>(memchr(config, ':', len));
+
+      if (sep != NULL) {
+        size_t name_len = static_cast<size_t>(sep - config);
+        bool match = false;
+
+        if (name_len > 0 && config[name_len - 1] == '*') {
+          match = strncmp(name, config, name_len - 1) == 0;
+        } else {
+          match = strlen(name) == name_len &&
+                  strncmp(name, config, name_len) == 0;
+        }
+
+        if (match) {
+          cpu_set_t cpu_set;
+          CPU_ZERO(&cpu_set);
+
+          const char* pos = sep + 1;
+          const char* list_end = config + len;
+          while (pos < list_end) {
+            char* next = NULL;
+            long first = strtol(pos, &next, 10);
+            long last = first;
+            if (next == pos) {
+              break;
+            }
+            if (*next == '-') {
+              pos = next + 1;
+              last = strtol(pos, &next, 10);
+            }
+            for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+              CPU_SET(static_cast<int>(cpu), &cpu_set);
+            }
+            pos = next + (*next == ',' ? 1 : 0);
+            if (next == pos) {
+              break;
+            }
+          }
+
+          if (CPU_COUNT(&cpu_set) > 0) {
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+          }
+          return;
+        }
+      }
+
+      if (end == NULL) {
+        break;
+      }
+      config = end + 1;
     }
-    pthread_create(&this->handle_, &attr, port, block);
   }
 
   static Thread Current(void) { return Thread(pthread_self()); }
@@ -93,10 +240,14 @@ class Thread {
   }
 
   void SleepUntil(uint32_t microseconds, uint32_t& last_wakeup_time) {
-    while (bsp_time_get_ms() - last_wakeup_time < microseconds) {
-      poll(NULL, 0, 1);
-    }
+    /* 以单调时钟上的绝对时刻为截止点，周期误差不会累积 */
+    uint64_t now = bsp_time_get_ns() / 1000000;
+    int32_t remain = static_cast<int32_t>(
+        last_wakeup_time + microseconds - static_cast<uint32_t>(now));
     last_wakeup_time += microseconds;
+    if (remain > 0) {
+      bsp_time_sleep_until_ns((now + remain) * 1000000);
+    }
   }
 
   void Delete() { pthread_cancel(this->handle_); }
@@ -104,5 +255,15 @@ class Thread {
   static void Yield() { sched_yield(); }
 
   pthread_t handle_;
+
+ private:
+  static void PrefaultStack() {
+    volatile uint8_t stack[LINUX_THREAD_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(stack); i += 1024) {
+      stack[i] = 0;
+    }
+  }
+
+  static inline bool memory_locked_ = false;
 };
 }  // namespace System
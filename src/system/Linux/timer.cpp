@@ -4,36 +4,23 @@
 
 using namespace System;
 
-Timer* Timer::self_ = NULL;
+Timer::Timer() : TimerCore(256) {
+  auto thread_fn = [](Timer* timer) {
+    uint64_t next = bsp_time_get_ns();
+    timer->start_time_ = next / 1000;
 
-Timer::Timer() {
-  self_ = this;
-
-  auto thread_fn = [](void* arg) {
-    XB_UNUSED(arg);
-    uint32_t last_wakeup_time = bsp_time_get_ms();
     while (1) {
-      Timer::self_->list_.Foreach(Timer::Refresh, NULL);
-      Timer::self_->thread_.SleepUntil(1, last_wakeup_time);
+      /* 同时记录当前时间，用于把周期计数换算为时间 */
+      Trace::Record(Trace::TIMER_BEGIN,
+                    static_cast<uint32_t>(bsp_time_get_us()));
+      timer->Refresh();
+      Trace::Record(Trace::TIMER_END, 0U);
+
+      /* 按绝对时间唤醒，落后时连续处理多个tick追上进度 */
+      next += TIMER_TICK_US * 1000;
+      bsp_time_sleep_until_ns(next);
     }
   };
 
-  this->thread_.Create(thread_fn, static_cast<void*>(NULL), "timer_task", 256,
-                       Thread::MEDIUM);
-}
-
-bool Timer::Refresh(ControlBlock& block, void* arg) {
-  XB_UNUSED(arg);
-
-  if (!block.running) {
-    return true;
-  }
-
-  block.count++;
-  if (block.cycle <= block.count) {
-    block.count = 0;
-    block.fun(block.type);
-  }
-
-  return true;
+  this->thread_.Create(thread_fn, this, "timer_task", 256, Thread::MEDIUM);
 }
@@ -0,0 +1,69 @@
+#include <array>
+#include <database.hpp>
+#include <term.hpp>
+
+#include "ms.h"
+
+using namespace System;
+
+static ms_item_t sn_tools;
+
+std::string Database::path_;
+
+Database::Key<std::array<uint8_t, 32>> *sn;
+
+Database::Database() {
+  auto sn_cmd_fn = [](ms_item_t *item, int argc, char **argv) {
+    OM_UNUSED(item);
+
+    if (argc == 1) {
+      printf("-show        show SN code.\r\n");
+
+      printf("-set [code]  set  SN code.\r\n");
+
+    } else if (argc == 2) {
+      if (strcmp("show", argv[1]) == 0) {
+        printf("SN\r\n:%.32s", sn->data_.data());
+
+      } else {
+        printf("Error command.\r\n");
+      }
+    } else if (argc == 3) {
+      if (strcmp("set", argv[1]) == 0 && strlen(argv[2]) == 32) {
+        memcpy(sn->data_.data(), argv[2], 32);
+        printf("SN:%.32s\r\n", sn->data_.data());
+      } else {
+        printf("Error sn code format: %s\r\n", argv[2]);
+      }
+    }
+
+    return 0;
+  };
+
+  const char *path = getenv("XROBOT_SIM_DATABASE");
+  if (path) {
+    path_ = std::string(path) + "/";
+  }
+
+  sn = new Database::Key<std::array<uint8_t, 32>>("SN");
+
+  ms_file_init(&sn_tools, "sn_tools", sn_cmd_fn, &(sn->data_),
+               sizeof(sn->data_), false);
+  ms_cmd_add(&sn_tools);
+}
+
+bool Database::Load(const char *name, void *data, uint32_t size) {
+  if (path_.empty()) {
+    return false;
+  }
+
+  FILE *fd = fopen((path_ + name).c_str(), "r");
+  if (fd == NULL) {
+    return false;
+  }
+
+  bool ans = fread(data, size, 1, fd) == 1;
+  static_cast<void>(fclose(fd));
+
+  return ans;
+}
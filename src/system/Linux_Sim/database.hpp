@@ -0,0 +1,47 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace System {
+/* 仿真中的数据只保存在内存里，多个仿真进程并行运行时互不干扰。
+ * 设置环境变量XROBOT_SIM_DATABASE后从该目录读取初始值（只读） */
+class Database {
+ public:
+  Database();
+
+  template <typename Data>
+  class Key {
+   public:
+    Key(const char* name) : name_(name) {
+      memset(&this->data_, 0, sizeof(Data));
+      Load(name, &this->data_, sizeof(Data));
+    }
+
+    Key(const char* name, const Data& init_value) : name_(name) {
+      this->data_ = init_value;
+      Load(name, &this->data_, sizeof(Data));
+    }
+
+    void Set() {}
+
+    void Set(const Data& data) { this->data_ = data; }
+
+    void Get() {}
+
+    operator Data() { return data_; }
+
+    Data data_;
+    const char* name_;
+  };
+
+  static bool Load(const char* name, void* data, uint32_t size);
+
+  static std::string path_;
+};
+}  // namespace System
@@ -0,0 +1,411 @@
+#include <executive.hpp>
+#include <trace.hpp>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "bsp_time.h"
+
+using namespace System;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+
+static thread_local Executive::Task* self_task = NULL;
+
+static Executive::Task* current = NULL;
+static Executive::Task* ready_head[EXECUTIVE_PRIORITY_NUM];
+static Executive::Task* ready_tail[EXECUTIVE_PRIORITY_NUM];
+static Executive::Task* timed = NULL;
+static Executive::Task* task_list[256];
+
+static uint32_t task_num = 0;
+static uint64_t now = 0;
+static uint64_t end_time = 0;
+static double speed = EXECUTIVE_SIM_SPEED;
+static uint64_t real_start = 0;
+static uint64_t switch_count = 0;
+static bool done = false;
+static int exit_code = 0;
+
+static uint64_t real_time_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void ready_push(Executive::Task* task, bool front) {
+  uint8_t prio = task->priority;
+  if (ready_head[prio] == NULL) {
+    task->next = NULL;
+    ready_head[prio] = ready_tail[prio] = task;
+  } else if (front) {
+    task->next = ready_head[prio];
+    ready_head[prio] = task;
+  } else {
+    task->next = NULL;
+    ready_tail[prio]->next = task;
+    ready_tail[prio] = task;
+  }
+}
+
+static int ready_top() {
+  for (int prio = EXECUTIVE_PRIORITY_NUM - 1; prio >= 0; prio--) {
+    if (ready_head[prio]) {
+      return prio;
+    }
+  }
+  return -1;
+}
+
+static Executive::Task* ready_pop() {
+  int prio = ready_top();
+  if (prio < 0) {
+    return NULL;
+  }
+  Executive::Task* task = ready_head[prio];
+  ready_head[prio] = task->next;
+  task->next = NULL;
+  return task;
+}
+
+static void ready_remove(Executive::Task* task) {
+  Executive::Task** pos = &ready_head[task->priority];
+  Executive::Task* prev = NULL;
+  while (*pos && *pos != task) {
+    prev = *pos;
+    pos = &(*pos)->next;
+  }
+  if (*pos) {
+    *pos = task->next;
+    if (ready_tail[task->priority] == task) {
+      ready_tail[task->priority] = prev;
+    }
+  }
+}
+
+/* 定时链表按唤醒时间排序，时间相同时按创建顺序 */
+static void timed_insert(Executive::Task* task) {
+  Executive::Task** pos = &timed;
+  while (*pos && ((*pos)->wake < task->wake ||
+                  ((*pos)->wake == task->wake && (*pos)->id < task->id))) {
+    pos = &(*pos)->next;
+  }
+  task->next = *pos;
+  *pos = task;
+  task->timed = true;
+}
+
+static void timed_remove(Executive::Task* task) {
+  Executive::Task** pos = &timed;
+  while (*pos && *pos != task) {
+    pos = &(*pos)->next;
+  }
+  if (*pos) {
+    *pos = task->next;
+  }
+  task->next = NULL;
+  task->timed = false;
+}
+
+static void queue_remove(Executive::WaitQueue* queue, Executive::Task* task) {
+  Executive::Task** pos = &queue->head;
+  Executive::Task* prev = NULL;
+  while (*pos && *pos != task) {
+    prev = *pos;
+    pos = &(*pos)->wait_next;
+  }
+  if (*pos) {
+    *pos = task->wait_next;
+    if (queue->tail == task) {
+      queue->tail = prev;
+    }
+  }
+  task->wait_next = NULL;
+  task->queue = NULL;
+}
+
+static void advance(uint64_t time) {
+  if (time <= now) {
+    return;
+  }
+
+  /* 限速运行时按实际时间对齐，方便交互调试 */
+  if (speed > 0.0) {
+    uint64_t target = real_start + static_cast<uint64_t>(time / speed);
+    uint64_t real = real_time_us();
+    if (target > real) {
+      usleep(static_cast<useconds_t>(target - real));
+    }
+  }
+
+  now = time;
+  bsp_time_set_us(now);
+}
+
+static void finish(int code) {
+  done = true;
+  exit_code = code;
+  pthread_cond_signal(&run_cond);
+}
+
+static Executive::Task* pick_next() {
+  Executive::Task* task = ready_pop();
+  if (task) {
+    return task;
+  }
+
+  if (timed == NULL) {
+    fprintf(stderr, "sim: deadlock at %.6fs, all tasks blocked:",
+            static_cast<double>(now) / 1000000.0);
+    for (uint32_t i = 0; i < task_num; i++) {
+      if (!task_list[i]->dead) {
+        fprintf(stderr, " %s", task_list[i]->name);
+      }
+    }
+    fprintf(stderr, "\n");
+    finish(EXIT_FAILURE);
+    return NULL;
+  }
+
+  task = timed;
+
+  if (end_time && task->wake > end_time) {
+    advance(end_time);
+    finish(EXIT_SUCCESS);
+    return NULL;
+  }
+
+  timed_remove(task);
+  advance(task->wake);
+
+  if (task->queue) {
+    queue_remove(task->queue, task);
+    task->notified = false;
+  }
+
+  return task;
+}
+
+/* 把运行权交给下一个线程，wait为false时调用者不再运行 */
+static void schedule(Executive::Task* self, bool wait) {
+  Executive::Task* next = pick_next();
+
+  if (next == NULL) {
+    while (1) {
+      pthread_cond_wait(&self->cond, &mutex);
+    }
+  }
+
+  if (next == self) {
+    return;
+  }
+
+  next->switch_count++;
+  switch_count++;
+  current = next;
+  Trace::Record(Trace::THREAD_SWITCH, next);
+  pthread_cond_signal(&next->cond);
+
+  while (wait && current != self) {
+    pthread_cond_wait(&self->cond, &mutex);
+  }
+}
+
+void Executive::Lock() { pthread_mutex_lock(&mutex); }
+
+void Executive::Unlock() { pthread_mutex_unlock(&mutex); }
+
+Executive::Task* Executive::Spawn(void (*fun)(void*), void* arg,
+                                  const char* name, uint8_t priority) {
+  auto port = [](void* arg) {
+    Task* task = static_cast<Task*>(arg);
+    self_task = task;
+
+    Lock();
+    while (current != task) {
+      pthread_cond_wait(&task->cond, &mutex);
+    }
+    Unlock();
+
+    task->fun(task->arg);
+
+    Lock();
+    task->dead = true;
+    schedule(task, false);
+    Unlock();
+
+    return static_cast<void*>(NULL);
+  };
+
+  Lock();
+
+  if (task_num >= sizeof(task_list) / sizeof(task_list[0])) {
+    Unlock();
+    return NULL;
+  }
+
+  Task* task = new Task();
+  pthread_cond_init(&task->cond, NULL);
+  task->fun = fun;
+  task->arg = arg;
+  task->name = name;
+  task->priority = priority < EXECUTIVE_PRIORITY_NUM
+                       ? priority
+                       : EXECUTIVE_PRIORITY_NUM - 1;
+  task->id = task_num;
+  task->sig_queue = new WaitQueue();
+  task_list[task_num++] = task;
+
+  ready_push(task, false);
+
+  pthread_create(&task->handle, NULL, port, task);
+
+  Unlock();
+
+  return task;
+}
+
+Executive::Task* Executive::Current() { return self_task; }
+
+uint64_t Executive::Now() { return now; }
+
+void Executive::SleepUntil(uint64_t time) {
+  Task* self = self_task;
+
+  if (time <= now) {
+    Yield();
+    return;
+  }
+
+  self->wake = time;
+  timed_insert(self);
+  schedule(self, true);
+}
+
+bool Executive::Block(WaitQueue* queue, uint32_t timeout) {
+  Task* self = self_task;
+
+  self->wait_next = NULL;
+  if (queue->tail) {
+    queue->tail->wait_next = self;
+  } else {
+    queue->head = self;
+  }
+  queue->tail = self;
+
+  self->queue = queue;
+  self->notified = false;
+
+  if (timeout != UINT32_MAX) {
+    self->wake = now + static_cast<uint64_t>(timeout) * 1000;
+    timed_insert(self);
+  }
+
+  schedule(self, true);
+
+  return self->notified;
+}
+
+bool Executive::Notify(WaitQueue* queue) {
+  Task* task = queue->head;
+  if (task == NULL) {
+    return false;
+  }
+
+  queue_remove(queue, task);
+
+  if (task->timed) {
+    timed_remove(task);
+  }
+
+  task->notified = true;
+  ready_push(task, false);
+
+  return true;
+}
+
+void Executive::Preempt() {
+  Task* self = self_task;
+
+  /* 只有当前运行的线程才能被抢占，main线程中调用时忽略 */
+  if (self == NULL || self != current) {
+    return;
+  }
+
+  if (ready_top() > self->priority) {
+    ready_push(self, true);
+    schedule(self, true);
+  }
+}
+
+void Executive::Yield() {
+  Task* self = self_task;
+  if (self == NULL) {
+    return;
+  }
+
+  ready_push(self, false);
+  schedule(self, true);
+}
+
+void Executive::Kill(Task* task) {
+  if (task->dead) {
+    return;
+  }
+
+  task->dead = true;
+
+  if (task == self_task) {
+    schedule(task, false);
+    Unlock();
+    pthread_exit(NULL);
+  }
+
+  /* 被结束的线程停在条件变量上，不会再被调度 */
+  if (task->timed) {
+    timed_remove(task);
+  }
+  if (task->queue) {
+    queue_remove(task->queue, task);
+  }
+  ready_remove(task);
+}
+
+int Executive::Run() {
+  const char* env = getenv("XROBOT_SIM_TIME");
+  double sim_time = env ? atof(env) : EXECUTIVE_SIM_TIME;
+  end_time = static_cast<uint64_t>(sim_time * 1000000.0);
+
+  env = getenv("XROBOT_SIM_SPEED");
+  if (env) {
+    speed = atof(env);
+  }
+
+  Lock();
+
+  real_start = real_time_us();
+
+  current = pick_next();
+  if (current) {
+    pthread_cond_signal(&current->cond);
+  }
+
+  while (!done) {
+    pthread_cond_wait(&run_cond, &mutex);
+  }
+
+  double real = static_cast<double>(real_time_us() - real_start) / 1000000.0;
+  double sim = static_cast<double>(now) / 1000000.0;
+
+  fprintf(stderr, "sim: %.3fs in %.3fs real time (%.1fx), %u tasks, %llu "
+          "switches\n", sim, real, real > 0.0 ? sim / real : 0.0, task_num,
+          static_cast<unsigned long long>(switch_count));
+
+  Unlock();
+
+  return exit_code;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstdint>
+
+/* 优先级数量，与Thread::Priority对应 */
+#define EXECUTIVE_PRIORITY_NUM (5)
+/* 仿真运行时长，单位s，0表示一直运行，可由环境变量XROBOT_SIM_TIME覆盖 */
+#define EXECUTIVE_SIM_TIME (0)
+/* 仿真速度相对实时的倍数，0表示不限速，可由环境变量XROBOT_SIM_SPEED覆盖 */
+#define EXECUTIVE_SIM_SPEED (0)
+
+namespace System {
+/* 锁步执行器，所有线程共用一个虚拟时钟，同一时刻只有一个线程在运行。
+ * 线程只在Sleep/Semaphore/Signal等系统调用处让出，
+ * 所有线程都阻塞时虚拟时钟直接跳到最早的唤醒时间，
+ * 因此仿真速度只受CPU限制，且相同输入下的结果完全确定 */
+class Executive {
+ public:
+  struct WaitQueue;
+
+  typedef struct Task {
+    pthread_t handle;
+    pthread_cond_t cond;
+    void (*fun)(void*);
+    void* arg;
+    const char* name;
+    uint8_t priority;
+    uint32_t id;       /* 创建顺序，同时刻唤醒时按此排序 */
+    uint64_t wake;     /* 超时时间，单位us */
+    bool timed;        /* 是否在定时链表中 */
+    bool notified;     /* 被同步对象唤醒，而不是超时 */
+    bool dead;
+    uint32_t signal;      /* 未处理的信号 */
+    uint32_t signal_wait; /* 正在等待的信号 */
+    struct WaitQueue* queue;
+    struct WaitQueue* sig_queue;
+    uint64_t switch_count;
+    struct Task* next;      /* 就绪链表或定时链表 */
+    struct Task* wait_next; /* 同步对象的等待链表 */
+  } Task;
+
+  typedef struct WaitQueue {
+    Task* head;
+    Task* tail;
+  } WaitQueue;
+
+  /* 以下接口除Spawn/Run外都需要在Lock()之后调用 */
+  static void Lock();
+
+  static void Unlock();
+
+  static Task* Spawn(void (*fun)(void*), void* arg, const char* name,
+                     uint8_t priority);
+
+  static Task* Current();
+
+  static uint64_t Now();
+
+  /* 阻塞到指定的虚拟时间 */
+  static void SleepUntil(uint64_t time);
+
+  /* 在同步对象上等待，返回false表示超时 */
+  static bool Block(WaitQueue* queue, uint32_t timeout);
+
+  /* 唤醒等待时间最长的线程，没有等待者时返回false */
+  static bool Notify(WaitQueue* queue);
+
+  /* 有更高优先级的线程就绪时切换过去 */
+  static void Preempt();
+
+  static void Yield();
+
+  static void Kill(Task* task);
+
+  /* 由main线程调用，直到仿真结束才返回 */
+  static int Run();
+};
+}  // namespace System
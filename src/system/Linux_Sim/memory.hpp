@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <pool.hpp>
+
+void* operator new(std::size_t size);
+void operator delete(void* ptr) noexcept;
+void operator delete(void* ptr, std::size_t size) noexcept;
+namespace System {
+class Memory {
+ public:
+  static void* Malloc(size_t size) { return Pool::Alloc(size); }
+  static void Free(void* block) { Pool::Free(block); }
+};
+}  // namespace System
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <semaphore.hpp>
+#include <thread.hpp>
+
+namespace System {
+/* 线程可能在持有锁时阻塞，不能使用pthread互斥锁，否则会卡住执行器 */
+class Mutex {
+ public:
+  Mutex() {}
+
+  ~Mutex() {}
+
+  void Unlock() { sem_.Post(); }
+
+  bool Lock() { return sem_.Wait(UINT32_MAX); }
+
+ private:
+  Semaphore sem_ = Semaphore(1);
+};
+}  // namespace System
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <executive.hpp>
+#include <thread.hpp>
+#include <trace.hpp>
+
+namespace System {
+class Semaphore {
+ public:
+  Semaphore(uint16_t init_count) : count_(init_count) {}
+
+  void Post() {
+    Trace::Record(Trace::SEM_POST, this);
+
+    Executive::Lock();
+    /* 有等待者时直接把计数交给它 */
+    if (!Executive::Notify(&this->queue_)) {
+      this->count_++;
+    }
+    Executive::Preempt();
+    Executive::Unlock();
+  }
+
+  bool Wait(uint32_t timeout = UINT32_MAX) {
+    Executive::Lock();
+
+    if (this->count_) {
+      this->count_--;
+      Executive::Unlock();
+      return true;
+    }
+
+    bool ans = false;
+    if (timeout) {
+      Trace::Record(Trace::SEM_WAIT, this);
+      ans = Executive::Block(&this->queue_, timeout);
+      Trace::Record(Trace::SEM_WAKE, this, ans);
+    }
+
+    Executive::Unlock();
+
+    return ans;
+  }
+
+ private:
+  uint32_t count_;
+  Executive::WaitQueue queue_ = {};
+};
+}  // namespace System
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <executive.hpp>
+#include <thread.hpp>
+
+#include "bsp_def.h"
+
+namespace System {
+class Signal {
+ public:
+  static bool Action(System::Thread& thread, int sig) {
+    XB_ASSERT(sig >= 0 && sig < 32);
+
+    Executive::Task* task = thread.handle_;
+
+    Executive::Lock();
+    task->signal |= 1u << sig;
+    if (task->signal_wait & (1u << sig)) {
+      Executive::Notify(task->sig_queue);
+    }
+    Executive::Preempt();
+    Executive::Unlock();
+
+    return true;
+  }
+
+  static bool Wait(int sig, uint32_t timeout) {
+    XB_ASSERT(sig >= 0 && sig < 32);
+
+    Executive::Task* task = Executive::Current();
+    uint32_t bit = 1u << sig;
+
+    Executive::Lock();
+
+    if (!(task->signal & bit) && timeout) {
+      task->signal_wait = bit;
+      Executive::Block(task->sig_queue, timeout);
+      task->signal_wait = 0;
+    }
+
+    bool ans = task->signal & bit;
+    task->signal &= ~bit;
+
+    Executive::Unlock();
+
+    return ans;
+  }
+};
+
+}  // namespace System
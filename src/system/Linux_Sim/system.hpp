@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <database.hpp>
+#include <executive.hpp>
+#include <functional>
+#include <log.hpp>
+#include <memory.hpp>
+#include <queue.hpp>
+#include <semaphore.hpp>
+#include <term.hpp>
+#include <thread.hpp>
+#include <timer.hpp>
+#include <trace.hpp>
+
+#include "om.hpp"
+
+namespace System {
+template <typename RobotType, typename... RobotParam>
+void Start(RobotParam... param) {
+  auto init_fun = [](RobotParam... param) {
+    new Message();
+    new Term();
+    new Database();
+    new Timer();
+#ifdef SYSTEM_TRACE
+    new Trace();
+#endif
+#ifdef SYSTEM_LOG_DEFERRED
+    new Log();
+#endif
+    new Pool();
+
+    static auto xrobot_debug_handle = new RobotType(param...);
+
+    XB_UNUSED(xrobot_debug_handle);
+
+    /* 之后再申请内存视为错误 */
+#ifdef SYSTEM_POOL_FREEZE
+    Pool::Freeze();
+#endif
+
+    while (1) {
+      System::Thread::Sleep(UINT32_MAX);
+    }
+  };
+
+  std::function<void(void)>* init_fun_call =
+      new std::function<void(void)>(std::bind(init_fun, param...));
+
+  auto init_thread_fn = [](std::function<void(void)>* init_fun) {
+    (*init_fun)();
+  };
+
+  System::Thread init_thread;
+
+  /* 线程在Executive::Run()之后才开始运行 */
+  init_thread.Create(init_thread_fn, init_fun_call, "init_thread_fn",
+                     INIT_TASK_STACK_DEPTH, System::Thread::REALTIME);
+}
+}  // namespace System
@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <log.hpp>
+#include <term.hpp>
+#include <thread.hpp>
+
+#include "bsp_sys.h"
+#include "bsp_time.h"
+#include "ms.h"
+#include "om.hpp"
+
+using namespace System;
+
+static System::Thread term_thread;
+
+static ms_item_t power_ctrl;
+
+int show_fun(const char *data, size_t len) {
+  fwrite(data, 1, len, stdout);
+
+  return 0;
+}
+
+/* 非阻塞读取，终端线程阻塞在getchar上会让整个执行器停住 */
+static int kbhit() {
+  struct termios oldt, newt;
+  int ch;
+  int oldf;
+  bool tty = isatty(STDIN_FILENO);
+  if (tty) {
+    tcgetattr(STDIN_FILENO, &oldt);
+    newt = oldt;
+    newt.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+  }
+  oldf = fcntl(STDIN_FILENO, F_GETFL, 0);
+  fcntl(STDIN_FILENO, F_SETFL, oldf | O_NONBLOCK);
+  ch = getchar();
+  if (tty) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+  }
+  fcntl(STDIN_FILENO, F_SETFL, oldf);
+  if (ch != EOF) {
+    ungetc(ch, stdin);
+    return 1;
+  }
+  clearerr(stdin);
+  return 0;
+}
+
+static om_status_t print_log(om_msg_t *msg, void *arg) {
+  XB_UNUSED(arg);
+
+  om_log_t *log = static_cast<om_log_t *>(msg->buff);
+
+  ms_printf_insert("%-.4f %s", static_cast<float>(bsp_time_get()) / 1000000.0f,
+                   log->data);
+
+  return OM_OK;
+}
+
+static void print_deferred_log(const char *text, size_t len) {
+  XB_UNUSED(len);
+  ms_printf_insert("%s", text);
+}
+
+Term::Term() {
+  if (isatty(STDIN_FILENO)) {
+    system("stty -icanon");
+    system("stty -echo");
+  }
+
+  ms_init(show_fun);
+
+  om_config_topic(om_get_log_handle(), "d", print_log, NULL);
+
+  Log::SetOutput(print_deferred_log, NULL);
+
+  auto term_thread_fn = [](void *arg) {
+    XB_UNUSED(arg);
+
+    ms_start();
+
+    while (1) {
+      if (kbhit()) {
+        ms_input(static_cast<char>(getchar()));
+      } else {
+        System::Thread::Sleep(10);
+      }
+    }
+  };
+
+  auto pwr_cmd_fn = [](ms_item_t *item, int argc, char **argv) {
+    XB_UNUSED(item);
+
+    if (argc == 1) {
+      printf("Please add option:shutdown reboot sleep or stop.\r\n");
+    } else if (argc == 2) {
+      if (strcmp(argv[1], "sleep") == 0) {
+        bsp_sys_sleep();
+      } else if (strcmp(argv[1], "stop") == 0) {
+        bsp_sys_stop();
+      } else if (strcmp(argv[1], "shutdown") == 0) {
+        bsp_sys_shutdown();
+      } else if (strcmp(argv[1], "reboot") == 0) {
+        bsp_sys_reset();
+      }
+    }
+
+    return 0;
+  };
+
+  ms_file_init(&power_ctrl, "power", pwr_cmd_fn, NULL, 0, false);
+  ms_cmd_add(&power_ctrl);
+
+  term_thread.Create(term_thread_fn, static_cast<void *>(0), "term_thread", 512,
+                     System::Thread::LOW);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <cstdint>
+#include <cstring>
+#include <executive.hpp>
+#include <memory.hpp>
+#include <string>
+#include <trace.hpp>
+
+#include "bsp_def.h"
+#include "bsp_time.h"
+#include "system_ext.hpp"
+
+namespace System {
+class Thread {
+ public:
+  typedef enum { IDLE, LOW, MEDIUM, HIGH, REALTIME } Priority;
+
+  Thread(){};
+  Thread(Executive::Task* handle) : handle_(handle){};
+
+  template <typename FunType, typename ArgType>
+  void Create(FunType fun, ArgType arg, const char* name, size_t stack_depth,
+              Priority priority) {
+    XB_UNUSED(stack_depth);
+
+    XB_UNUSED(static_cast<void (*)(ArgType)>(fun));
+
+    class ThreadBlock {
+     public:
+      ThreadBlock(FunType fun, ArgType arg, const char* name)
+          : type_(fun, arg),
+            name_(reinterpret_cast<char*>(
+                System::Memory::Malloc(strlen(name) + 1))) {
+        strcpy(name_, name);
+      }
+      TypeErasure<void, ArgType> type_;
+      char* name_;
+    };
+
+    auto block = new ThreadBlock(fun, arg, name);
+
+    auto port = [](void* arg) {
+      ThreadBlock* block = static_cast<ThreadBlock*>(arg);
+      block->type_.fun_(block->type_.arg_);
+    };
+
+    this->handle_ = Executive::Spawn(port, block, block->name_, priority);
+
+    Trace::Thread(this->handle_, block->name_);
+  }
+
+  static Thread Current(void) { return Thread(Executive::Current()); }
+
+  /* 所有延时都基于虚拟时钟，阻塞期间时钟可以直接跳过 */
+  static void Sleep(uint32_t microseconds) {
+    Executive::Lock();
+    Executive::SleepUntil(Executive::Now() +
+                          static_cast<uint64_t>(microseconds) * 1000);
+    Executive::Unlock();
+  }
+
+  static void SleepMilliseconds(uint32_t microseconds) { Sleep(microseconds); }
+
+  static void SleepSeconds(uint32_t seconds) {
+    Executive::Lock();
+    Executive::SleepUntil(Executive::Now() +
+                          static_cast<uint64_t>(seconds) * 1000000);
+    Executive::Unlock();
+  }
+
+  static void SleepMinutes(uint32_t minutes) { SleepSeconds(minutes * 60); }
+
+  static void SleepHours(uint32_t hours) {
+    while (hours--) {
+      SleepMinutes(60);
+    }
+  }
+
+  static void SleepDays(uint32_t days) {
+    while (days--) {
+      SleepHours(24);
+    }
+  }
+
+  void SleepUntil(uint32_t microseconds, uint32_t& last_wakeup_time) {
+    if (last_wakeup_time == 0) {
+      last_wakeup_time = bsp_time_get_ms();
+    }
+
+    last_wakeup_time += microseconds;
+
+    Executive::Lock();
+    Executive::SleepUntil(static_cast<uint64_t>(last_wakeup_time) * 1000);
+    Executive::Unlock();
+  }
+
+  void Delete() {
+    Executive::Lock();
+    Executive::Kill(this->handle_);
+    Executive::Unlock();
+  }
+
+  static void Yield() {
+    Executive::Lock();
+    Executive::Yield();
+    Executive::Unlock();
+  }
+
+  Executive::Task* handle_;
+};
+}  // namespace System
@@ -0,0 +1,25 @@
+#include <timer.hpp>
+
+#include "bsp_time.h"
+
+using namespace System;
+
+Timer::Timer() : TimerCore(256) {
+  auto thread_fn = [](Timer* timer) {
+    /* tick跟随虚拟时钟，没有到期的定时器时时钟直接跳过 */
+    uint32_t last_wakeup_time = bsp_time_get_ms();
+    timer->start_time_ = bsp_time_get_us();
+
+    while (1) {
+      /* 同时记录当前时间，用于把周期计数换算为时间 */
+      Trace::Record(Trace::TIMER_BEGIN,
+                    static_cast<uint32_t>(bsp_time_get_us()));
+      timer->Refresh();
+      Trace::Record(Trace::TIMER_END, 0U);
+
+      timer->thread_.SleepUntil(1, last_wakeup_time);
+    }
+  };
+
+  this->thread_.Create(thread_fn, this, "timer_task", 256, Thread::MEDIUM);
+}
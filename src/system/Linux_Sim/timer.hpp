@@ -0,0 +1,14 @@
+#pragma once
+
+#include <thread.hpp>
+
+#include "timer_core.hpp"
+
+namespace System {
+class Timer : public TimerCore {
+ public:
+  Timer();
+
+  Thread thread_;
+};
+}  // namespace System
@@ -51,8 +51,9 @@ class Queue {
 
   uint32_t Size() {
     mutex_.Lock();
-    return om_fifo_readable_item_count(&fifo_);
+    uint32_t ans = om_fifo_readable_item_count(&fifo_);
     mutex_.Unlock();
+    return ans;
   }
 
  private:
@@ -1,39 +1,20 @@
 #include <timer.hpp>
 
-using namespace System;
-
-Timer* Timer::self_ = NULL;
-
-Timer::Timer() {
-  self_ = this;
+#include "bsp_time.h"
 
-  auto thread_fn = [](void* arg) {
-    XB_UNUSED(arg);
+using namespace System;
 
+Timer::Timer() : TimerCore(256) {
+  auto thread_fn = [](Timer* timer) {
+    /* 仿真时间由Webots驱动，tick跟随仿真步进 */
     uint32_t last_wakeup_time = bsp_time_get_ms();
+    timer->start_time_ = bsp_time_get_us();
 
     while (1) {
-      Timer::self_->list_.Foreach(Timer::Refresh, NULL);
-      Timer::self_->thread_.SleepUntil(1, last_wakeup_time);
+      timer->Refresh();
+      timer->thread_.SleepUntil(1, last_wakeup_time);
     }
   };
 
-  this->thread_.Create(thread_fn, static_cast<void*>(NULL), "timer_task", 256,
-                       Thread::MEDIUM);
-}
-
-bool Timer::Refresh(ControlBlock& block, void* arg) {
-  XB_UNUSED(arg);
-
-  if (!block.running) {
-    return true;
-  }
-
-  block.count++;
-  if (block.cycle <= block.count) {
-    block.count = 0;
-    block.fun(block.type);
-  }
-
-  return true;
+  this->thread_.Create(thread_fn, this, "timer_task", 256, Thread::MEDIUM);
 }
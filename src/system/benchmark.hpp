@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <trace.hpp>
+
+#include "bsp_time.h"
+
+/* 每个测试正式采样前丢弃的次数 */
+#ifndef BENCHMARK_WARMUP_NUM
+#define BENCHMARK_WARMUP_NUM (10)
+#endif
+/* 每个测试的采样次数，p99取第99个 */
+#ifndef BENCHMARK_SAMPLE_NUM
+#define BENCHMARK_SAMPLE_NUM (100)
+#endif
+/* 校准周期计数器时等待的时间，单位us */
+#define BENCHMARK_CALI_US (10000)
+/* 校准时最多读取时间的次数，仿真时间不前进时据此退出 */
+#define BENCHMARK_CALI_LOOP (10000000)
+
+namespace System {
+/* 基准测试注册表。设备和模块把测试作为成员构造，和终端命令一样在构造时登记，
+ * 由perf bench统一运行，各平台使用相同的采样次数和统计方式。
+ * sample每次测量一次，返回单次操作的耗时，小于0表示本次失败；
+ * setup返回false时跳过这个测试，例如没有连接对端设备 */
+class Benchmark {
+ public:
+  typedef float (*SampleFun)(void* arg);
+  typedef bool (*SetupFun)(void* arg);
+  typedef void (*TeardownFun)(void* arg);
+
+  typedef struct {
+    float min;
+    float median;
+    float p99;
+    float max;
+    uint32_t num; /* 成功的采样次数 */
+  } Result;
+
+  Benchmark(const char* name, SampleFun sample, void* arg = NULL,
+            SetupFun setup = NULL, TeardownFun teardown = NULL)
+      : name_(name),
+        sample_(sample),
+        setup_(setup),
+        teardown_(teardown),
+        arg_(arg) {
+    /* 按名称排序插入，输出顺序与构造顺序无关，方便比较不同平台的结果 */
+    Benchmark** pos = &head_;
+    while (*pos != NULL && strcmp((*pos)->name_, name) < 0) {
+      pos = &(*pos)->next_;
+    }
+    next_ = *pos;
+    *pos = this;
+  }
+
+  /* 每次测试开始时的计时起点 */
+  static uint32_t Now() { return Trace::Cycle(); }
+
+  /* 从start到现在的耗时除以num，校准后单位为ns，否则为周期数 */
+  static float Elapsed(uint32_t start, uint32_t num = 1) {
+    return ToNs(Trace::Cycle() - start) / static_cast<float>(num);
+  }
+
+  static float ToNs(uint32_t cycle) {
+    return ns_per_cycle_ > 0.0f ? static_cast<float>(cycle) * ns_per_cycle_
+                                : static_cast<float>(cycle);
+  }
+
+  /* 用bsp_time校准周期计数器，仿真时间不前进时保持周期数 */
+  static void Calibrate() {
+    Trace::InitCycle();
+
+    if (ns_per_cycle_ > 0.0f) {
+      return;
+    }
+
+    uint64_t begin = bsp_time_get_us();
+    uint32_t cycle = Trace::Cycle();
+    uint64_t now = begin;
+
+    for (uint32_t i = 0; i < BENCHMARK_CALI_LOOP; i++) {
+      now = bsp_time_get_us();
+      if (now - begin >= BENCHMARK_CALI_US) {
+        break;
+      }
+    }
+
+    cycle = Trace::Cycle() - cycle;
+
+    if (now - begin >= BENCHMARK_CALI_US && cycle != 0) {
+      ns_per_cycle_ = static_cast<float>(now - begin) * 1000.0f /
+                      static_cast<float>(cycle);
+    }
+  }
+
+  static bool Calibrated() { return ns_per_cycle_ > 0.0f; }
+
+  static const char* Unit() { return Calibrated() ? "ns" : "cycle"; }
+
+  bool Run(Result& result) {
+    if (setup_ != NULL && !setup_(arg_)) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < BENCHMARK_WARMUP_NUM; i++) {
+      sample_(arg_);
+    }
+
+    float* sample = new float[BENCHMARK_SAMPLE_NUM];
+    uint32_t num = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_SAMPLE_NUM; i++) {
+      float value = sample_(arg_);
+      if (value >= 0.0f) {
+        sample[num++] = value;
+      }
+    }
+
+    if (teardown_ != NULL) {
+      teardown_(arg_);
+    }
+
+    if (num != 0) {
+      std::sort(sample, sample + num);
+      result.min = sample[0];
+      result.median = sample[num / 2];
+      /* 最近秩法，采样100次时为第99个 */
+      result.p99 = sample[(num * 99 + 99) / 100 - 1];
+      result.max = sample[num - 1];
+    }
+    result.num = num;
+
+    delete[] sample;
+
+    return num != 0;
+  }
+
+  static Benchmark* Head() { return head_; }
+
+  Benchmark* Next() { return next_; }
+
+  const char* Name() { return name_; }
+
+ private:
+  const char* name_;
+  SampleFun sample_;
+  SetupFun setup_;
+  TeardownFun teardown_;
+  void* arg_;
+  Benchmark* next_ = NULL;
+
+  static inline Benchmark* head_ = NULL;
+  static inline float ns_per_cycle_ = 0.0f;
+};
+}  // namespace System
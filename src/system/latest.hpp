@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "om.hpp"
+
+namespace System {
+/* 单写多读的双缓冲，写入不加锁也不会阻塞，读取端只拿到完整的最新值。
+ * 写入buff_[begin & 1]前先更新begin，写完后更新end，
+ * 读取端拷贝buff_[end & 1]后begin没有超过end + 1，说明拷贝期间没有被覆盖 */
+template <typename Data>
+class LatestSlot {
+ public:
+  void Write(const Data& data) {
+    uint32_t version = begin_.load(std::memory_order_relaxed) + 1;
+    begin_.store(version, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(static_cast<void*>(&buff_[version & 1]), &data, sizeof(Data));
+    end_.store(version, std::memory_order_release);
+  }
+
+  uint32_t Version() { return end_.load(std::memory_order_acquire); }
+
+  bool Valid(uint32_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return begin_.load(std::memory_order_relaxed) - version <= 1;
+  }
+
+  const Data* Buffer(uint32_t version) { return &buff_[version & 1]; }
+
+  /* version为上次读到的版本，有新数据时拷贝到data并更新version */
+  bool Read(Data& data, uint32_t& version) {
+    uint32_t ans = 0;
+    do {
+      ans = this->Version();
+      if (ans == version) {
+        return false;
+      }
+      memcpy(static_cast<void*>(&data), this->Buffer(ans), sizeof(Data));
+    } while (!this->Valid(ans));
+
+    version = ans;
+    return true;
+  }
+
+ private:
+  std::atomic<uint32_t> begin_{0};
+  std::atomic<uint32_t> end_{0};
+  Data buff_[2];
+};
+
+/* 只保留最新值的话题读取端，用于控制线程周期性读取指令、姿态、裁判系统等数据。
+ * 同一话题的所有Latest共用一个LatestSlot，发布时只在话题回调中写一次，
+ * 读取端先比较版本号，没有更新时不拷贝数据，也可以只拷贝需要的成员。
+ * 发布和读取都不加锁，要求每个话题只有一个发布者 */
+template <typename Data>
+class Latest {
+ public:
+  class Channel : public LatestSlot<Data> {
+   public:
+    Channel(om_topic_t* topic) : topic_(topic) {}
+
+    om_topic_t* topic_;
+    Channel* next_ = NULL;
+  };
+
+  Latest(const char* name) : name_(name) { this->Attach(); }
+
+  /* 话题还没有创建时返回false，之后每次调用都会重新查找 */
+  bool Available() { return channel_ != NULL || this->Attach(); }
+
+  /* 有新数据时拷贝到data并返回true，没有更新时data保持不变 */
+  bool DumpData(Data& data) {
+    return this->Available() && channel_->Read(data, version_);
+  }
+
+  /* 只拷贝指定的成员，例如
+   * DumpField(ref, &Referee::Data::status, &Referee::Data::power_heat) */
+  template <typename... Member>
+  bool DumpField(Data& data, Member... member) {
+    return this->Read([&](const Data* buff) {
+      auto in = reinterpret_cast<const uint8_t*>(buff);
+      auto out = reinterpret_cast<uint8_t*>(&data);
+      (memcpy(out + Offset(buff, member), in + Offset(buff, member),
+              sizeof(buff->*member)),
+       ...);
+    });
+  }
+
+  /* 从上次读取后是否有新数据，不拷贝 */
+  bool Updated() {
+    return this->Available() && channel_->Version() != version_;
+  }
+
+ private:
+  /* 成员可能位于packed结构体中，按字节偏移拷贝，不经过成员类型的指针 */
+  template <typename Member>
+  static size_t Offset(const Data* base, Member member) {
+    return reinterpret_cast<uintptr_t>(&(base->*member)) -
+           reinterpret_cast<uintptr_t>(base);
+  }
+
+  template <typename CopyFun>
+  bool Read(CopyFun copy) {
+    if (!this->Available()) {
+      return false;
+    }
+
+    uint32_t version = 0;
+    do {
+      version = channel_->Version();
+      if (version == version_) {
+        return false;
+      }
+      copy(channel_->Buffer(version));
+    } while (!channel_->Valid(version));
+
+    version_ = version;
+    return true;
+  }
+
+  static std::atomic<Channel*>& Head() {
+    static std::atomic<Channel*> head(NULL);
+    return head;
+  }
+
+  /* 同一话题只注册一次回调，链表只增不减，插入使用CAS */
+  bool Attach() {
+    om_topic_t* topic = Message::Topic<Data>::Find(name_);
+    if (topic == NULL) {
+      return false;
+    }
+
+    Channel* channel = NULL;
+    Channel* head = Head().load(std::memory_order_acquire);
+
+    while (1) {
+      for (Channel* i = head; i != NULL; i = i->next_) {
+        if (i->topic_ == topic) {
+          delete channel;
+          channel_ = i;
+          return true;
+        }
+      }
+
+      if (channel == NULL) {
+        channel = new Channel(topic);
+      }
+
+      channel->next_ = head;
+      if (Head().compare_exchange_weak(head, channel,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+        break;
+      }
+    }
+
+    auto write_cb = [](Data& data, Channel* channel) {
+      channel->Write(data);
+      return true;
+    };
+
+    Message::Topic<Data>(topic).RegisterCallback(write_cb, channel);
+
+    channel_ = channel;
+    return true;
+  }
+
+  const char* name_;
+  Channel* channel_ = NULL;
+  uint32_t version_ = 0;
+};
+}  // namespace System
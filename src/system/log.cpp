@@ -0,0 +1,337 @@
+#include <log.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+#include "bsp_def.h"
+
+using namespace System;
+
+/* 与OneMessage的日志颜色设置一致 */
+#if OM_LOG_COLORFUL
+static const bool LOG_COLORFUL = true;
+#else
+static const bool LOG_COLORFUL = false;
+#endif
+
+/* 按等级编号索引 */
+static const char* const LOG_COLOR[] = {
+    "", "", "\033[34m", "\033[32m", "\033[33m", "\033[31m",
+};
+
+Log::Log() : cmd_(this, Command, "log") {
+  /* Term已经设置了输出，在这里申请以免初始化完成后再申请内存 */
+  if (packet_fun_ != NULL) {
+    packet_ = new Packet;
+  }
+
+  auto drain_thread_fn = [](Log* log) {
+    XB_UNUSED(log);
+    while (true) {
+      Drain();
+      Thread::Sleep(SYSTEM_LOG_DRAIN_CYCLE);
+    }
+  };
+
+  this->thread_.Create(drain_thread_fn, this, "log_drain",
+                       SYSTEM_LOG_STACK_DEPTH, Thread::LOW);
+}
+
+bool Log::Read(Record& rec) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  uint32_t header =
+      ring_[tail & (RING_WORDS - 1)].load(std::memory_order_acquire);
+
+  /* 预留了空间但还没有写完的日志会挡住后面的日志，下次再取 */
+  if (!(header & READY)) {
+    return false;
+  }
+
+  uint32_t words = (header >> 16) & 0xff;
+  uint32_t buff[HEADER_WORDS + LOG_ARG_MAX_SIZE / 4];
+
+  /* 全部清零，之后这里作为头读取时不会把旧数据当作READY */
+  for (uint32_t i = 0; i < words; i++) {
+    std::atomic<uint32_t>& word = ring_[(tail + i) & (RING_WORDS - 1)];
+    buff[i] = word.load(std::memory_order_relaxed);
+    word.store(0, std::memory_order_relaxed);
+  }
+  tail_.store(tail + words, std::memory_order_release);
+
+  memcpy(rec.data, buff + HEADER_WORDS, (words - HEADER_WORDS) * 4);
+  rec.time = buff[1] | static_cast<uint64_t>(buff[2]) << 32;
+  rec.format = formats_[header & 0xffff];
+  rec.size = (words - HEADER_WORDS) * 4;
+
+  return true;
+}
+
+size_t Log::Print(const Record& rec, char* buff, size_t size) {
+  const Format* format = rec.format;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(rec.data);
+  const char* sig = format->sig_;
+  size_t offset = 0;
+  /* 末尾留给颜色复位和换行 */
+  size_t limit = size - 8;
+
+  int ret = snprintf(buff, limit, "%s%-.4f ",
+                     LOG_COLORFUL ? LOG_COLOR[format->level_] : "",
+                     static_cast<double>(rec.time) / 1000000.0);
+  size_t len = ret > 0 ? static_cast<size_t>(ret) : 0;
+
+  /* 逐个转换说明符格式化，长度修饰按记录的参数类型重新生成 */
+  const char* pos = format->fmt_;
+  while (*pos != '\0' && len + 1 < limit) {
+    if (*pos != '%' || pos[1] == '%') {
+      buff[len++] = *pos;
+      pos += *pos == '%' ? 2 : 1;
+      continue;
+    }
+
+    char spec[16];
+    size_t spec_len = 0;
+    spec[spec_len++] = *pos++;
+    while (*pos != '\0' && strchr("-+ #0123456789.", *pos) != NULL &&
+           spec_len < sizeof(spec) - 4) {
+      spec[spec_len++] = *pos++;
+    }
+    while (*pos != '\0' && strchr("hlLqjzt", *pos) != NULL) {
+      pos++;
+    }
+    if (*pos == '\0') {
+      break;
+    }
+
+    char tag = *sig != '\0' ? *sig++ : '\0';
+    if (tag == 'I' || tag == 'U') {
+      spec[spec_len++] = 'l';
+      spec[spec_len++] = 'l';
+    }
+    spec[spec_len++] = *pos++;
+    spec[spec_len] = '\0';
+
+    uint8_t raw[LOG_STR_MAX_LEN + 2] = {};
+    size_t raw_size = 0;
+    switch (tag) {
+      case 'i':
+      case 'u':
+      case 'f':
+        raw_size = 4;
+        break;
+      case 'I':
+      case 'U':
+      case 'd':
+      case 'p':
+        raw_size = 8;
+        break;
+      case 's':
+        if (offset < rec.size && data[offset] <= LOG_STR_MAX_LEN) {
+          raw_size = data[offset] + 1u;
+        }
+        break;
+      default:
+        break;
+    }
+
+    /* 参数缺失或被截断 */
+    if (raw_size == 0 || offset + raw_size > rec.size) {
+      ret = snprintf(buff + len, limit - len, "?");
+      tag = '\0';
+    } else {
+      memcpy(raw, data + offset, raw_size);
+      offset += raw_size;
+    }
+
+    char* out = buff + len;
+    size_t out_size = limit - len;
+    switch (tag) {
+      case 'i': {
+        int32_t value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec, static_cast<int>(value));
+      } break;
+      case 'u': {
+        uint32_t value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec, static_cast<unsigned int>(value));
+      } break;
+      case 'I': {
+        int64_t value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec, static_cast<long long>(value));
+      } break;
+      case 'U': {
+        uint64_t value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec,
+                       static_cast<unsigned long long>(value));
+      } break;
+      case 'f': {
+        float value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec, static_cast<double>(value));
+      } break;
+      case 'd': {
+        double value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec, value);
+      } break;
+      case 'p': {
+        uint64_t value;
+        memcpy(&value, raw, sizeof(value));
+        ret = snprintf(out, out_size, spec,
+                       reinterpret_cast<void*>(static_cast<uintptr_t>(value)));
+      } break;
+      case 's':
+        raw[raw_size] = '\0';
+        ret = snprintf(out, out_size, spec, reinterpret_cast<char*>(raw + 1));
+        break;
+      default:
+        break;
+    }
+
+    /* snprintf返回的是完整长度，截断时只计入写入的部分 */
+    if (ret > 0) {
+      size_t written = static_cast<size_t>(ret);
+      len += written < limit - len ? written : limit - len - 1;
+    }
+  }
+
+  len += snprintf(buff + len, size - len, "%s\r\n",
+                  LOG_COLORFUL ? "\033[0m" : "");
+  return len;
+}
+
+void Log::Drain() {
+  static Record rec;
+  static char text[LOG_TEXT_MAX_LEN];
+  static uint32_t last_dropped = 0;
+  Packet* packet = packet_;
+
+  if (packet != NULL && resend_.exchange(false, std::memory_order_relaxed)) {
+    packet->Resend();
+  }
+
+  uint32_t used = head_.load(std::memory_order_relaxed) -
+                  tail_.load(std::memory_order_relaxed);
+  if (used > peak_) {
+    peak_ = used;
+  }
+
+  while (Read(rec)) {
+    if (text_fun_ != NULL) {
+      text_fun_(text, Print(rec, text, sizeof(text)));
+    }
+
+    /* 放不进空包的日志直接丢弃 */
+    if (packet != NULL && !packet->Add(rec) && !packet->Empty()) {
+      packet_fun_(packet->Data(), packet->Size());
+      packet->Clear();
+      packet->Add(rec);
+    }
+  }
+
+  if (packet != NULL && !packet->Empty()) {
+    packet_fun_(packet->Data(), packet->Size());
+    packet->Clear();
+  }
+
+  uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped != last_dropped && text_fun_ != NULL) {
+    int len = snprintf(text, sizeof(text), "log: %u messages dropped\r\n",
+                       static_cast<unsigned int>(dropped - last_dropped));
+    text_fun_(text, static_cast<size_t>(len));
+  }
+  last_dropped = dropped;
+}
+
+void Log::Packet::Clear() {
+  this->size_ = HEADER_SIZE;
+  this->count_ = 0;
+  this->seq_++;
+}
+
+uint8_t* Log::Packet::Entry(uint16_t id, size_t len) {
+  uint8_t* entry = this->buff_ + this->size_;
+  uint16_t size = static_cast<uint16_t>(len);
+  memcpy(entry, &id, sizeof(id));
+  memcpy(entry + 2, &size, sizeof(size));
+  this->size_ += ENTRY_SIZE + len;
+  this->count_++;
+  return entry + ENTRY_SIZE;
+}
+
+/* 条目为id、长度和数据，id为0时是格式字符串的定义：
+ * 编号、等级、参数类型和格式字符串，后两者以'\0'结尾 */
+bool Log::Packet::Add(const Record& rec) {
+  const Format* format = rec.format;
+  uint16_t id = format->id_.load(std::memory_order_relaxed);
+  size_t sig_len = strlen(format->sig_) + 1;
+  size_t fmt_len = strlen(format->fmt_) + 1;
+  size_t def_len = sent_[id] ? 0 : ENTRY_SIZE + 3 + sig_len + fmt_len;
+  size_t log_len = sizeof(rec.time) + rec.size;
+
+  if (this->size_ + def_len + ENTRY_SIZE + log_len > LOG_PACKET_SIZE) {
+    return false;
+  }
+
+  if (def_len != 0) {
+    uint8_t* data = this->Entry(0, def_len - ENTRY_SIZE);
+    memcpy(data, &id, sizeof(id));
+    data[2] = format->level_;
+    memcpy(data + 3, format->sig_, sig_len);
+    memcpy(data + 3 + sig_len, format->fmt_, fmt_len);
+    this->sent_[id] = true;
+  }
+
+  uint8_t* data = this->Entry(id, log_len);
+  memcpy(data, &rec.time, sizeof(rec.time));
+  memcpy(data + sizeof(rec.time), rec.data, rec.size);
+
+  return true;
+}
+
+/* 包头为magic、序号、条目数和累计丢弃数 */
+const uint8_t* Log::Packet::Data() {
+  uint32_t magic = LOG_PACKET_MAGIC;
+  uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+  memcpy(this->buff_, &magic, sizeof(magic));
+  memcpy(this->buff_ + 4, &this->seq_, sizeof(this->seq_));
+  memcpy(this->buff_ + 6, &this->count_, sizeof(this->count_));
+  memcpy(this->buff_ + 8, &dropped, sizeof(dropped));
+  return this->buff_;
+}
+
+int Log::Command(Log* log, int argc, char** argv) {
+  XB_UNUSED(log);
+
+  uint32_t format_num = format_num_.load(std::memory_order_relaxed);
+  if (format_num > LOG_FORMAT_NUM) {
+    format_num = LOG_FORMAT_NUM;
+  }
+
+  if (argc == 1) {
+    printf("%u formats, %u written, %u dropped, peak %u/%u bytes\r\n",
+           static_cast<unsigned int>(format_num),
+           static_cast<unsigned int>(written_.load()),
+           static_cast<unsigned int>(dropped_.load()),
+           static_cast<unsigned int>(peak_ * 4),
+           static_cast<unsigned int>(SYSTEM_LOG_RING_SIZE));
+  } else if (argc == 2 && strcmp(argv[1], "formats") == 0) {
+    for (uint32_t i = 1; i <= format_num; i++) {
+      const Format* format = formats_[i];
+      /* 登记中的格式还没有写入 */
+      if (format == NULL) {
+        continue;
+      }
+      printf("%3u %u %-6s %s\r\n", static_cast<unsigned int>(i),
+             static_cast<unsigned int>(format->level_), format->sig_,
+             format->fmt_);
+    }
+  } else {
+    printf("log            show deferred log statistics.\r\n");
+    printf("log formats    list format strings, id level args format.\r\n");
+  }
+
+  return 0;
+}
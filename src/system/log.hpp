@@ -0,0 +1,331 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <term.hpp>
+#include <thread.hpp>
+#include <type_traits>
+
+#include "bsp_def.h"
+#include "bsp_time.h"
+#include "om.hpp"
+
+/* 环形缓冲区大小，单位字节，必须是2的幂，开启SYSTEM_LOG_DEFERRED时才使用 */
+#ifndef SYSTEM_LOG_RING_SIZE
+#define SYSTEM_LOG_RING_SIZE (2048)
+#endif
+/* 取出日志并格式化的周期，单位ms */
+#ifndef SYSTEM_LOG_DRAIN_CYCLE
+#define SYSTEM_LOG_DRAIN_CYCLE (10)
+#endif
+#ifndef SYSTEM_LOG_STACK_DEPTH
+#define SYSTEM_LOG_STACK_DEPTH (512)
+#endif
+/* 单条日志参数的最大字节数 */
+#define LOG_ARG_MAX_SIZE (48)
+/* 字符串参数最多保存的字符数 */
+#define LOG_STR_MAX_LEN (23)
+/* 最多登记的格式字符串数 */
+#define LOG_FORMAT_NUM (128)
+/* 格式化后一条日志的最大长度 */
+#define LOG_TEXT_MAX_LEN (160)
+/* 批量发送的数据包大小，小于以太网MTU */
+#define LOG_PACKET_SIZE (1024)
+/* 数据包头，小端序的"XLOG" */
+#define LOG_PACKET_MAGIC (0x474f4c58)
+/* 低于这个等级的日志在编译时去掉，与OneMessage一致 */
+#ifdef OM_LOG_LEVEL
+#define LOG_LEVEL OM_LOG_LEVEL
+#else
+#define LOG_LEVEL (1)
+#endif
+
+namespace System {
+/* 二进制延迟日志。调用点只把格式字符串编号、时间戳和原始参数
+ * 写入无锁环形缓冲区，可以在控制线程和中断中使用。
+ * 低优先级的drain线程周期性取出，在设备上格式化后输出到终端，
+ * 或者打包成数据报，由utils/python/log_decode.py在主机上格式化。
+ * 缓冲区满时丢弃新日志并计数，不会阻塞调用者 */
+class Log {
+ public:
+  /* 与OM_LOG_LEVEL的编号一致 */
+  typedef enum : uint8_t {
+    DEFAULT = 1,
+    NOTICE,
+    PASS,
+    WARNING,
+    ERROR,
+  } Level;
+
+  /* 每个调用点一个静态对象，常量初始化，第一次写入时登记编号 */
+  class Format {
+   public:
+    constexpr Format(const char* fmt, uint8_t level)
+        : fmt_(fmt), level_(level) {}
+
+    const char* fmt_;
+    const char* sig_ = NULL; /* 每个参数的类型，见Tag */
+    uint8_t level_;
+    std::atomic<uint16_t> id_{0};
+  };
+
+  typedef struct {
+    const Format* format;
+    uint64_t time; /* 单位us */
+    uint32_t size; /* data的字节数，按4字节对齐 */
+    uint32_t data[LOG_ARG_MAX_SIZE / 4];
+  } Record;
+
+  /* 打包成数据报，第一次出现的格式字符串随日志一起发送 */
+  class Packet {
+   public:
+    Packet() { this->Clear(); }
+
+    /* 放不下时返回false，发送后清空再添加 */
+    bool Add(const Record& rec);
+
+    /* 新的接收端连接后重新发送所有格式字符串 */
+    void Resend() { memset(this->sent_, 0, sizeof(this->sent_)); }
+
+    void Clear();
+
+    bool Empty() const { return this->count_ == 0; }
+
+    /* 填写包头后返回数据 */
+    const uint8_t* Data();
+
+    size_t Size() const { return this->size_; }
+
+   private:
+    static const size_t HEADER_SIZE = 12;
+    static const size_t ENTRY_SIZE = 4;
+
+    /* 写入条目头，返回数据位置 */
+    uint8_t* Entry(uint16_t id, size_t len);
+
+    uint8_t buff_[LOG_PACKET_SIZE];
+    size_t size_;
+    uint16_t seq_ = 0;
+    uint16_t count_;
+    bool sent_[LOG_FORMAT_NUM + 1] = {};
+  };
+
+  typedef void (*TextFun)(const char* text, size_t len);
+  typedef void (*PacketFun)(const uint8_t* data, size_t len);
+
+  Log();
+
+  /* 由各平台的Term设置，packet为NULL时只在设备上格式化 */
+  static void SetOutput(TextFun text, PacketFun packet) {
+    text_fun_ = text;
+    packet_fun_ = packet;
+  }
+
+  static void Resend() { resend_.store(true, std::memory_order_relaxed); }
+
+  template <typename... Args>
+  static void Write(Format& format, Args... args) {
+    uint16_t id = format.id_.load(std::memory_order_acquire);
+    if (id == 0 || id == BUSY) {
+      id = Register(format, Signature<Args...>::VALUE);
+      if (id == BUSY) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+
+    uint32_t buff[HEADER_WORDS + LOG_ARG_MAX_SIZE / 4];
+    uint8_t* data = reinterpret_cast<uint8_t*>(buff + HEADER_WORDS);
+    size_t size = 0;
+    (Pack(data, size, args), ...);
+    XB_UNUSED(data);
+
+    uint64_t time = bsp_time_get_us();
+    uint32_t words = HEADER_WORDS + (size + 3) / 4;
+    buff[0] = READY | words << 16 | id;
+    buff[1] = static_cast<uint32_t>(time);
+    buff[2] = static_cast<uint32_t>(time >> 32);
+
+    Push(buff, words);
+  }
+
+  /* 只能在drain线程中调用 */
+  static bool Read(Record& rec);
+
+  /* 按格式字符串输出文本，返回长度 */
+  static size_t Print(const Record& rec, char* buff, size_t size);
+
+  static void Drain();
+
+  static int Command(Log* log, int argc, char** argv);
+
+ private:
+  static const uint32_t RING_WORDS = SYSTEM_LOG_RING_SIZE / 4;
+  static const uint32_t HEADER_WORDS = 3;
+  static const uint32_t READY = 1u << 31;
+  static const uint16_t BUSY = 0xffff;
+
+  static_assert((RING_WORDS & (RING_WORDS - 1)) == 0,
+                "SYSTEM_LOG_RING_SIZE must be a power of 2");
+
+  /* i:int32 u:uint32 I:int64 U:uint64 f:float d:double s:字符串 p:指针 */
+  template <typename T>
+  static constexpr char Tag() {
+    typedef std::decay_t<T> Type;
+    if constexpr (std::is_same_v<Type, float>) {
+      return 'f';
+    } else if constexpr (std::is_floating_point_v<Type>) {
+      return 'd';
+    } else if constexpr (std::is_same_v<Type, char*> ||
+                         std::is_same_v<Type, const char*>) {
+      return 's';
+    } else if constexpr (std::is_pointer_v<Type>) {
+      return 'p';
+    } else if constexpr (std::is_enum_v<Type>) {
+      return Tag<std::underlying_type_t<Type>>();
+    } else {
+      static_assert(std::is_integral_v<Type>, "unsupported log argument");
+      if constexpr (sizeof(Type) > 4) {
+        return std::is_signed_v<Type> ? 'I' : 'U';
+      } else {
+        /* 小于int的类型在printf中提升为int */
+        return std::is_signed_v<Type> || sizeof(Type) < 4 ? 'i' : 'u';
+      }
+    }
+  }
+
+  template <typename... Args>
+  struct Signature {
+    static constexpr char VALUE[] = {Tag<Args>()..., '\0'};
+  };
+
+  template <typename T>
+  static void Pack(uint8_t* data, size_t& size, T arg) {
+    constexpr char TAG = Tag<T>();
+    if constexpr (TAG == 's') {
+      /* 长度加内容，超过剩余空间时截断 */
+      if (size >= LOG_ARG_MAX_SIZE) {
+        return;
+      }
+      size_t len = arg == NULL ? 0 : strnlen(arg, LOG_STR_MAX_LEN);
+      if (len > LOG_ARG_MAX_SIZE - size - 1) {
+        len = LOG_ARG_MAX_SIZE - size - 1;
+      }
+      data[size] = static_cast<uint8_t>(len);
+      memcpy(data + size + 1, arg, len);
+      size += len + 1;
+    } else {
+      typedef std::conditional_t<
+          TAG == 'f', float,
+          std::conditional_t<
+              TAG == 'd', double,
+              std::conditional_t<
+                  TAG == 'i', int32_t,
+                  std::conditional_t<
+                      TAG == 'u', uint32_t,
+                      std::conditional_t<TAG == 'I', int64_t, uint64_t>>>>>
+          Raw;
+      Raw raw;
+      if constexpr (TAG == 'p') {
+        raw = reinterpret_cast<uintptr_t>(arg);
+      } else {
+        raw = static_cast<Raw>(arg);
+      }
+      /* 参数过多时截断，主机上显示为缺失 */
+      if (size + sizeof(raw) > LOG_ARG_MAX_SIZE) {
+        size = LOG_ARG_MAX_SIZE;
+        return;
+      }
+      memcpy(data + size, &raw, sizeof(raw));
+      size += sizeof(raw);
+    }
+  }
+
+  /* 编号从1开始，同时登记时后来者本次丢弃 */
+  static uint16_t Register(Format& format, const char* sig) {
+    uint16_t id = 0;
+    if (!format.id_.compare_exchange_strong(id, BUSY,
+                                            std::memory_order_acq_rel)) {
+      return id;
+    }
+
+    uint32_t index = format_num_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (index > LOG_FORMAT_NUM) {
+      /* 保持BUSY，这个调用点的日志全部丢弃 */
+      return BUSY;
+    }
+
+    format.sig_ = sig;
+    formats_[index] = &format;
+    format.id_.store(static_cast<uint16_t>(index), std::memory_order_release);
+    return static_cast<uint16_t>(index);
+  }
+
+  /* 多个生产者用CAS预留空间，写完数据后最后写入带READY的头 */
+  static void Push(const uint32_t* buff, uint32_t words) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    do {
+      uint32_t used = head + words - tail_.load(std::memory_order_acquire);
+      if (used > RING_WORDS) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    } while (!head_.compare_exchange_weak(head, head + words,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+
+    for (uint32_t i = 1; i < words; i++) {
+      ring_[(head + i) & (RING_WORDS - 1)].store(buff[i],
+                                                 std::memory_order_relaxed);
+    }
+    ring_[head & (RING_WORDS - 1)].store(buff[0], std::memory_order_release);
+
+    written_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /* 常量初始化，没有用到时不会被链接 */
+  static inline std::atomic<uint32_t> ring_[RING_WORDS] = {};
+  static inline std::atomic<uint32_t> head_{0};
+  static inline std::atomic<uint32_t> tail_{0};
+
+  static inline std::atomic<uint32_t> written_{0};
+  static inline std::atomic<uint32_t> dropped_{0};
+  static inline uint32_t peak_ = 0;
+
+  static inline std::atomic<uint32_t> format_num_{0};
+  static inline Format* formats_[LOG_FORMAT_NUM + 1] = {};
+
+  static inline TextFun text_fun_ = NULL;
+  static inline PacketFun packet_fun_ = NULL;
+  static inline Packet* packet_ = NULL;
+  static inline std::atomic<bool> resend_{false};
+
+  Thread thread_;
+  Term::Command<Log*> cmd_;
+};
+}  // namespace System
+
+/* 在支持的系统上使用延迟日志，否则直接使用OneMessage的日志 */
+#ifdef SYSTEM_LOG_DEFERRED
+#define XB_LOG(_level, _format, ...)                                   \
+  do {                                                                 \
+    if ((_level) >= LOG_LEVEL) {                                       \
+      static System::Log::Format xb_log_format_(_format, _level);      \
+      XB_UNUSED(sizeof(printf(_format, ##__VA_ARGS__)));               \
+      System::Log::Write(xb_log_format_, ##__VA_ARGS__);               \
+    }                                                                  \
+  } while (0)
+
+#define XB_LOG_NOTICE(...) XB_LOG(System::Log::NOTICE, __VA_ARGS__)
+#define XB_LOG_PASS(...) XB_LOG(System::Log::PASS, __VA_ARGS__)
+#define XB_LOG_WARNING(...) XB_LOG(System::Log::WARNING, __VA_ARGS__)
+#define XB_LOG_ERROR(...) XB_LOG(System::Log::ERROR, __VA_ARGS__)
+#else
+#define XB_LOG_NOTICE(...) OMLOG_NOTICE(__VA_ARGS__)
+#define XB_LOG_PASS(...) OMLOG_PASS(__VA_ARGS__)
+#define XB_LOG_WARNING(...) OMLOG_WARNING(__VA_ARGS__)
+#define XB_LOG_ERROR(...) OMLOG_ERROR(__VA_ARGS__)
+#endif
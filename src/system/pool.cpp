@@ -0,0 +1,51 @@
+#include <pool.hpp>
+
+#include <cstdio>
+
+using namespace System;
+
+Pool::Pool() : cmd_(this, Command, "pool") {}
+
+int Pool::Command(Pool* pool, int argc, char** argv) {
+  XB_UNUSED(pool);
+  XB_UNUSED(argv);
+
+  if (argc != 1) {
+    printf("pool    show size class usage and backend allocations.\r\n");
+    return 0;
+  }
+
+  printf("%u bytes, %u/%u pages, backend %u, fallback %u%s\r\n",
+         static_cast<unsigned int>(SYSTEM_POOL_SIZE),
+         static_cast<unsigned int>(page_num_.load()),
+         static_cast<unsigned int>(PAGE_NUM),
+         static_cast<unsigned int>(backend_.load()),
+         static_cast<unsigned int>(fallback_.load()),
+         frozen_.load() ? ", frozen" : "");
+
+  if (failed_.load()) {
+    printf("ERR:failed to allocate pool from backend.\r\n");
+  }
+
+  if (violation_.load()) {
+    printf("ERR:%u allocations after freeze.\r\n",
+           static_cast<unsigned int>(violation_.load()));
+  }
+
+  /* free为已切分但空闲的块，反映等级内部的碎片 */
+  printf("size\tpage\tused\tpeak\tfree\ttotal\r\n");
+  for (uint32_t i = 0; i < CLASS_NUM; i++) {
+    Class& cls = class_[i];
+    uint32_t capacity =
+        cls.page.load() * (SYSTEM_POOL_PAGE_SIZE / CLASS_SIZE[i]);
+    printf("%u\t%u\t%u\t%u\t%u\t%u\r\n",
+           static_cast<unsigned int>(CLASS_SIZE[i]),
+           static_cast<unsigned int>(cls.page.load()),
+           static_cast<unsigned int>(cls.used.load()),
+           static_cast<unsigned int>(cls.peak.load()),
+           static_cast<unsigned int>(capacity - cls.used.load()),
+           static_cast<unsigned int>(cls.total.load()));
+  }
+
+  return 0;
+}
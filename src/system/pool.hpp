@@ -0,0 +1,246 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <term.hpp>
+#include <type_traits>
+
+#include "bsp_def.h"
+
+/* 小块内存池的总大小，从后端一次申请，为0时全部交给后端。
+ * 大小由各板子的配置决定，默认不使用 */
+#ifndef SYSTEM_POOL_SIZE
+#define SYSTEM_POOL_SIZE (0)
+#endif
+/* 定义SYSTEM_POOL_FREEZE时初始化完成后禁止申请内存 */
+/* 内存池按页分给各个大小等级，页大小不小于最大的块 */
+#define SYSTEM_POOL_PAGE_SIZE (256)
+#define SYSTEM_POOL_ALIGN (8)
+
+namespace System {
+/* 按大小等级划分的小块内存池，作为System::Memory和operator new的前端。
+ * 每个等级是一个无锁栈，申请和释放都是一次CAS；空了以后从池中取一页切分，
+ * 页不归还，释放时按地址所在的页找到等级。超过最大等级或池用完时交给后端，
+ * 后端由各平台的memory.cpp实现 */
+class Pool {
+ public:
+  /* 栈顶为块编号加版本号，防止ABA，32位平台池最大512KB */
+  typedef std::conditional<sizeof(void*) == 8, uint64_t, uint32_t>::type Word;
+
+  static const uint32_t INDEX_BITS = sizeof(Word) * 4;
+  static const Word INDEX_MASK = (static_cast<Word>(1) << INDEX_BITS) - 1;
+
+  static const uint32_t CLASS_NUM = 8;
+
+  static constexpr uint16_t CLASS_SIZE[CLASS_NUM] = {8,  16, 24,  32,
+                                                     48, 64, 128, 256};
+
+  static const uint32_t PAGE_NUM = SYSTEM_POOL_SIZE / SYSTEM_POOL_PAGE_SIZE;
+
+  static_assert(SYSTEM_POOL_PAGE_SIZE >= 256, "page smaller than block");
+  static_assert(sizeof(Word) == 8 || SYSTEM_POOL_SIZE / SYSTEM_POOL_ALIGN <
+                                         (static_cast<uint32_t>(1) << 16),
+                "pool too large");
+
+  typedef struct {
+    std::atomic<Word> head;
+    std::atomic<uint32_t> page;  /* 已分到的页数 */
+    std::atomic<uint32_t> used;  /* 正在使用的块数 */
+    std::atomic<uint32_t> peak;  /* 使用块数的最大值 */
+    std::atomic<uint32_t> total; /* 累计申请次数 */
+  } Class;
+
+  Pool();
+
+  static void* Alloc(size_t size) {
+    Check();
+
+    if (size > CLASS_SIZE[CLASS_NUM - 1] || !Init()) {
+      return Backend(size);
+    }
+
+    uint32_t index = ClassOf(size);
+    Class& cls = class_[index];
+
+    void* block = Pop(cls);
+    if (block == NULL) {
+      block = Grow(index);
+    }
+
+    /* 池已用完 */
+    if (block == NULL) {
+      fallback_.fetch_add(1, std::memory_order_relaxed);
+      return Backend(size);
+    }
+
+    uint32_t used = cls.used.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t peak = cls.peak.load(std::memory_order_relaxed);
+    while (used > peak && !cls.peak.compare_exchange_weak(
+                              peak, used, std::memory_order_relaxed)) {
+    }
+    cls.total.fetch_add(1, std::memory_order_relaxed);
+
+    return block;
+  }
+
+  static void Free(void* block) {
+    if (block == NULL) {
+      return;
+    }
+
+    uint8_t* base = base_.load(std::memory_order_acquire);
+    uintptr_t offset = reinterpret_cast<uintptr_t>(block) -
+                       reinterpret_cast<uintptr_t>(base);
+
+    if (base == NULL || offset >= PAGE_NUM * SYSTEM_POOL_PAGE_SIZE) {
+      BackendFree(block);
+      return;
+    }
+
+    Class& cls = class_[page_class_[offset / SYSTEM_POOL_PAGE_SIZE]];
+    Push(cls, static_cast<uint8_t*>(block), static_cast<uint8_t*>(block));
+    cls.used.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /* 之后的申请都视为错误，调试模式下停在断言处 */
+  static void Freeze() { frozen_.store(true, std::memory_order_relaxed); }
+
+  static void* BackendMalloc(size_t size);
+
+  static void BackendFree(void* block);
+
+  static int Command(Pool* pool, int argc, char** argv);
+
+ private:
+  /* 编号从1开始，0表示空 */
+  static Word IndexOf(uint8_t* block) {
+    return static_cast<Word>((block - base_.load(std::memory_order_relaxed)) /
+                             SYSTEM_POOL_ALIGN) +
+           1;
+  }
+
+  static uint8_t* BlockOf(Word word) {
+    return base_.load(std::memory_order_relaxed) +
+           ((word & INDEX_MASK) - 1) * SYSTEM_POOL_ALIGN;
+  }
+
+  /* 块中的第一个字保存下一个块的编号 */
+  static Word& Next(uint8_t* block) { return *reinterpret_cast<Word*>(block); }
+
+  static uint32_t ClassOf(size_t size) {
+    static constexpr uint8_t TABLE[33] = {0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6,
+                                          6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7,
+                                          7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7};
+    return TABLE[(size + SYSTEM_POOL_ALIGN - 1) / SYSTEM_POOL_ALIGN];
+  }
+
+  static void* Pop(Class& cls) {
+    Word head = cls.head.load(std::memory_order_acquire);
+    while (head & INDEX_MASK) {
+      uint8_t* block = BlockOf(head);
+      /* 块可能已被其他线程取走，读到的值无效时下面的CAS会失败 */
+      Word next = (head & ~INDEX_MASK) + (static_cast<Word>(1) << INDEX_BITS) +
+                  (Next(block) & INDEX_MASK);
+      if (cls.head.compare_exchange_weak(head, next,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+        return block;
+      }
+    }
+    return NULL;
+  }
+
+  /* 把first到last的一串块放回栈顶 */
+  static void Push(Class& cls, uint8_t* first, uint8_t* last) {
+    Word head = cls.head.load(std::memory_order_relaxed);
+    Word next = 0;
+    do {
+      Next(last) = head & INDEX_MASK;
+      next = (head & ~INDEX_MASK) + (static_cast<Word>(1) << INDEX_BITS) +
+             IndexOf(first);
+    } while (!cls.head.compare_exchange_weak(
+        head, next, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  /* 取一页切分为块，返回第一块，其余放入栈中 */
+  static void* Grow(uint32_t index) {
+    uint32_t page = page_num_.load(std::memory_order_relaxed);
+    do {
+      if (page >= PAGE_NUM) {
+        return NULL;
+      }
+    } while (!page_num_.compare_exchange_weak(page, page + 1,
+                                              std::memory_order_relaxed));
+
+    page_class_[page] = static_cast<uint8_t>(index);
+    class_[index].page.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t size = CLASS_SIZE[index];
+    uint32_t num = SYSTEM_POOL_PAGE_SIZE / size;
+    uint8_t* block = base_.load(std::memory_order_relaxed) +
+                     page * SYSTEM_POOL_PAGE_SIZE;
+
+    if (num > 1) {
+      for (uint32_t i = 1; i < num - 1; i++) {
+        Next(block + i * size) = IndexOf(block + (i + 1) * size);
+      }
+      Push(class_[index], block + size, block + (num - 1) * size);
+    }
+
+    return block;
+  }
+
+  static bool Init() {
+    if (SYSTEM_POOL_SIZE == 0 || failed_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+
+    if (base_.load(std::memory_order_acquire) != NULL) {
+      return true;
+    }
+
+    /* 多个线程同时初始化时只保留一个 */
+    auto base = static_cast<uint8_t*>(BackendMalloc(SYSTEM_POOL_SIZE));
+    uint8_t* expected = NULL;
+    if (base != NULL &&
+        !base_.compare_exchange_strong(expected, base,
+                                       std::memory_order_acq_rel)) {
+      BackendFree(base);
+    }
+
+    if (base_.load(std::memory_order_acquire) != NULL) {
+      return true;
+    }
+
+    /* 申请失败后不再重试，之后全部交给后端 */
+    failed_.store(true, std::memory_order_relaxed);
+    return false;
+  }
+
+  static void Check() {
+    if (frozen_.load(std::memory_order_relaxed)) {
+      violation_.fetch_add(1, std::memory_order_relaxed);
+      XB_ASSERT(false);
+    }
+  }
+
+  static void* Backend(size_t size) {
+    backend_.fetch_add(1, std::memory_order_relaxed);
+    return BackendMalloc(size);
+  }
+
+  static inline std::atomic<uint8_t*> base_{NULL};
+  static inline std::atomic<bool> failed_{false};
+  static inline std::atomic<uint32_t> page_num_{0};
+  static inline uint8_t page_class_[PAGE_NUM ? PAGE_NUM : 1];
+  static inline Class class_[CLASS_NUM];
+
+  static inline std::atomic<bool> frozen_{false};
+  static inline std::atomic<uint32_t> violation_{0};
+  static inline std::atomic<uint32_t> backend_{0};
+  static inline std::atomic<uint32_t> fallback_{0};
+
+  Term::Command<Pool*> cmd_;
+};
+}  // namespace System
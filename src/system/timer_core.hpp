@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory.hpp>
+#include <mutex.hpp>
+#include <queue.hpp>
+#include <semaphore.hpp>
+#include <term.hpp>
+#include <thread.hpp>
+
+#include "bsp_time.h"
+#include "system_ext.hpp"
+#include "timer_wheel.hpp"
+
+/* 时间轮tick周期，单位us，默认与原来的1ms一致。
+ * 周期以ms为单位，需要更细的分辨率时在系统的timer.hpp中改小 */
+#ifndef TIMER_TICK_US
+#define TIMER_TICK_US (1000)
+#endif
+/* 回调执行超过此时间后转入分发线程池，单位us */
+#ifndef TIMER_LONG_CALLBACK_US
+#define TIMER_LONG_CALLBACK_US (1000)
+#endif
+/* 分发线程数量 */
+#ifndef TIMER_DISPATCH_THREAD_NUM
+#define TIMER_DISPATCH_THREAD_NUM (2)
+#endif
+/* 分发队列长度 */
+#ifndef TIMER_DISPATCH_QUEUE_LEN
+#define TIMER_DISPATCH_QUEUE_LEN (16)
+#endif
+
+namespace System {
+/* 各系统共用的定时器管理，tick线程由各系统的Timer提供。
+ * 回调不能阻塞，执行时间过长的回调转入分发线程，分发线程为所有定时器共用 */
+class TimerCore {
+ public:
+  typedef struct ControlBlock {
+    TimerWheel::Node node;
+    struct ControlBlock* next;
+    struct ControlBlock* ready; /* 本tick待执行的回调 */
+    void* type;
+    void (*fun)(void*);
+    uint32_t cycle;
+    bool running;
+    bool dispatch;
+    std::atomic<bool> busy; /* 回调等待执行或正在执行 */
+    uint64_t scheduled;
+    uint32_t count;
+    uint32_t overrun;
+    uint32_t jitter_last;
+    uint32_t jitter_max;
+    uint64_t jitter_sum;
+  } ControlBlock;
+
+  typedef ControlBlock* TimerHandle;
+
+  explicit TimerCore(uint32_t stack_depth)
+      : dispatch_queue_(TIMER_DISPATCH_QUEUE_LEN),
+        dispatch_sem_(0),
+        cmd_(this, ShowInfo, "timer") {
+    self_ = this;
+
+    auto dispatch_fn = [](TimerCore* core) {
+      ControlBlock* block = NULL;
+
+      while (1) {
+        core->dispatch_sem_.Wait(UINT32_MAX);
+        if (core->dispatch_queue_.Receive(block)) {
+          Run(block);
+          block->busy.store(false, std::memory_order_release);
+        }
+      }
+    };
+
+    for (auto& thread : this->dispatch_thread_) {
+      thread.Create(dispatch_fn, this, "timer_dispatch", stack_depth,
+                    Thread::MEDIUM);
+    }
+  }
+
+  template <typename FunType, typename ArgType>
+  static TimerHandle Create(FunType fun, ArgType arg, uint32_t cycle) {
+    (void)static_cast<void (*)(ArgType)>(fun);
+    TypeErasure<void, ArgType>* type = static_cast<TypeErasure<void, ArgType>*>(
+        System::Memory::Malloc(sizeof(TypeErasure<void, ArgType>)));
+    *type = TypeErasure<void, ArgType>(fun, arg);
+    auto block = new ControlBlock();
+    block->cycle = cycle;
+    block->fun = type->Port;
+    block->type = type;
+    block->running = true;
+    self_->Add(block);
+    return block;
+  }
+
+  static void Delete(TimerHandle& handle);
+
+  static void Start(TimerHandle& handle) { handle->running = true; }
+
+  static void Stop(TimerHandle& handle) { handle->running = false; }
+
+  static void SetCycle(TimerHandle& timer, uint32_t cycle) {
+    timer->cycle = cycle;
+  }
+
+  /* 周期为0时与原来一样每个tick运行一次 */
+  static uint64_t Ticks(uint32_t cycle) {
+    uint64_t ticks = static_cast<uint64_t>(cycle) * 1000 / TIMER_TICK_US;
+    return ticks ? ticks : 1;
+  }
+
+  /* 推进一个tick，由各系统的tick线程调用 */
+  void Refresh();
+
+  static inline TimerCore* self_ = NULL;
+
+ protected:
+  void Add(ControlBlock* block);
+
+  static void Run(ControlBlock* block);
+
+  static int ShowInfo(TimerCore* core, int argc, char** argv);
+
+  TimerWheel wheel_;
+  ControlBlock* list_ = NULL;
+  Mutex mutex_;
+  uint64_t start_time_ = 0;
+  Queue<ControlBlock*> dispatch_queue_;
+  Semaphore dispatch_sem_;
+  std::array<Thread, TIMER_DISPATCH_THREAD_NUM> dispatch_thread_;
+  Term::Command<TimerCore*> cmd_;
+};
+
+inline void TimerCore::Add(ControlBlock* block) {
+  mutex_.Lock();
+
+  block->node.expires = wheel_.Now() + Ticks(block->cycle);
+  wheel_.Add(&block->node);
+
+  ControlBlock** tail = &list_;
+  while (*tail) {
+    tail = &(*tail)->next;
+  }
+  *tail = block;
+
+  mutex_.Unlock();
+}
+
+inline void TimerCore::Delete(TimerHandle& handle) {
+  self_->mutex_.Lock();
+
+  TimerWheel::Remove(&handle->node);
+
+  for (ControlBlock** block = &self_->list_; *block; block = &(*block)->next) {
+    if (*block == handle) {
+      *block = handle->next;
+      break;
+    }
+  }
+
+  self_->mutex_.Unlock();
+
+  /* 等待tick线程或分发线程中的回调执行完毕 */
+  while (handle->busy.load(std::memory_order_acquire)) {
+    Thread::Sleep(1);
+  }
+
+  Memory::Free(handle->type);
+  delete (handle);
+  handle = NULL;
+}
+
+/* 回调在释放锁之后执行，回调中可以创建、启停定时器 */
+inline void TimerCore::Refresh() {
+  TimerWheel::Link expired;
+  ControlBlock* ready = NULL;
+  ControlBlock** ready_tail = &ready;
+
+  mutex_.Lock();
+
+  uint64_t tick = wheel_.Now();
+  uint64_t scheduled = start_time_ + tick * TIMER_TICK_US;
+
+  wheel_.Advance(&expired);
+
+  while (!TimerWheel::Empty(&expired)) {
+    TimerWheel::Node* node = TimerWheel::Entry(expired.next);
+    TimerWheel::Remove(node);
+
+    ControlBlock* block = reinterpret_cast<ControlBlock*>(node);
+
+    /* 先重新加入时间轮，周期修改在此生效 */
+    node->expires = tick + Ticks(block->cycle);
+    wheel_.Add(node);
+
+    if (!block->running) {
+      continue;
+    }
+
+    if (block->busy.load(std::memory_order_acquire)) {
+      if (block->cycle) {
+        block->overrun++;
+      }
+      continue;
+    }
+
+    /* busy期间Delete会等待，解锁后block仍然有效 */
+    block->busy.store(true, std::memory_order_relaxed);
+    block->scheduled = scheduled;
+
+    if (block->dispatch) {
+      if (dispatch_queue_.Send(block)) {
+        dispatch_sem_.Post();
+      } else {
+        block->busy.store(false, std::memory_order_relaxed);
+        block->overrun++;
+      }
+      continue;
+    }
+
+    block->ready = NULL;
+    *ready_tail = block;
+    ready_tail = &block->ready;
+  }
+
+  mutex_.Unlock();
+
+  while (ready) {
+    ControlBlock* block = ready;
+    ready = block->ready;
+
+    uint64_t start = bsp_time_get_us();
+    Run(block);
+    if (bsp_time_get_us() - start > TIMER_LONG_CALLBACK_US) {
+      block->dispatch = true;
+    }
+    block->busy.store(false, std::memory_order_release);
+  }
+}
+
+inline void TimerCore::Run(ControlBlock* block) {
+  uint64_t start = bsp_time_get_us();
+  uint32_t jitter = start > block->scheduled
+                        ? static_cast<uint32_t>(start - block->scheduled)
+                        : 0;
+
+  block->fun(block->type);
+
+  block->count++;
+  block->jitter_last = jitter;
+  block->jitter_sum += jitter;
+  if (jitter > block->jitter_max) {
+    block->jitter_max = jitter;
+  }
+  if (block->cycle && jitter >= block->cycle * 1000) {
+    block->overrun++;
+  }
+}
+
+inline int TimerCore::ShowInfo(TimerCore* core, int argc, char** argv) {
+  XB_UNUSED(argv);
+
+  if (argc != 1) {
+    printf("timer  show cycle, overrun and jitter of all timers.\r\n");
+    return 0;
+  }
+
+  printf("tick:%dus\r\n", TIMER_TICK_US);
+  printf("%-4s%-10s%-10s%-12s%-10s%-10s%-10s%-10s\r\n", "id", "cycle(ms)",
+         "mode", "count", "overrun", "last(us)", "max(us)", "avg(us)");
+
+  core->mutex_.Lock();
+
+  unsigned int id = 0;
+  for (ControlBlock* block = core->list_; block; block = block->next, id++) {
+    uint32_t avg =
+        block->count ? static_cast<uint32_t>(block->jitter_sum / block->count)
+                     : 0;
+    printf("%-4u%-10u%-10s%-12u%-10u%-10u%-10u%-10u\r\n", id,
+           static_cast<unsigned int>(block->cycle),
+           !block->running ? "stop" : (block->dispatch ? "dispatch" : "tick"),
+           static_cast<unsigned int>(block->count),
+           static_cast<unsigned int>(block->overrun),
+           static_cast<unsigned int>(block->jitter_last),
+           static_cast<unsigned int>(block->jitter_max),
+           static_cast<unsigned int>(avg));
+  }
+
+  core->mutex_.Unlock();
+
+  return 0;
+}
+}  // namespace System
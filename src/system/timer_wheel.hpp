@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+/* 分层时间轮，插入、删除与每个tick的处理均为O(1)
+ * 第0层每格对应1个tick，第n层每格对应64^n个tick，6层共覆盖2^36个tick */
+class TimerWheel {
+ public:
+  static const uint32_t SLOT_BITS = 6;
+  static const uint32_t SLOT_NUM = 1 << SLOT_BITS;
+  static const uint32_t SLOT_MASK = SLOT_NUM - 1;
+  static const uint32_t LEVEL_NUM = 6;
+  static const uint64_t MAX_DELTA = (1ULL << (SLOT_BITS * LEVEL_NUM)) - 1;
+
+  typedef struct Link {
+    struct Link* prev;
+    struct Link* next;
+  } Link;
+
+  typedef struct {
+    Link link;
+    uint64_t expires;
+  } Node;
+
+  TimerWheel() {
+    for (auto& level : slot_) {
+      for (auto& head : level) {
+        Init(&head);
+      }
+    }
+  }
+
+  static void Init(Link* head) {
+    head->prev = head;
+    head->next = head;
+  }
+
+  static bool Empty(const Link* head) { return head->next == head; }
+
+  static bool Linked(const Node* node) { return node->link.next != NULL; }
+
+  static Node* Entry(Link* link) {
+    return reinterpret_cast<Node*>(reinterpret_cast<uint8_t*>(link) -
+                                   offsetof(Node, link));
+  }
+
+  /* 按node->expires插入，已经过期的节点在下一个tick处理 */
+  void Add(Node* node) {
+    uint64_t expires = node->expires;
+
+    if (expires < now_) {
+      expires = now_;
+    } else if (expires - now_ > MAX_DELTA) {
+      expires = now_ + MAX_DELTA;
+    }
+
+    uint64_t delta = expires - now_;
+    uint32_t level = 0;
+
+    while (level < LEVEL_NUM - 1 &&
+           delta >= (1ULL << (SLOT_BITS * (level + 1)))) {
+      level++;
+    }
+
+    Link* head = &slot_[level][(expires >> (SLOT_BITS * level)) & SLOT_MASK];
+
+    node->link.next = head;
+    node->link.prev = head->prev;
+    head->prev->next = &node->link;
+    head->prev = &node->link;
+  }
+
+  static void Remove(Node* node) {
+    if (!Linked(node)) {
+      return;
+    }
+
+    node->link.prev->next = node->link.next;
+    node->link.next->prev = node->link.prev;
+    node->link.prev = NULL;
+    node->link.next = NULL;
+  }
+
+  /* 推进一个tick，把本tick到期的节点移动到expired链表 */
+  void Advance(Link* expired) {
+    uint32_t index = now_ & SLOT_MASK;
+
+    if (index == 0) {
+      for (uint32_t level = 1; level < LEVEL_NUM; level++) {
+        uint32_t level_index = (now_ >> (SLOT_BITS * level)) & SLOT_MASK;
+        Cascade(level, level_index);
+        if (level_index != 0) {
+          break;
+        }
+      }
+    }
+
+    Move(&slot_[0][index], expired);
+
+    now_++;
+  }
+
+  uint64_t Now() const { return now_; }
+
+ private:
+  static void Move(Link* from, Link* to) {
+    Init(to);
+
+    if (Empty(from)) {
+      return;
+    }
+
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+
+    Init(from);
+  }
+
+  void Cascade(uint32_t level, uint32_t index) {
+    Link list;
+
+    Move(&slot_[level][index], &list);
+
+    while (!Empty(&list)) {
+      Node* node = Entry(list.next);
+      Remove(node);
+      Add(node);
+    }
+  }
+
+  Link slot_[LEVEL_NUM][SLOT_NUM];
+  uint64_t now_ = 0;
+};
+}  // namespace System
@@ -0,0 +1,102 @@
+#include <trace.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bsp_def.h"
+
+using namespace System;
+
+/* 由FreeRTOS的traceTASK_SWITCHED_IN和仿真执行器调用 */
+extern "C" void system_trace_task_switch(void* task) {
+  Trace::Record(Trace::THREAD_SWITCH, task);
+}
+
+extern "C" void bsp_trace_isr(bsp_trace_isr_t type, uint32_t index,
+                              bool enter) {
+  Trace::Record(enter ? Trace::ISR_BEGIN : Trace::ISR_END,
+                static_cast<uint32_t>(type), static_cast<uint16_t>(index));
+}
+
+Trace::Trace() : cmd_(this, Command, "trace") {}
+
+void Trace::Start(bool oneshot) {
+  InitCycle();
+
+  enable_.store(false);
+  oneshot_ = oneshot;
+  head_.store(0);
+  enable_.store(true);
+}
+
+void Trace::Dump() {
+  Stop();
+
+  uint32_t head = head_.load();
+  uint32_t num = head < TRACE_BUFF_NUM ? head : TRACE_BUFF_NUM;
+  /* 循环模式下最早的事件已被覆盖，从head - num开始输出 */
+  uint32_t start = oneshot_ ? 0 : head - num;
+
+  uint32_t name_num = name_num_.load();
+  if (name_num > TRACE_NAME_NUM) {
+    name_num = TRACE_NAME_NUM;
+  }
+
+  printf("trace begin %u %u %u\r\n", static_cast<unsigned int>(num),
+         static_cast<unsigned int>(head - num),
+         static_cast<unsigned int>(CYCLE_SHIFT));
+
+  for (uint32_t i = 0; i < name_num; i++) {
+    printf("trace name %08x %u %s\r\n",
+           static_cast<unsigned int>(names_[i].obj),
+           static_cast<unsigned int>(i + 1), names_[i].name);
+  }
+
+  for (uint32_t i = 0; i < num; i += TRACE_DUMP_LINE_NUM) {
+    printf("trace ev");
+    for (uint32_t j = i; j < num && j < i + TRACE_DUMP_LINE_NUM; j++) {
+      const Event& event = buff_[(start + j) & (TRACE_BUFF_NUM - 1)];
+      printf(" %08x%08x%04x%02x%02x", static_cast<unsigned int>(event.cycle),
+             static_cast<unsigned int>(event.obj),
+             static_cast<unsigned int>(event.arg),
+             static_cast<unsigned int>(event.type),
+             static_cast<unsigned int>(event.thread));
+    }
+    printf("\r\n");
+  }
+
+  printf("trace end\r\n");
+}
+
+int Trace::Command(Trace* trace, int argc, char** argv) {
+  XB_UNUSED(trace);
+
+  if (argc == 1) {
+    uint32_t head = head_.load();
+    printf("%s, %u/%u events, %u threads\r\n",
+           enable_.load() ? "running" : "stopped",
+           static_cast<unsigned int>(head < TRACE_BUFF_NUM ? head
+                                                           : TRACE_BUFF_NUM),
+           static_cast<unsigned int>(TRACE_BUFF_NUM),
+           static_cast<unsigned int>(name_num_.load()));
+  } else if (argc == 2 && strcmp(argv[1], "start") == 0) {
+    Start(false);
+  } else if (argc == 3 && strcmp(argv[1], "start") == 0 &&
+             strcmp(argv[2], "oneshot") == 0) {
+    Start(true);
+  } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+    Stop();
+  } else if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+    Dump();
+  } else {
+    printf("trace                    show trace buffer status.\r\n");
+    printf("trace start [oneshot]    start recording, oneshot stops when "
+           "full.\r\n");
+    printf("trace stop               stop recording.\r\n");
+    printf("trace dump               stop and print events for "
+           "trace2json.py.\r\n");
+  }
+
+  return 0;
+}
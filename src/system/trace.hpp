@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <term.hpp>
+
+#include "bsp_def.h"
+#include "bsp_time.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* 环形缓冲区中的事件数量，必须是2的幂，只在开启SYSTEM_TRACE时占用内存 */
+#ifndef TRACE_BUFF_NUM
+#define TRACE_BUFF_NUM (256)
+#endif
+/* 记录名称的线程数量 */
+#ifndef TRACE_NAME_NUM
+#define TRACE_NAME_NUM (32)
+#endif
+/* dump时每行输出的事件数 */
+#define TRACE_DUMP_LINE_NUM (4)
+
+namespace System {
+/* 二进制事件跟踪，记录线程切换、信号量、定时器和中断，
+ * 时间戳直接读取周期计数器，每个事件只有一次原子加和几次存储。
+ * 用trace dump输出后由utils/python/trace2json.py转换为Chrome trace格式。
+ * 未定义SYSTEM_TRACE时Record为空函数，也不链接trace.cpp和缓冲区 */
+class Trace {
+ public:
+  typedef enum : uint8_t {
+    THREAD_CREATE, /* obj为线程句柄，arg为线程编号 */
+    THREAD_SWITCH, /* obj为切换到的线程句柄 */
+    SEM_POST,      /* obj为信号量地址 */
+    SEM_WAIT,      /* obj为信号量地址 */
+    SEM_WAKE,      /* obj为信号量地址，arg为等待结果 */
+    TIMER_BEGIN,   /* obj为当前时间(us)，用于时间戳校准 */
+    TIMER_END,
+    ISR_BEGIN, /* obj为中断类型，arg为外设编号 */
+    ISR_END,
+    MARK, /* 用户自定义标记 */
+  } Type;
+
+  typedef struct {
+    uint32_t cycle; /* 周期计数器的低32位，右移CYCLE_SHIFT */
+    uint32_t obj;
+    uint16_t arg;
+    uint8_t type;
+    uint8_t thread; /* Linux上为线程编号，其他平台为0，由线程切换事件推断 */
+  } Event;
+
+  typedef struct {
+    uint32_t obj;
+    const char* name;
+  } Name;
+
+#if defined(__x86_64__) || defined(__i386__)
+  /* TSC频率在GHz级别，右移后32位约20s才回绕一次 */
+  static const uint32_t CYCLE_SHIFT = 4;
+#else
+  static const uint32_t CYCLE_SHIFT = 0;
+#endif
+
+  static uint32_t Cycle() {
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+    return *reinterpret_cast<volatile uint32_t*>(0xe0001004);
+#elif defined(__x86_64__) || defined(__i386__)
+    return static_cast<uint32_t>(__rdtsc() >> CYCLE_SHIFT);
+#elif defined(__aarch64__)
+    uint64_t cycle = 0;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cycle));
+    return static_cast<uint32_t>(cycle);
+#else
+    return static_cast<uint32_t>(bsp_time_get_us());
+#endif
+  }
+
+  /* 打开周期计数器，Cortex-M上DWT默认关闭 */
+  static void InitCycle() {
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+    *reinterpret_cast<volatile uint32_t*>(0xe000edfc) |= 1 << 24;
+    *reinterpret_cast<volatile uint32_t*>(0xe0001000) |= 1;
+#endif
+  }
+
+  static void Record(Type type, const void* obj, uint16_t arg = 0) {
+    Record(type, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(obj)), arg);
+  }
+
+#ifdef SYSTEM_TRACE
+  static void Record(Type type, uint32_t obj, uint16_t arg = 0) {
+    if (!enable_.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    uint32_t index = head_.fetch_add(1, std::memory_order_relaxed);
+
+    /* 单次模式下缓冲区写满后停止，保留开始的部分 */
+    if (oneshot_ && index >= TRACE_BUFF_NUM) {
+      enable_.store(false, std::memory_order_relaxed);
+      return;
+    }
+
+    Event& event = buff_[index & (TRACE_BUFF_NUM - 1)];
+    event.cycle = Cycle();
+    event.obj = obj;
+    event.arg = arg;
+    event.type = type;
+#if defined(__linux__)
+    event.thread = thread_;
+#else
+    event.thread = 0;
+#endif
+  }
+
+  /* 记录线程名称，返回线程编号，名称需要在整个运行期间有效 */
+  static uint8_t Thread(const void* handle, const char* name) {
+    uint32_t index = name_num_.fetch_add(1, std::memory_order_relaxed);
+    if (index < TRACE_NAME_NUM) {
+      names_[index].obj =
+          static_cast<uint32_t>(reinterpret_cast<uintptr_t>(handle));
+      names_[index].name = name;
+    }
+    Record(THREAD_CREATE, handle, static_cast<uint16_t>(index + 1));
+    return static_cast<uint8_t>(index + 1);
+  }
+#else
+  static void Record(Type type, uint32_t obj, uint16_t arg = 0) {
+    XB_UNUSED(type);
+    XB_UNUSED(obj);
+    XB_UNUSED(arg);
+  }
+
+  static uint8_t Thread(const void* handle, const char* name) {
+    XB_UNUSED(handle);
+    XB_UNUSED(name);
+    return 0;
+  }
+#endif
+
+#if defined(__linux__)
+  /* 在新线程中调用，之后该线程记录的事件都带有这个编号 */
+  static void SetThread(uint8_t thread) { thread_ = thread; }
+#endif
+
+#ifdef SYSTEM_TRACE
+  Trace();
+
+  static void Start(bool oneshot);
+
+  static void Stop() { enable_.store(false, std::memory_order_relaxed); }
+
+  static void Dump();
+
+  static int Command(Trace* trace, int argc, char** argv);
+#endif
+
+ private:
+#ifdef SYSTEM_TRACE
+  static inline std::atomic<bool> enable_{false};
+  static inline bool oneshot_ = false;
+  static inline std::atomic<uint32_t> head_{0};
+  static inline Event buff_[TRACE_BUFF_NUM];
+
+  static inline std::atomic<uint32_t> name_num_{0};
+  static inline Name names_[TRACE_NAME_NUM];
+
+  Term::Command<Trace*> cmd_;
+#endif
+
+#if defined(__linux__)
+  static inline thread_local uint8_t thread_ = 0;
+#endif
+};
+}  // namespace System
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <semaphore.hpp>
+#include <term.hpp>
+#include <thread.hpp>
+
+#include "bsp_def.h"
+#include "bsp_time.h"
+#include "om.hpp"
+
+/* 每个Trigger最多监听的话题数 */
+#define TRIGGER_INPUT_NUM (8)
+
+namespace System {
+/* 数据驱动的控制线程调度，代替固定周期的SleepUntil。
+ * 控制线程声明输入话题，所有必需的输入都更新后立即唤醒，与IMU、电机反馈的
+ * 发布相位对齐；输入没有在deadline内到齐时照常运行一次，退化为原来的周期调度。
+ * 记录从最早一个输入到达到执行器输出完成的延迟，用trigger命令查看 */
+class Trigger {
+ public:
+  typedef struct {
+    uint32_t run;     /* 运行次数 */
+    uint32_t timeout; /* 输入未到齐，超时运行的次数 */
+    uint32_t last;    /* 输入到输出的延迟，单位us */
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t num; /* 记录了延迟的次数，超时且没有任何输入时不记录 */
+  } Stat;
+
+  /* deadline为两次运行的最大间隔，单位ms。
+   * control_freq为控制器按其计算dt的频率，输入比它快时两次运行之间
+   * 至少间隔1/control_freq，为0时不限制 */
+  Trigger(const char* name, uint32_t deadline, float control_freq = 0.0f)
+      : name_(name),
+        deadline_(deadline),
+        period_(control_freq > 0.0f
+                    ? static_cast<uint32_t>(1000.0f / control_freq + 0.5f)
+                    : 0),
+        sem_(0) {
+    this->next_ = head_;
+    head_ = this;
+
+    if (cmd_ == NULL) {
+      cmd_ = new Term::Command<Trigger*>(NULL, Command, "trigger");
+    }
+  }
+
+  /* 监听话题，required为false时只记录到达时间，不等待它更新。
+   * 话题可以晚于Trigger创建，在之后的Wait中重新查找 */
+  template <typename Data>
+  void Watch(const char* topic, bool required = true) {
+    XB_ASSERT(input_num_ < TRIGGER_INPUT_NUM);
+
+    auto attach = [](Trigger* trig, uint32_t index) {
+      om_topic_t* tp = Message::Topic<Data>::Find(trig->input_[index].name);
+      if (tp == NULL) {
+        return false;
+      }
+
+      auto notify_cb = [](Data& data, Input* input) {
+        XB_UNUSED(data);
+        input->trig->Notify(input->mask);
+        return true;
+      };
+
+      Message::Topic<Data>(tp).RegisterCallback(notify_cb,
+                                                &trig->input_[index]);
+      return true;
+    };
+
+    Input& input = input_[input_num_];
+    input.name = topic;
+    input.trig = this;
+    input.mask = 1u << input_num_;
+    input.required = required;
+    input.attach = attach;
+    input_num_++;
+
+    this->Attach();
+  }
+
+  /* 在发布者的上下文中调用，可能位于中断中 */
+  void Notify(uint32_t mask) {
+    uint32_t last = fresh_.fetch_or(mask, std::memory_order_acq_rel);
+
+    if (last == 0) {
+      first_.store(static_cast<uint32_t>(bsp_time_get_us()),
+                   std::memory_order_relaxed);
+    }
+
+    uint32_t required = required_.load(std::memory_order_relaxed);
+    if ((last & required) != required &&
+        ((last | mask) & required) == required) {
+      this->sem_.Post();
+    }
+  }
+
+  /* 等待所有必需的输入更新，返回false表示超时 */
+  bool Wait() {
+    if (attached_ != (1u << input_num_) - 1) {
+      this->Attach();
+    }
+
+    uint32_t required = required_.load(std::memory_order_relaxed);
+    bool ready = true;
+
+    /* 没有可等待的输入时按deadline周期运行 */
+    while (required == 0 ||
+           (fresh_.load(std::memory_order_acquire) & required) != required) {
+      uint32_t elapsed = bsp_time_get_ms() - this->last_run_;
+      if (elapsed >= this->deadline_) {
+        ready = false;
+        break;
+      }
+      /* 信号量中可能有上一轮剩下的计数，醒来后重新检查 */
+      this->sem_.Wait(this->deadline_ - elapsed);
+    }
+
+    /* 输入到齐得比控制周期早时睡眠剩余时间，控制器的dt保持不变 */
+    uint32_t elapsed = bsp_time_get_ms() - this->last_run_;
+    if (ready && elapsed < this->period_) {
+      Thread::Sleep(this->period_ - elapsed);
+    }
+
+    this->last_run_ = bsp_time_get_ms();
+
+    /* 先清除输入再读取时间，first_属于本轮已到达的输入 */
+    this->pending_ = fresh_.exchange(0, std::memory_order_acq_rel) != 0;
+    this->input_time_ = first_.load(std::memory_order_acquire);
+
+    this->stat_.run++;
+    if (!ready) {
+      this->stat_.timeout++;
+    }
+
+    return ready;
+  }
+
+  /* 执行器输出写入后调用 */
+  void Done() {
+    if (!this->pending_) {
+      return;
+    }
+
+    uint32_t latency =
+        static_cast<uint32_t>(bsp_time_get_us()) - this->input_time_;
+
+    Stat& stat = this->stat_;
+    stat.last = latency;
+    stat.sum += latency;
+    if (stat.num == 0 || latency < stat.min) {
+      stat.min = latency;
+    }
+    if (latency > stat.max) {
+      stat.max = latency;
+    }
+    stat.num++;
+
+    this->pending_ = false;
+  }
+
+  const Stat& GetStat() const { return this->stat_; }
+
+  static int Command(Trigger* trig, int argc, char** argv) {
+    XB_UNUSED(trig);
+
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+      for (Trigger* i = head_; i != NULL; i = i->next_) {
+        memset(&i->stat_, 0, sizeof(i->stat_));
+      }
+      return 0;
+    }
+
+    if (argc != 1) {
+      printf("trigger         show input to output latency in us.\r\n");
+      printf("trigger reset   clear statistics.\r\n");
+      return 0;
+    }
+
+    printf("%-16s%10s%10s%8s%8s%8s%8s\r\n", "name", "run", "timeout", "last",
+           "min", "avg", "max");
+
+    for (Trigger* i = head_; i != NULL; i = i->next_) {
+      const Stat& stat = i->stat_;
+      printf("%-16s%10u%10u%8u%8u%8u%8u\r\n", i->name_,
+             static_cast<unsigned int>(stat.run),
+             static_cast<unsigned int>(stat.timeout),
+             static_cast<unsigned int>(stat.last),
+             static_cast<unsigned int>(stat.min),
+             static_cast<unsigned int>(stat.num ? stat.sum / stat.num : 0),
+             static_cast<unsigned int>(stat.max));
+
+      for (uint32_t j = 0; j < i->input_num_; j++) {
+        const Input& input = i->input_[j];
+        printf("  <- %s%s%s\r\n", input.name,
+               input.required ? "" : " (optional)",
+               i->attached_ & input.mask ? "" : " (missing)");
+      }
+    }
+
+    return 0;
+  }
+
+ private:
+  typedef struct Input {
+    const char* name;
+    Trigger* trig;
+    uint32_t mask;
+    bool required;
+    bool (*attach)(Trigger* trig, uint32_t index);
+  } Input;
+
+  /* 只有找到话题的必需输入才参与等待，找不到时全部按超时运行 */
+  void Attach() {
+    for (uint32_t i = 0; i < input_num_; i++) {
+      Input& input = input_[i];
+      if ((attached_ & input.mask) || !input.attach(this, i)) {
+        continue;
+      }
+
+      attached_ |= input.mask;
+      if (input.required) {
+        required_.fetch_or(input.mask, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  const char* name_;
+  uint32_t deadline_;
+  uint32_t period_;
+  Semaphore sem_;
+
+  Input input_[TRIGGER_INPUT_NUM] = {};
+  uint32_t input_num_ = 0;
+  uint32_t attached_ = 0;
+
+  std::atomic<uint32_t> required_{0};
+  std::atomic<uint32_t> fresh_{0};
+  std::atomic<uint32_t> first_{0};
+
+  uint32_t last_run_ = 0;
+  uint32_t input_time_ = 0;
+  bool pending_ = false;
+
+  Stat stat_ = {};
+
+  Trigger* next_ = NULL;
+
+  static inline Trigger* head_ = NULL;
+  static inline Term::Command<Trigger*>* cmd_ = NULL;
+};
+}  // namespace System
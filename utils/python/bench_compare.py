@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# 比较两次perf json的输出，找出中位数变慢的测试
+# 用法: bench_compare.py base.txt new.txt [--threshold 10]
+
+import argparse
+import json
+import sys
+
+
+def parse(path):
+    """终端输出中混有其他内容，只取以{开头的行"""
+    result = {}
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                item = json.loads(line)
+            except ValueError:
+                continue
+            if "bench" in item:
+                result[(item["board"], item["bench"])] = item
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="compare two perf json outputs")
+    parser.add_argument("base", help="基准结果")
+    parser.add_argument("new", help="新结果")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="中位数变慢超过此百分比时返回非0")
+    args = parser.parse_args()
+
+    base = parse(args.base)
+    new = parse(args.new)
+
+    regress = 0
+
+    print("%-10s %-16s %12s %12s %8s %12s" %
+          ("board", "bench", "base", "new", "diff", "p99"))
+
+    for key in sorted(set(base) | set(new)):
+        old_item = base.get(key, {})
+        new_item = new.get(key, {})
+
+        if "median" not in old_item or "median" not in new_item:
+            print("%-10s %-16s %s" % (key[0], key[1], "skipped or missing"))
+            continue
+
+        if old_item["unit"] != new_item["unit"]:
+            print("%-10s %-16s %s" % (key[0], key[1], "unit mismatch"))
+            continue
+
+        diff = (new_item["median"] - old_item["median"]) * 100.0 / \
+            max(old_item["median"], 1e-6)
+        mark = ""
+        if diff > args.threshold:
+            mark = " <-"
+            regress += 1
+
+        print("%-10s %-16s %12.1f %12.1f %+7.1f%% %12.1f%s" %
+              (key[0], key[1], old_item["median"], new_item["median"], diff,
+               new_item["p99"], mark))
+
+    if regress:
+        print("%d benchmarks regressed" % regress, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
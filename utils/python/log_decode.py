@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+# 接收并格式化System::Log的二进制日志，对应Linux上的TERM_LOG_UDP_SERVER
+# 用法: log_decode.py 192.168.1.10 [--port 1230] [--save log.bin]
+#       log_decode.py --load log.bin
+
+import argparse
+import re
+import socket
+import struct
+import sys
+
+MAGIC = 0x474F4C58
+HEADER = struct.Struct("<IHHI")
+ENTRY = struct.Struct("<HH")
+TIME = struct.Struct("<Q")
+DEF = struct.Struct("<HB")
+
+# 与System::Log::Tag一致
+TAG = {"i": "<i", "u": "<I", "I": "<q", "U": "<Q", "f": "<f", "d": "<d",
+       "p": "<Q"}
+
+# 与System::Log::Level和log.cpp中的颜色一致
+COLOR = {2: "\033[34m", 3: "\033[32m", 4: "\033[33m", 5: "\033[31m"}
+RESET = "\033[0m"
+
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d*)?)(hh|h|ll|l|L|q|j|z|t)?"
+                  r"([diouxXeEfFgGaAcsp%])")
+
+# 长时间收不到数据时重新发送，设备向最后一个来源发送数据报
+HELLO_TIMEOUT = 2.0
+
+
+class Decoder:
+    def __init__(self, color=True):
+        self.color = color
+        self.formats = {}
+        self.seq = None
+        self.dropped = 0
+        self.lost = 0
+
+    def feed(self, data):
+        """返回格式化后的行，不是二进制日志的数据报按文本输出"""
+        if len(data) < HEADER.size or \
+                struct.unpack_from("<I", data)[0] != MAGIC:
+            text = data.decode("utf-8", "replace").rstrip("\r\n")
+            return [text] if text else []
+
+        _, seq, count, dropped = HEADER.unpack_from(data)
+        lines = []
+
+        if self.seq is not None and seq != (self.seq + 1) & 0xFFFF:
+            lost = (seq - self.seq - 1) & 0xFFFF
+            self.lost += lost
+            lines.append("log: %d packets lost" % lost)
+        self.seq = seq
+
+        if dropped > self.dropped:
+            lines.append("log: %d messages dropped on device" %
+                         (dropped - self.dropped))
+        self.dropped = dropped
+
+        pos = HEADER.size
+        for _ in range(count):
+            if pos + ENTRY.size > len(data):
+                break
+            fmt_id, size = ENTRY.unpack_from(data, pos)
+            payload = data[pos + ENTRY.size:pos + ENTRY.size + size]
+            pos += ENTRY.size + size
+            if fmt_id == 0:
+                self.define(payload)
+            else:
+                lines.append(self.record(fmt_id, payload))
+
+        return lines
+
+    def define(self, payload):
+        fmt_id, level = DEF.unpack_from(payload)
+        sig, fmt = payload[DEF.size:].split(b"\0")[:2]
+        self.formats[fmt_id] = (level, sig.decode(), fmt.decode("utf-8",
+                                                                "replace"))
+
+    def record(self, fmt_id, payload):
+        stamp = TIME.unpack_from(payload)[0] / 1000000.0
+        if fmt_id not in self.formats:
+            return "%.4f <format %d> %s" % (stamp, fmt_id,
+                                            payload[TIME.size:].hex())
+
+        level, sig, fmt = self.formats[fmt_id]
+        text = "%.4f %s" % (stamp, format_args(fmt, sig,
+                                               payload[TIME.size:]))
+        if self.color and level in COLOR:
+            text = COLOR[level] + text + RESET
+        return text
+
+
+def unpack_args(sig, data):
+    """按参数类型取出值，数据不足时为None"""
+    values = []
+    pos = 0
+    for tag in sig:
+        if tag == "s":
+            if pos >= len(data):
+                values.append(None)
+                continue
+            size = data[pos]
+            values.append(data[pos + 1:pos + 1 + size].decode("utf-8",
+                                                              "replace"))
+            pos += 1 + size
+        else:
+            fmt = TAG[tag]
+            size = struct.calcsize(fmt)
+            if pos + size > len(data):
+                values.append(None)
+                pos = len(data)
+                continue
+            values.append(struct.unpack_from(fmt, data, pos)[0])
+            pos += size
+    return values
+
+
+def format_args(fmt, sig, data):
+    values = iter(zip(sig, unpack_args(sig, data)))
+
+    def convert(match):
+        flags, _, conv = match.groups()
+        if conv == "%":
+            return "%"
+        tag, value = next(values, (None, None))
+        if value is None:
+            return "?"
+        if conv == "p":
+            return "0x%x" % value if value else "(nil)"
+        if conv in "xXo" and tag in "iI" and value < 0:
+            value &= 0xFFFFFFFF if tag == "i" else 0xFFFFFFFFFFFFFFFF
+        if conv in "aA":
+            return float(value).hex()
+        if conv == "c":
+            return chr(value & 0xFF)
+        try:
+            return ("%" + flags + conv) % value
+        except (TypeError, ValueError):
+            return str(value)
+
+    return SPEC.sub(convert, fmt).rstrip("\r\n")
+
+
+def load(path, decoder):
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos + 2 <= len(data):
+        size = struct.unpack_from("<H", data, pos)[0]
+        for line in decoder.feed(data[pos + 2:pos + 2 + size]):
+            print(line)
+        pos += 2 + size
+
+
+def receive(host, port, decoder, save=None):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(HELLO_TIMEOUT)
+    out = open(save, "ab") if save else None
+    try:
+        while True:
+            sock.sendto(b"log", (host, port))
+            while True:
+                try:
+                    data = sock.recv(65536)
+                except socket.timeout:
+                    break
+                if out:
+                    out.write(struct.pack("<H", len(data)) + data)
+                for line in decoder.feed(data):
+                    print(line, flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+        if out:
+            out.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="deferred log decoder")
+    parser.add_argument("host", nargs="?", help="设备地址")
+    parser.add_argument("--port", type=int, default=1230,
+                        help="TERM_LOG_UDP_SERVER_PORT")
+    parser.add_argument("--save", help="同时保存收到的数据报")
+    parser.add_argument("--load", help="解码保存的数据报，不连接设备")
+    parser.add_argument("--no-color", action="store_true",
+                        help="不按日志等级输出颜色")
+    args = parser.parse_args()
+
+    decoder = Decoder(color=not args.no_color and sys.stdout.isatty())
+
+    if args.load:
+        load(args.load, decoder)
+    elif args.host:
+        receive(args.host, args.port, decoder, args.save)
+    else:
+        parser.error("host is required without --load")
+
+    if decoder.lost:
+        print("log: %d packets lost in total" % decoder.lost,
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# 把终端中trace dump的输出转换为Chrome/Perfetto可以打开的trace json
+# 用法: trace2json.py log.txt -o trace.json [--freq MHz]
+
+import argparse
+import json
+import struct
+import sys
+
+EVENT_TYPE = [
+    "THREAD_CREATE",
+    "THREAD_SWITCH",
+    "SEM_POST",
+    "SEM_WAIT",
+    "SEM_WAKE",
+    "TIMER_BEGIN",
+    "TIMER_END",
+    "ISR_BEGIN",
+    "ISR_END",
+    "MARK",
+]
+
+ISR_NAME = ["CAN", "UART"]
+
+# 中断单独显示在这些tid上，避开线程编号
+ISR_TID_BASE = 1000
+
+
+def parse(lines):
+    """返回最后一段完整的dump"""
+    block = None
+    result = None
+
+    for line in lines:
+        line = line.strip()
+        if line.startswith("trace begin"):
+            item = line.split()
+            block = {"lost": int(item[3]), "shift": int(item[4]),
+                     "names": {}, "events": []}
+        elif block is None:
+            continue
+        elif line.startswith("trace name"):
+            _, _, obj, index, name = line.split(" ", 4)
+            block["names"][int(obj, 16)] = (int(index), name)
+        elif line.startswith("trace ev"):
+            for item in line.split()[2:]:
+                raw = bytes.fromhex(item)
+                block["events"].append(struct.unpack(">IIHBB", raw))
+        elif line.startswith("trace end"):
+            result = block
+            block = None
+
+    if result is None:
+        sys.exit("no complete trace dump found")
+
+    return result
+
+
+def unwrap(values):
+    """32位计数器展开为单调递增，允许少量乱序"""
+    out = []
+    last = None
+    total = 0
+    for value in values:
+        if last is not None:
+            delta = (value - last) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            total += delta
+        else:
+            total = value
+        last = value
+        out.append(total)
+    return out
+
+
+class Clock:
+    """用TIMER_BEGIN中记录的us时间分段线性换算周期计数"""
+
+    def __init__(self, cycles, sync, freq):
+        self.points = sync
+        self.freq = freq
+        if len(sync) < 2 and freq is None:
+            print("warning: no sync points, use --freq", file=sys.stderr)
+            self.freq = 1.0
+        self.base = cycles[0] if cycles else 0
+
+    def us(self, cycle):
+        if len(self.points) < 2:
+            return (cycle - self.base) / self.freq
+
+        points = self.points
+        lo, hi = 0, len(points) - 1
+        if cycle <= points[0][0]:
+            hi = 1
+        elif cycle >= points[-1][0]:
+            lo = hi - 1
+        else:
+            while hi - lo > 1:
+                mid = (lo + hi) // 2
+                if points[mid][0] <= cycle:
+                    lo = mid
+                else:
+                    hi = mid
+
+        (c0, t0), (c1, t1) = points[lo], points[hi]
+        if c1 == c0:
+            return t0
+        return t0 + (cycle - c0) * (t1 - t0) / (c1 - c0)
+
+
+def convert(dump, freq):
+    names = dump["names"]
+    events = dump["events"]
+
+    cycles = unwrap([ev[0] for ev in events])
+    sync_index = [i for i, ev in enumerate(events)
+                  if ev[3] == EVENT_TYPE.index("TIMER_BEGIN")]
+    sync_us = unwrap([events[i][1] for i in sync_index])
+    sync = [(cycles[i], us) for i, us in zip(sync_index, sync_us)]
+
+    if freq is not None:
+        freq /= 1 << dump["shift"]
+
+    clock = Clock(cycles, sync, freq)
+    origin = clock.us(cycles[0]) if cycles else 0
+
+    out = []
+    tids = {}
+
+    def thread_tid(obj):
+        if obj in names:
+            index, name = names[obj]
+            tids[index] = name
+            return index
+        tids.setdefault(obj & 0xFFFFFF, "0x%08x" % obj)
+        return obj & 0xFFFFFF
+
+    current = 0
+
+    for cycle, (_, obj, arg, type_id, thread) in zip(cycles, events):
+        ts = clock.us(cycle) - origin
+        if type_id < len(EVENT_TYPE):
+            kind = EVENT_TYPE[type_id]
+        else:
+            kind = str(type_id)
+        tid = thread if thread else current
+        if thread and thread not in tids:
+            tids[thread] = next(
+                (n for i, n in names.values() if i == thread), str(thread))
+
+        base = {"pid": 1, "tid": tid, "ts": ts}
+
+        if kind == "THREAD_SWITCH":
+            if current:
+                out.append(dict(base, ph="E", name="run"))
+            current = thread_tid(obj)
+            out.append(dict(base, tid=current, ph="B", name="run"))
+        elif kind == "THREAD_CREATE":
+            out.append(dict(base, ph="i", s="t", name="create",
+                            args={"thread": arg}))
+        elif kind == "SEM_POST":
+            out.append(dict(base, ph="i", s="t", name="post 0x%08x" % obj))
+        elif kind == "SEM_WAIT":
+            out.append(dict(base, ph="B", name="wait 0x%08x" % obj))
+        elif kind == "SEM_WAKE":
+            out.append(dict(base, ph="E", args={"ok": bool(arg)}))
+        elif kind == "TIMER_BEGIN":
+            out.append(dict(base, ph="B", name="timer refresh"))
+        elif kind == "TIMER_END":
+            out.append(dict(base, ph="E"))
+        elif kind in ("ISR_BEGIN", "ISR_END"):
+            isr = ISR_NAME[obj] if obj < len(ISR_NAME) else str(obj)
+            isr_tid = ISR_TID_BASE + obj * 16 + arg
+            tids[isr_tid] = "ISR %s%d" % (isr, arg + 1)
+            out.append(dict(base, tid=isr_tid,
+                            ph="B" if kind == "ISR_BEGIN" else "E",
+                            name="%s rx" % isr))
+        else:
+            out.append(dict(base, ph="i", s="t", name=kind,
+                            args={"obj": obj, "arg": arg}))
+
+    for tid, name in tids.items():
+        out.append({"pid": 1, "tid": tid, "ph": "M", "name": "thread_name",
+                    "args": {"name": name}})
+
+    return {"traceEvents": out, "displayTimeUnit": "ns",
+            "otherData": {"lost": dump["lost"]}}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="convert trace dump to Chrome trace json")
+    parser.add_argument("input", nargs="?", help="终端输出，默认stdin")
+    parser.add_argument("-o", "--output", help="输出文件，默认stdout")
+    parser.add_argument("--freq", type=float,
+                        help="计数器频率(MHz)，没有定时器事件时使用")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, encoding="utf-8", errors="replace") as f:
+            dump = parse(f)
+    else:
+        dump = parse(sys.stdin)
+
+    trace = convert(dump, args.freq)
+
+    if dump["lost"]:
+        print("%d events lost" % dump["lost"], file=sys.stderr)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,397 @@
+#!/usr/bin/env python3
+# 流式固件升级，对应Module::UartUpdate的STREAM模式
+# 用法: uart_update.py /dev/ttyACM0 app.bin [--resume] [--jump]
+#       uart_update.py --loopback app.bin [--rate KB/s] [--flash-ms ms]
+
+import argparse
+import os
+import select
+import socket
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+import zlib
+
+MAGIC = 0x50555258
+FRAME = struct.Struct("<5I")
+
+INFO, DATA, QUERY, FINISH, JUMP = range(5)
+ACK = 0x100
+NAK = 0x200
+
+# 握手字符，与UartUpdate::STREAM一致
+STREAM_KEY = b"~"
+
+
+class UpdateError(Exception):
+    pass
+
+
+class TtyLink:
+    """USB虚拟串口，不依赖pyserial"""
+
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def read(self, size, timeout):
+        data = b""
+        deadline = time.monotonic() + timeout
+        while len(data) < size:
+            remain = deadline - time.monotonic()
+            if remain <= 0 or not select.select([self.fd], [], [], remain)[0]:
+                break
+            data += os.read(self.fd, size - len(data))
+        return data
+
+    def close(self):
+        os.close(self.fd)
+
+
+class SocketLink:
+    """回环测试用，按rate(KB/s)限制主机发送速度，模拟USB带宽"""
+
+    def __init__(self, sock, rate):
+        self.sock = sock
+        self.rate = rate * 1000.0 if rate else None
+
+    def write(self, data):
+        if self.rate:
+            time.sleep(len(data) / self.rate)
+        self.sock.sendall(data)
+
+    def read(self, size, timeout):
+        data = b""
+        deadline = time.monotonic() + timeout
+        while len(data) < size:
+            remain = deadline - time.monotonic()
+            if remain <= 0:
+                break
+            self.sock.settimeout(remain)
+            try:
+                chunk = self.sock.recv(size - len(data))
+            except socket.timeout:
+                break
+            if not chunk:
+                break
+            data += chunk
+        return data
+
+    def close(self):
+        self.sock.close()
+
+
+def frame(kind, index=0, length=0, crc=0):
+    return FRAME.pack(MAGIC, kind, index, length, crc)
+
+
+class Updater:
+    def __init__(self, link, timeout=1.0, retry=5):
+        self.link = link
+        self.timeout = timeout
+        self.retry = retry
+        self.board_id = None
+        self.block = None
+        self.window = None
+
+    def reply(self, timeout=None):
+        """返回(type, index, len, crc)，超时返回None，逐字节寻找帧头"""
+        timeout = self.timeout if timeout is None else timeout
+        raw = self.link.read(FRAME.size, timeout)
+        while len(raw) == FRAME.size and \
+                struct.unpack_from("<I", raw)[0] != MAGIC:
+            more = self.link.read(1, timeout)
+            if not more:
+                return None
+            raw = raw[1:] + more
+        if len(raw) < FRAME.size:
+            return None
+        return FRAME.unpack(raw)[1:]
+
+    def request(self, kind, index=0, length=0, crc=0, timeout=None):
+        for _ in range(self.retry):
+            self.link.write(frame(kind, index, length, crc))
+            while True:
+                ans = self.reply(timeout)
+                if ans is None:
+                    break
+                if ans[0] & 0xFF == kind and ans[1] == index:
+                    return ans
+        raise UpdateError("no reply for request %d" % kind)
+
+    def connect(self):
+        for _ in range(self.retry):
+            self.link.write(STREAM_KEY)
+            self.link.write(frame(INFO))
+            ans = self.reply()
+            if ans is not None and ans[0] == INFO | ACK:
+                _, self.board_id, self.block, self.window = ans
+                return
+        raise UpdateError("device did not enter stream mode")
+
+    def query(self, blocks):
+        """回复flash中每块的CRC32，与本地相同的块不再发送"""
+        done = set()
+        for start in range(0, len(blocks), 16):
+            batch = range(start, min(start + 16, len(blocks)))
+            for i in batch:
+                self.link.write(frame(QUERY, i, len(blocks[i])))
+            for _ in batch:
+                ans = self.reply()
+                if ans is None:
+                    raise UpdateError("query timeout")
+                kind, index, _, crc = ans
+                if kind == QUERY | ACK and \
+                        crc == zlib.crc32(blocks[index]):
+                    done.add(index)
+        return done
+
+    def send(self, blocks, window, skip=()):
+        todo = [i for i in range(len(blocks)) if i not in skip]
+        inflight = {}
+        resend = 0
+        sent = 0
+        pos = 0
+
+        while pos < len(todo) or inflight:
+            while pos < len(todo) and len(inflight) < window:
+                index = todo[pos]
+                pos += 1
+                self.send_block(blocks, index)
+                inflight[index] = 0
+                sent += len(blocks[index])
+
+            ans = self.reply()
+            if ans is None:
+                # 超时后重发最早的块，重复写入同一块没有影响
+                index = min(inflight)
+                inflight[index] += 1
+                if inflight[index] > self.retry:
+                    raise UpdateError("block %d timeout" % index)
+                self.send_block(blocks, index)
+                resend += 1
+                continue
+
+            kind, index, _, _ = ans
+            if kind == DATA | ACK and index in inflight:
+                del inflight[index]
+            elif kind == DATA | NAK and index in inflight:
+                inflight[index] += 1
+                if inflight[index] > self.retry:
+                    raise UpdateError("block %d rejected" % index)
+                self.send_block(blocks, index)
+                resend += 1
+
+        return sent, resend
+
+    def send_block(self, blocks, index):
+        data = blocks[index]
+        self.link.write(frame(DATA, index, len(data), zlib.crc32(data)) +
+                        data)
+
+    def update(self, image, window=None, resume=False, jump=False):
+        self.connect()
+        window = min(window or self.window, self.window)
+        blocks = [image[i:i + self.block]
+                  for i in range(0, len(image), self.block)]
+
+        begin = time.monotonic()
+        skip = self.query(blocks) if resume else set()
+        sent, resend = self.send(blocks, window, skip)
+
+        # 校验整个固件时需要读一遍flash
+        ans = self.request(FINISH, 0, len(image), zlib.crc32(image),
+                           timeout=self.timeout * 10)
+        if ans[0] != FINISH | ACK:
+            raise UpdateError("image crc mismatch")
+        elapsed = time.monotonic() - begin
+
+        if jump:
+            self.request(JUMP)
+
+        return {"board": self.board_id, "window": window,
+                "blocks": len(blocks), "skipped": len(skip),
+                "resend": resend, "bytes": sent, "seconds": elapsed,
+                "kbps": len(image) / 1000.0 / elapsed}
+
+
+class SimDevice(threading.Thread):
+    """按固件中UartUpdate::Stream的逻辑模拟设备，flash写入用sleep代替"""
+
+    def __init__(self, sock, flash, block, window, flash_ms, stop_after=None):
+        super().__init__(daemon=True)
+        self.sock = sock
+        self.flash = flash
+        self.block = block
+        self.window = window
+        self.flash_ms = flash_ms
+        self.stop_after = stop_after
+        self.slots = []
+        self.programmed = 0
+
+    def recv(self, size):
+        data = b""
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise EOFError
+            data += chunk
+        return data
+
+    def reply(self, kind, index=0, length=0, crc=0):
+        self.sock.sendall(frame(kind, index, length, crc))
+
+    def crc(self, offset, length):
+        return zlib.crc32(bytes(self.flash[offset:offset + length]))
+
+    def program(self):
+        (_, index, length, crc), data = self.slots.pop(0)
+        if zlib.crc32(data) != crc:
+            self.reply(DATA | NAK, index, length, crc)
+            return
+        time.sleep(self.flash_ms / 1000.0)
+        offset = index * self.block
+        self.flash[offset:offset + self.block] = \
+            data + b"\xff" * (self.block - length)
+        self.reply(DATA | ACK, index, length, self.crc(offset, length))
+        self.programmed += 1
+        if self.stop_after and self.programmed >= self.stop_after:
+            raise EOFError
+
+    def read_frame(self):
+        raw = self.recv(4)
+        while struct.unpack("<I", raw)[0] != MAGIC:
+            raw = raw[1:] + self.recv(1)
+        return FRAME.unpack(raw + self.recv(FRAME.size - 4))[1:]
+
+    def run(self):
+        try:
+            while self.recv(1) != STREAM_KEY:
+                pass
+            self.loop()
+        except (EOFError, OSError):
+            pass
+        self.sock.close()
+
+    def loop(self):
+        app_size = len(self.flash)
+        while True:
+            idle = not select.select([self.sock], [], [], 0)[0]
+            if len(self.slots) == self.window or (self.slots and idle):
+                self.program()
+                continue
+
+            kind, index, length, crc = self.read_frame()
+            if kind == INFO:
+                self.reply(INFO | ACK, 0x01, self.block, self.window)
+            elif kind == DATA:
+                if length > self.block or index >= app_size // self.block:
+                    self.reply(DATA | NAK, index, length, crc)
+                else:
+                    self.slots.append(((kind, index, length, crc),
+                                       self.recv(length)))
+            elif kind == QUERY:
+                while self.slots:
+                    self.program()
+                self.reply(QUERY | ACK, index, length,
+                           self.crc(index * self.block, length))
+            elif kind == FINISH:
+                while self.slots:
+                    self.program()
+                ok = length <= app_size and self.crc(0, length) == crc
+                self.reply(FINISH | (ACK if ok else NAK), 0, length, crc)
+            elif kind == JUMP:
+                self.reply(JUMP | ACK)
+                return
+            else:
+                self.reply(kind | NAK, index, length, crc)
+
+
+def loopback(image, args):
+    """同一个固件分别用停等和窗口方式升级，再模拟中断后续传"""
+    flash = bytearray(b"\xff" * max(len(image), args.block) * 2)
+
+    def run(window, resume=False, stop_after=None):
+        host, dev = socket.socketpair()
+        device = SimDevice(dev, flash, args.block, args.window,
+                           args.flash_ms, stop_after)
+        device.start()
+        link = SocketLink(host, args.rate)
+        try:
+            return Updater(link, timeout=0.5).update(image, window, resume)
+        finally:
+            link.close()
+            device.join()
+
+    def show(name, result):
+        print("%-14s %4d blocks %4d skipped %3d resend %8.1f KB/s" %
+              (name, result["blocks"], result["skipped"], result["resend"],
+               result["kbps"]))
+
+    show("stop-and-wait", run(1))
+    flash[:] = b"\xff" * len(flash)
+    show("window %d" % args.window, run(args.window))
+
+    flash[:] = b"\xff" * len(flash)
+    half = (len(image) // args.block) // 2
+    try:
+        run(args.window, stop_after=max(half, 1))
+    except (UpdateError, OSError):
+        pass
+    show("resume", run(args.window, resume=True))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="stream firmware update")
+    parser.add_argument("port", nargs="?", help="USB虚拟串口")
+    parser.add_argument("image", help="APP固件bin文件")
+    parser.add_argument("--window", type=int, help="在途块数，默认与设备一致")
+    parser.add_argument("--resume", action="store_true",
+                        help="跳过flash中已经一致的块")
+    parser.add_argument("--jump", action="store_true", help="完成后跳转APP")
+    parser.add_argument("--loopback", action="store_true",
+                        help="不连接设备，用模拟设备测试速度")
+    parser.add_argument("--block", type=int, default=2048,
+                        help="模拟设备的块大小")
+    parser.add_argument("--rate", type=float, default=800.0,
+                        help="模拟链路带宽(KB/s)，0为不限制")
+    parser.add_argument("--flash-ms", type=float, default=10.0,
+                        help="模拟设备写入一块的时间(ms)")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    if args.loopback:
+        args.window = args.window or 4
+        loopback(image, args)
+        return
+
+    if args.port is None:
+        parser.error("port is required without --loopback")
+
+    link = TtyLink(args.port)
+    try:
+        result = Updater(link).update(image, args.window, args.resume,
+                                      args.jump)
+    except UpdateError as err:
+        sys.exit("update failed: %s" % err)
+    finally:
+        link.close()
+
+    print("board 0x%02x, %d blocks, %d skipped, %d resend, %.1f KB/s" %
+          (result["board"], result["blocks"], result["skipped"],
+           result["resend"], result["kbps"]))
+
+
+if __name__ == "__main__":
+    main()